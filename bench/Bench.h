@@ -0,0 +1,106 @@
+/**
+ * @file Bench.h
+ * @brief Minimal micro-benchmark harness for the host (`native`) build.
+ *
+ * Each suite measures the cost per call of one part of the processing
+ * pipeline using the stand-in drivers from lib/NativeHal. Results are printed
+ * as one line per case so they can be diffed between commits. Suites may
+ * also check hard bounds with bench::fail(), which makes the program exit
+ * with a non-zero status.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+
+namespace bench {
+
+/**
+ * Prevent the optimiser from discarding a value computed inside a measured
+ * loop.
+ */
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** Set once any suite detects a violated bound; makes the program fail. */
+inline bool g_failed = false;
+
+/**
+ * Report a violated bound (e.g. a hot path that blocks or allocates). The
+ * benchmark program exits with a non-zero status at the end of the run.
+ */
+inline void fail(const char *what) {
+    printf("FAIL: %s\n", what);
+    g_failed = true;
+}
+
+/**
+ * Heap allocations made by the whole program since start, counted by the
+ * replacement operator new in bench_heap.cpp.
+ */
+uint64_t allocations();
+
+/** Print the heading of a benchmark suite. */
+inline void suite(const char *name) {
+    printf("\n[%s]\n", name);
+    printf("%-40s %14s %12s\n", "case", "ns/call", "calls");
+}
+
+/** Print one result row. */
+inline void report(const char *name, double nsPerCall, uint64_t iterations) {
+    printf("%-40s %14.1f %12llu\n", name, nsPerCall,
+           static_cast<unsigned long long>(iterations));
+}
+
+/**
+ * Run @p fn @p iterations times (after a short warm-up) and report the mean
+ * wall-clock cost per call.
+ *
+ * @return Mean cost per call in nanoseconds
+ */
+template <typename Fn>
+double measure(const char *name, uint64_t iterations, Fn fn) {
+    for (uint64_t i = 0; i < iterations / 10 + 1; ++i) {
+        fn(i);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        fn(i);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    const double perCall = ns / static_cast<double>(iterations);
+    report(name, perCall, iterations);
+    return perCall;
+}
+
+} // namespace bench
+
+// Suites, one per translation unit
+void benchFilters();
+void benchAlerts();
+void benchUploads();
+void benchDisplay();
+void benchPipeline();
+void benchWiFi();
+void benchStorage();
+void benchHeap();
+void benchPower();
+void benchLight();
+void benchDht();
+void benchRegistry();
+void benchHistory();
+void benchMetrics();
+void benchProfiler();
+void benchLog();
+void benchSampling();
+void benchDelta();
+void benchQos();
+
+#endif // BENCH_H
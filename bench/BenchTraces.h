@@ -0,0 +1,211 @@
+/**
+ * @file BenchTraces.h
+ * @brief Day-long synthetic site traces shared by the replay suites.
+ *
+ * A trace is the true signal of the three standard channels at
+ * one-second resolution, with the events (doors, lamps, vents,
+ * irrigation, clouds) that happened on that day. TraceSensor stands in
+ * for the DHT or the LDR and returns the signal at the replay's current
+ * second with the sensor's noise and resolution.
+ */
+
+#ifndef BENCH_TRACES_H
+#define BENCH_TRACES_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "config.h"
+#include "sensors/Sensor.h"
+
+namespace traces {
+
+inline constexpr size_t kChannels = 3;
+inline constexpr uint32_t kDaySeconds = 24u * 3600u;
+
+inline const ChannelSpec kSpecs[kChannels] = {
+    {"Temp", "t", "C", 1, TEMP_MIN_VALID, TEMP_MAX_VALID},
+    {"Humid", "h", "%", 0, HUMID_MIN_VALID, HUMID_MAX_VALID},
+    {"Light", "l", "mV", 0, LIGHT_MIN_VALID, LIGHT_MAX_VALID},
+};
+
+/** Small deterministic generator so traces are identical on every run. */
+struct Noise {
+    uint32_t state;
+    float uniform() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / 16777216.0f;
+    }
+    float gauss() { return uniform() + uniform() + uniform() - 1.5f; }
+};
+
+struct Event {
+    size_t channel;
+    uint32_t start;   ///< Second of the day
+};
+
+struct Trace {
+    const char *name;
+    std::vector<float> truth[kChannels];   ///< One value per second
+    std::vector<Event> events;
+    float tempStep;                        ///< DHT resolution, 0 for recorded values
+    float humidStep;
+    float lightNoise;                      ///< LDR noise (standard deviation in mV)
+};
+
+inline float quantize(float value, float step) {
+    return step > 0.0f ? roundf(value / step) * step : value;
+}
+
+/** 0 before @p start, rising to 1 with @p tauIn, decaying with @p tauOut after @p length. */
+inline float pulse(float t, float start, float length, float tauIn, float tauOut) {
+    if (t < start) {
+        return 0.0f;
+    }
+    if (t < start + length) {
+        return 1.0f - expf(-(t - start) / tauIn);
+    }
+    const float peak = 1.0f - expf(-length / tauIn);
+    return peak * expf(-(t - start - length) / tauOut);
+}
+
+inline float hours(float h) { return h * 3600.0f; }
+
+/** Diurnal temperature, humidity and daylight on the LDR. */
+inline void diurnal(float t, float meanTemp, float tempSwing, float daylight, float *values) {
+    const float day = t / kDaySeconds * 2.0f * static_cast<float>(M_PI);
+    values[0] = meanTemp - tempSwing * cosf(day);
+    values[1] = 48.0f + 6.0f * cosf(day);
+    const float sun = sinf(day - 0.3f);
+    values[2] = sun > 0.0f ? daylight * sun + 300.0f : 300.0f;
+}
+
+/** An office on a day nobody comes in: DHT11, slow drift only. */
+inline Trace quietOffice() {
+    Trace trace = {"office, quiet day", {}, {}, 1.0f, 1.0f, 6.0f};
+    for (uint32_t s = 0; s < kDaySeconds; ++s) {
+        float v[kChannels];
+        diurnal(static_cast<float>(s), 21.0f, 2.5f, 1200.0f, v);
+        for (size_t c = 0; c < kChannels; ++c) {
+            trace.truth[c].push_back(v[c]);
+        }
+    }
+    return trace;
+}
+
+/** A working day: lamps switched on and off, a door opened twice. */
+inline Trace busyOffice() {
+    Trace trace = {"office, lamps and door", {}, {}, 1.0f, 1.0f, 6.0f};
+    // Odd times, so fixed reads do not line up with the events
+    const float lamps[][2] = {{7.52f, 12.07f}, {13.03f, 18.49f}};
+    const float doors[] = {10.01f, 15.04f};
+    for (const auto &on : lamps) {
+        trace.events.push_back({2, static_cast<uint32_t>(hours(on[0]))});
+        trace.events.push_back({2, static_cast<uint32_t>(hours(on[1]))});
+    }
+    for (float door : doors) {
+        trace.events.push_back({0, static_cast<uint32_t>(hours(door))});
+    }
+    for (uint32_t s = 0; s < kDaySeconds; ++s) {
+        const float t = static_cast<float>(s);
+        float v[kChannels];
+        diurnal(t, 21.0f, 2.5f, 1200.0f, v);
+        for (const auto &on : lamps) {
+            if (t >= hours(on[0]) && t < hours(on[1])) {
+                v[2] += 900.0f;
+            }
+        }
+        for (float door : doors) {
+            // Three minutes open: the room cools and takes in damp air
+            const float open = pulse(t, hours(door), 180.0f, 60.0f, 600.0f);
+            v[0] -= 3.0f * open;
+            v[1] += 8.0f * open;
+        }
+        for (size_t c = 0; c < kChannels; ++c) {
+            trace.truth[c].push_back(v[c]);
+        }
+    }
+    return trace;
+}
+
+/** A greenhouse: DHT22, vents, irrigation and passing clouds. */
+inline Trace greenhouse() {
+    Trace trace = {"greenhouse, vents", {}, {}, 0.1f, 0.1f, 4.0f};
+    const float vents[] = {11.02f, 13.51f, 15.03f};
+    const float irrigation[] = {6.01f, 18.04f};
+    const float clouds[][2] = {{9.2f, 240.0f}, {10.7f, 120.0f}, {12.3f, 400.0f}, {14.1f, 180.0f}};
+    for (float vent : vents) {
+        trace.events.push_back({0, static_cast<uint32_t>(hours(vent))});
+    }
+    for (float water : irrigation) {
+        trace.events.push_back({1, static_cast<uint32_t>(hours(water))});
+    }
+    for (const auto &cloud : clouds) {
+        trace.events.push_back({2, static_cast<uint32_t>(hours(cloud[0]))});
+    }
+    for (uint32_t s = 0; s < kDaySeconds; ++s) {
+        const float t = static_cast<float>(s);
+        float v[kChannels];
+        diurnal(t, 24.0f, 6.0f, 3000.0f, v);
+        for (float vent : vents) {
+            v[0] -= 4.0f * pulse(t, hours(vent), 600.0f, 90.0f, 900.0f);
+        }
+        for (float water : irrigation) {
+            v[1] += 20.0f * pulse(t, hours(water), 300.0f, 30.0f, 1200.0f);
+        }
+        for (const auto &cloud : clouds) {
+            v[2] -= 0.5f * (v[2] - 300.0f) * pulse(t, hours(cloud[0]), cloud[1], 5.0f, 5.0f);
+        }
+        for (size_t c = 0; c < kChannels; ++c) {
+            trace.truth[c].push_back(v[c]);
+        }
+    }
+    return trace;
+}
+
+/** The trace value at the replay's current second, as a sensor reads it. */
+class TraceSensor : public Sensor {
+public:
+    TraceSensor(const Trace &trace, size_t first, size_t count, uint32_t seed)
+        : _trace(trace), _first(first), _count(count), _noise{seed}, _second(0) {}
+
+    void setSecond(size_t second) { _second = second; }
+
+    size_t channelCount() const override { return _count; }
+    const ChannelSpec &channel(size_t index) const override { return kSpecs[_first + index]; }
+
+    void sample(float *values) override {
+        for (size_t i = 0; i < _count; ++i) {
+            const size_t c = _first + i;
+            const float truth = _trace.truth[c][_second];
+            if (_trace.tempStep == 0.0f) {
+                values[i] = truth;   // recorded: replay as is
+                continue;
+            }
+            switch (c) {
+            case 0:
+                values[i] = quantize(truth + 0.15f * _noise.gauss(), _trace.tempStep);
+                break;
+            case 1:
+                values[i] = quantize(truth + 0.6f * _noise.gauss(), _trace.humidStep);
+                break;
+            default:
+                values[i] = roundf(truth + 2.0f * _trace.lightNoise * _noise.gauss());
+                break;
+            }
+        }
+    }
+
+private:
+    const Trace &_trace;
+    size_t _first;
+    size_t _count;
+    Noise _noise;
+    size_t _second;
+};
+
+} // namespace traces
+
+#endif // BENCH_TRACES_H
@@ -0,0 +1,251 @@
+/**
+ * @file bench_alerts.cpp
+ * @brief Alert rule evaluation: cost per sample and crossing-to-LED latency.
+ *
+ * The cost cases run the node's rule table through AlertManager and
+ * generated tables of 32 and 128 rules through a bare AlertEngine. The
+ * behaviour cases drive the virtual clock at SENSOR_READ_INTERVAL and read
+ * the LED back from the stand-in GPIO: a step through the moving average
+ * (latency), noise around a threshold (flapping, against a rule without
+ * hysteresis or debounce), several alerts at once, a temperature ramp
+ * for the rate rule, and light reads between two temperature reads, which
+ * must not count towards the temperature rule's debounce.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "utils/AlertEngine.h"
+#include "utils/AlertManager.h"
+#include "utils/DataFilter.h"
+
+namespace {
+
+const size_t kChannels = 16;
+
+template <size_t N>
+struct RuleTable {
+    AlertRule rules[N];
+};
+
+/** N rules over kChannels channels, cycling through all four conditions. */
+template <size_t N>
+constexpr RuleTable<N> makeRules() {
+    RuleTable<N> table = {};
+    for (size_t i = 0; i < N; ++i) {
+        const uint8_t channel = static_cast<uint8_t>(i % kChannels);
+        const float offset = static_cast<float>(i / kChannels);
+        switch (i % 4) {
+        case 0:
+            table.rules[i] = alertAbove(channel, 30.0f + offset, 0.5f, 2, 1);
+            break;
+        case 1:
+            table.rules[i] = alertBelow(channel, 10.0f - offset, 0.5f, 2, 2);
+            break;
+        case 2:
+            table.rules[i] = alertRising(channel, 0.5f, 0.1f, 10000, 2, 3);
+            break;
+        default:
+            table.rules[i] = alertFalling(channel, -0.5f, 0.1f, 10000, 2, 4);
+            break;
+        }
+    }
+    return table;
+}
+
+constexpr RuleTable<32> kRules32 = makeRules<32>();
+constexpr RuleTable<128> kRules128 = makeRules<128>();
+static_assert(alertRulesValid(kRules128.rules), "Generated rules are invalid");
+
+/** ns per sample of @p N rules on a row that moves around the thresholds. */
+template <size_t N>
+double engineCost(const RuleTable<N> &table) {
+    AlertEngine<N> engine(table.rules);
+    float row[kChannels];
+    char name[48];
+    snprintf(name, sizeof(name), "AlertEngine::update (%u rules)", static_cast<unsigned>(N));
+    return bench::measure(name, 200000, [&](uint64_t i) {
+        for (size_t c = 0; c < kChannels; ++c) {
+            row[c] = 20.0f + static_cast<float>((i * 7 + c * 3) % 32);
+        }
+        bench::doNotOptimize(
+            engine.update(row, kChannels, static_cast<uint32_t>(i * SENSOR_READ_INTERVAL)));
+    });
+}
+
+struct Latency {
+    uint32_t filterMs;  ///< Raw step to the moving average crossing the threshold
+    uint32_t ledMs;     ///< Moving average crossing to the LED turning on
+};
+
+/** Step the raw temperature from 22 to 35 C and time the LED through the filter. */
+Latency stepLatency() {
+    hal::setMillis(0);
+    AlertManager alerts;
+    alerts.begin();
+    DataFilter<FILTER_WINDOW_SIZE> filter;
+    uint32_t stepAt = 0;
+    uint32_t crossedAt = 0;
+    uint32_t ledAt = 0;
+    for (int i = 0; i < 100 && ledAt == 0; ++i) {
+        hal::advanceMillis(SENSOR_READ_INTERVAL);
+        const uint32_t now = millis();
+        const float raw = i < 20 ? 22.0f : 35.0f;
+        if (i == 20) {
+            stepAt = now;
+        }
+        filter.addValue(raw);
+        const float t = filter.getAverage();
+        if (crossedAt == 0 && t >= TEMP_HIGH_THRESHOLD) {
+            crossedAt = now;
+        }
+        alerts.update(t, 50.0f, 2000, now);
+        if (hal::pinLevel(LED_ALERT_PIN) == HIGH) {
+            ledAt = now;
+        }
+    }
+    return Latency{crossedAt - stepAt, ledAt - crossedAt};
+}
+
+/** LED toggles over 1000 samples of 30 C +- 0.3 C noise. */
+template <size_t N>
+uint32_t flaps(const AlertRule (&rules)[N]) {
+    AlertEngine<N> engine(rules);
+    uint32_t seed = 12345;
+    uint32_t toggles = 0;
+    bool led = false;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const float noise = (static_cast<float>(seed >> 8) / 16777216.0f - 0.5f) * 0.6f;
+        const float row[3] = {TEMP_HIGH_THRESHOLD + noise, 50.0f, 2000.0f};
+        engine.update(row, 3, i * SENSOR_READ_INTERVAL);
+        if (engine.any() != led) {
+            led = engine.any();
+            ++toggles;
+        }
+    }
+    return toggles;
+}
+
+constexpr AlertRule kBareThreshold[] = {
+    alertAbove(CHANNEL_TEMPERATURE, TEMP_HIGH_THRESHOLD, 0.0f, 1, ALERT_TEMP_HIGH),
+};
+
+int ruleIndex(AlertState code) {
+    for (size_t i = 0; i < AlertManager::Engine::ruleCount(); ++i) {
+        if (kAlertRules[i].code == code) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool maskHas(uint32_t mask, AlertState code) {
+    const int rule = ruleIndex(code);
+    return rule >= 0 && ((mask >> rule) & 1) != 0;
+}
+
+} // namespace
+
+void benchAlerts() {
+    bench::suite("alerts");
+    AlertManager alerts;
+    alerts.begin();
+    bench::measure("AlertManager::update (ok)", 1000000, [&](uint64_t i) {
+        bench::doNotOptimize(
+            alerts.update(22.0f, 50.0f, 2000, static_cast<uint32_t>(i * SENSOR_READ_INTERVAL)));
+    });
+    bench::measure("AlertManager::update (alternating)", 1000000, [&](uint64_t i) {
+        const float t = (i & 1) ? 35.0f : 22.0f;
+        bench::doNotOptimize(
+            alerts.update(t, 50.0f, 2000, static_cast<uint32_t>(i * SENSOR_READ_INTERVAL)));
+    });
+    const double ns32 = engineCost(kRules32);
+    const double ns128 = engineCost(kRules128);
+    printf("  per rule: 32 rules %.2f ns, 128 rules %.2f ns\n", ns32 / 32, ns128 / 128);
+
+    const Latency latency = stepLatency();
+    printf("  step 22 -> 35 C: average crosses after %lu ms, LED on %lu ms later "
+           "(debounce %d x %d ms)\n",
+           static_cast<unsigned long>(latency.filterMs),
+           static_cast<unsigned long>(latency.ledMs), ALERT_DEBOUNCE_SAMPLES,
+           SENSOR_READ_INTERVAL);
+
+    const uint32_t bareFlaps = flaps(kBareThreshold);
+    const uint32_t ruleFlaps = flaps(kAlertRules);
+    printf("  30 C +- 0.3 C noise, 1000 samples: %lu LED changes without hysteresis, "
+           "%lu with the rule table\n",
+           static_cast<unsigned long>(bareFlaps), static_cast<unsigned long>(ruleFlaps));
+
+    // Several conditions at once all show in the mask
+    AlertManager multi;
+    multi.begin();
+    for (uint32_t i = 0; i < ALERT_DEBOUNCE_SAMPLES; ++i) {
+        multi.update(35.0f, 20.0f, 100, i * SENSOR_READ_INTERVAL);
+    }
+    const uint32_t mask = multi.activeMask();
+    const bool maskOk = maskHas(mask, ALERT_TEMP_HIGH) && maskHas(mask, ALERT_HUMID_LOW) &&
+                        maskHas(mask, ALERT_LIGHT_LOW) && !maskHas(mask, ALERT_TEMP_LOW) &&
+                        multi.getState() == ALERT_TEMP_HIGH &&
+                        multi.alertChannel() == CHANNEL_TEMPERATURE;
+
+    // Only the LDR is read between two DHT reads: the unchanged temperature
+    // must not be counted again
+    AlertEngine<AlertManager::Engine::ruleCount()> partial(kAlertRules);
+    const float hot[3] = {35.0f, 50.0f, 2000.0f};
+    const ChannelMask lightOnly = ChannelMask(1) << CHANNEL_LIGHT;
+    uint32_t samplesToAlert = 0;
+    for (uint32_t i = 0; i < 10 && !partial.active(ruleIndex(ALERT_TEMP_HIGH)); ++i) {
+        const ChannelMask sampled = i % 4 == 0 ? CHANNEL_MASK_ALL : lightOnly;
+        partial.update(hot, 3, i * SENSOR_READ_INTERVAL, sampled);
+        samplesToAlert += sampled == CHANNEL_MASK_ALL ? 1 : 0;
+    }
+    printf("  temperature read every 4th sample: alert after %lu temperature samples\n",
+           static_cast<unsigned long>(samplesToAlert));
+
+    // 4 C/min ramp from 18 C: the rate rule fires well before the level rule
+    AlertManager ramp;
+    ramp.begin();
+    uint32_t risingAt = 0;
+    uint32_t highAt = 0;
+    uint32_t clearedAt = 0;
+    for (uint32_t now = 0; now <= 600000; now += SENSOR_READ_INTERVAL) {
+        const float t = 18.0f + 4.0f / 60000.0f * static_cast<float>(now < 240000 ? now : 240000);
+        ramp.update(t, 50.0f, 2000, now);
+        const uint32_t m = ramp.activeMask();
+        if (risingAt == 0 && maskHas(m, ALERT_TEMP_RISING)) {
+            risingAt = now;
+        }
+        if (highAt == 0 && maskHas(m, ALERT_TEMP_HIGH)) {
+            highAt = now;
+        }
+        if (risingAt != 0 && clearedAt == 0 && !maskHas(m, ALERT_TEMP_RISING)) {
+            clearedAt = now;
+        }
+    }
+    printf("  4 C/min ramp from 18 C: rising alert at %lu s, high at %lu s, "
+           "rising cleared at %lu s (ramp ends at 240 s)\n",
+           static_cast<unsigned long>(risingAt / 1000), static_cast<unsigned long>(highAt / 1000),
+           static_cast<unsigned long>(clearedAt / 1000));
+
+    if (ns128 / 128 > 2.0 * (ns32 / 32)) {
+        bench::fail("Alert evaluation cost per rule grows with the table size");
+    }
+    if (latency.ledMs != (ALERT_DEBOUNCE_SAMPLES - 1) * SENSOR_READ_INTERVAL) {
+        bench::fail("LED did not follow the crossing after exactly the debounce samples");
+    }
+    if (ruleFlaps > 1 || bareFlaps <= ruleFlaps) {
+        bench::fail("Alert LED flaps at the threshold");
+    }
+    if (!maskOk) {
+        bench::fail("Active mask does not hold every active alert");
+    }
+    if (samplesToAlert != ALERT_DEBOUNCE_SAMPLES) {
+        bench::fail("Reads of other channels counted towards an alert's debounce");
+    }
+    if (risingAt == 0 || risingAt >= highAt || clearedAt <= 240000) {
+        bench::fail("Rate rule did not fire on the ramp or clear after it");
+    }
+}
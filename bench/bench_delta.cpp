@@ -0,0 +1,259 @@
+/**
+ * @file bench_delta.cpp
+ * @brief Uplink messages saved by reporting on delta, and what it costs.
+ *
+ * The day-long site traces of BenchTraces.h are sampled every
+ * SENSOR_READ_INTERVAL into a SensorRegistry, and every
+ * CLOUD_UPLOAD_INTERVAL its channels go to CloudUploader::uploadChannels()
+ * with the MQTT stand-in as the broker, once sending every reading and
+ * once reporting on delta. A consumer behind the broker keeps the last
+ * received value of each channel. The suite reports data messages and
+ * payload bytes per node and day, the sent/suppressed/heartbeat counters,
+ * the largest difference between the consumer's value and the node's
+ * filtered value at each upload, and the longest silence. It fails if the
+ * difference exceeds a channel's deadband (plus the rounding of the
+ * payload), if the node is silent for longer than the heartbeat interval,
+ * or if the quiet day does not shrink traffic at least fivefold.
+ *
+ * A last case changes the values while the broker is down: the failed
+ * frame must not count as reported, so the change goes out as soon as
+ * the broker is back instead of waiting for the heartbeat.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Bench.h"
+#include "BenchTraces.h"
+#include "NativeHal.h"
+#include "connectivity/CloudUploader.h"
+#include "connectivity/DeltaReporter.h"
+#include "sensors/SensorRegistry.h"
+
+namespace {
+
+using namespace traces;
+
+typedef SensorRegistry<SENSOR_MAX_CHANNELS, SENSOR_MAX_SENSORS> BenchRegistry;
+
+/** What a subscriber to MQTT_TOPIC_DATA knows about the node. */
+struct Consumer {
+    float values[kChannels];
+    uint32_t messages;
+    uint64_t bytes;
+    uint32_t lastMessageMs;
+};
+
+Consumer s_consumer;
+
+/** Update the consumer from a JSON channel frame; absent keys keep their value. */
+void onPublish(const char *topic, const uint8_t *payload, size_t length) {
+    if (strcmp(topic, MQTT_TOPIC_DATA) != 0) {
+        return;
+    }
+    char text[MQTT_CHANNEL_PAYLOAD_MAX + 1];
+    length = length < MQTT_CHANNEL_PAYLOAD_MAX ? length : MQTT_CHANNEL_PAYLOAD_MAX;
+    memcpy(text, payload, length);
+    text[length] = '\0';
+    for (size_t c = 0; c < kChannels; ++c) {
+        char key[16];
+        snprintf(key, sizeof(key), "\"%s\":", kSpecs[c].key);
+        const char *at = strstr(text, key);
+        if (at) {
+            at += strlen(key);
+            s_consumer.values[c] = strncmp(at, "null", 4) == 0 ? NAN : strtof(at, nullptr);
+        }
+    }
+    ++s_consumer.messages;
+    s_consumer.bytes += strlen(topic) + length;
+    s_consumer.lastMessageMs = millis();
+}
+
+struct Result {
+    UploadStats stats;
+    uint32_t messages;
+    uint64_t bytes;
+    float maxError[kChannels];   ///< Consumer value against the filtered value
+    uint32_t maxSilenceMs;
+};
+
+/** One day of @p trace through the registry and the uploader. */
+Result replay(const Trace &trace, bool onDelta) {
+    BenchRegistry registry;
+    TraceSensor dht(trace, 0, 2, 7);
+    TraceSensor ldr(trace, 2, 1, 11);
+    registry.add(dht);
+    registry.add(ldr);
+
+    CloudUploader uploader;
+    uploader.setTarget(UPLOAD_MQTT);
+    uploader.begin();
+    uploader.setReportOnDelta(onDelta);
+    hal::resetStats();
+    s_consumer = Consumer{{NAN, NAN, NAN}, 0, 0, static_cast<uint32_t>(millis())};
+    hal::setMqttPublishHook(onPublish);
+
+    Result r = {};
+    const uint32_t uploadEvery = CLOUD_UPLOAD_INTERVAL / SENSOR_READ_INTERVAL;
+    const size_t seconds = trace.truth[0].size();
+    for (uint32_t tick = 0; tick * (SENSOR_READ_INTERVAL / 1000) < seconds; ++tick) {
+        const size_t second = tick * (SENSOR_READ_INTERVAL / 1000);
+        dht.setSecond(second);
+        ldr.setSecond(second);
+        registry.sample();
+        if (tick % uploadEvery == 0) {
+            uploader.uploadChannels(registry.view());
+            while (uploader.process()) {
+            }
+            for (size_t c = 0; c < kChannels; ++c) {
+                const float error = fabsf(s_consumer.values[c] - registry.average(c));
+                if (error > r.maxError[c]) {
+                    r.maxError[c] = error;
+                }
+            }
+            const uint32_t silence = millis() - s_consumer.lastMessageMs;
+            r.maxSilenceMs = silence > r.maxSilenceMs ? silence : r.maxSilenceMs;
+        }
+        hal::advanceMillis(SENSOR_READ_INTERVAL);
+    }
+    hal::setMqttPublishHook(nullptr);
+    r.stats = uploader.getStats();
+    r.messages = s_consumer.messages;
+    r.bytes = s_consumer.bytes;
+    return r;
+}
+
+void print(const char *mode, const Result &r) {
+    printf("  %-9s %6u %8llu  %6u %6u %4u  %5.2f %5.2f %6.1f  %6.1f\n", mode,
+           static_cast<unsigned>(r.messages), static_cast<unsigned long long>(r.bytes),
+           static_cast<unsigned>(r.stats.sent), static_cast<unsigned>(r.stats.suppressed),
+           static_cast<unsigned>(r.stats.heartbeats), r.maxError[0], r.maxError[1],
+           r.maxError[2], r.maxSilenceMs / 60000.0);
+}
+
+/** Replay both ways and check the deadband and heartbeat guarantees. */
+void compare(const Trace &trace, bool checkReduction) {
+    printf("\n  %s\n", trace.name);
+    const Result all = replay(trace, false);
+    const Result delta = replay(trace, true);
+    print("every", all);
+    print("on delta", delta);
+    const double factor = delta.messages > 0 ? static_cast<double>(all.messages) / delta.messages
+                                             : 0.0;
+    // A fleet of 1000 nodes as the broker sees it
+    printf("  %.1fx fewer messages; 1000 nodes: %.1f -> %.1f msg/s\n", factor,
+           all.messages * 1000.0 / kDaySeconds, delta.messages * 1000.0 / kDaySeconds);
+
+    char what[128];
+    for (size_t c = 0; c < kChannels; ++c) {
+        float deadband = 0.0f;
+        for (const DeltaRule &rule : kDeltaRules) {
+            deadband = rule.channel == c ? rule.deadband : deadband;
+        }
+        // JSON carries two decimals, or whole numbers for channels shown without
+        const float rounding = kSpecs[c].decimals == 0 ? 0.5f : 0.005f;
+        if (!(delta.maxError[c] <= deadband + rounding + 1e-3f)) {
+            snprintf(what, sizeof(what), "%s: consumer %s off by %.2f (deadband %.2f)",
+                     trace.name, kSpecs[c].label, delta.maxError[c], deadband);
+            bench::fail(what);
+        }
+    }
+    if (delta.maxSilenceMs > REPORT_HEARTBEAT_INTERVAL + CLOUD_UPLOAD_INTERVAL) {
+        snprintf(what, sizeof(what), "%s: silent for %lu ms", trace.name,
+                 static_cast<unsigned long>(delta.maxSilenceMs));
+        bench::fail(what);
+    }
+    if (delta.stats.sent != delta.messages || delta.stats.sent + delta.stats.suppressed !=
+                                                  all.stats.sent) {
+        snprintf(what, sizeof(what), "%s: sent and suppressed do not add up", trace.name);
+        bench::fail(what);
+    }
+    if (checkReduction && factor < 5.0) {
+        snprintf(what, sizeof(what), "%s: only %.1fx fewer messages", trace.name, factor);
+        bench::fail(what);
+    }
+}
+
+/** Uploads until the consumer has the change made during a broker outage. */
+void changeDuringOutage() {
+    BenchRegistry registry;
+    for (size_t c = 0; c < kChannels; ++c) {
+        registry.addChannel(kSpecs[c]);
+    }
+    CloudUploader uploader;
+    uploader.setTarget(UPLOAD_MQTT);
+    uploader.begin();
+    uploader.setReportOnDelta(true);
+    s_consumer = Consumer{{NAN, NAN, NAN}, 0, 0, static_cast<uint32_t>(millis())};
+    hal::setMqttPublishHook(onPublish);
+
+    const float before[kChannels] = {21.0f, 48.0f, 1200.0f};
+    const float after[kChannels] = {25.0f, 48.0f, 1200.0f};
+    for (size_t w = 0; w < FILTER_WINDOW_SIZE; ++w) {
+        registry.addSamples(before);
+    }
+    uploader.uploadChannels(registry.view());
+    while (uploader.process()) {
+    }
+    hal::setMqttAvailable(false);
+    for (size_t w = 0; w < FILTER_WINDOW_SIZE; ++w) {
+        registry.addSamples(after);
+    }
+    uploader.uploadChannels(registry.view());
+    while (uploader.process()) {
+    }
+    const UploadStats down = uploader.getStats();
+    hal::setMqttAvailable(true);
+    uint32_t waitedMs = 0;
+    while (fabsf(s_consumer.values[0] - after[0]) > TEMP_DEADBAND &&
+           waitedMs < REPORT_HEARTBEAT_INTERVAL) {
+        hal::advanceMillis(CLOUD_UPLOAD_INTERVAL);
+        waitedMs += CLOUD_UPLOAD_INTERVAL;
+        uploader.uploadChannels(registry.view());
+        while (uploader.process()) {
+        }
+    }
+    hal::setMqttPublishHook(nullptr);
+    printf("  change made while the broker was down: %u failed, consumer updated after %.1f min\n",
+           static_cast<unsigned>(down.failed), waitedMs / 60000.0);
+    if (down.failed == 0 || waitedMs >= REPORT_HEARTBEAT_INTERVAL) {
+        bench::fail("A change whose send failed was suppressed until the heartbeat");
+    }
+}
+
+} // namespace
+
+void benchDelta() {
+    bench::suite("delta");
+    hal::setWiFiAvailable(true);
+    hal::setMqttAvailable(true);
+    WiFi.begin("bench");
+    hal::advanceMillis(60000);
+
+    printf("  %-9s %6s %8s  %6s %6s %4s  %-19s  %s\n", "mode", "msgs", "bytes", "sent",
+           "supp", "hb", "max error t/h/l", "max silence (min)");
+    compare(quietOffice(), true);
+    compare(busyOffice(), false);
+    compare(greenhouse(), false);
+    changeDuringOutage();
+
+    // Per-upload cost of the deadband test when nothing goes out
+    BenchRegistry registry;
+    for (size_t c = 0; c < kChannels; ++c) {
+        registry.addChannel(kSpecs[c]);
+    }
+    const float row[kChannels] = {21.0f, 48.0f, 1200.0f};
+    registry.addSamples(row);
+    CloudUploader uploader;
+    uploader.setTarget(UPLOAD_MQTT);
+    uploader.begin();
+    uploader.setReportOnDelta(true);
+    uploader.uploadChannels(registry.view());
+    while (uploader.process()) {
+    }
+    bench::measure("uploadChannels, suppressed", 1000000, [&](uint64_t) {
+        uploader.uploadChannels(registry.view());
+    });
+}
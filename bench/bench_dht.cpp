@@ -0,0 +1,214 @@
+/**
+ * @file bench_dht.cpp
+ * @brief DHT frame decoding and the CPU cost of a read.
+ *
+ * Captures are pulse trains built from datasheet timing (80/80 us
+ * response, 50 us bit lows, 26 or 70 us bit highs) with a few
+ * microseconds of spread, plus the faults seen on real wiring: a bad
+ * checksum, a truncated frame, a glitch and noise before the response.
+ * Each is decoded directly and through the RMT driver, which replays it
+ * via hal::setDHTCapture(). The bit-banged Adafruit stand-in accounts the
+ * time its driver spins on the data line, which the RMT path never does.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "sensors/DHTDecoder.h"
+#include "sensors/DHTSensor.h"
+
+namespace {
+
+const size_t kMaxCapture = 128;
+
+struct Capture {
+    uint16_t durations[kMaxCapture];
+    size_t count;
+};
+
+/** Pulse train for five frame bytes, with a small deterministic spread. */
+Capture encodeFrame(const uint8_t data[5]) {
+    static const int8_t kSpread[] = {0, 2, -1, 3, -3, 1, -2, 4};
+    Capture c;
+    c.count = 0;
+    unsigned k = 0;
+    auto push = [&](uint16_t us) { c.durations[c.count++] = us + kSpread[k++ % 8]; };
+    push(80);
+    push(80);
+    for (int bit = 0; bit < 40; ++bit) {
+        push(50);
+        push((data[bit / 8] >> (7 - bit % 8)) & 1 ? 70 : 26);
+    }
+    push(50);
+    return c;
+}
+
+Capture frame(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) {
+    const uint8_t data[5] = {b0, b1, b2, b3, static_cast<uint8_t>(b0 + b1 + b2 + b3)};
+    return encodeFrame(data);
+}
+
+struct Case {
+    const char *name;
+    uint8_t type;
+    Capture capture;
+    DHTStatus status;
+    float temperature;
+    float humidity;
+};
+
+bool matches(const DHTReading &r, const Case &c) {
+    if (r.status != c.status) {
+        return false;
+    }
+    if (c.status != DHT_OK) {
+        return isnan(r.temperature) && isnan(r.humidity);
+    }
+    return fabsf(r.temperature - c.temperature) < 0.05f && fabsf(r.humidity - c.humidity) < 0.05f;
+}
+
+bool checkCaptures() {
+    Case cases[] = {
+        {"DHT11 23.4 C 51 %", DHT11, frame(51, 0, 23, 4), DHT_OK, 23.4f, 51.0f},
+        {"DHT11 -5.3 C", DHT11, frame(30, 0, 5, 0x87), DHT_OK, -5.3f, 30.0f},
+        {"DHT22 -7.3 C 88.5 %", DHT22, frame(0x03, 0x75, 0x80, 0x49), DHT_OK, -7.3f, 88.5f},
+        {"DHT22 noise before response", DHT22, frame(0x01, 0xF4, 0x00, 0xFA), DHT_OK, 25.0f,
+         50.0f},
+        {"checksum error", DHT11, frame(51, 0, 23, 4), DHT_ERROR_CHECKSUM, NAN, NAN},
+        {"truncated frame", DHT11, frame(51, 0, 23, 4), DHT_ERROR_PULSES, NAN, NAN},
+        {"glitch in bit 12", DHT11, frame(51, 0, 23, 4), DHT_ERROR_PULSES, NAN, NAN},
+    };
+    // Noise: two short pulses before the response
+    Capture &noisy = cases[3].capture;
+    memmove(noisy.durations + 2, noisy.durations, noisy.count * sizeof(uint16_t));
+    noisy.durations[0] = 12;
+    noisy.durations[1] = 200;
+    noisy.count += 2;
+    cases[4].capture.durations[2 + 2 * 39 + 1] ^= 70 ^ 26;  // flip the last checksum bit
+    cases[5].capture.count = 60;
+    cases[6].capture.durations[2 + 2 * 12 + 1] = 140;
+
+    bool ok = true;
+    printf("  %-30s %-10s %-10s %s\n", "capture", "decoded", "driver", "values");
+    for (const Case &c : cases) {
+        DHTReading direct;
+        decodeDhtPulses(c.capture.durations, c.capture.count, c.type, direct);
+
+        DHTSensor sensor(DHT_PIN, c.type);
+        sensor.begin();
+        hal::setDHTCapture(c.capture.durations, c.capture.count);
+        const DHTReading driver = sensor.read();
+
+        printf("  %-30s %-10s %-10s %.1f C %.1f %%\n", c.name, dhtStatusName(direct.status),
+               dhtStatusName(driver.status), static_cast<double>(driver.temperature),
+               static_cast<double>(driver.humidity));
+        if (!matches(direct, c) || !matches(driver, c)) {
+            ok = false;
+        }
+        hal::advanceMillis(2000);
+    }
+    return ok;
+}
+
+} // namespace
+
+void benchDht() {
+    bench::suite("dht");
+
+    const Capture sample = frame(51, 0, 23, 4);
+    DHTReading decoded;
+    const double decodeNs = bench::measure("decodeDhtPulses", 1000000, [&](uint64_t) {
+        decodeDhtPulses(sample.durations, sample.count, DHT11, decoded);
+        bench::doNotOptimize(decoded);
+    });
+
+    if (!checkCaptures()) {
+        bench::fail("DHT capture decoded wrongly");
+    }
+
+    // Simulated sensor answering the start pulse, both drivers
+    hal::setDHTType(DHT11);
+    hal::setDHTReading(21.6f, 40.0f);
+    const int kReads = 100;
+
+    DHTSensor sensor;
+    sensor.begin();
+    hal::resetStats();
+    unsigned long blockedMs = 0;
+    int good = 0;
+    for (int i = 0; i < kReads; ++i) {
+        hal::advanceMillis(SENSOR_READ_INTERVAL);
+        const unsigned long start = millis();
+        const DHTReading r = sensor.read();
+        blockedMs += millis() - start;
+        good += r.status == DHT_OK && fabsf(r.temperature - 21.6f) < 0.05f ? 1 : 0;
+    }
+    const hal::DHTBusStats rmt = hal::dhtBusStats();
+
+    // Within the sampling period: cached, no transfer
+    const unsigned long cachedStart = millis();
+    const DHTReading cached = sensor.read();
+    const bool cacheOk = millis() == cachedStart && cached.status == DHT_OK;
+
+    // Non-blocking: poll once per tick until the frame is in
+    hal::advanceMillis(SENSOR_READ_INTERVAL);
+    const unsigned long pollStart = millis();
+    int polls = 0;
+    DHTStatus polled = sensor.startRead() ? DHT_PENDING : DHT_ERROR_TIMEOUT;
+    while (polled == DHT_PENDING && polls < 100) {
+        delay(1);
+        polled = sensor.poll();
+        ++polls;
+    }
+    const unsigned long pollMs = millis() - pollStart;
+
+    DHT adafruit(DHT_PIN, DHT11);
+    adafruit.begin();
+    hal::resetStats();
+    unsigned long adafruitMs = 0;
+    for (int i = 0; i < kReads; ++i) {
+        hal::advanceMillis(SENSOR_READ_INTERVAL);
+        const unsigned long start = millis();
+        adafruit.readTemperature();
+        adafruit.readHumidity();
+        adafruitMs += millis() - start;
+    }
+    const hal::DHTBusStats bitBang = hal::dhtBusStats();
+
+    printf("  per read (DHT11)                 blocked   busy-wait     IRQ off\n");
+    printf("  RMT + decode                  %6.1f ms %8.1f us %8.1f us  (+%.2f us decode)\n",
+           static_cast<double>(blockedMs) / kReads,
+           static_cast<double>(rmt.busyWaitMicros) / kReads,
+           static_cast<double>(rmt.irqOffMicros) / kReads, decodeNs / 1000.0);
+    printf("  Adafruit bit-banging          %6.1f ms %8.1f us %8.1f us\n",
+           static_cast<double>(adafruitMs) / kReads,
+           static_cast<double>(bitBang.busyWaitMicros) / bitBang.transfers,
+           static_cast<double>(bitBang.irqOffMicros) / bitBang.transfers);
+    printf("  transfers: RMT %d reads ok, Adafruit %lu transfers for %d read pairs\n", good,
+           static_cast<unsigned long>(bitBang.transfers), kReads);
+    printf("  startRead + poll: %s after %d polls, %lu ms\n", dhtStatusName(polled), polls,
+           pollMs);
+
+    if (good != kReads) {
+        bench::fail("RMT reads of the simulated sensor failed");
+    }
+    if (rmt.busyWaitMicros != 0 || rmt.irqOffMicros != 0) {
+        bench::fail("RMT read spun on the data line");
+    }
+    if (bitBang.transfers != static_cast<uint32_t>(kReads)) {
+        bench::fail("Adafruit stand-in did not make one transfer per read pair");
+    }
+    if (decodeNs * 1e-3 * 100.0 > static_cast<double>(bitBang.busyWaitMicros) / kReads) {
+        bench::fail("Decoding costs more than 1% of bit-banging");
+    }
+    if (!cacheOk) {
+        bench::fail("Read within the sampling period started a transfer");
+    }
+    if (polled != DHT_OK) {
+        bench::fail("Non-blocking read did not complete");
+    }
+    hal::setDHTReading(22.0f, 45.0f);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file bench_display.cpp
+ * @brief Cost per call of OledDisplay::showReadings() into the fake SSD1306.
+ *
+ * Besides CPU cost, reports I2C bytes and bus time per frame for unchanged,
+ * partially changed and fully redrawn frames at several bus clocks, and
+ * checks that the simulated panel RAM always matches the rendered frame.
+ */
+
+#include <string.h>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "display/OledDisplay.h"
+
+namespace {
+
+bool panelMatches(OledDisplay &display) {
+    return memcmp(hal::ssd1306Ram(), display.frameBuffer(), OLED_WIDTH * OLED_HEIGHT / 8) == 0;
+}
+
+/** Run @p frames frames produced by @p fn and print bytes and time per frame. */
+template <typename Fn>
+void runFrames(OledDisplay &display, const char *name, uint32_t frames, Fn fn) {
+    hal::resetStats();
+    const DisplayStats before = display.getStats();
+    bool matches = true;
+    for (uint32_t i = 0; i < frames; ++i) {
+        fn(i);
+        matches &= panelMatches(display);
+    }
+    const DisplayStats &after = display.getStats();
+    printf("  %-38s %8.1f B/frame %8.1f us/frame (virtual) %5.1f%% flushed\n", name,
+           static_cast<double>(hal::i2cBytesWritten()) / frames,
+           static_cast<double>(after.totalFrameUs - before.totalFrameUs) / frames,
+           100.0 * (after.flushes - before.flushes) / frames);
+    if (static_cast<uint64_t>(hal::i2cBytesWritten()) != after.i2cBytes - before.i2cBytes) {
+        bench::fail("OledDisplay I2C byte counter disagrees with the bus");
+    }
+    if (!matches) {
+        bench::fail("Panel RAM does not match the rendered frame");
+    }
+}
+
+} // namespace
+
+void benchDisplay() {
+    bench::suite("display");
+    OledDisplay display;
+    display.begin();
+    if (!panelMatches(display)) {
+        bench::fail("Panel RAM not initialised by begin()");
+    }
+
+    const uint64_t calls = 100000;
+    bench::measure("OledDisplay::showReadings", calls, [&](uint64_t i) {
+        display.showReadings(21.5f + (i & 7) * 0.1f, 48.0f, static_cast<int>(i & 0xFFF));
+    });
+    bench::measure("OledDisplay::showReadings (unchanged)", calls, [&](uint64_t) {
+        display.showReadings(21.5f, 48.0f, 1234);
+    });
+
+    // Reference: the driver's full-frame display()
+    Adafruit_SSD1306 reference(OLED_WIDTH, OLED_HEIGHT, &Wire, -1, OLED_I2C_CLOCK,
+                               OLED_I2C_CLOCK);
+    reference.begin(SSD1306_SWITCHCAPVCC, OLED_ADDRESS ^ 1);  // off the simulated panel
+    hal::resetStats();
+    reference.display();
+    const uint64_t fullBytes = hal::i2cBytesWritten();
+    printf("  %-38s %8.1f B/frame %8.1f us/frame (virtual)\n", "full display()",
+           static_cast<double>(fullBytes), static_cast<double>(hal::i2cBusMicros()));
+
+    display.showStatus("sync");
+    const uint32_t kClocks[] = {100000, 400000, 1000000};
+    for (uint32_t clock : kClocks) {
+        char name[64];
+        display.setClock(clock);
+        printf("  I2C clock %lu Hz\n", static_cast<unsigned long>(clock));
+        snprintf(name, sizeof(name), "unchanged values");
+        runFrames(display, name, 1000, [&](uint32_t) { display.showReadings(21.5f, 48.0f, 1234); });
+        snprintf(name, sizeof(name), "light changes");
+        runFrames(display, name, 1000, [&](uint32_t i) {
+            display.showReadings(21.5f, 48.0f, 1000 + static_cast<int>(i % 50));
+        });
+        snprintf(name, sizeof(name), "all values change");
+        runFrames(display, name, 1000, [&](uint32_t i) {
+            display.showReadings(20.0f + (i % 37) * 0.1f, 40.0f + (i % 23) * 0.1f,
+                                 static_cast<int>((i * 37) & 0xFFF));
+        });
+        snprintf(name, sizeof(name), "readings / status alternate");
+        runFrames(display, name, 1000, [&](uint32_t i) {
+            if (i & 1) {
+                display.showStatus("WiFi lost");
+            } else {
+                display.showReadings(21.5f, 48.0f, 1234);
+            }
+        });
+    }
+    display.setClock(OLED_I2C_CLOCK);
+
+    display.showReadings(21.5f, 48.0f, 1234);
+    hal::resetStats();
+    for (int i = 0; i < 100; ++i) {
+        display.showReadings(21.5f, 48.0f, 1234);
+    }
+    if (hal::i2cBytesWritten() != 0) {
+        bench::fail("Unchanged frames still touch the I2C bus");
+    }
+    hal::resetStats();
+    display.showReadings(21.6f, 48.0f, 1234);
+    if (hal::i2cBytesWritten() == 0 || hal::i2cBytesWritten() >= fullBytes / 2) {
+        bench::fail("A one-digit change did not produce a small partial update");
+    }
+}
@@ -0,0 +1,45 @@
+/**
+ * @file bench_filters.cpp
+ * @brief Cost per call of the filter engine (addValue() and getAverage()).
+ */
+
+#include "Bench.h"
+#include "utils/DataFilter.h"
+#include "utils/EmaFilter.h"
+#include "utils/KalmanFilter.h"
+#include "utils/MedianFilter.h"
+
+namespace {
+
+template <typename Filter>
+void benchFilter(const char *label, Filter &filter) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s::addValue", label);
+    bench::measure(name, 1000000, [&](uint64_t i) {
+        filter.addValue(static_cast<float>(i & 0xFF) * 0.1f);
+    });
+    snprintf(name, sizeof(name), "%s::getAverage", label);
+    bench::measure(name, 1000000, [&](uint64_t) {
+        bench::doNotOptimize(filter.getAverage());
+    });
+}
+
+} // namespace
+
+void benchFilters() {
+    bench::suite("filters");
+    DataFilter<FILTER_WINDOW_SIZE> small;
+    DataFilter<32> medium;
+    DataFilter<256> large;
+    EmaFilter<> ema;
+    MedianFilter<FILTER_WINDOW_SIZE> medianSmall;
+    MedianFilter<32> medianLarge;
+    KalmanFilter1D<> kalman;
+    benchFilter("DataFilter<5>", small);
+    benchFilter("DataFilter<32>", medium);
+    benchFilter("DataFilter<256>", large);
+    benchFilter("EmaFilter", ema);
+    benchFilter("MedianFilter<5>", medianSmall);
+    benchFilter("MedianFilter<32>", medianLarge);
+    benchFilter("KalmanFilter1D", kalman);
+}
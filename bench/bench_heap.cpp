@@ -0,0 +1,131 @@
+/**
+ * @file bench_heap.cpp
+ * @brief Checks that the upload path performs no heap allocation.
+ *
+ * Replaces the global operator new/delete with counting versions. After a
+ * warm-up (first connection, lazily created state) every further upload
+ * must complete without a single allocation, for each upload format. A
+ * steady stream of small allocations is what fragments the ESP32 heap over
+ * weeks of uptime, so any allocation here fails the run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "connectivity/CloudUploader.h"
+#include "utils/HeapStats.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+} // namespace
+
+uint64_t bench::allocations() { return g_allocations.load(); }
+
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+}
+
+namespace {
+
+/**
+ * Upload @p readings through @p uploader after a warm-up and return the
+ * number of allocations made while doing so.
+ */
+uint64_t countUploadAllocations(const char *name, UploadTarget target, size_t batchSize,
+                                MqttPayloadFormat format) {
+    CloudUploader uploader;
+    uploader.begin();
+    uploader.setTarget(target);
+    uploader.setBatchSize(batchSize);
+    uploader.setPayloadFormat(format);
+    uploader.setReportOnDelta(false);
+
+    const size_t kReadings = 2000;
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < kReadings + 50; ++i) {
+        if (i == 50) {
+            allocations = g_allocations.load();
+            bytes = g_allocatedBytes.load();
+        }
+        uploader.upload(20.0f + (i % 100) * 0.01f, 45.0f - (i % 50) * 0.1f,
+                        static_cast<int>(i & 0x3FF));
+        uploader.process();
+        hal::advanceMillis(CLOUD_UPLOAD_INTERVAL);
+    }
+    allocations = g_allocations.load() - allocations;
+    bytes = g_allocatedBytes.load() - bytes;
+
+    const UploadStats stats = uploader.getStats();
+    printf("%-40s %14llu %12llu\n", name, static_cast<unsigned long long>(allocations),
+           static_cast<unsigned long long>(bytes));
+    if (stats.sent < kReadings) {
+        bench::fail("Upload path check did not deliver every reading");
+    }
+    return allocations;
+}
+
+} // namespace
+
+void benchHeap() {
+    printf("\n[heap]\n");
+    printf("%-40s %14s %12s\n", "case", "allocations", "bytes");
+    hal::setWiFiAvailable(true);
+    hal::setMqttAvailable(true);
+    hal::setHttpResponse(200);
+    hal::setHttpLatency(0);
+    hal::setMqttLatency(0);
+    WiFi.begin("bench");
+    hal::advanceMillis(60000);
+
+    uint64_t total = 0;
+    total += countUploadAllocations("ThingSpeak GET", UPLOAD_THINGSPEAK, 1, MQTT_PAYLOAD_JSON);
+    total += countUploadAllocations("ThingSpeak bulk update", UPLOAD_THINGSPEAK,
+                                    THINGSPEAK_BATCH_SIZE, MQTT_PAYLOAD_JSON);
+    total += countUploadAllocations("MQTT JSON", UPLOAD_MQTT, 1, MQTT_PAYLOAD_JSON);
+    total += countUploadAllocations("MQTT CBOR", UPLOAD_MQTT, 1, MQTT_PAYLOAD_CBOR);
+    if (total > 0) {
+        bench::fail("Upload path allocates on the heap");
+    }
+
+    const HeapStats heap = readHeapStats();
+    char text[MQTT_PAYLOAD_MAX];
+    if (formatHeapStats(heap, text, sizeof(text)) == 0) {
+        bench::fail("Heap telemetry does not fit MQTT_PAYLOAD_MAX");
+    }
+    printf("%-40s %s\n", "  telemetry", text);
+}
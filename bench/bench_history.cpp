@@ -0,0 +1,295 @@
+/**
+ * @file bench_history.cpp
+ * @brief Compression ratio and encode/decode throughput of the history store.
+ *
+ * Traces are three-channel rows (temperature, humidity, light) at
+ * SENSOR_READ_INTERVAL with the few milliseconds of jitter the polling
+ * loop adds; timestamps come back to HISTORY_TIME_UNIT, values bit for
+ * bit. The built-in ones model the sites the node runs at: an
+ * office with a DHT11 (whole degrees and percent) and a raw LDR, a
+ * greenhouse with a DHT22 (0.1 resolution) and the oversampled LDR
+ * (fractional values), and the office trace with failed DHT reads. A
+ * recorded trace can be added with BENCH_HISTORY_TRACE=<file>: one row
+ * per line, "timestamp_ms,temperature,humidity,light", blank values for
+ * failed reads.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "connectivity/CloudUploader.h"
+#include "storage/History.h"
+#include "storage/HistoryCodec.h"
+
+namespace {
+
+const size_t kChannels = 3;
+
+struct Row {
+    uint32_t timestamp;
+    float values[kChannels];
+};
+
+struct Trace {
+    const char *name;
+    std::vector<Row> rows;
+};
+
+/** Small deterministic generator so traces are identical on every run. */
+struct Noise {
+    uint32_t state;
+    float uniform() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / 16777216.0f;
+    }
+    float gauss() { return uniform() + uniform() + uniform() - 1.5f; }
+};
+
+float quantize(float value, float step) {
+    return roundf(value / step) * step;
+}
+
+/** 24 hours of a site: diurnal temperature and light, humidity following. */
+Trace siteTrace(const char *name, float tempStep, float humidStep, bool rawLight,
+                float failureRate, uint32_t seed) {
+    Trace trace;
+    trace.name = name;
+    Noise noise = {seed};
+    const uint32_t rows = 24u * 3600u * 1000u / SENSOR_READ_INTERVAL;
+    uint32_t t = 1000;
+    for (uint32_t i = 0; i < rows; ++i) {
+        const float day = static_cast<float>(i) / rows * 2.0f * static_cast<float>(M_PI);
+        const float temp = 21.0f - 2.5f * cosf(day) + 0.15f * noise.gauss();
+        const float humid = 48.0f + 6.0f * cosf(day) + 0.6f * noise.gauss();
+        const float sun = sinf(day - 0.3f);
+        const float lux = sun > 0.0f ? 2600.0f * sun + 300.0f : 300.0f;
+        Row row;
+        row.timestamp = t;
+        row.values[0] = quantize(temp, tempStep);
+        row.values[1] = quantize(humid, humidStep);
+        row.values[2] = rawLight ? roundf(lux + 12.0f * noise.gauss())
+                                 : lux + 4.0f * noise.gauss();
+        if (noise.uniform() < failureRate) {
+            row.values[0] = NAN;
+            row.values[1] = NAN;
+        }
+        trace.rows.push_back(row);
+        // loop() polls every ~10 ms, so samples land up to a tick late
+        t += SENSOR_READ_INTERVAL + static_cast<uint32_t>(noise.uniform() * 11.0f);
+    }
+    return trace;
+}
+
+bool loadTrace(const char *path, Trace &trace) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    trace.name = "recorded";
+    char line[160];
+    while (fgets(line, sizeof(line), file)) {
+        Row row;
+        char *p = line;
+        row.timestamp = static_cast<uint32_t>(strtoul(p, &p, 10));
+        for (size_t c = 0; c < kChannels; ++c) {
+            row.values[c] = NAN;
+            if (*p == ',') {
+                ++p;
+                char *end;
+                const float v = strtof(p, &end);
+                if (end != p) {
+                    row.values[c] = v;
+                }
+                p = end;
+            }
+        }
+        trace.rows.push_back(row);
+    }
+    fclose(file);
+    return !trace.rows.empty();
+}
+
+bool sameBits(float a, float b) {
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+struct Result {
+    double ratio;
+    double bitsPerRow;
+    double hoursHeld;
+    bool exact;
+};
+
+/** Encode @p trace into blocks, decode it back and time both directions. */
+Result run(const Trace &trace) {
+    const size_t rows = trace.rows.size();
+    // Every block takes at least this many rows, whatever the data
+    const size_t minRows = ((HISTORY_BLOCK_BYTES - HISTORY_HEADER_BYTES) * 8 -
+                            HistoryEncoder::maxRowBits(kChannels)) /
+                               HistoryEncoder::maxRowBits(kChannels) +
+                           1;
+    std::vector<uint8_t> storage((rows / minRows + 1) * HISTORY_BLOCK_BYTES);
+    std::vector<size_t> lengths;
+    size_t encoded = 0;
+
+    const auto encodeStart = std::chrono::steady_clock::now();
+    HistoryEncoder encoder;
+    uint8_t *block = storage.data();
+    encoder.begin(block, HISTORY_BLOCK_BYTES, kChannels, HISTORY_TIME_UNIT);
+    for (const Row &row : trace.rows) {
+        if (!encoder.append(row.timestamp, row.values)) {
+            lengths.push_back(encoder.length());
+            encoded += encoder.length();
+            block += HISTORY_BLOCK_BYTES;
+            encoder.begin(block, HISTORY_BLOCK_BYTES, kChannels, HISTORY_TIME_UNIT);
+            encoder.append(row.timestamp, row.values);
+        }
+    }
+    lengths.push_back(encoder.length());
+    encoded += encoder.length();
+    const auto encodeEnd = std::chrono::steady_clock::now();
+
+    bool exact = true;
+    size_t decodedRows = 0;
+    Row out;
+    for (size_t b = 0; b < lengths.size(); ++b) {
+        HistoryDecoder decoder(storage.data() + b * HISTORY_BLOCK_BYTES, lengths[b]);
+        exact = exact && decoder.valid() && decoder.channels() == kChannels;
+        const uint32_t first = trace.rows[decodedRows].timestamp;
+        while (decoder.next(out.timestamp, out.values)) {
+            const Row &in = trace.rows[decodedRows++];
+            // Exact to the time unit, counted from the block's first row
+            exact = exact && out.timestamp == first + (in.timestamp - first) /
+                                                          HISTORY_TIME_UNIT * HISTORY_TIME_UNIT;
+            for (size_t c = 0; c < kChannels; ++c) {
+                exact = exact && sameBits(out.values[c], in.values[c]);
+            }
+        }
+        exact = exact && decoder.valid();
+    }
+    exact = exact && decodedRows == rows;
+    const auto decodeEnd = std::chrono::steady_clock::now();
+
+    const double encodeNs =
+        std::chrono::duration<double, std::nano>(encodeEnd - encodeStart).count() / rows;
+    const double decodeNs =
+        std::chrono::duration<double, std::nano>(decodeEnd - encodeEnd).count() / rows;
+    const size_t raw = rows * (sizeof(uint32_t) + kChannels * sizeof(float));
+
+    Result r;
+    r.ratio = static_cast<double>(raw) / encoded;
+    r.bitsPerRow = encoded * 8.0 / rows;
+    // Rows the configured ring holds, at the trace's mean block fill
+    const double rowsPerBlock = static_cast<double>(rows) / lengths.size();
+    r.hoursHeld = rowsPerBlock * (HISTORY_BLOCKS - 1) * SENSOR_READ_INTERVAL / 3.6e6;
+    r.exact = exact;
+    printf("  %-22s %7u rows %8.2fx %6.1f bit/row %7.1f ns enc %7.1f ns dec %5.1f h  %s\n",
+           trace.name, static_cast<unsigned>(rows), r.ratio, r.bitsPerRow, encodeNs, decodeNs,
+           r.hoursHeld, exact ? "ok" : "MISMATCH");
+    return r;
+}
+
+/** Ring behaviour and publishing a sealed block as the MQTT payload. */
+bool checkStore(const Trace &trace) {
+    History history;
+    history.begin(kChannels);
+    hal::setWiFiAvailable(true);
+    hal::setMqttAvailable(true);
+    WiFi.begin("bench");
+    hal::advanceMillis(60000);
+    CloudUploader uploader;
+    uploader.setTarget(UPLOAD_MQTT);
+    uploader.begin();
+    hal::resetStats();
+
+    size_t published = 0;
+    uint64_t publishedBytes = 0;
+    bool sealedValid = true;
+    for (const Row &row : trace.rows) {
+        if (history.append(row.timestamp, row.values)) {
+            size_t length;
+            const uint8_t *block = history.lastSealed(length);
+            HistoryDecoder decoder(block, length);
+            sealedValid = sealedValid && decoder.valid() && decoder.blockLength() == length;
+            uploader.uploadHistory(block, length);
+            while (uploader.process()) {
+            }
+            ++published;
+            publishedBytes += length;
+        }
+    }
+    const HistoryStats &stats = history.getStats();
+    size_t length = 0;
+    const uint8_t *newest = history.block(history.blockCount() - 1, length);
+    HistoryDecoder open(newest, length);
+    Row last;
+    while (open.next(last.timestamp, last.values)) {
+    }
+    const Row &expected = trace.rows.back();
+    const uint32_t first = trace.rows[stats.rows - open.rows()].timestamp;
+
+    printf("  ring: %u of %u rows held in %u B, %u blocks sealed, %u overwritten, "
+           "%u published (%.0f B avg)\n",
+           static_cast<unsigned>(history.rows()), static_cast<unsigned>(stats.rows),
+           static_cast<unsigned>(history.encodedBytes()), static_cast<unsigned>(stats.sealed),
+           static_cast<unsigned>(stats.overwritten), static_cast<unsigned>(published),
+           published ? static_cast<double>(publishedBytes) / published : 0.0);
+
+    const hal::NetStats &mqtt = hal::mqttStats();
+    return sealedValid && published == stats.sealed && mqtt.requests == published &&
+           mqtt.bytesSent == publishedBytes + published * (sizeof(MQTT_TOPIC_HISTORY) - 1) &&
+           history.rows() + stats.droppedRows == stats.rows &&
+           history.blockCount() == HISTORY_BLOCKS && open.valid() &&
+           last.timestamp - first == (expected.timestamp - first) / HISTORY_TIME_UNIT *
+                                          HISTORY_TIME_UNIT &&
+           sameBits(last.values[2], expected.values[2]);
+}
+
+} // namespace
+
+void benchHistory() {
+    bench::suite("history");
+    std::vector<Trace> traces;
+    traces.push_back(siteTrace("office (DHT11, raw LDR)", 1.0f, 1.0f, true, 0.0f, 1));
+    traces.push_back(siteTrace("greenhouse (DHT22, DMA)", 0.1f, 0.1f, false, 0.0f, 2));
+    traces.push_back(siteTrace("office, 2% failed reads", 1.0f, 1.0f, true, 0.02f, 3));
+    const char *path = getenv("BENCH_HISTORY_TRACE");
+    Trace recorded;
+    if (path && loadTrace(path, recorded)) {
+        traces.push_back(recorded);
+    } else if (path) {
+        printf("  cannot read %s\n", path);
+    }
+
+    printf("  ratio against 4 B per timestamp and value; hours held by %u blocks of %u B\n",
+           HISTORY_BLOCKS, HISTORY_BLOCK_BYTES);
+    bool exact = true;
+    Result office = {};
+    for (size_t i = 0; i < traces.size(); ++i) {
+        const Result r = run(traces[i]);
+        exact = exact && r.exact;
+        if (i == 0) {
+            office = r;
+        }
+    }
+    const bool storeOk = checkStore(traces[0]);
+
+    if (!exact) {
+        bench::fail("Decoded history differs from the samples");
+    }
+    if (office.ratio < 4.0) {
+        bench::fail("Office trace compresses less than 4:1");
+    }
+    if (office.hoursHeld < 2.0) {
+        bench::fail("History holds less than two hours of the office trace");
+    }
+    if (!storeOk) {
+        bench::fail("History ring or block upload inconsistent");
+    }
+}
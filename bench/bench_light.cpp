@@ -0,0 +1,117 @@
+/**
+ * @file bench_light.cpp
+ * @brief Oversampled light readings: kernel cost, noise and flicker.
+ *
+ * The continuous ADC stand-in produces conversions on the virtual clock
+ * from the pin level plus a sine modulation and Gaussian noise, so the
+ * suite can compare a single analogRead() against an oversampled window
+ * on the same signal, and check that lamp flicker is detected at the
+ * right frequency while steady light is not reported as flicker.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "sensors/LightSensor.h"
+
+namespace {
+
+const int kLevel = 2000;
+const float kNoise = 20.0f;   ///< ESP32 ADC noise is in the tens of counts
+const int kTrials = 200;
+
+/** RMS error of @p trials readings of a steady level. */
+template <typename Fn>
+double rmsError(Fn read) {
+    double sum = 0.0;
+    for (int i = 0; i < kTrials; ++i) {
+        hal::advanceMillis(SENSOR_READ_INTERVAL);
+        const double e = read() - kLevel;
+        sum += e * e;
+    }
+    return sqrt(sum / kTrials);
+}
+
+void benchKernel() {
+    static uint16_t samples[LIGHT_ADC_WINDOW];
+    static uint32_t blocks[LIGHT_ADC_WINDOW / LIGHT_ADC_DECIMATION];
+    for (size_t i = 0; i < LIGHT_ADC_WINDOW; ++i) {
+        // Channel tag in the top bits, as in a DMA frame
+        samples[i] = static_cast<uint16_t>((LDR_ADC_CHANNEL << 12) |
+                                           static_cast<int>(2000 + 300 * sin(i * 0.0314)));
+    }
+    const double ns = bench::measure("oversampleWindow (flicker)", 20000, [&](uint64_t) {
+        bench::doNotOptimize(oversampleWindow(samples, LIGHT_ADC_WINDOW, LIGHT_ADC_DECIMATION,
+                                              blocks, LIGHT_ADC_SAMPLE_RATE,
+                                              LIGHT_FLICKER_MIN_PERCENT));
+    });
+    bench::report("  per conversion", ns / LIGHT_ADC_WINDOW, LIGHT_ADC_WINDOW);
+}
+
+} // namespace
+
+void benchLight() {
+    bench::suite("light");
+    benchKernel();
+
+    LightSensor sensor;
+    sensor.begin();
+    if (!sensor.isContinuous()) {
+        bench::fail("Continuous ADC did not start");
+        return;
+    }
+    hal::setAnalogValue(LDR_PIN, kLevel);
+    hal::setAnalogWaveform(LDR_PIN, 0.0f, 0.0f, kNoise);
+
+    const unsigned long before = millis();
+    sensor.readRaw();
+    const unsigned long windowMs = millis() - before;
+
+    const double single = rmsError([] { return static_cast<double>(analogRead(LDR_PIN)); });
+    const double oversampled = rmsError([&sensor] {
+        sensor.readRaw();
+        return static_cast<double>(sensor.getWindow().raw);
+    });
+    printf("  window: %lu conversions in %lu ms (virtual), calibrated %lu mV\n",
+           static_cast<unsigned long>(sensor.getWindow().conversions), windowMs,
+           static_cast<unsigned long>(sensor.getWindow().millivolts));
+    printf("  RMS error, noise %.0f counts: single %.2f, oversampled %.2f counts\n",
+           static_cast<double>(kNoise), single, oversampled);
+    const float steadyFlicker = sensor.getWindow().flickerHz;
+
+    struct FlickerCase {
+        float amplitude;
+        float hz;
+    };
+    const FlickerCase cases[] = {{600.0f, 100.0f}, {300.0f, 120.0f}, {150.0f, 100.0f}};
+    bool flickerOk = true;
+    for (const FlickerCase &c : cases) {
+        hal::setAnalogWaveform(LDR_PIN, c.amplitude, c.hz, kNoise);
+        hal::advanceMillis(SENSOR_READ_INTERVAL);
+        sensor.readRaw();
+        const LightWindow &w = sensor.getWindow();
+        printf("  flicker %4.0f Hz, depth %4.1f%%: measured %5.1f Hz, %4.1f%%, mean %.1f\n",
+               static_cast<double>(c.hz), 100.0 * c.amplitude / kLevel,
+               static_cast<double>(w.flickerHz), static_cast<double>(w.flickerPercent),
+               static_cast<double>(w.raw));
+        if (fabsf(w.flickerHz - c.hz) > 0.1f * c.hz || fabsf(w.raw - kLevel) > 10.0f) {
+            flickerOk = false;
+        }
+    }
+    hal::setAnalogWaveform(LDR_PIN, 0.0f, 0.0f, 0.0f);
+
+    if (oversampled * 4.0 > single) {
+        bench::fail("Oversampling did not reduce the noise");
+    }
+    if (steadyFlicker != 0.0f) {
+        bench::fail("Steady light reported as flicker");
+    }
+    if (!flickerOk) {
+        bench::fail("Lamp flicker not detected at its frequency");
+    }
+    if (hal::adcDroppedConversions() > 0) {
+        bench::fail("Continuous ADC dropped conversions");
+    }
+}
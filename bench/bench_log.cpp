@@ -0,0 +1,318 @@
+/**
+ * @file bench_log.cpp
+ * @brief Cost of a LOG_* call against a blocking Serial.printf().
+ *
+ * The cost cases time a binary record (three arguments) with the drain
+ * amortised over the calls, a call whose level is filtered out and a call
+ * into a full ring. With Serial paced at SERIAL_BAUD_RATE the suite then
+ * logs a burst of lines both ways and reports the virtual time the caller
+ * spent blocked: Serial.printf() waits for the TX FIFO, LOG_INFO() never
+ * does. Four producer threads log numbered records while the main thread
+ * drains; every frame is decoded again and checked for order, loss and
+ * duplicates. A short capture is left in bench_log.bin for
+ * tools/logdecode.py (run it with --src src --src include --src bench).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "utils/BinaryLog.h"
+
+namespace {
+
+/** Output that keeps every byte and never blocks. */
+class CapturePrint : public Print {
+public:
+    size_t write(uint8_t c) override {
+        bytes.push_back(c);
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size) override {
+        bytes.insert(bytes.end(), buffer, buffer + size);
+        return size;
+    }
+    int availableForWrite() override { return 1 << 16; }
+
+    std::vector<uint8_t> bytes;
+};
+
+/** Output that only counts. */
+class NullPrint : public Print {
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+    int availableForWrite() override { return 1 << 16; }
+};
+
+struct Frame {
+    uint32_t id;
+    uint8_t level;
+    std::vector<uint8_t> args;
+};
+
+/** Split @p bytes into frames; false on a bad COBS block or CRC. */
+bool decodeFrames(const std::vector<uint8_t> &bytes, std::vector<Frame> &frames) {
+    size_t start = 0;
+    for (size_t end = 0; end < bytes.size(); ++end) {
+        if (bytes[end] != 0) {
+            continue;
+        }
+        if (end > start) {
+            std::vector<uint8_t> raw;
+            size_t i = start;
+            while (i < end) {
+                const uint8_t code = bytes[i];
+                if (code == 0 || i + code > end) {
+                    return false;
+                }
+                raw.insert(raw.end(), bytes.begin() + i + 1, bytes.begin() + i + code);
+                i += code;
+                if (i < end) {
+                    raw.push_back(0);
+                }
+            }
+            uint8_t crc = 0;
+            for (size_t k = 0; k + 1 < raw.size(); ++k) {
+                crc ^= raw[k];
+                for (int bit = 0; bit < 8; ++bit) {
+                    crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07)
+                                       : static_cast<uint8_t>(crc << 1);
+                }
+            }
+            if (raw.size() < 10 || crc != raw.back()) {
+                return false;
+            }
+            Frame frame;
+            memcpy(&frame.id, raw.data(), 4);
+            frame.level = raw[8];
+            frame.args.assign(raw.begin() + 9, raw.end() - 1);
+            frames.push_back(frame);
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+uint32_t argAt(const Frame &frame, size_t index) {
+    uint32_t value = 0;
+    if (frame.args.size() >= (index + 1) * 4) {
+        memcpy(&value, frame.args.data() + index * 4, 4);
+    }
+    return value;
+}
+
+} // namespace
+
+void benchLog() {
+    bench::suite("log");
+    NullPrint sink;
+    binaryLog.begin(sink);
+    binaryLog.drain();
+    binaryLog.setLevel(LOG_LEVEL_INFO);
+
+    // Producer side alone: batches that fit the ring, drained untimed
+    const uint64_t kBatches = 40000;
+    const uint32_t kBatch = LOG_RING_SLOTS / 2;
+    double producerNs = 0.0;
+    for (uint64_t b = 0; b < kBatches; ++b) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < kBatch; ++i) {
+            LOG_INFO("bench sample %lu: t=%.2f C, light %d", static_cast<unsigned long>(i),
+                     21.5f + static_cast<float>(i & 7), static_cast<int>(i & 4095));
+        }
+        producerNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() -
+                                                               start).count();
+        binaryLog.drain();
+    }
+    const double logNs = producerNs / static_cast<double>(kBatches * kBatch);
+    bench::report("LOG_INFO, 3 args", logNs, kBatches * kBatch);
+    bench::measure("LOG_INFO, 3 args + drain", 2000000, [&](uint64_t i) {
+        LOG_INFO("bench sample %lu: t=%.2f C, light %d", static_cast<unsigned long>(i),
+                 21.5f + static_cast<float>(i & 7), static_cast<int>(i & 4095));
+        if ((i & 31) == 31) {
+            binaryLog.drain();
+        }
+    });
+    const double filteredNs = bench::measure("LOG_DEBUG, level off", 5000000, [&](uint64_t i) {
+        LOG_DEBUG("bench debug %lu", static_cast<unsigned long>(i));
+    });
+    binaryLog.drain();
+    const uint32_t droppedBefore = binaryLog.getStats().dropped;
+    bench::measure("LOG_INFO, ring full", 2000000, [&](uint64_t i) {
+        LOG_INFO("bench sample %lu: t=%.2f C, light %d", static_cast<unsigned long>(i), 21.5f,
+                 static_cast<int>(i & 4095));
+    });
+    binaryLog.drain();
+    const bool dropsCounted = binaryLog.getStats().dropped - droppedBefore > 0;
+
+    char line[96];
+    bench::measure("snprintf of the same line", 2000000, [&](uint64_t i) {
+        bench::doNotOptimize(snprintf(line, sizeof(line), "bench sample %lu: t=%.2f C, light %d\n",
+                                      static_cast<unsigned long>(i),
+                                      21.5f + static_cast<float>(i & 7),
+                                      static_cast<int>(i & 4095)));
+    });
+
+    // A burst of 50 lines at SERIAL_BAUD_RATE, as the caller sees it
+    const int kBurst = 50;
+    Serial.begin(SERIAL_BAUD_RATE);
+    hal::resetStats();
+    uint64_t t0 = hal::nowMicros();
+    for (int i = 0; i < kBurst; ++i) {
+        Serial.printf("bench sample %d: t=%.2f C, light %d\n", i, 21.5, 1800 + i);
+    }
+    const uint64_t printfBlocked = hal::serialBlockedMicros();
+    const uint64_t printfElapsed = hal::nowMicros() - t0;
+    const uint64_t textBytes = hal::serialBytesWritten();
+    hal::advanceMillis(1000);  // let the FIFO empty
+
+    binaryLog.begin(Serial);
+    hal::resetStats();
+    t0 = hal::nowMicros();
+    for (int i = 0; i < kBurst; ++i) {
+        LOG_INFO("bench sample %lu: t=%.2f C, light %d", static_cast<unsigned long>(i), 21.5f,
+                 1800 + i);
+    }
+    const uint64_t logElapsed = hal::nowMicros() - t0;
+    // What the drain task does: write what fits, sleep, repeat
+    const LogStats before = binaryLog.getStats();
+    uint64_t drainStart = hal::nowMicros();
+    while (binaryLog.pending() > 0) {
+        if (binaryLog.drain() == 0) {
+            delay(LOG_DRAIN_IDLE_MS);
+        }
+    }
+    const uint64_t drainElapsed = hal::nowMicros() - drainStart;
+    const LogStats after = binaryLog.getStats();
+    const uint64_t drainBlocked = hal::serialBlockedMicros();
+    Serial.end();
+    const uint32_t binaryBytes = after.bytes - before.bytes;
+    printf("  %d lines at %u baud: Serial.printf blocks the caller %llu us (%llu B), "
+           "LOG_INFO %llu us\n",
+           kBurst, SERIAL_BAUD_RATE, static_cast<unsigned long long>(printfElapsed),
+           static_cast<unsigned long long>(textBytes), static_cast<unsigned long long>(logElapsed));
+    printf("  drain: %u B in %llu us of virtual time, %llu us blocked, %.1f B per record "
+           "(text %.1f B)\n",
+           static_cast<unsigned>(binaryBytes), static_cast<unsigned long long>(drainElapsed),
+           static_cast<unsigned long long>(drainBlocked),
+           static_cast<double>(binaryBytes) / kBurst, static_cast<double>(textBytes) / kBurst);
+    printf("  RAM: %u B ring (%u records of %u B)\n", static_cast<unsigned>(sizeof(BinaryLog)),
+           static_cast<unsigned>(LOG_RING_SLOTS), static_cast<unsigned>(sizeof(LogRecord)));
+
+    // Level filtering
+    CapturePrint filtered;
+    binaryLog.begin(filtered);
+    binaryLog.setLevel(LOG_LEVEL_WARN);
+    LOG_INFO("bench filtered info");
+    LOG_WARN("bench kept warn");
+    binaryLog.enable(LOG_LEVEL_DEBUG, true);
+    LOG_DEBUG("bench kept debug");
+    LOG_INFO("bench filtered info");
+    binaryLog.drain();
+    std::vector<Frame> filterFrames;
+    const bool filterOk = decodeFrames(filtered.bytes, filterFrames) &&
+                          filterFrames.size() == 2 &&
+                          filterFrames[0].id == logFormatId("bench kept warn") &&
+                          filterFrames[1].id == logFormatId("bench kept debug") &&
+                          filterFrames[1].level == LOG_LEVEL_DEBUG;
+    binaryLog.setLevel(LOG_LEVEL_INFO);
+
+    // Four producers against one consumer
+    const int kThreads = 4;
+    const uint32_t kPerThread = 100000;
+    CapturePrint capture;
+    binaryLog.begin(capture);
+    const uint32_t dropsBefore = binaryLog.getStats().dropped;
+    std::atomic<int> running(kThreads);
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kThreads; ++t) {
+        producers.emplace_back([t, kPerThread, &running]() {
+            for (uint32_t seq = 0; seq < kPerThread; ++seq) {
+                // Mostly stay below a full ring so records get through
+                while (binaryLog.pending() > LOG_RING_SLOTS / 2 && (seq & 1023) != 0) {
+                    std::this_thread::yield();
+                }
+                LOG_INFO("bench thread %d record %lu", t, static_cast<unsigned long>(seq));
+            }
+            running.fetch_sub(1);
+        });
+    }
+    while (running.load() > 0) {
+        if (binaryLog.drain() == 0) {
+            std::this_thread::yield();
+        }
+    }
+    for (std::thread &producer : producers) {
+        producer.join();
+    }
+    binaryLog.drain();
+    const uint32_t drops = binaryLog.getStats().dropped - dropsBefore;
+    std::vector<Frame> frames;
+    const bool framesOk = decodeFrames(capture.bytes, frames);
+    const uint32_t threadId = logFormatId("bench thread %d record %lu");
+    int64_t last[kThreads];
+    for (int64_t &seq : last) {
+        seq = -1;
+    }
+    uint32_t received = 0;
+    uint32_t announced = 0;
+    bool ordered = true;
+    for (const Frame &frame : frames) {
+        if (frame.id == 0) {
+            announced += argAt(frame, 0);
+        } else if (frame.id == threadId) {
+            const uint32_t t = argAt(frame, 0);
+            const int64_t seq = argAt(frame, 1);
+            if (t >= static_cast<uint32_t>(kThreads) || seq <= last[t]) {
+                ordered = false;
+            } else {
+                last[t] = seq;
+            }
+            ++received;
+        }
+    }
+    printf("  %d producers: %u records, %u received, %u dropped (%u announced), %u B\n",
+           kThreads, static_cast<unsigned>(kThreads * kPerThread), static_cast<unsigned>(received),
+           static_cast<unsigned>(drops), static_cast<unsigned>(announced),
+           static_cast<unsigned>(capture.bytes.size()));
+    const bool mpscOk = framesOk && ordered && received + drops == kThreads * kPerThread &&
+                        announced == drops;
+
+    // Sample capture for tools/logdecode.py
+    CapturePrint sample;
+    binaryLog.begin(sample);
+    LOG_INFO("bench sample %lu: t=%.2f C, light %d", 7UL, 23.25f, 1800);
+    LOG_WARN("bench status %s, code %d, ratio %.3f", "degraded", -3, 0.125f);
+    LOG_ERROR("bench long string %s", "a string too long for the space left in a log record");
+    LOG_INFO("bench big %llu and hex 0x%08lx", 1ULL << 40, 0xBEEFUL);
+    binaryLog.drain();
+    FILE *file = fopen("bench_log.bin", "wb");
+    if (file) {
+        fwrite(sample.bytes.data(), 1, sample.bytes.size(), file);
+        fclose(file);
+    }
+    binaryLog.begin(sink);
+
+    if (logElapsed != 0 || printfBlocked == 0) {
+        bench::fail("LOG_INFO advanced the clock, or Serial.printf never blocked");
+    }
+    if (logNs > 100.0 || filteredNs > 5.0) {
+        bench::fail("A LOG_* call costs more than 100 ns, or 5 ns when filtered");
+    }
+    if (!dropsCounted) {
+        bench::fail("Records dropped by a full ring were not counted");
+    }
+    if (!filterOk) {
+        bench::fail("Per-level filtering kept or lost the wrong records");
+    }
+    if (!mpscOk) {
+        bench::fail("Records lost, duplicated or reordered between producers and drain");
+    }
+}
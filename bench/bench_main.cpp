@@ -0,0 +1,60 @@
+/**
+ * @file bench_main.cpp
+ * @brief Entry point of the host benchmark program.
+ *
+ * Usage: `pio run -e native -t exec` runs every suite. Passing a suite name
+ * (e.g. `program filters`) runs only the matching suites.
+ */
+
+#include <string.h>
+
+#include "Bench.h"
+#include "NativeHal.h"
+
+namespace {
+
+struct Suite {
+    const char *name;
+    void (*run)();
+};
+
+const Suite kSuites[] = {
+    {"filters", benchFilters},
+    {"alerts", benchAlerts},
+    {"uploads", benchUploads},
+    {"display", benchDisplay},
+    {"pipeline", benchPipeline},
+    {"wifi", benchWiFi},
+    {"storage", benchStorage},
+    {"heap", benchHeap},
+    {"power", benchPower},
+    {"light", benchLight},
+    {"dht", benchDht},
+    {"registry", benchRegistry},
+    {"history", benchHistory},
+    {"metrics", benchMetrics},
+    {"profiler", benchProfiler},
+    {"log", benchLog},
+    {"sampling", benchSampling},
+    {"delta", benchDelta},
+    {"qos", benchQos},
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    // Firmware debug output would dominate the timings
+    hal::setSerialEcho(false);
+    for (const Suite &s : kSuites) {
+        bool selected = (argc < 2);
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], s.name) == 0) {
+                selected = true;
+            }
+        }
+        if (selected) {
+            s.run();
+        }
+    }
+    return bench::g_failed ? 1 : 0;
+}
@@ -0,0 +1,371 @@
+/**
+ * @file bench_metrics.cpp
+ * @brief Load test of the local /metrics and /history endpoint.
+ *
+ * The MetricsServer listens on the loopback socket of the WiFiServer
+ * stand-in, with a registry, alert rules and a History filled with a day
+ * of office samples. Client threads issue requests over real TCP
+ * connections as fast as they are answered while the main thread polls
+ * loop(), as the firmware does. Reported per case: requests per second
+ * (wall clock), response size and heap allocations per request; then the
+ * RAM the server holds per connection. The checks cover the exposition
+ * format, the downsampled row counts and averages, errors, and shedding
+ * connections beyond METRICS_MAX_CLIENTS.
+ */
+
+#include <arpa/inet.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "connectivity/MetricsServer.h"
+#include "storage/HistoryCodec.h"
+
+namespace {
+
+const ChannelSpec kTemperature = {"Temp", "t", "C", 1, -40.0f, 80.0f};
+const ChannelSpec kHumidity = {"Humidity", "h", "%", 0, 0.0f, 100.0f};
+const ChannelSpec kLight = {"Light", "l", "", 0, 0.0f, 4095.0f};
+
+const size_t kResponseMax = 256 * 1024;
+
+struct Response {
+    int status;
+    size_t bytes;    ///< Whole response, head included
+    size_t lines;    ///< Body lines
+    const char *body;
+};
+
+int openConnection(uint16_t port) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** Read until the server closes and split off the status and body. */
+Response readResponse(int fd, char *buffer) {
+    size_t length = 0;
+    ssize_t n;
+    while (length < kResponseMax - 1 &&
+           (n = recv(fd, buffer + length, kResponseMax - 1 - length, 0)) > 0) {
+        length += static_cast<size_t>(n);
+    }
+    close(fd);
+    buffer[length] = '\0';
+    Response r = {0, length, 0, ""};
+    if (strncmp(buffer, "HTTP/1.1 ", 9) == 0) {
+        r.status = atoi(buffer + 9);
+    }
+    const char *body = strstr(buffer, "\r\n\r\n");
+    if (body) {
+        r.body = body + 4;
+        for (const char *p = r.body; *p; ++p) {
+            r.lines += *p == '\n' ? 1 : 0;
+        }
+    }
+    return r;
+}
+
+/** One blocking request, issued from a client thread. */
+Response get(uint16_t port, const char *path, char *buffer) {
+    const int fd = openConnection(port);
+    if (fd < 0) {
+        return Response{0, 0, 0, ""};
+    }
+    char request[160];
+    const int length =
+        snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: envnode\r\n\r\n", path);
+    send(fd, request, static_cast<size_t>(length), MSG_NOSIGNAL);
+    return readResponse(fd, buffer);
+}
+
+/** Issue a request on another thread while the server is polled here. */
+Response fetch(MetricsServer &server, const char *path, std::vector<char> &buffer) {
+    std::atomic<bool> done{false};
+    Response response;
+    std::thread client([&] {
+        response = get(hal::serverPort(), path, buffer.data());
+        done = true;
+    });
+    while (!done) {
+        server.loop();
+    }
+    client.join();
+    return response;
+}
+
+struct Load {
+    double requestsPerSecond;
+    double bytesPerResponse;
+    double allocationsPerRequest;
+    bool allOk;
+};
+
+/** @p clients threads requesting @p path back to back for @p ms of wall time. */
+Load loadTest(MetricsServer &server, const char *name, const char *path, size_t clients,
+              unsigned ms) {
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<bool> allOk{true};
+    std::vector<std::vector<char>> buffers(clients, std::vector<char>(kResponseMax));
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i] {
+            while (!go) {
+            }
+            while (!stop) {
+                const Response r = get(hal::serverPort(), path, buffers[i].data());
+                if (r.status != 200) {
+                    allOk = false;
+                }
+                requests.fetch_add(1);
+                bytes.fetch_add(r.bytes);
+            }
+        });
+    }
+
+    const uint64_t allocationsBefore = bench::allocations();
+    const auto start = std::chrono::steady_clock::now();
+    go = true;
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(ms)) {
+        server.loop();
+    }
+    stop = true;
+    // Let the last requests complete
+    for (int i = 0; i < 1000; ++i) {
+        server.loop();
+    }
+    const uint64_t allocations = bench::allocations() - allocationsBefore;
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    Load load;
+    load.requestsPerSecond = requests / seconds;
+    load.bytesPerResponse = requests ? static_cast<double>(bytes) / requests : 0.0;
+    load.allocationsPerRequest = requests ? static_cast<double>(allocations) / requests : 0.0;
+    load.allOk = allOk && requests > 0;
+    printf("  %-28s %2u client%s %8.0f req/s %8.0f B/response %5.2f alloc/request\n", name,
+           static_cast<unsigned>(clients), clients == 1 ? " " : "s", load.requestsPerSecond,
+           load.bytesPerResponse, load.allocationsPerRequest);
+    return load;
+}
+
+/** Every sample line is "name[{labels}] value" with a number, NaN or +-Inf. */
+bool validExposition(const char *body) {
+    size_t samples = 0;
+    while (*body) {
+        const char *end = strchr(body, '\n');
+        if (!end) {
+            return false;
+        }
+        if (*body != '#') {
+            const char *value = end;
+            while (value > body && value[-1] != ' ') {
+                --value;
+            }
+            if (value == body) {
+                return false;
+            }
+            char *parsed;
+            strtod(value, &parsed);
+            if (parsed != end && strncmp(value, "NaN", 3) != 0) {
+                return false;
+            }
+            ++samples;
+        }
+        body = end + 1;
+    }
+    return samples > 0;
+}
+
+/** Day of office samples at SENSOR_READ_INTERVAL: diurnal temperature and light. */
+void fillHistory(History &history) {
+    const uint32_t rows = 24u * 3600u * 1000u / SENSOR_READ_INTERVAL;
+    uint32_t seed = 7;
+    for (uint32_t i = 0; i < rows; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const float day = static_cast<float>(i) / rows * 2.0f * static_cast<float>(M_PI);
+        const float sun = sinf(day - 0.3f);
+        const float row[3] = {
+            roundf(21.0f - 2.5f * cosf(day)),
+            roundf(48.0f + 6.0f * cosf(day)),
+            roundf((sun > 0.0f ? 2600.0f * sun : 0.0f) + 300.0f + (seed >> 28)),
+        };
+        history.append(1000 + i * SENSOR_READ_INTERVAL, row);
+    }
+    hal::setMillis(1000 + rows * SENSOR_READ_INTERVAL);
+}
+
+/** Buckets and first-bucket temperature average of @p step over the history. */
+void reference(const History &history, uint32_t step, size_t &buckets, float &firstAverage) {
+    buckets = 0;
+    uint32_t current = 0;
+    float sum = 0.0f;
+    size_t count = 0;
+    float values[SENSOR_MAX_CHANNELS];
+    for (size_t b = 0; b < history.blockCount(); ++b) {
+        size_t length;
+        const uint8_t *block = history.block(b, length);
+        HistoryDecoder decoder(block, length);
+        uint32_t timestamp;
+        while (decoder.next(timestamp, values)) {
+            const uint32_t start = timestamp - timestamp % step;
+            if (buckets == 0 || start != current) {
+                ++buckets;
+                current = start;
+            }
+            if (buckets == 1) {
+                sum += values[0];
+                ++count;
+            }
+        }
+    }
+    firstAverage = count ? sum / count : NAN;
+}
+
+} // namespace
+
+void benchMetrics() {
+    bench::suite("metrics");
+    hal::setMillis(0);
+    SensorRegistry<> registry;
+    registry.addChannel(kTemperature);
+    registry.addChannel(kHumidity);
+    registry.addChannel(kLight);
+    AlertManager alerts;
+    alerts.begin();
+    for (int i = 0; i < FILTER_WINDOW_SIZE; ++i) {
+        const float row[3] = {22.5f, 20.0f, 1800.0f};
+        registry.addSamples(row);
+        alerts.update(registry.view(), i * SENSOR_READ_INTERVAL);
+    }
+    CloudUploader uploader;
+    static History history;
+    history.begin(registry.channelCount());
+    fillHistory(history);
+
+    MetricsServer server(registry, alerts, uploader, &history, 0);
+    server.begin();
+    if (hal::serverPort() == 0) {
+        bench::fail("Cannot listen on a loopback socket");
+        return;
+    }
+    std::vector<char> buffer(kResponseMax);
+
+    // Content
+    const Response metrics = fetch(server, "/metrics", buffer);
+    const bool metricsOk =
+        metrics.status == 200 && validExposition(metrics.body) &&
+        strstr(metrics.body, "envnode_value{channel=\"t\",label=\"Temp\",unit=\"C\"} 22.5\n") &&
+        strstr(metrics.body, "envnode_alert_active{rule=\"3\",code=\"4\",channel=\"h\"} 1\n") &&
+        strstr(metrics.body, "envnode_alert_state 4\n");
+    printf("  /metrics: %u B, %u lines\n", static_cast<unsigned>(metrics.bytes),
+           static_cast<unsigned>(metrics.lines));
+
+    const Response raw = fetch(server, "/history", buffer);
+    const bool rawOk = raw.status == 200 && raw.lines == history.rows() + 1 &&
+                       strncmp(raw.body, "timestamp_ms,t,h,l\n", 19) == 0;
+
+    size_t buckets;
+    float firstAverage;
+    reference(history, 600000, buckets, firstAverage);
+    const Response stepped = fetch(server, "/history?step=600000", buffer);
+    const char *firstRow = strchr(stepped.body, '\n');
+    float servedAverage = NAN;
+    if (firstRow) {
+        const char *comma = strchr(firstRow + 1, ',');
+        servedAverage = comma ? strtof(comma + 1, nullptr) : NAN;
+    }
+    const bool steppedOk = stepped.status == 200 && stepped.lines == buckets + 1 &&
+                           fabsf(servedAverage - firstAverage) < 0.01f;
+    printf("  /history: %u rows in %u B; step=600000: %u rows in %u B (%u buckets expected)\n",
+           static_cast<unsigned>(raw.lines - 1), static_cast<unsigned>(raw.bytes),
+           static_cast<unsigned>(stepped.lines - 1), static_cast<unsigned>(stepped.bytes),
+           static_cast<unsigned>(buckets));
+
+    const Response lastHour = fetch(server, "/history?last=3600000&step=60000&agg=max", buffer);
+    const bool rangeOk = lastHour.status == 200 && lastHour.lines >= 60 && lastHour.lines <= 62;
+    const bool errorsOk = fetch(server, "/nope", buffer).status == 404 &&
+                          fetch(server, "/history?agg=median", buffer).status == 400 &&
+                          fetch(server, "/history?from=x", buffer).status == 400;
+
+    // Load
+    const Load small1 = loadTest(server, "/metrics", "/metrics", 1, 300);
+    const Load small4 = loadTest(server, "/metrics", "/metrics", METRICS_MAX_CLIENTS, 300);
+    const Load hour = loadTest(server, "/history last hour by minute",
+                               "/history?last=3600000&step=60000", METRICS_MAX_CLIENTS, 300);
+    const Load full = loadTest(server, "/history (all rows)", "/history", 1, 300);
+    printf("  RAM per connection: %u B (request line %u B); one %u B chunk buffer while "
+           "answering; server %u B\n",
+           static_cast<unsigned>(MetricsServer::connectionBytes()), METRICS_REQUEST_MAX,
+           METRICS_CHUNK_BYTES, static_cast<unsigned>(sizeof(MetricsServer)));
+
+    // Overload: idle connections fill every slot, the next one is shed
+    const MetricsServerStats before = server.getStats();
+    int idle[METRICS_MAX_CLIENTS];
+    for (int &fd : idle) {
+        fd = openConnection(hal::serverPort());
+    }
+    const int extra = openConnection(hal::serverPort());
+    for (int i = 0; i < 100; ++i) {
+        server.loop();
+    }
+    const size_t open = server.openConnections();
+    const Response busy = readResponse(extra, buffer.data());
+    hal::advanceMillis(METRICS_REQUEST_TIMEOUT + 1);
+    server.loop();
+    for (int fd : idle) {
+        close(fd);
+    }
+    const MetricsServerStats &after = server.getStats();
+    const bool sheddingOk = open == METRICS_MAX_CLIENTS && busy.status == 503 &&
+                            after.rejected == before.rejected + 1 &&
+                            after.timeouts == before.timeouts + METRICS_MAX_CLIENTS &&
+                            server.openConnections() == 0;
+    printf("  %u idle connections + 1: %u held, extra answered %d, idle closed after %u ms\n",
+           METRICS_MAX_CLIENTS, static_cast<unsigned>(open), busy.status,
+           METRICS_REQUEST_TIMEOUT);
+    server.end();
+
+    if (!metricsOk) {
+        bench::fail("/metrics is not valid exposition text or misses values");
+    }
+    if (!rawOk || !steppedOk || !rangeOk) {
+        bench::fail("/history rows or downsampled values are wrong");
+    }
+    if (!errorsOk) {
+        bench::fail("Bad requests not answered with 4xx");
+    }
+    if (!small1.allOk || !small4.allOk || !hour.allOk || !full.allOk) {
+        bench::fail("Requests failed under load");
+    }
+    if (small1.allocationsPerRequest > 0 || small4.allocationsPerRequest > 0 ||
+        hour.allocationsPerRequest > 0 || full.allocationsPerRequest > 0) {
+        bench::fail("Serving a request allocates on the heap");
+    }
+    if (!sheddingOk) {
+        bench::fail("Connections beyond METRICS_MAX_CLIENTS or idle ones not handled");
+    }
+}
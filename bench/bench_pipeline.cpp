@@ -0,0 +1,62 @@
+/**
+ * @file bench_pipeline.cpp
+ * @brief Cost of the hand-over primitives used by the task pipeline.
+ *
+ * The cross-thread case runs a producer and a consumer on separate host
+ * threads, the same arrangement as the sensing and uplink tasks on the two
+ * ESP32 cores.
+ */
+
+#include <thread>
+
+#include "Bench.h"
+#include "connectivity/CloudUploader.h"
+#include "utils/JitterMonitor.h"
+#include "utils/SpscRing.h"
+
+void benchPipeline() {
+    bench::suite("pipeline");
+
+    // The sensing task hands over a snapshot of every registry channel
+    static SpscRing<ChannelFrame, PIPELINE_QUEUE_DEPTH> ring;
+    ChannelFrame reading = {0, 3, nullptr, {21.5f, 48.0f, 1200.0f}, CHANNEL_MASK_ALL};
+    bench::measure("SpscRing push+pop (same thread)", 5000000, [&](uint64_t i) {
+        reading.timestamp = static_cast<uint32_t>(i);
+        ring.push(reading);
+        ChannelFrame out;
+        ring.pop(out);
+        bench::doNotOptimize(out);
+    });
+
+    const uint64_t transfers = 2000000;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&]() {
+        ChannelFrame out;
+        uint64_t received = 0;
+        while (received < transfers) {
+            if (ring.pop(out)) {
+                ++received;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (uint64_t i = 0; i < transfers; ++i) {
+        reading.timestamp = static_cast<uint32_t>(i);
+        while (!ring.push(reading)) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    const auto end = std::chrono::steady_clock::now();
+    bench::report("SpscRing transfer (two threads)",
+                  std::chrono::duration<double, std::nano>(end - start).count() / transfers,
+                  transfers);
+
+    JitterMonitor monitor("bench", SENSOR_READ_INTERVAL);
+    bench::measure("JitterMonitor::onWake+onDone", 5000000, [&](uint64_t i) {
+        const uint32_t now = static_cast<uint32_t>(i) * SENSOR_READ_INTERVAL * 1000UL;
+        monitor.onWake(now + (i & 0x3F));
+        monitor.onDone(now + 200);
+    });
+}
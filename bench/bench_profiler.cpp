@@ -0,0 +1,247 @@
+/**
+ * @file bench_profiler.cpp
+ * @brief Cost and accuracy of the loop profiler, and a profiled polling loop.
+ *
+ * The cost cases time one lap (two cycle-counter reads and a histogram
+ * update) and a bare histogram update. The accuracy cases compare the
+ * histogram's p50 and p99 with the exact percentiles of sorted samples
+ * from three latency shapes. Finally the polled loop of main.cpp runs with
+ * the stand-in sensors, display and MQTT broker for one report period, and
+ * the stage table and the published message are checked. On the host the
+ * cycle counter follows the virtual clock, so the stage times are the
+ * simulated bus, sensor and network times.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "connectivity/CloudUploader.h"
+#include "connectivity/WiFiManager.h"
+#include "display/OledDisplay.h"
+#include "sensors/DHTSensor.h"
+#include "sensors/LightSensor.h"
+#include "sensors/SensorRegistry.h"
+#include "utils/AlertManager.h"
+#include "utils/CycleHistogram.h"
+#include "utils/LoopProfiler.h"
+
+namespace {
+
+/** Small deterministic generator so runs are identical. */
+struct Noise {
+    uint32_t state;
+    double uniform() {
+        state = state * 1664525u + 1013904223u;
+        return (static_cast<double>(state >> 8) + 0.5) / 16777216.0;
+    }
+};
+
+struct Shape {
+    const char *name;
+    uint32_t (*draw)(Noise &);
+};
+
+/** Tight stage with rare slow outliers (cache miss, interrupt). */
+uint32_t drawTight(Noise &n) {
+    return n.uniform() < 0.02 ? 20000 + static_cast<uint32_t>(n.uniform() * 80000)
+                              : 1200 + static_cast<uint32_t>(n.uniform() * 100);
+}
+
+/** Long-tailed I/O stage. */
+uint32_t drawLogNormal(Noise &n) {
+    const double g = sqrt(-2.0 * log(n.uniform())) * cos(2.0 * M_PI * n.uniform());
+    return static_cast<uint32_t>(exp(11.0 + 0.8 * g));
+}
+
+/** Two modes: cached path and bus transfer. */
+uint32_t drawBimodal(Noise &n) {
+    return n.uniform() < 0.7 ? 800 + static_cast<uint32_t>(n.uniform() * 50)
+                             : 5000000 + static_cast<uint32_t>(n.uniform() * 200000);
+}
+
+/** Worst relative error of p50/p99 against the exact values; -1 if below them. */
+double percentileError(const Shape &shape) {
+    Noise noise = {42};
+    CycleHistogram histogram;
+    std::vector<uint32_t> samples;
+    for (int i = 0; i < 60000; ++i) {
+        const uint32_t v = shape.draw(noise);
+        histogram.record(v);
+        samples.push_back(v);
+    }
+    std::sort(samples.begin(), samples.end());
+    double worst = 0.0;
+    bool below = false;
+    const uint32_t perMille[] = {500, 990};
+    printf("  %-24s", shape.name);
+    for (uint32_t q : perMille) {
+        const size_t rank = (samples.size() * q + 999) / 1000;
+        const uint32_t exact = samples[rank - 1];
+        const uint32_t reported = histogram.percentile(q);
+        const double error = (static_cast<double>(reported) - exact) / exact;
+        printf(" p%-4.1f %9u exact %9u histogram (%+5.1f%%)", q / 10.0, exact, reported,
+               error * 100.0);
+        if (reported < exact) {
+            below = true;
+        }
+        worst = std::max(worst, error);
+    }
+    printf("\n");
+    return below ? -1.0 : worst;
+}
+
+void printStage(const LoopProfiler &profiler, ProfileStage stage) {
+    const CycleHistogram &h = profiler.histogram(stage);
+    if (h.count() == 0) {
+        return;
+    }
+    const double mhz = ESP.getCpuFreqMHz();
+    printf("  %-8s %6u %10.1f %10.1f %10.1f %10.1f\n", LoopProfiler::stageName(stage),
+           static_cast<unsigned>(h.count()), h.min() / mhz, h.percentile(500) / mhz,
+           h.percentile(990) / mhz, h.max() / mhz);
+}
+
+} // namespace
+
+void benchProfiler() {
+    bench::suite("profiler");
+    static LoopProfiler profiler;
+    const double lapNs = bench::measure("LoopProfiler::lap", 2000000, [&](uint64_t i) {
+        hal::advanceMicros(i & 7);
+        profiler.lap(static_cast<ProfileStage>(i % PROFILE_STAGES));
+    });
+    CycleHistogram histogram;
+    bench::measure("CycleHistogram::record", 2000000, [&](uint64_t i) {
+        histogram.record(static_cast<uint32_t>(i * 2654435761u));
+        bench::doNotOptimize(histogram);
+    });
+    printf("  RAM: %u B per stage, %u B for %u stages and the message buffer\n",
+           static_cast<unsigned>(sizeof(CycleHistogram)),
+           static_cast<unsigned>(sizeof(LoopProfiler)), static_cast<unsigned>(PROFILE_STAGES));
+
+    const Shape shapes[] = {
+        {"tight + 2% outliers", drawTight},
+        {"log-normal", drawLogNormal},
+        {"bimodal", drawBimodal},
+    };
+    double worstError = 0.0;
+    bool neverBelow = true;
+    for (const Shape &shape : shapes) {
+        const double error = percentileError(shape);
+        neverBelow = neverBelow && error >= 0.0;
+        worstError = std::max(worstError, error);
+    }
+
+    // The polled loop of main.cpp for one report period
+    hal::setDHTReading(23.5f, 41.0f);
+    hal::setAnalogValue(LDR_PIN, 1500);
+    hal::setWiFiAvailable(true);
+    hal::setMqttAvailable(true);
+    WiFi.begin("bench");
+    hal::advanceMillis(60000);
+    DHTSensor dht;
+    LightSensor light;
+    OledDisplay display;
+    WiFiManager wifi;
+    AlertManager alerts;
+    CloudUploader uploader;
+    SensorRegistry<> registry;
+    dht.begin();
+    light.begin();
+    display.begin();
+    alerts.begin();
+    registry.add(dht);
+    registry.add(light);
+    uploader.setTarget(UPLOAD_MQTT);
+    uploader.begin();
+    LoopProfiler &loop = *new LoopProfiler();
+    loop.closePeriod(millis());
+    hal::resetStats();
+
+    uint32_t lastSensor = 0;
+    uint32_t lastDisplay = 0;
+    uint32_t lastUpload = 0;
+    uint32_t loops = 0;
+    uint32_t sensorTicks = 0;
+    size_t length = 0;
+    for (;;) {
+        const uint32_t now = millis();
+        PROFILE_LOOP_BEGIN(loop);
+        wifi.loop();
+        PROFILE_LAP(loop, PROFILE_WIFI);
+        if (now - lastSensor >= SENSOR_READ_INTERVAL) {
+            lastSensor = now;
+            ++sensorTicks;
+            PROFILE_MARK(loop);
+            const float *row = registry.readSensors();
+            PROFILE_LAP(loop, PROFILE_SENSORS);
+            registry.addSamples(row);
+            PROFILE_LAP(loop, PROFILE_FILTER);
+            alerts.update(registry.view(), now);
+            PROFILE_LAP(loop, PROFILE_ALERTS);
+        }
+        if (now - lastDisplay >= DISPLAY_UPDATE_INTERVAL) {
+            lastDisplay = now;
+            PROFILE_MARK(loop);
+            display.showChannels(registry.view());
+            PROFILE_LAP(loop, PROFILE_DISPLAY);
+        }
+        if (now - lastUpload >= CLOUD_UPLOAD_INTERVAL) {
+            lastUpload = now;
+            PROFILE_MARK(loop);
+            // Inline, as the worker task would send it
+            uploader.uploadChannels(registry.view());
+            while (uploader.process()) {
+            }
+            PROFILE_LAP(loop, PROFILE_UPLOAD);
+        }
+        PROFILE_LOOP_END(loop);
+        ++loops;
+        if (loop.due(now)) {
+            printf("  stage     count    min us     p50 us     p99 us     max us\n");
+            for (size_t s = 0; s < PROFILE_STAGES; ++s) {
+                printStage(loop, static_cast<ProfileStage>(s));
+            }
+            length = loop.closePeriod(now);
+            break;
+        }
+        delay(10);
+    }
+    const uint32_t dataPublishes = hal::mqttStats().requests;
+    const uint64_t dataBytes = hal::mqttStats().bytesSent;
+    uploader.uploadProfile(loop.payload(), length);
+    while (uploader.process()) {
+    }
+    printf("  %s: %s (%u B)\n", MQTT_TOPIC_PROFILE, loop.payload(),
+           static_cast<unsigned>(length));
+    const hal::NetStats &mqtt = hal::mqttStats();
+    const bool published = length > 0 && mqtt.requests == dataPublishes + 1 &&
+                           mqtt.bytesSent == dataBytes + length + sizeof(MQTT_TOPIC_PROFILE) - 1;
+    const bool stagesOk = strstr(loop.payload(), "\"loop\":[") &&
+                          strstr(loop.payload(), "\"sensors\":[") &&
+                          strstr(loop.payload(), "\"display\":[") &&
+                          strstr(loop.payload(), "\"upload\":[") &&
+                          loop.histogram(PROFILE_LOOP).count() == 0;
+    printf("  %u loops, %u sensor cycles in %u s\n", static_cast<unsigned>(loops),
+           static_cast<unsigned>(sensorTicks), PROFILER_REPORT_INTERVAL / 1000);
+    delete &loop;
+
+    if (lapNs > 50.0) {
+        bench::fail("Timing a stage costs more than 50 ns on the host");
+    }
+    if (!neverBelow || worstError > 0.25) {
+        bench::fail("Histogram percentiles are off by more than one bucket");
+    }
+    if (!stagesOk) {
+        bench::fail("Profile message misses a stage or histograms were not cleared");
+    }
+    if (!published) {
+        bench::fail("Profile message not published on MQTT_TOPIC_PROFILE");
+    }
+}
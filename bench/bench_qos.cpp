@@ -0,0 +1,189 @@
+/**
+ * @file bench_qos.cpp
+ * @brief Reconnects, delivery and throughput of the MQTT session under loss.
+ *
+ * Six simulated hours of one message per CLOUD_UPLOAD_INTERVAL go to the
+ * broker stand-in while it loses 0 to 10% of the packets in each
+ * direction, three ways: QoS 0 with the session serviced only when a
+ * message is due (the old upload path: the keep-alive lapses between
+ * messages), QoS 0 serviced every 100 ms, and QoS 1 serviced every 100 ms.
+ * A subscriber behind the broker counts each sequence number. The suite
+ * reports reconnects per hour, the share of accepted messages delivered,
+ * duplicates and retransmissions, then the throughput of back-to-back QoS 1
+ * messages at 20 ms round trip with one message in flight against a full
+ * window. It fails if QoS 1 loses a message, if a serviced session
+ * reconnects without loss, or if the window is not at least four times
+ * faster.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "connectivity/MqttSession.h"
+
+namespace {
+
+const uint32_t kHours = 6;
+const uint32_t kServiceMs = 100;         ///< loop() period of a serviced session
+const float kLossRates[] = {0.0f, 0.01f, 0.05f, 0.10f};
+const uint32_t kBurstMessages = 400;
+const unsigned long kBurstRttMs = 20;
+const char kBroker[] = "localhost";    ///< Any host reaches the stand-in on MQTT_PORT
+
+/** Deliveries per sequence number, as a subscriber sees them. */
+std::vector<uint8_t> s_received;
+
+void onPublish(const char *topic, const uint8_t *payload, size_t length) {
+    uint32_t sequence;
+    if (strcmp(topic, MQTT_TOPIC_DATA) != 0 || length < sizeof(sequence)) {
+        return;
+    }
+    memcpy(&sequence, payload, sizeof(sequence));
+    if (sequence < s_received.size() && s_received[sequence] < 255) {
+        ++s_received[sequence];
+    }
+}
+
+enum Mode { PER_CYCLE_QOS0, SERVICED_QOS0, SERVICED_QOS1 };
+
+const char *const kModeNames[] = {"per cycle, QoS 0", "serviced, QoS 0", "serviced, QoS 1"};
+
+struct Result {
+    MqttSessionStats stats;
+    uint32_t accepted;     ///< publish() succeeded
+    uint32_t refused;      ///< No session, or the window stayed full
+    uint32_t delivered;    ///< Distinct messages the subscriber got
+    uint32_t duplicates;
+};
+
+Result run(Mode mode, float loss) {
+    const uint32_t messages = kHours * 3600000UL / CLOUD_UPLOAD_INTERVAL;
+    s_received.assign(messages, 0);
+    MqttSession session(kBroker, MQTT_PORT);
+    session.setClientId("bench-qos");
+    hal::setMqttPacketLoss(loss);
+
+    Result r = {};
+    uint8_t payload[40] = {0};   // About a CBOR reading
+    const uint8_t qos = mode == SERVICED_QOS1 ? 1 : 0;
+    for (uint32_t sequence = 0; sequence < messages; ++sequence) {
+        memcpy(payload, &sequence, sizeof(sequence));
+        // As uploadMQTT(): connect unless open, then publish
+        if (session.connect() &&
+            session.publish(MQTT_TOPIC_DATA, payload, sizeof(payload), qos)) {
+            ++r.accepted;
+        } else {
+            ++r.refused;
+        }
+        if (mode == PER_CYCLE_QOS0) {
+            hal::advanceMillis(CLOUD_UPLOAD_INTERVAL);
+            continue;
+        }
+        for (uint32_t t = 0; t < CLOUD_UPLOAD_INTERVAL; t += kServiceMs) {
+            hal::advanceMillis(kServiceMs);
+            session.loop();
+        }
+    }
+    // Whatever is still in flight is retransmitted until acknowledged
+    session.flush(600000);
+    hal::setMqttPacketLoss(0.0f);
+    session.disconnect();
+
+    r.stats = session.getStats();
+    for (uint8_t deliveries : s_received) {
+        r.delivered += deliveries > 0 ? 1 : 0;
+        r.duplicates += deliveries > 1 ? deliveries - 1 : 0;
+    }
+    return r;
+}
+
+/** Messages per second of a burst of QoS 1 publishes with @p window in flight. */
+double burst(size_t window) {
+    hal::setMqttLatency(kBurstRttMs);
+    MqttSession session(kBroker, MQTT_PORT);
+    session.setClientId("bench-qos-burst");
+    session.setWindow(window);
+    session.connect();
+    uint8_t payload[40] = {0};
+    const uint32_t start = millis();
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < kBurstMessages; ++i) {
+        accepted += session.publish(MQTT_TOPIC_DATA, payload, sizeof(payload), 1) ? 1 : 0;
+    }
+    const bool flushed = session.flush(60000);
+    const uint32_t elapsed = millis() - start;
+    session.disconnect();
+    hal::setMqttLatency(0);
+    if (accepted != kBurstMessages || !flushed) {
+        bench::fail("QoS 1 burst not acknowledged");
+    }
+    return elapsed > 0 ? kBurstMessages * 1000.0 / elapsed : 0.0;
+}
+
+} // namespace
+
+void benchQos() {
+    bench::suite("qos");
+    hal::setWiFiAvailable(true);
+    hal::setMqttAvailable(true);
+    hal::setMqttLatency(0);
+    WiFi.begin("bench");
+    hal::advanceMillis(60000);
+
+    // Host cost of taking one message into the window and reading its PUBACK
+    MqttSession session(kBroker, MQTT_PORT);
+    session.setClientId("bench-qos-cost");
+    session.connect();
+    uint8_t payload[40] = {0};
+    bench::measure("MqttSession::publish+loop (QoS 0)", 200000, [&](uint64_t) {
+        session.publish(MQTT_TOPIC_DATA, payload, sizeof(payload), 0);
+        session.loop();
+    });
+    bench::measure("MqttSession::publish+loop (QoS 1)", 200000, [&](uint64_t) {
+        session.publish(MQTT_TOPIC_DATA, payload, sizeof(payload), 1);
+        session.loop();
+    });
+    session.disconnect();
+
+    hal::setMqttPublishHook(onPublish);
+    printf("  %-17s %5s %11s %9s %9s %5s %5s %9s\n", "mode", "loss", "connects/h", "refused",
+           "delivered", "dup", "retx", "max ack");
+    char what[128];
+    for (float loss : kLossRates) {
+        for (Mode mode : {PER_CYCLE_QOS0, SERVICED_QOS0, SERVICED_QOS1}) {
+            const Result r = run(mode, loss);
+            printf("  %-17s %4.0f%% %11.1f %9u %8.2f%% %5u %5u %6u ms\n", kModeNames[mode],
+                   loss * 100.0f, static_cast<double>(r.stats.connects) / kHours,
+                   static_cast<unsigned>(r.refused),
+                   r.accepted ? 100.0 * r.delivered / r.accepted : 0.0,
+                   static_cast<unsigned>(r.duplicates),
+                   static_cast<unsigned>(r.stats.retransmitted),
+                   static_cast<unsigned>(r.stats.maxAckMs));
+            if (mode == SERVICED_QOS1 && (r.delivered != r.accepted || r.stats.inFlight != 0)) {
+                snprintf(what, sizeof(what), "QoS 1 at %.0f%% loss: %u of %u delivered",
+                         loss * 100.0f, static_cast<unsigned>(r.delivered),
+                         static_cast<unsigned>(r.accepted));
+                bench::fail(what);
+            }
+            if (mode != PER_CYCLE_QOS0 && loss == 0.0f && r.stats.connects != 1) {
+                snprintf(what, sizeof(what), "%s: %u connects without loss", kModeNames[mode],
+                         static_cast<unsigned>(r.stats.connects));
+                bench::fail(what);
+            }
+        }
+    }
+    hal::setMqttPublishHook(nullptr);
+
+    const double single = burst(1);
+    const double window = burst(MQTT_INFLIGHT_MAX);
+    printf("  burst of %u at %lu ms RTT: %.0f msg/s with 1 in flight, %.0f with %u (%.1fx)\n",
+           static_cast<unsigned>(kBurstMessages), kBurstRttMs, single, window,
+           static_cast<unsigned>(MQTT_INFLIGHT_MAX), single > 0 ? window / single : 0.0);
+    if (window < 4.0 * single) {
+        bench::fail("QoS 1 window less than 4x faster than one message in flight");
+    }
+}
@@ -0,0 +1,208 @@
+/**
+ * @file bench_registry.cpp
+ * @brief Per-cycle cost of the sensor registry from 3 to 64 channels.
+ *
+ * One cycle is what the polling loop does per channel: add a row of
+ * samples to the struct-of-arrays store, evaluate alerts and encode the
+ * upload payload. The suite checks that the cost per channel stays flat
+ * (linear growth), that paging the display covers every channel, and
+ * that the three standard channels render exactly like showReadings().
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "connectivity/CloudUploader.h"
+#include "display/OledDisplay.h"
+#include "sensors/DHTSensor.h"
+#include "sensors/LightSensor.h"
+#include "sensors/SensorRegistry.h"
+#include "utils/AlertManager.h"
+#include "utils/DataFilter.h"
+
+namespace {
+
+const size_t kMaxChannels = 64;
+typedef SensorRegistry<kMaxChannels, SENSOR_MAX_SENSORS> BenchRegistry;
+
+char s_labels[kMaxChannels][8];
+char s_keys[kMaxChannels][8];
+ChannelSpec s_specs[kMaxChannels];
+
+void makeSpecs() {
+    for (size_t c = 0; c < kMaxChannels; ++c) {
+        snprintf(s_labels[c], sizeof(s_labels[c]), "T%u", static_cast<unsigned>(c));
+        snprintf(s_keys[c], sizeof(s_keys[c]), "t%u", static_cast<unsigned>(c));
+        s_specs[c] = ChannelSpec{s_labels[c], s_keys[c], "C", 1, -40.0f, 80.0f};
+    }
+}
+
+/** ns per cycle of @p channels channels: store, alerts and payload. */
+double cycleCost(size_t channels) {
+    static BenchRegistry registry;
+    registry = BenchRegistry();
+    for (size_t c = 0; c < channels; ++c) {
+        registry.addChannel(s_specs[c]);
+    }
+    AlertManager alerts;
+    CloudUploader uploader;
+    float row[kMaxChannels];
+    uint8_t payload[32 + 20 * kMaxChannels];
+
+    char name[48];
+    snprintf(name, sizeof(name), "cycle, %u channels", static_cast<unsigned>(channels));
+    return bench::measure(name, 200000, [&](uint64_t i) {
+        for (size_t c = 0; c < channels; ++c) {
+            row[c] = 20.0f + static_cast<float>((i + c) & 7) * 0.5f;
+        }
+        registry.addSamples(row);
+        const ChannelView view = registry.view();
+        bench::doNotOptimize(alerts.update(view, static_cast<uint32_t>(i)));
+        bench::doNotOptimize(uploader.encodeChannels(view, static_cast<uint32_t>(i), 1,
+                                                     MQTT_PAYLOAD_JSON, payload,
+                                                     sizeof(payload)));
+    });
+}
+
+/** Reference: the fixed three-channel path of the polling loop before the registry. */
+void fixedCost() {
+    DataFilter<FILTER_WINDOW_SIZE> t, h, l;
+    AlertManager alerts;
+    CloudUploader uploader;
+    uint8_t payload[MQTT_PAYLOAD_MAX];
+    bench::measure("fixed path, 3 channels", 200000, [&](uint64_t i) {
+        t.addValue(20.0f + (i & 7) * 0.5f);
+        h.addValue(45.0f);
+        l.addValue(2000.0f);
+        bench::doNotOptimize(alerts.update(t.getAverage(), h.getAverage(),
+                                           static_cast<int>(l.getAverage()),
+                                           static_cast<uint32_t>(i)));
+        SensorReading r = {static_cast<uint32_t>(i), t.getAverage(), h.getAverage(),
+                           static_cast<int>(l.getAverage()), 0};
+        bench::doNotOptimize(
+            uploader.encodePayload(r, 1, MQTT_PAYLOAD_JSON, payload, sizeof(payload)));
+    });
+}
+
+bool checkDisplayPaging(OledDisplay &display) {
+    BenchRegistry registry;
+    for (size_t c = 0; c < kMaxChannels; ++c) {
+        registry.addChannel(s_specs[c]);
+    }
+    float row[kMaxChannels];
+    for (size_t c = 0; c < kMaxChannels; ++c) {
+        row[c] = static_cast<float>(c);
+    }
+    registry.addSamples(row);
+    const size_t pages = OledDisplay::channelPages(kMaxChannels);
+    hal::resetStats();
+    for (size_t p = 0; p < pages; ++p) {
+        display.showChannels(registry.view(), p);
+    }
+    printf("  display: %u channels on %u pages, %.1f B/page\n",
+           static_cast<unsigned>(kMaxChannels), static_cast<unsigned>(pages),
+           static_cast<double>(hal::i2cBytesWritten()) / pages);
+    // 7 channels per page plus the page indicator
+    return pages == (kMaxChannels + 6) / 7;
+}
+
+} // namespace
+
+void benchRegistry() {
+    bench::suite("registry");
+    makeSpecs();
+
+    fixedCost();
+    const size_t kCounts[] = {3, 8, 16, 32, 64};
+    double perChannel[5];
+    for (size_t i = 0; i < 5; ++i) {
+        perChannel[i] = cycleCost(kCounts[i]) / kCounts[i];
+    }
+    printf("  per channel:");
+    for (size_t i = 0; i < 5; ++i) {
+        printf(" %u: %.1f ns", static_cast<unsigned>(kCounts[i]), perChannel[i]);
+    }
+    printf("\n");
+
+    // Real sensors through the registry
+    hal::setDHTReading(23.5f, 41.0f);
+    hal::setAnalogValue(LDR_PIN, 1500);
+    DHTSensor dht;
+    LightSensor light;
+    dht.begin();
+    light.begin();
+    SensorRegistry<> registry;
+    registry.add(dht);
+    registry.add(light);
+    for (int i = 0; i < FILTER_WINDOW_SIZE; ++i) {
+        hal::advanceMillis(SENSOR_READ_INTERVAL);
+        registry.sample();
+    }
+    const bool sensorsOk = registry.channelCount() == 3 &&
+                           fabsf(registry.average(0) - 23.5f) < 0.05f &&
+                           fabsf(registry.average(1) - 41.0f) < 0.05f &&
+                           fabsf(registry.average(2) -
+                                 static_cast<float>(light.getWindow().millivolts)) < 2.0f;
+
+    // The standard channels render exactly like the fixed display path
+    OledDisplay display;
+    display.begin();
+    display.showReadings(registry.average(0), registry.average(1),
+                         static_cast<int>(lroundf(registry.average(2))));
+    uint8_t fixedFrame[OLED_WIDTH * OLED_HEIGHT / 8];
+    memcpy(fixedFrame, display.frameBuffer(), sizeof(fixedFrame));
+    display.showStatus("sync");
+    display.showChannels(registry.view());
+    const bool sameFrame = memcmp(fixedFrame, display.frameBuffer(), sizeof(fixedFrame)) == 0;
+
+    // A failed DHT leaves gaps, not zeros, in the window
+    hal::setDHTReading(NAN, NAN);
+    hal::advanceMillis(SENSOR_READ_INTERVAL);
+    registry.sample();
+    const bool gapOk = registry.validCount(0) == FILTER_WINDOW_SIZE - 1 &&
+                       fabsf(registry.average(0) - 23.5f) < 0.05f && isnan(registry.latest(0));
+    hal::setDHTReading(22.0f, 45.0f);
+
+    const bool pagingOk = checkDisplayPaging(display);
+
+    // All channels in one MQTT message
+    hal::setWiFiAvailable(true);
+    hal::setMqttAvailable(true);
+    WiFi.begin("bench");
+    hal::advanceMillis(60000);
+    CloudUploader uploader;
+    uploader.setTarget(UPLOAD_MQTT);
+    uploader.begin();
+    hal::resetStats();
+    uploader.uploadChannels(registry.view());
+    while (uploader.process()) {
+    }
+    uint8_t payload[MQTT_CHANNEL_PAYLOAD_MAX];
+    const size_t length = uploader.encodeChannels(registry.view(), 0, 0, MQTT_PAYLOAD_JSON,
+                                                  payload, sizeof(payload));
+    printf("  upload: %s\n", reinterpret_cast<const char *>(payload));
+    const bool uploadOk = uploader.getStats().sent == 1 && hal::mqttStats().requests == 1 &&
+                          length > 0;
+
+    if (perChannel[4] > 2.0 * perChannel[1]) {
+        bench::fail("Registry cost per channel grows with the channel count");
+    }
+    if (!sensorsOk) {
+        bench::fail("Registry averages do not match the sensors");
+    }
+    if (!sameFrame) {
+        bench::fail("showChannels() differs from showReadings() for the standard channels");
+    }
+    if (!gapOk) {
+        bench::fail("Failed sample was not treated as a gap");
+    }
+    if (!pagingOk) {
+        bench::fail("Display pages do not cover every channel");
+    }
+    if (!uploadOk) {
+        bench::fail("Channel frame was not published");
+    }
+}
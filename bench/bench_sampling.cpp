@@ -0,0 +1,277 @@
+/**
+ * @file bench_sampling.cpp
+ * @brief Sensor reads against reconstruction error, fixed and adaptive.
+ *
+ * Each trace is a day of the true signal at one-second resolution
+ * (temperature, humidity, light). It is replayed through a SensorRegistry
+ * whose DHT and LDR stand-ins return the signal at the current virtual
+ * time with the sensor's noise and resolution. The loop is polled every
+ * 10 ms, reading either every SENSOR_READ_INTERVAL or as AdaptiveSampler
+ * decides. The reads of each channel are then turned back into a signal,
+ * held until the next read (what alerts and the display see) and linearly
+ * interpolated (what the history allows afterwards), and compared with
+ * the truth every second. For the traces with events (doors, lamps,
+ * vents, irrigation, clouds) the delay from the start of each event to
+ * the next read of its channel is reported as well.
+ *
+ * A recorded trace can be added with BENCH_SAMPLING_TRACE=<file>, in the
+ * format of BENCH_HISTORY_TRACE ("timestamp_ms,temperature,humidity,light"
+ * per line); its values are replayed as they are, without added noise.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "Bench.h"
+#include "BenchTraces.h"
+#include "NativeHal.h"
+#include "sensors/AdaptiveSampler.h"
+#include "sensors/SensorRegistry.h"
+
+namespace {
+
+using namespace traces;
+
+const uint32_t kPollMs = 10;
+
+typedef SensorRegistry<SENSOR_MAX_CHANNELS, SENSOR_MAX_SENSORS> BenchRegistry;
+
+/** Rows held until the next one, failed reads keep the previous value. */
+bool loadTrace(const char *path, Trace &trace) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    trace = Trace{"recorded", {}, {}, 0.0f, 0.0f, 0.0f};
+    char line[160];
+    uint32_t first = 0;
+    bool started = false;
+    float held[kChannels] = {NAN, NAN, NAN};
+    while (fgets(line, sizeof(line), file)) {
+        char *p = line;
+        const uint32_t timestamp = static_cast<uint32_t>(strtoul(p, &p, 10));
+        if (!started) {
+            first = timestamp;
+            started = true;
+        }
+        const size_t second = (timestamp - first) / 1000;
+        while (trace.truth[0].size() < second) {
+            for (size_t c = 0; c < kChannels; ++c) {
+                trace.truth[c].push_back(held[c]);
+            }
+        }
+        for (size_t c = 0; c < kChannels; ++c) {
+            if (*p == ',') {
+                ++p;
+                char *end;
+                const float v = strtof(p, &end);
+                if (end != p) {
+                    held[c] = v;
+                }
+                p = end;
+            }
+        }
+    }
+    fclose(file);
+    for (size_t c = 0; c < kChannels; ++c) {
+        trace.truth[c].push_back(held[c]);
+    }
+    return trace.truth[0].size() > 1;
+}
+
+
+struct Read {
+    uint32_t ms;
+    float value;
+};
+
+struct Result {
+    uint32_t reads[2];              ///< DHT, LDR
+    double holdRms[kChannels];
+    double linearRms[kChannels];
+    double holdMax[kChannels];
+    double meanDelayMs;             ///< Event start to the next read of its channel
+    double maxDelayMs;
+};
+
+/** Error of @p reads against the truth, held and linearly interpolated. */
+void reconstruct(const std::vector<Read> &reads, const std::vector<float> &truth, double &holdRms,
+                 double &linearRms, double &holdMax) {
+    double holdSq = 0.0, linearSq = 0.0;
+    holdMax = 0.0;
+    size_t n = 0;
+    size_t next = 0;   // First read after the current second
+    for (size_t s = 0; s < truth.size(); ++s) {
+        const uint32_t ms = static_cast<uint32_t>(s * 1000);
+        while (next < reads.size() && reads[next].ms <= ms) {
+            ++next;
+        }
+        if (next == 0 || truth[s] != truth[s]) {
+            continue;   // nothing read yet
+        }
+        const Read &before = reads[next - 1];
+        double linear = before.value;
+        if (next < reads.size()) {
+            const Read &after = reads[next];
+            const double f = static_cast<double>(ms - before.ms) / (after.ms - before.ms);
+            linear = before.value + f * (after.value - before.value);
+        }
+        const double hold = fabs(before.value - truth[s]);
+        holdSq += hold * hold;
+        linearSq += (linear - truth[s]) * (linear - truth[s]);
+        holdMax = hold > holdMax ? hold : holdMax;
+        ++n;
+    }
+    holdRms = n > 0 ? sqrt(holdSq / n) : 0.0;
+    linearRms = n > 0 ? sqrt(linearSq / n) : 0.0;
+}
+
+/** Replay @p trace through the polled loop's sampling. */
+Result replay(const Trace &trace, bool adaptive) {
+    BenchRegistry registry;
+    TraceSensor dht(trace, 0, 2, 7);
+    TraceSensor ldr(trace, 2, 1, 11);
+    registry.add(dht);
+    registry.add(ldr);
+    AdaptiveSampler<BenchRegistry> sampler(registry);
+    sampler.begin(0);
+
+    std::vector<Read> reads[kChannels];
+    Result r = {};
+    const uint32_t endMs = static_cast<uint32_t>(trace.truth[0].size() * 1000);
+    uint32_t lastRead = 0;
+    bool first = true;
+    for (uint32_t now = 0; now < endMs; now += kPollMs) {
+        SensorMask mask = 0;
+        if (adaptive) {
+            mask = sampler.due(now);
+        } else if (first || now - lastRead >= SENSOR_READ_INTERVAL) {
+            mask = SENSOR_MASK_ALL;
+            lastRead = now;
+            first = false;
+        }
+        if (mask == 0) {
+            continue;
+        }
+        dht.setSecond(now / 1000);
+        ldr.setSecond(now / 1000);
+        const float *row = registry.readSensors(mask);
+        registry.addSamples(row, mask);
+        sampler.update(mask, now);
+        for (size_t s = 0; s < 2; ++s) {
+            if ((mask >> s) & 1u) {
+                ++r.reads[s];
+            }
+        }
+        for (size_t c = 0; c < kChannels; ++c) {
+            const size_t sensor = c < 2 ? 0 : 1;
+            if ((mask >> sensor) & 1u && row[c] == row[c]) {
+                reads[c].push_back({now, row[c]});
+            }
+        }
+    }
+
+    for (size_t c = 0; c < kChannels; ++c) {
+        reconstruct(reads[c], trace.truth[c], r.holdRms[c], r.linearRms[c], r.holdMax[c]);
+    }
+    double delaySum = 0.0;
+    for (const Event &e : trace.events) {
+        const uint32_t start = e.start * 1000;
+        for (const Read &read : reads[e.channel]) {
+            if (read.ms >= start) {
+                const double delay = read.ms - start;
+                delaySum += delay;
+                r.maxDelayMs = delay > r.maxDelayMs ? delay : r.maxDelayMs;
+                break;
+            }
+        }
+    }
+    r.meanDelayMs = trace.events.empty() ? 0.0 : delaySum / trace.events.size();
+    return r;
+}
+
+void print(const char *mode, const Result &r, bool events) {
+    printf("  %-9s %6u %6u  %5.2f %5.2f %6.1f  %5.2f %5.2f %6.1f  %5.1f %5.1f %6.0f", mode,
+           static_cast<unsigned>(r.reads[0]), static_cast<unsigned>(r.reads[1]), r.holdRms[0],
+           r.holdRms[1], r.holdRms[2], r.linearRms[0], r.linearRms[1], r.linearRms[2],
+           r.holdMax[0], r.holdMax[1], r.holdMax[2]);
+    if (events) {
+        printf("  %5.1f %5.1f s", r.meanDelayMs / 1000.0, r.maxDelayMs / 1000.0);
+    }
+    printf("\n");
+}
+
+/** Replay both ways and check adaptive sampling against the fixed interval. */
+void compare(const Trace &trace, bool checkQuiet) {
+    printf("\n  %s\n", trace.name);
+    const Result fixed = replay(trace, false);
+    const Result adaptive = replay(trace, true);
+    const bool events = !trace.events.empty();
+    print("fixed", fixed, events);
+    print("adaptive", adaptive, events);
+    printf("  reads: DHT %.0f%%, LDR %.0f%% of fixed\n", 100.0 * adaptive.reads[0] / fixed.reads[0],
+           100.0 * adaptive.reads[1] / fixed.reads[1]);
+
+    char what[128];
+    if (checkQuiet && (adaptive.reads[0] * 5 > fixed.reads[0] * 3 ||
+                       adaptive.reads[1] * 5 > fixed.reads[1] * 3)) {
+        snprintf(what, sizeof(what), "%s: adaptive sampling reads more than 60%% of fixed",
+                 trace.name);
+        bench::fail(what);
+    }
+    // maxInterval trades reads for detection: keep the worst case within
+    // the order of the fixed cadence
+    if (events && adaptive.maxDelayMs > 3.0 * fixed.maxDelayMs) {
+        snprintf(what, sizeof(what), "%s: event noticed after %.1f s vs %.1f s fixed", trace.name,
+                 adaptive.maxDelayMs / 1000.0, fixed.maxDelayMs / 1000.0);
+        bench::fail(what);
+    }
+    // The error may grow, but not beyond a fraction of each channel's
+    // quiet band: events are followed at the fast interval
+    const float bound[kChannels] = {TEMP_QUIET_STDDEV, HUMID_QUIET_STDDEV, LIGHT_QUIET_STDDEV};
+    for (size_t c = 0; c < kChannels; ++c) {
+        if (adaptive.linearRms[c] > fixed.linearRms[c] + bound[c]) {
+            snprintf(what, sizeof(what), "%s: %s error %.2f vs %.2f fixed", trace.name,
+                     kSpecs[c].label, adaptive.linearRms[c], fixed.linearRms[c]);
+            bench::fail(what);
+        }
+    }
+}
+
+} // namespace
+
+void benchSampling() {
+    bench::suite("sampling");
+    printf("  %-9s %6s %6s  %-19s  %-19s  %-18s  %s\n", "mode", "DHT", "LDR", "RMS held t/h/l",
+           "RMS linear t/h/l", "max held t/h/l", "event delay mean/max");
+
+    compare(quietOffice(), true);
+    compare(busyOffice(), false);
+    compare(greenhouse(), false);
+    const char *path = getenv("BENCH_SAMPLING_TRACE");
+    Trace recorded;
+    if (path && loadTrace(path, recorded)) {
+        compare(recorded, false);
+    }
+
+    // Cost of the scheduling itself, per loop pass and per read
+    BenchRegistry registry;
+    const Trace trace = quietOffice();
+    TraceSensor dht(trace, 0, 2, 7);
+    TraceSensor ldr(trace, 2, 1, 11);
+    registry.add(dht);
+    registry.add(ldr);
+    AdaptiveSampler<BenchRegistry> sampler(registry);
+    sampler.begin(0);
+    bench::measure("AdaptiveSampler::due", 1000000, [&](uint64_t i) {
+        bench::doNotOptimize(sampler.due(static_cast<uint32_t>(i)));
+    });
+    const float row[kChannels] = {21.0f, 48.0f, 1200.0f};
+    bench::measure("addSamples + AdaptiveSampler::update", 1000000, [&](uint64_t i) {
+        registry.addSamples(row, SENSOR_MASK_ALL);
+        sampler.update(SENSOR_MASK_ALL, static_cast<uint32_t>(i) * 1000);
+    });
+}
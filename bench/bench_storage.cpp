@@ -0,0 +1,332 @@
+/**
+ * @file bench_storage.cpp
+ * @brief Flash log capacity, throughput and power-loss recovery.
+ *
+ * Runs FlashLog on the file-backed FileFlash stand-in. Besides timing
+ * append and replay, the suite checks that the ring holds capacity()
+ * readings, wears all sectors evenly, survives a power cut at any byte of
+ * a write or erase without losing acknowledged readings, keeps the time of
+ * readings stored before a reboot, and that replay through StoreAndForward
+ * never crowds out live uploads nor loses readings the broker did not take.
+ */
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FileFlash.h"
+#include "NativeHal.h"
+#include "connectivity/StoreAndForward.h"
+#include "storage/FlashLog.h"
+
+namespace {
+
+const char *kImagePath = "bench_flash.bin";
+
+/** A reading numbered @p timestamp in its light field too, which survives a remount. */
+SensorReading makeReading(uint32_t timestamp) {
+    SensorReading reading = {timestamp, 21.5f, 48.0f, static_cast<int>(timestamp), 0};
+    return reading;
+}
+
+/**
+ * Drain the log and check the reading numbers increase by one from
+ * @p first. Timestamps of an earlier boot come back in the current one.
+ */
+bool drainConsecutive(FlashLog &log, uint32_t &first, uint32_t &last, size_t &count) {
+    SensorReading batch[16];
+    count = 0;
+    bool ok = true;
+    size_t n;
+    while ((n = log.peek(batch, 16)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t number = static_cast<uint32_t>(batch[i].light);
+            if (count == 0) {
+                first = number;
+            } else if (number != last + 1) {
+                ok = false;
+            }
+            last = number;
+            ++count;
+        }
+        log.commit();
+    }
+    return ok;
+}
+
+void benchCapacity() {
+    remove(kImagePath);
+    FileFlash flash(kImagePath, 16);
+    FlashLog log(flash);
+    log.format();
+
+    const size_t capacity = log.capacity();
+    uint32_t ts = 1;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < capacity; ++i) {
+        log.append(makeReading(ts++));
+    }
+    auto end = std::chrono::steady_clock::now();
+    bench::report("FlashLog::append",
+                  std::chrono::duration<double, std::nano>(end - start).count() / capacity,
+                  capacity);
+    printf("%-40s %14lu\n", "  capacity (readings)", static_cast<unsigned long>(capacity));
+    if (log.pending() != capacity || log.getStats().overwritten != 0) {
+        bench::fail("FlashLog lost readings below capacity");
+    }
+
+    // Keep writing for many laps of the ring
+    const size_t laps = 20;
+    for (size_t i = 0; i < capacity * laps; ++i) {
+        log.append(makeReading(ts++));
+    }
+    printf("%-40s %14lu\n", "  overwritten when full",
+           static_cast<unsigned long>(log.getStats().overwritten));
+    printf("%-40s %14lu / %lu\n", "  erases per sector (min/max)",
+           static_cast<unsigned long>(flash.minEraseCount()),
+           static_cast<unsigned long>(flash.maxEraseCount()));
+    if (log.pending() < capacity) {
+        bench::fail("FlashLog kept fewer than capacity() readings when full");
+    }
+    if (flash.maxEraseCount() - flash.minEraseCount() > 1) {
+        bench::fail("FlashLog wears sectors unevenly");
+    }
+
+    uint32_t first = 0;
+    uint32_t last = 0;
+    size_t count = 0;
+    start = std::chrono::steady_clock::now();
+    const bool ordered = drainConsecutive(log, first, last, count);
+    end = std::chrono::steady_clock::now();
+    bench::report("FlashLog::peek+commit (per reading)",
+                  std::chrono::duration<double, std::nano>(end - start).count() / count, count);
+    if (!ordered || last != ts - 1) {
+        bench::fail("FlashLog replay out of order or missing the newest readings");
+    }
+}
+
+/**
+ * Cut power after every possible number of programmed bytes while
+ * appending and committing, then remount and check the log.
+ */
+void benchPowerLoss() {
+    const size_t kSectors = 6;
+    const size_t kSectorSize = 512;
+    uint32_t failures = 0;
+    uint32_t cuts = 0;
+    for (size_t cutAt = 0; cutAt < 4000; cutAt += 3) {
+        remove(kImagePath);
+        uint32_t acknowledged = 0;
+        uint32_t committedUpTo = 0;
+        {
+            FileFlash flash(kImagePath, kSectors, kSectorSize);
+            FlashLog log(flash);
+            log.format();
+            for (uint32_t ts = 1; ts <= 40; ++ts) {
+                log.append(makeReading(ts));
+            }
+            SensorReading batch[8];
+            const size_t n = log.peek(batch, 8);
+            log.commit();
+            committedUpTo = static_cast<uint32_t>(batch[n - 1].light);
+            acknowledged = 40;
+
+            // Keep appending (wrapping the ring) and replaying until the cut
+            flash.cutPowerAfter(cutAt);
+            for (uint32_t ts = 41; !flash.powerLost(); ++ts) {
+                if (log.append(makeReading(ts))) {
+                    acknowledged = ts;
+                }
+                if (ts % 10 == 0 && !flash.powerLost()) {
+                    const size_t replayed = log.peek(batch, 8);
+                    if (log.commit() && replayed > 0) {
+                        committedUpTo = static_cast<uint32_t>(batch[replayed - 1].light);
+                    }
+                }
+            }
+            ++cuts;
+        }
+
+        FileFlash flash(kImagePath, kSectors, kSectorSize);
+        FlashLog log(flash);
+        if (!log.begin()) {
+            ++failures;
+            continue;
+        }
+        uint32_t first = 0;
+        uint32_t last = 0;
+        size_t count = 0;
+        const bool ordered = drainConsecutive(log, first, last, count);
+        // Every acknowledged reading after the last commit must still be
+        // there unless the ring pushed it out; a torn commit may replay its
+        // batch again, but never skips readings. The record in flight at the
+        // cut may survive if its CRC-covered bytes made it
+        const size_t expected = acknowledged - committedUpTo;
+        const bool complete = count > 0 &&
+                              (last == acknowledged || last == acknowledged + 1) &&
+                              count >= (expected < log.capacity() ? expected : log.capacity());
+        if (!ordered || !complete) {
+            ++failures;
+        }
+    }
+    remove(kImagePath);
+    printf("%-40s %14lu\n", "  power cuts injected", static_cast<unsigned long>(cuts));
+    printf("%-40s %14lu\n", "  bad recoveries", static_cast<unsigned long>(failures));
+    if (failures > 0) {
+        bench::fail("FlashLog lost or reordered readings after a power cut");
+    }
+}
+
+/**
+ * Readings stored before a reset must come back at the time they were
+ * taken: the remounted log is a new boot, whose millis() only the
+ * calendar time stored with each record can relate to.
+ */
+void benchReboot() {
+    remove(kImagePath);
+    const uint32_t first = millis();
+    {
+        FileFlash flash(kImagePath, 8);
+        FlashLog log(flash);
+        log.format();
+        for (uint32_t i = 0; i < 10; ++i) {
+            log.append(makeReading(millis()));
+            hal::advanceMillis(CLOUD_UPLOAD_INTERVAL);
+        }
+    }
+    FileFlash flash(kImagePath, 8);
+    FlashLog log(flash);
+    log.begin();
+    SensorReading batch[16];
+    const size_t n = log.peek(batch, 16);
+    log.commit();
+    remove(kImagePath);
+    // Calendar time has whole seconds
+    int32_t worst = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const int32_t error = static_cast<int32_t>(batch[i].timestamp - batch[i].light);
+        worst = error < 0 ? (-error > worst ? -error : worst) : (error > worst ? error : worst);
+    }
+    printf("%-40s %14ld\n", "  timestamp error after reboot (ms)", static_cast<long>(worst));
+    if (n != 10 || log.getStats().stale != 0 || static_cast<uint32_t>(batch[0].light) != first ||
+        worst > 2000) {
+        bench::fail("FlashLog misplaced readings stored before a reboot");
+    }
+}
+
+/**
+ * One hour offline, then reconnect: stored readings must drain while every
+ * live reading is still accepted.
+ */
+void benchReplay() {
+    remove(kImagePath);
+    FileFlash flash(kImagePath, 32);
+    FlashLog log(flash);
+    log.format();
+    CloudUploader uploader;
+    uploader.begin();
+    uploader.setTarget(UPLOAD_MQTT);
+    StoreAndForward saf(log, uploader);
+    saf.begin();
+
+    const unsigned long kTickMs = 100;
+    unsigned long lastLive = millis();
+    for (unsigned long t = 0; t < 3600000; t += CLOUD_UPLOAD_INTERVAL) {
+        saf.submit(makeReading(millis()), false);
+        hal::advanceMillis(CLOUD_UPLOAD_INTERVAL);
+    }
+    const size_t stored = saf.pending();
+
+    const unsigned long reconnect = millis();
+    unsigned long drainedAfter = 0;
+    size_t live = 0;
+    for (unsigned long t = 0; t < 3600000; t += kTickMs) {
+        if (millis() - lastLive >= CLOUD_UPLOAD_INTERVAL) {
+            lastLive = millis();
+            saf.submit(makeReading(millis()), true);
+            ++live;
+        }
+        saf.loop(true);
+        uploader.process();
+        if (drainedAfter == 0 && saf.pending() == 0) {
+            drainedAfter = millis() - reconnect;
+        }
+        hal::advanceMillis(kTickMs);
+    }
+    while (uploader.process()) {
+    }
+    remove(kImagePath);
+
+    const UploadStats stats = uploader.getStats();
+    printf("%-40s %14lu\n", "  readings stored offline (1 h)", static_cast<unsigned long>(stored));
+    printf("%-40s %14lu\n", "  backlog drained after (ms)", drainedAfter);
+    printf("%-40s %14lu\n", "  sent (live + replayed)", static_cast<unsigned long>(stats.sent));
+    if (saf.pending() != 0 || stats.sent != stored + live) {
+        bench::fail("StoreAndForward did not deliver every stored reading");
+    }
+    if (stats.dropped != 0 || stats.coalesced != 0) {
+        bench::fail("Replay crowded out live uploads");
+    }
+}
+
+/**
+ * Reconnect to WiFi while the broker is still down for ten minutes: the
+ * replayed batches fail, must stay in flash and arrive once it is back.
+ */
+void benchReplayBrokerDown() {
+    remove(kImagePath);
+    FileFlash flash(kImagePath, 32);
+    FlashLog log(flash);
+    log.format();
+    CloudUploader uploader;
+    uploader.begin();
+    uploader.setTarget(UPLOAD_MQTT);
+    StoreAndForward saf(log, uploader);
+    saf.begin();
+
+    for (unsigned long t = 0; t < 3600000; t += CLOUD_UPLOAD_INTERVAL) {
+        saf.submit(makeReading(millis()), false);
+        hal::advanceMillis(CLOUD_UPLOAD_INTERVAL);
+    }
+    const size_t stored = saf.pending();
+
+    const unsigned long kTickMs = 100;
+    hal::setMqttAvailable(false);
+    for (unsigned long t = 0; t < 3600000; t += kTickMs) {
+        if (t == 600000) {
+            hal::setMqttAvailable(true);
+        }
+        saf.loop(true);
+        uploader.process();
+        hal::advanceMillis(kTickMs);
+    }
+    while (uploader.process()) {
+    }
+    saf.loop(true);
+    remove(kImagePath);
+
+    const UploadStats stats = uploader.getStats();
+    printf("%-40s %14lu\n", "  replays failed while broker down",
+           static_cast<unsigned long>(stats.replayFailed));
+    printf("%-40s %14lu / %lu\n", "  replays delivered / stored",
+           static_cast<unsigned long>(stats.replayed), static_cast<unsigned long>(stored));
+    if (stats.replayFailed == 0 || saf.pending() != 0 || stats.replayed < stored) {
+        bench::fail("StoreAndForward lost readings whose replay failed");
+    }
+}
+
+} // namespace
+
+void benchStorage() {
+    bench::suite("storage");
+    hal::setWiFiAvailable(true);
+    hal::setMqttAvailable(true);
+    WiFi.begin("bench");
+    hal::advanceMillis(60000);
+    // As SNTP would once online; records carry calendar time from here on
+    hal::setWallClock(hal::kSntpEpoch);
+    benchCapacity();
+    benchPowerLoss();
+    benchReboot();
+    benchReplay();
+    benchReplayBrokerDown();
+}
@@ -0,0 +1,248 @@
+/**
+ * @file bench_uploads.cpp
+ * @brief Cost of the upload path: payload formatting, enqueueing and
+ *        behaviour against a slow server.
+ *
+ * The formatting cases call send() with network stand-ins that answer
+ * instantly, so the figures are dominated by URL/payload construction.
+ * The slow-server case runs the upload worker on its own thread against a
+ * stand-in that sleeps for real, and fails if upload() ever blocks. The
+ * batching case compares one GET per reading with ThingSpeak bulk updates
+ * over two hours of virtual time, for readings and for eight-channel
+ * frames from uploadChannels(). The MQTT case compares encode time and
+ * payload size of the JSON and CBOR message formats.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "connectivity/CloudUploader.h"
+
+namespace {
+
+void printStats(const char *label, const UploadStats &s) {
+    printf("  %s: enqueued=%lu sent=%lu failed=%lu dropped=%lu coalesced=%lu expired=%lu "
+           "max_depth=%lu max_latency=%lums\n",
+           label, static_cast<unsigned long>(s.enqueued), static_cast<unsigned long>(s.sent),
+           static_cast<unsigned long>(s.failed), static_cast<unsigned long>(s.dropped),
+           static_cast<unsigned long>(s.coalesced), static_cast<unsigned long>(s.expired),
+           static_cast<unsigned long>(s.maxQueueDepth),
+           static_cast<unsigned long>(s.maxLatencyMs));
+}
+
+void benchSlowServer(UploadTarget target, const char *label) {
+    hal::setNetworkLatencyRealTime(true);
+    hal::setHttpLatency(200);
+    hal::setMqttLatency(200); // per publish, one publish per reading
+
+    CloudUploader uploader;
+    uploader.begin();
+    uploader.setTarget(target);
+    uploader.setBatchSize(1);  // one request per reading, the worst case
+    uploader.setReportOnDelta(false);
+
+    std::atomic<bool> stop(false);
+    std::thread worker([&]() {
+        while (!stop) {
+            if (!uploader.process()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+
+    // Produce far faster than the server drains: one reading per 2 ms
+    double maxNs = 0.0;
+    const int readings = 500;
+    for (int i = 0; i < readings; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        uploader.upload(21.5f, 48.0f, i);
+        const auto end = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        maxNs = ns > maxNs ? ns : maxNs;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    stop = true;
+    worker.join();
+    hal::setNetworkLatencyRealTime(false);
+    hal::setHttpLatency(0);
+    hal::setMqttLatency(0);
+
+    char name[64];
+    snprintf(name, sizeof(name), "upload() max, slow %s", label);
+    bench::report(name, maxNs, readings);
+    printStats(label, uploader.getStats());
+    if (maxNs > 1000000.0) {
+        bench::fail("CloudUploader::upload() blocked on a slow server");
+    }
+}
+
+const ChannelSpec kFrameSpecs[8] = {
+    {"Temp", "t", "C", 1, -40.0f, 80.0f},       {"Hum", "h", "%", 1, 0.0f, 100.0f},
+    {"Light", "l", "mV", 0, 0.0f, 3300.0f},     {"CO2", "c", "ppm", 0, 0.0f, 5000.0f},
+    {"Press", "p", "hPa", 1, 300.0f, 1100.0f},  {"Soil", "s", "%", 1, 0.0f, 100.0f},
+    {"Wind", "w", "m/s", 1, 0.0f, 60.0f},       {"Rain", "r", "mm", 1, 0.0f, 500.0f},
+};
+const ChannelSpec *const kFrameSpecPtrs[8] = {&kFrameSpecs[0], &kFrameSpecs[1], &kFrameSpecs[2],
+                                              &kFrameSpecs[3], &kFrameSpecs[4], &kFrameSpecs[5],
+                                              &kFrameSpecs[6], &kFrameSpecs[7]};
+
+/**
+ * Two hours of uploads every CLOUD_UPLOAD_INTERVAL, of readings or of
+ * eight-channel frames; returns wire bytes per upload.
+ */
+double runThingSpeakCadence(size_t batchSize, const char *label, bool frames = false) {
+    CloudUploader uploader;
+    uploader.begin();
+    uploader.setTarget(UPLOAD_THINGSPEAK);
+    uploader.setBatchSize(batchSize);
+    uploader.setReportOnDelta(false);
+    hal::resetStats();
+    const uint32_t readings = 7200000 / CLOUD_UPLOAD_INTERVAL;
+    for (uint32_t i = 0; i < readings; ++i) {
+        if (frames) {
+            const float values[8] = {21.55f + (i & 7), 48.25f, 1234.0f + (i & 0xFF), 612.0f,
+                                     1013.25f, 35.5f, 12.75f, 104.5f};
+            uploader.uploadChannels(ChannelView{8, kFrameSpecPtrs, values});
+        } else {
+            uploader.upload(21.5f + (i & 7), 48.25f, static_cast<int>(i & 0xFFF));
+        }
+        while (uploader.process()) {
+        }
+        hal::advanceMillis(CLOUD_UPLOAD_INTERVAL);
+    }
+    const hal::NetStats &net = hal::httpStats();
+    const double wirePerReading = static_cast<double>(net.wireBytes) / readings;
+    printf("  %s: %lu readings, %lu requests, %lu connects, %.1f wire bytes/reading, "
+           "%.2f requests/reading\n",
+           label, static_cast<unsigned long>(readings), static_cast<unsigned long>(net.requests),
+           static_cast<unsigned long>(net.connects), wirePerReading,
+           static_cast<double>(net.requests) / readings);
+    if (uploader.getStats().sent != readings) {
+        bench::fail("ThingSpeak upload lost readings");
+    }
+    return wirePerReading;
+}
+
+void benchThingSpeakBatching() {
+    CloudUploader uploader;
+    SensorReading batch[THINGSPEAK_BATCH_SIZE];
+    for (size_t i = 0; i < THINGSPEAK_BATCH_SIZE; ++i) {
+        batch[i] = SensorReading{static_cast<uint32_t>(i * CLOUD_UPLOAD_INTERVAL),
+                                 21.37f + i, 48.25f, static_cast<int>(1000 + i), 0};
+    }
+    static char body[64 + 96 * THINGSPEAK_BATCH_SIZE];
+    size_t length = 0;
+    const double ns = bench::measure("serializeBulkUpdate (per batch)", 100000, [&](uint64_t i) {
+        batch[0].light = static_cast<int>(i & 0xFFF);
+        length = uploader.serializeBulkUpdate(batch, THINGSPEAK_BATCH_SIZE, body, sizeof(body));
+        bench::doNotOptimize(body[0]);
+    });
+    bench::report("  per reading", ns / THINGSPEAK_BATCH_SIZE, THINGSPEAK_BATCH_SIZE);
+    printf("  bulk body: %lu bytes for %d readings\n", static_cast<unsigned long>(length),
+           THINGSPEAK_BATCH_SIZE);
+    if (length == 0) {
+        bench::fail("Bulk-update body did not fit its buffer");
+    }
+
+    const double single = runThingSpeakCadence(1, "GET per reading");
+    const double bulk = runThingSpeakCadence(THINGSPEAK_BATCH_SIZE, "bulk update");
+    if (bulk >= single) {
+        bench::fail("Bulk updates did not reduce bytes on the wire");
+    }
+    const double singleFrames = runThingSpeakCadence(1, "GET per frame", true);
+    const double bulkFrames = runThingSpeakCadence(THINGSPEAK_BATCH_SIZE, "frames, bulk", true);
+    if (bulkFrames >= singleFrames) {
+        bench::fail("Channel frames are not batched into bulk updates");
+    }
+}
+
+void benchMqttPayload(MqttPayloadFormat format, const char *label) {
+    CloudUploader uploader;
+    uploader.begin();
+    uploader.setTarget(UPLOAD_MQTT);
+    uploader.setPayloadFormat(format);
+
+    SensorReading reading = {123456789u, 21.37f, 48.25f, 1234, 0};
+    uint8_t payload[MQTT_PAYLOAD_MAX];
+    size_t length = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "encodePayload (%s)", label);
+    bench::measure(name, 1000000, [&](uint64_t i) {
+        reading.light = static_cast<int>(i & 0xFFF);
+        length = uploader.encodePayload(reading, static_cast<uint32_t>(i), format, payload,
+                                        sizeof(payload));
+        bench::doNotOptimize(payload[0]);
+    });
+
+    hal::resetStats();
+    const uint32_t readings = 1000;
+    for (uint32_t i = 0; i < readings; ++i) {
+        uploader.upload(21.5f + (i & 7), 48.25f, static_cast<int>(i & 0xFFF));
+        uploader.process();
+    }
+    const hal::NetStats &net = hal::mqttStats();
+    printf("  %s: payload %lu bytes, %.2f publishes/reading, %.1f wire bytes/reading\n", label,
+           static_cast<unsigned long>(length), static_cast<double>(net.requests) / readings,
+           static_cast<double>(net.wireBytes) / readings);
+    if (length == 0 || net.requests != readings) {
+        bench::fail("MQTT upload did not publish exactly one message per reading");
+    }
+}
+
+} // namespace
+
+void benchUploads() {
+    bench::suite("uploads");
+    hal::setWiFiAvailable(true);
+    WiFi.begin("bench");
+    hal::advanceMillis(60000);
+    // Bulk entries carry created_at, the larger form, once the clock is set
+    hal::setWallClock(hal::kSntpEpoch);
+
+    CloudUploader uploader;
+    uploader.begin();
+    // The transport is measured here; report by exception has its own suite
+    uploader.setReportOnDelta(false);
+
+    uploader.setTarget(UPLOAD_THINGSPEAK);
+    bench::measure("CloudUploader::send (ThingSpeak)", 200000, [&](uint64_t i) {
+        uploader.send(21.5f + (i & 7), 48.25f, static_cast<int>(i & 0xFFF));
+    });
+
+    uploader.setTarget(UPLOAD_MQTT);
+    bench::measure("CloudUploader::send (MQTT)", 200000, [&](uint64_t i) {
+        uploader.send(21.5f + (i & 7), 48.25f, static_cast<int>(i & 0xFFF));
+    });
+
+    bench::measure("CloudUploader::upload+process (MQTT)", 200000, [&](uint64_t i) {
+        uploader.upload(21.5f + (i & 7), 48.25f, static_cast<int>(i & 0xFFF));
+        uploader.process();
+    });
+
+    benchThingSpeakBatching();
+    benchMqttPayload(MQTT_PAYLOAD_JSON, "JSON");
+    benchMqttPayload(MQTT_PAYLOAD_CBOR, "CBOR");
+
+    benchSlowServer(UPLOAD_THINGSPEAK, "ThingSpeak");
+    benchSlowServer(UPLOAD_MQTT, "MQTT");
+
+    // Server slower than the request timeout: every request must fail fast
+    hal::setHttpLatency(UPLOAD_REQUEST_TIMEOUT * 4);
+    CloudUploader timingOut;
+    timingOut.begin();
+    timingOut.setTarget(UPLOAD_THINGSPEAK);
+    timingOut.setBatchSize(1);
+    timingOut.setReportOnDelta(false);
+    for (int i = 0; i < 4; ++i) {
+        timingOut.upload(21.5f, 48.0f, i);
+        timingOut.process();
+    }
+    hal::setHttpLatency(0);
+    const UploadStats stats = timingOut.getStats();
+    printStats("timeouts", stats);
+    if (stats.failed != 4 || stats.maxLatencyMs > UPLOAD_REQUEST_TIMEOUT) {
+        bench::fail("Upload requests were not bounded by UPLOAD_REQUEST_TIMEOUT");
+    }
+}
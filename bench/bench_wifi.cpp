@@ -0,0 +1,163 @@
+/**
+ * @file bench_wifi.cpp
+ * @brief WiFiManager::loop() latency during simulated outages.
+ *
+ * Drives the simulated WiFi event source through a long outage while
+ * calling loop() every 10 ms of virtual time, the cadence of the polling
+ * firmware. loop() must never consume virtual time (i.e. call delay()) and
+ * its wall-clock cost must stay bounded regardless of reconnect attempts.
+ *
+ * A second part boots fresh WiFiManager instances, as after deep sleep or
+ * power loss, and measures virtual time to connect with and without the
+ * cached link, including an access point that moved to another channel.
+ */
+
+#include "Bench.h"
+#include "NativeHal.h"
+#include "connectivity/WiFiManager.h"
+
+namespace {
+
+const unsigned long kStepMs = 10;
+const double kMaxLoopNs = 1000000.0;  ///< 1 ms wall clock, orders above normal
+
+struct Transitions {
+    uint32_t connected;
+    uint32_t backoffs;
+};
+
+void countTransitions(WiFiState state, void *context) {
+    Transitions *t = static_cast<Transitions *>(context);
+    if (state == WIFI_STATE_CONNECTED) {
+        ++t->connected;
+    } else if (state == WIFI_STATE_BACKOFF) {
+        ++t->backoffs;
+    }
+}
+
+/** One simulated boot: connect from radio off and time it in virtual ms. */
+struct BootResult {
+    unsigned long connectMs;
+    bool fast;
+    bool connected;
+    uint32_t nvsWrites;
+};
+
+BootResult boot() {
+    WiFi.mode(WIFI_OFF);
+    const uint32_t nvsBefore = hal::nvsWrites();
+    const unsigned long start = millis();
+    WiFiManager wifi;
+    wifi.connect();
+    while (!wifi.isConnected() && millis() - start < 30000) {
+        hal::advanceMillis(kStepMs);
+        wifi.loop();
+    }
+    const BootResult result = {millis() - start, wifi.getStats().lastFast, wifi.isConnected(),
+                               hal::nvsWrites() - nvsBefore};
+    wifi.disconnect();
+    return result;
+}
+
+void printBoot(const char *label, const BootResult &r) {
+    printf("  %-30s %6lu ms  %-11s  %lu NVS writes\n", label, r.connectMs,
+           r.fast ? "cached link" : "full scan", static_cast<unsigned long>(r.nvsWrites));
+}
+
+void benchFastReconnect() {
+    const uint8_t homeBssid[6] = {0x24, 0x0A, 0xC4, 0x11, 0x22, 0x33};
+    hal::setWiFiAvailable(true);
+    hal::setWiFiAssociationDelay(3000);  // all-channel scan, association, DHCP
+    hal::setWiFiFastPathTiming(200, 600);
+    hal::setWiFiAccessPoint(homeBssid, 6);
+    hal::eraseNvs();
+    WiFiManager::forgetRetainedLink();
+
+    const BootResult first = boot();
+    printBoot("first boot (no cache)", first);
+    const BootResult wake = boot();
+    printBoot("deep sleep wake (RTC)", wake);
+    WiFiManager::forgetRetainedLink();
+    const BootResult cold = boot();
+    printBoot("power cycle (NVS)", cold);
+    hal::setWiFiAccessPoint(homeBssid, 11);
+    const BootResult moved = boot();
+    printBoot("AP changed channel", moved);
+    const BootResult after = boot();
+    printBoot("wake after channel change", after);
+    hal::setWiFiAccessPoint(homeBssid, 6);
+
+    if (!first.connected || !wake.connected || !cold.connected || !moved.connected ||
+        !after.connected) {
+        bench::fail("Node did not connect after boot");
+    }
+    if (!wake.fast || !cold.fast || !after.fast || wake.connectMs >= first.connectMs ||
+        cold.connectMs >= first.connectMs) {
+        bench::fail("Cached link did not shorten the connection");
+    }
+    if (moved.fast || moved.connectMs > WIFI_FAST_TIMEOUT + first.connectMs) {
+        bench::fail("Stale cached link did not fall back to a scan");
+    }
+    if (wake.nvsWrites > 0 || cold.nvsWrites > 0 || after.nvsWrites > 0) {
+        bench::fail("Fast reconnect wrote NVS");
+    }
+    hal::setWiFiAssociationDelay(0);
+}
+
+} // namespace
+
+void benchWiFi() {
+    bench::suite("wifi");
+    hal::setWiFiAvailable(true);
+    hal::setWiFiAssociationDelay(2000);
+
+    WiFiManager wifi;
+    Transitions transitions = {0, 0};
+    wifi.onStateChange(countTransitions, &transitions);
+    wifi.connect();
+
+    double maxNs = 0.0;
+    double totalNs = 0.0;
+    uint64_t calls = 0;
+    unsigned long maxVirtualMs = 0;
+
+    // 1 min up, 30 min outage, 5 min up
+    const unsigned long phases[][2] = {{60000, 1}, {1800000, 0}, {300000, 1}};
+    for (const auto &phase : phases) {
+        hal::setWiFiAvailable(phase[1] != 0);
+        for (unsigned long t = 0; t < phase[0]; t += kStepMs) {
+            const unsigned long virtualBefore = millis();
+            const auto start = std::chrono::steady_clock::now();
+            wifi.loop();
+            const auto end = std::chrono::steady_clock::now();
+            const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            totalNs += ns;
+            maxNs = ns > maxNs ? ns : maxNs;
+            ++calls;
+            const unsigned long spent = millis() - virtualBefore;
+            maxVirtualMs = spent > maxVirtualMs ? spent : maxVirtualMs;
+            hal::advanceMillis(kStepMs);
+        }
+    }
+
+    bench::report("WiFiManager::loop (mean, with outage)", totalNs / calls, calls);
+    bench::report("WiFiManager::loop (max)", maxNs, calls);
+    printf("%-40s %14lu\n", "  max virtual ms inside loop()", maxVirtualMs);
+    printf("%-40s %14lu\n", "  reconnects after outage",
+           static_cast<unsigned long>(transitions.connected));
+    printf("%-40s %14lu\n", "  backoff periods entered",
+           static_cast<unsigned long>(transitions.backoffs));
+
+    if (maxVirtualMs > 0) {
+        bench::fail("WiFiManager::loop() blocked on the virtual clock");
+    }
+    if (maxNs > kMaxLoopNs) {
+        bench::fail("WiFiManager::loop() exceeded 1 ms wall clock");
+    }
+    if (!wifi.isConnected()) {
+        bench::fail("WiFiManager did not reconnect after the outage");
+    }
+    wifi.disconnect();
+
+    benchFastReconnect();
+}
@@ -20,10 +20,18 @@
 // DHT11 Sensor
 #define DHT_PIN         4           // GPIO4 - DHT11 data pin
 #define DHT_TYPE        DHT11       // Sensor type
+#ifndef DHT_USE_RMT
+#define DHT_USE_RMT     1           // Capture the frame with the RMT peripheral (0: Adafruit bit-banging)
+#endif
+#define DHT_RMT_CHANNEL 0           // RMT_CHANNEL_0 - receive channel for the data line
+#define DHT_RESPONSE_TIMEOUT 10     // ms after the start pulse before a read times out
 
 // Light Sensor (LDR)
 #define LDR_PIN         34          // GPIO34 (ADC1_CH6) - Analog input
 #define LDR_RESOLUTION  12          // 12‑bit ADC resolution (0‑4095)
+#define LDR_ADC_CHANNEL 6           // ADC1_CHANNEL_6 (same pin), for the continuous driver
+#define LDR_DEFAULT_VREF 1100       // mV, used when eFuse holds no ADC calibration
+#define LDR_FULL_SCALE_MV 3300      // Divider supply (mV): readNormalized() == 100
 
 // OLED Display (I2C)
 #define OLED_SDA        21          // GPIO21 - I2C Data
@@ -31,6 +39,8 @@
 #define OLED_WIDTH      128         // Display width in pixels
 #define OLED_HEIGHT     64          // Display height in pixels
 #define OLED_ADDRESS    0x3C        // I2C address
+#define OLED_I2C_CLOCK  400000      // I2C clock (Hz): 400 kHz fast mode, 1 MHz fast mode plus
+#define OLED_I2C_CHUNK  32          // Bytes per I2C transaction (<= Wire buffer)
 
 // Alert LED
 #define LED_PIN         2           // GPIO2 - Built‑in LED
@@ -44,19 +54,122 @@
 #define DISPLAY_UPDATE_INTERVAL 2000    // Update display every 2 seconds
 #define CLOUD_UPLOAD_INTERVAL   30000   // Upload to cloud every 30 seconds
 #define WIFI_TIMEOUT            15000   // WiFi connection timeout
-#define WIFI_RETRY_INTERVAL     30000   // Retry WiFi every 30 seconds if disconnected
+#define WIFI_RETRY_INTERVAL     30000   // Upper bound of the WiFi reconnect backoff
+#define WIFI_BACKOFF_INITIAL    1000    // First WiFi reconnect backoff (doubles per failure)
+#define WIFI_MAX_LISTENERS      4       // WiFi state change listeners
+#define WIFI_FAST_CONNECT       1       // Join the cached BSSID/channel before scanning
+#define WIFI_FAST_TIMEOUT       3000    // Fast-path attempt limit before the full scan
+#define WIFI_CACHE_STATIC_IP    1       // Fast path reuses the cached lease, skipping DHCP
+#define WIFI_CACHE_NVS          1       // Also keep the cache in NVS for cold boots
+
+// ============================================================================
+// LIGHT SENSOR SAMPLING
+// ============================================================================
+
+#define LIGHT_ADC_CONTINUOUS    1       // DMA burst per reading instead of one analogRead()
+#define LIGHT_ADC_SAMPLE_RATE   20000   // Conversions per second (ESP32 DMA minimum)
+#define LIGHT_ADC_WINDOW        1024    // Conversions per reading (~51 ms, 5 periods of 100 Hz)
+#define LIGHT_ADC_DECIMATION    8       // Conversions per decimated sample (multiple of 4)
+#define LIGHT_FLICKER_MIN_PERCENT 5.0f  // Percent flicker reported as lamp flicker
+
+// ============================================================================
+// LOW-POWER MODE (PowerManager)
+// ============================================================================
+
+#define LOW_POWER_OFF           0       // Always on (task pipeline or polling loop)
+#define LOW_POWER_LIGHT         1       // Light sleep between samples
+#define LOW_POWER_DEEP          2       // Deep sleep between samples, state in RTC memory
+#ifndef LOW_POWER_MODE
+#define LOW_POWER_MODE          LOW_POWER_OFF
+#endif
+#define LOW_POWER_PENDING_MAX   32      // Readings kept in RTC memory until uploaded
+#define LOW_POWER_WIFI_TIMEOUT  8000    // Give up connecting for this upload cycle (ms)
+#define LOW_POWER_WIFI_POLL     10      // Poll period while waiting for WiFi (ms)
+#define LOW_POWER_MAX_BACKOFF   8       // Max upload cycles skipped after failures
+
+// Energy model for the per-cycle report (supply current per state)
+#define POWER_SUPPLY_MV         3300
+#define POWER_ACTIVE_MA         40.0f   // CPU awake, radio off
+#define POWER_RADIO_MA          120.0f  // CPU awake, WiFi on
+#define POWER_LIGHT_SLEEP_MA    0.8f
+#define POWER_DEEP_SLEEP_MA     0.01f   // RTC timer and RTC memory only
+#define POWER_ALWAYS_ON_MA      80.0f   // Polling loop with WiFi associated (baseline)
+
+// ============================================================================
+// TASK PIPELINE (FreeRTOS)
+// ============================================================================
+
+#ifndef USE_TASK_PIPELINE
+#if LOW_POWER_MODE != LOW_POWER_OFF
+#define USE_TASK_PIPELINE       0       // The low-power duty cycle replaces the tasks
+#else
+#define USE_TASK_PIPELINE       1       // 1: sensing/display/uplink tasks, 0: polling loop()
+#endif
+#endif
+#define PIPELINE_QUEUE_DEPTH    16      // Readings buffered per consumer (power of two)
+#define UPLINK_TASK_PERIOD      1000    // Uplink task wake-up period (ms)
+
+#define SENSE_TASK_CORE         1       // APP_CPU, away from the WiFi stack
+#define SENSE_TASK_PRIORITY     3
+#define SENSE_TASK_STACK        4096
+#define DISPLAY_TASK_CORE       1
+#define DISPLAY_TASK_PRIORITY   2
+#define DISPLAY_TASK_STACK      4096
+#define UPLINK_TASK_CORE        0       // PRO_CPU, next to the WiFi stack
+#define UPLINK_TASK_PRIORITY    1
+#define UPLINK_TASK_STACK       8192
+
+#ifndef PIPELINE_JITTER_REPORT
+#define PIPELINE_JITTER_REPORT  0       // Periodically print worst-case jitter per task
+#endif
+#define PIPELINE_JITTER_REPORT_INTERVAL 60000
 
 // ============================================================================
 // DATA FILTERING
 // ============================================================================
 
 #define FILTER_WINDOW_SIZE      5       // Moving average window size
+#define FILTER_EMA_ALPHA        0.3f    // EmaFilter smoothing factor (0..1]
+#define KALMAN_PROCESS_NOISE    0.01f   // KalmanFilter1D process variance (q)
+#define KALMAN_MEASUREMENT_NOISE 0.5f   // KalmanFilter1D measurement variance (r)
+#ifndef SENSOR_MAX_CHANNELS
+#define SENSOR_MAX_CHANNELS     16      // Channel capacity of the sensor registry
+#endif
+#define SENSOR_MAX_SENSORS      8       // Sensors (DHT, LDR, ...) in the registry
 #define TEMP_MIN_VALID          -40.0f  // Minimum valid temperature (°C)
 #define TEMP_MAX_VALID          80.0f   // Maximum valid temperature (°C)
 #define HUMID_MIN_VALID         0.0f    // Minimum valid humidity (%)
 #define HUMID_MAX_VALID         100.0f  // Maximum valid humidity (%)
-#define LIGHT_MIN_VALID         0       // Minimum valid light reading
-#define LIGHT_MAX_VALID         4095    // Maximum valid light reading
+#define LIGHT_MIN_VALID         0       // Minimum valid light reading (mV)
+#define LIGHT_MAX_VALID         LDR_FULL_SCALE_MV // Maximum valid light reading (mV)
+
+// ============================================================================
+// ADAPTIVE SAMPLING (polled loop)
+// ============================================================================
+
+// Per-channel read intervals between the fast and the maximum interval,
+// driven by the variance of the filter window. The rule table itself is
+// kSamplingRules in sensors/AdaptiveSampler.h.
+#ifndef ADAPTIVE_SAMPLING
+#if USE_TASK_PIPELINE || LOW_POWER_MODE != LOW_POWER_OFF
+#define ADAPTIVE_SAMPLING       0       // The tasks and the duty cycle sample at a fixed cadence
+#else
+#define ADAPTIVE_SAMPLING       1       // 0: every sensor each SENSOR_READ_INTERVAL
+#endif
+#endif
+#define SAMPLE_FAST_INTERVAL    2000    // During events (DHT22 minimum period, ms)
+#define TEMP_MAX_INTERVAL       20000   // Longest interval of a quiet channel (ms);
+#define HUMID_MAX_INTERVAL      15000   // bounds how late an event is noticed, so at
+#define LIGHT_MAX_INTERVAL      10000   // most 4x SENSOR_READ_INTERVAL
+#define TEMP_QUIET_STDDEV       0.3f    // °C; window deviation that stretches the interval
+#define TEMP_EVENT_STDDEV       1.0f    // °C; window deviation that switches to fast
+#define TEMP_EVENT_STEP         1.5f    // °C between two reads that switches to fast
+#define HUMID_QUIET_STDDEV      1.0f    // %
+#define HUMID_EVENT_STDDEV      3.0f    // %
+#define HUMID_EVENT_STEP        4.0f    // %
+#define LIGHT_QUIET_STDDEV      25.0f   // mV
+#define LIGHT_EVENT_STDDEV      200.0f  // mV
+#define LIGHT_EVENT_STEP        300.0f  // mV
 
 // ============================================================================
 // ALERT THRESHOLDS
@@ -66,7 +179,20 @@
 #define TEMP_LOW_THRESHOLD      15.0f   // Low temperature alert (°C)
 #define HUMID_HIGH_THRESHOLD    80.0f   // High humidity alert (%)
 #define HUMID_LOW_THRESHOLD     30.0f   // Low humidity alert (%)
-#define LIGHT_LOW_THRESHOLD     500     // Low light alert (darkness)
+#define LIGHT_LOW_THRESHOLD     600     // Low light alert (darkness, mV)
+
+// An alert clears once the value is back past its threshold by the
+// hysteresis band; both edges need ALERT_DEBOUNCE_SAMPLES samples in a row.
+// The rule table itself is kAlertRules in utils/AlertManager.h.
+#ifndef ALERT_DEBOUNCE_SAMPLES
+#define ALERT_DEBOUNCE_SAMPLES  2
+#endif
+#define TEMP_HYSTERESIS         0.5f    // °C
+#define HUMID_HYSTERESIS        2.0f    // %
+#define LIGHT_HYSTERESIS        100     // mV
+#define TEMP_RISE_THRESHOLD     0.05f   // Fast warming alert (°C/s, 3 °C/min)
+#define TEMP_RISE_HYSTERESIS    0.02f   // °C/s
+#define TEMP_RISE_WINDOW        60000   // Span of one rate measurement (ms)
 
 // ============================================================================
 // NETWORK CONFIGURATION
@@ -76,16 +202,117 @@
 
 #define THINGSPEAK_SERVER       "api.thingspeak.com"
 #define THINGSPEAK_PORT         80
+#ifndef THINGSPEAK_BATCH_SIZE
+#define THINGSPEAK_BATCH_SIZE   10      // Readings per bulk-update POST (1: one GET per reading)
+#endif
+#define THINGSPEAK_BATCH_MAX_AGE 300000 // Send a partial batch after this long (ms)
 
 #ifndef MQTT_PORT
 #define MQTT_PORT               1883
 #endif
 
+// Calendar time (WallClock): the system clock is set over SNTP once WiFi is
+// up, so readings stored in flash can still be placed after a reboot
+#define NTP_SERVER              "pool.ntp.org"
+#define WALL_CLOCK_VALID_AFTER  1600000000UL // Earlier system times mean "not set" (s)
+
+// Report by exception (CloudUploader): a channel is published only once its
+// filtered value has moved by more than its deadband since it was last
+// published; after REPORT_HEARTBEAT_INTERVAL without any message every
+// channel goes out. The deadbands are kDeltaRules in
+// connectivity/DeltaReporter.h.
+#ifndef REPORT_ON_DELTA
+#define REPORT_ON_DELTA         1       // 0: upload every reading
+#endif
+#define REPORT_HEARTBEAT_INTERVAL 900000 // Longest silence (ms), shows the node is alive
+#define TEMP_DEADBAND           0.3f    // °C
+#define HUMID_DEADBAND          1.5f    // %
+#define LIGHT_DEADBAND          100.0f  // mV
+
+// Upload queue (CloudUploader)
+#ifndef UPLOAD_ASYNC
+#if LOW_POWER_MODE != LOW_POWER_OFF
+#define UPLOAD_ASYNC            0       // The duty cycle sends inline (sendBatch) before sleeping
+#else
+#define UPLOAD_ASYNC            1       // 1: upload() enqueues, a worker task sends
+#endif
+#endif
+#define UPLOAD_QUEUE_DEPTH      8       // Queued readings (power of two)
+#define UPLOAD_OVERFLOW_POLICY  UPLOAD_COALESCE // or UPLOAD_DROP_NEWEST
+#define UPLOAD_CONNECT_TIMEOUT  3000    // TCP connect deadline per request (ms)
+#define UPLOAD_REQUEST_TIMEOUT  5000    // Response deadline per request (ms)
+#define UPLOAD_DEADLINE         300000  // Discard queued readings older than this (ms)
+#define UPLOAD_WORKER_IDLE_MS   100     // Worker poll period when the queue is empty
+#define UPLOAD_TASK_CORE        0
+#define UPLOAD_TASK_PRIORITY    1
+#define UPLOAD_TASK_STACK       8192
+#define HTTP_HEAD_MAX           320     // Request head / response line buffer (bytes)
+#define HEAP_REPORT_INTERVAL    60000   // Heap telemetry period (ms), 0 disables
+
+// Store-and-forward (FlashLog + StoreAndForward)
+#ifndef STORE_AND_FORWARD
+#define STORE_AND_FORWARD       1       // Keep readings in flash while offline
+#endif
+#define FLASH_LOG_PARTITION     "datalog" // Data partition label in partitions.csv
+#define REPLAY_BATCH_SIZE       4       // Stored readings handed over per replay step
+#define REPLAY_INTERVAL         2000    // Minimum time between replay steps (ms)
+#define REPLAY_RETRY_INTERVAL   30000   // Pause after a batch failed to send (ms)
+
+// Compressed in-RAM history of raw samples (History), polled loop only
+#ifndef HISTORY_ENABLED
+#if USE_TASK_PIPELINE || LOW_POWER_MODE != LOW_POWER_OFF
+#define HISTORY_ENABLED         0       // Not kept by the tasks or the duty cycle
+#else
+#define HISTORY_ENABLED         1       // Keep full-resolution samples in RAM
+#endif
+#endif
+#define HISTORY_BLOCK_BYTES     512     // One compressed block, also one upload
+#define HISTORY_BLOCKS          8       // Blocks kept; the oldest is overwritten
+#define HISTORY_TIME_UNIT       100     // Timestamp resolution in the history (ms)
+
+// Local HTTP endpoint (MetricsServer), polled loop only: main.cpp stops the
+// build if it is enabled with USE_TASK_PIPELINE or LOW_POWER_MODE
+#ifndef METRICS_SERVER
+#define METRICS_SERVER          0       // Serve /metrics and /history on the node
+#endif
+#define METRICS_HTTP_PORT       80
+#define METRICS_MAX_CLIENTS     4       // Connections served at once; more get 503
+#define METRICS_REQUEST_MAX     128     // Request line kept per connection (bytes)
+#define METRICS_REQUEST_TIMEOUT 2000    // Close connections idle this long before the request (ms)
+#define METRICS_CHUNK_BYTES     512     // Responses are written in pieces of this size
+
+// Per-stage loop profiler (LoopProfiler), polled loop only
+#ifndef LOOP_PROFILER
+#if USE_TASK_PIPELINE || LOW_POWER_MODE != LOW_POWER_OFF
+#define LOOP_PROFILER           0       // No loop() stages to time
+#else
+#define LOOP_PROFILER           1       // Time loop() stages; 0 compiles the timers out
+#endif
+#endif
+#define PROFILER_REPORT_INTERVAL 60000  // Histogram period, printed and published (ms)
+#define PROFILER_PAYLOAD_MAX    768     // JSON message of one period (bytes)
+
 #define MQTT_CLIENT_ID          "ESP32_EnvNode"
-#define MQTT_TOPIC_TEMP         "envnode/temperature"
-#define MQTT_TOPIC_HUMID        "envnode/humidity"
-#define MQTT_TOPIC_LIGHT        "envnode/light"
-#define MQTT_TOPIC_STATUS       "envnode/status"
+#define MQTT_KEEPALIVE          15      // Seconds; the broker drops a client silent for 1.5x this
+#define MQTT_TOPIC_DATA         "envnode/data"  // One message per reading, all channels
+#define MQTT_TOPIC_STATUS       "envnode/status" // Heap telemetry
+#define MQTT_TOPIC_HISTORY      "envnode/history" // Sealed history blocks (binary)
+#define MQTT_TOPIC_PROFILE      "envnode/profile" // Loop stage histograms
+#define MQTT_PAYLOAD_FORMAT     MQTT_PAYLOAD_JSON // or MQTT_PAYLOAD_CBOR
+#define MQTT_PAYLOAD_MAX        96      // Encoded payload buffer (bytes)
+#define MQTT_CHANNEL_PAYLOAD_MAX (32 + 20 * SENSOR_MAX_CHANNELS) // uploadChannels() payload
+
+// Persistent MQTT session (MqttSession): data messages go out at QoS 1 with
+// up to MQTT_INFLIGHT_MAX of them awaiting their PUBACK; status, history and
+// profile messages stay at QoS 0
+#ifndef MQTT_QOS
+#define MQTT_QOS                1       // Data messages: 1 acknowledged and resent, 0 fire and forget
+#endif
+#define MQTT_INFLIGHT_MAX       8       // Unacknowledged QoS 1 messages (window)
+#define MQTT_INFLIGHT_PACKET_MAX (MQTT_CHANNEL_PAYLOAD_MAX + sizeof(MQTT_TOPIC_DATA) + 8) // Slot (bytes)
+#define MQTT_RETRY_INTERVAL     10000   // Resend an unacknowledged PUBLISH with DUP after (ms)
+#define MQTT_RECONNECT_MIN      1000    // First reconnect delay (ms), doubled per failure
+#define MQTT_RECONNECT_MAX      60000   // Longest reconnect delay (ms)
 
 // ============================================================================
 // SERIAL DEBUGGING
@@ -104,6 +331,25 @@
     #define DEBUG_PRINTF(...)
 #endif
 
+// Firmware modules log through LOG_ERROR/WARN/INFO/DEBUG (utils/BinaryLog.h).
+// In binary mode a call stores the format hash and raw arguments in a ring
+// that a low-priority task drains to Serial; tools/logdecode.py turns the
+// stream back into text. LOG_BINARY 0 prints text through DEBUG_PRINTF.
+#ifndef LOG_BINARY
+#define LOG_BINARY              1
+#endif
+#define LOG_RING_SLOTS          64      // Records in flight (power of two)
+#define LOG_RECORD_ARGS         38      // Argument bytes per record (48-byte records)
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL           3       // 0 error .. 3 debug; higher levels are compiled out
+#endif
+#define LOG_DEFAULT_LEVEL       3       // Runtime threshold at boot (BinaryLog::setLevel)
+#define LOG_TASK_CORE           0
+#define LOG_TASK_PRIORITY       0       // Idle priority: drains when nothing else runs
+#define LOG_TASK_STACK          2048
+#define LOG_DRAIN_IDLE_MS       10      // Drain task sleep when the ring is empty or the FIFO full
+#define LOG_FLUSH_TIMEOUT       250     // Longest wait for the ring to empty before sleeping (ms)
+
 // ============================================================================
 // SYSTEM INFORMATION
 // ============================================================================
@@ -5,6 +5,47 @@
  * This implementation supports both HTTP uploads to ThingSpeak and
  * MQTT publishes to a broker. The active mechanism is selected at
  * runtime based on whether a valid ThingSpeak API key is defined.
+ *
+ * With UPLOAD_ASYNC, upload() only places the reading in a bounded queue;
+ * a background worker performs the network requests with per-request
+ * timeouts, so a slow or unreachable server never stalls the caller.
+ *
+ * ThingSpeak uploads are batched: THINGSPEAK_BATCH_SIZE readings with
+ * relative timestamps go out in one JSON bulk-update POST, cutting the
+ * number of requests (and radio-on time) per reading accordingly. MQTT
+ * uploads publish one message per reading on MQTT_TOPIC_DATA, encoded as
+ * compact JSON or CBOR.
+ *
+ * MQTT goes through a persistent MqttSession that loop() (or process())
+ * keeps alive between uploads. Data messages are published at MQTT_QOS:
+ * at QoS 1 up to MQTT_INFLIGHT_MAX are pipelined and retransmitted until
+ * the broker acknowledges them. Status, history and profile messages stay
+ * at QoS 0.
+ *
+ * uploadChannels() sends every channel of a SensorRegistry instead of the
+ * fixed temperature/humidity/light reading: one MQTT message keyed by
+ * each channel's upload key, or a ThingSpeak update with one field per
+ * channel (the first eight), which joins the readings' bulk update.
+ * Channel frames have their own queue and are not stored in flash.
+ *
+ * With REPORT_ON_DELTA, upload() and uploadChannels() report by exception
+ * (see DeltaReporter): a reading goes out only if one of its channels has
+ * moved by more than its deadband since it was last delivered, and a
+ * channel frame then carries just those channels. After
+ * REPORT_HEARTBEAT_INTERVAL of silence everything is sent. Suppressed
+ * readings are counted. Only a successful send updates the reported
+ * values; the worker hands them back to the producer, which owns the
+ * DeltaReporter, so the change of a dropped or failed reading goes out
+ * with the next one.
+ *
+ * uploadHistory() publishes sealed History blocks unchanged on
+ * MQTT_TOPIC_HISTORY; the compressed block is the payload. uploadProfile()
+ * publishes the LoopProfiler report of a period on MQTT_TOPIC_PROFILE.
+ *
+ * Once begin() has run, the upload path does not touch the heap: requests
+ * are formatted into fixed buffers and sent over a kept-alive
+ * HttpConnection. Heap statistics are logged, and published on
+ * MQTT_TOPIC_STATUS, every HEAP_REPORT_INTERVAL.
  */
 
 #ifndef CLOUD_UPLOADER_H
@@ -12,9 +53,96 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
-#include <PubSubClient.h>
 #include "config.h"
+#include "connectivity/DeltaReporter.h"
+#include "connectivity/HttpConnection.h"
+#include "connectivity/MqttSession.h"
+#include "sensors/Sensor.h"
+#include "sensors/SensorReading.h"
+#include "utils/SpscRing.h"
+
+/**
+ * Selects the upload mechanism used by CloudUploader::upload().
+ */
+enum UploadTarget {
+    UPLOAD_AUTO,        ///< ThingSpeak if an API key is configured, MQTT otherwise
+    UPLOAD_THINGSPEAK,  ///< Always use the ThingSpeak HTTP API
+    UPLOAD_MQTT         ///< Always publish to the MQTT broker
+};
+
+/**
+ * Encoding of the single MQTT message published per reading. Both carry
+ * the keys seq, ts (millis() of the sample), t, h and l.
+ */
+enum MqttPayloadFormat {
+    MQTT_PAYLOAD_JSON,  ///< Compact JSON text
+    MQTT_PAYLOAD_CBOR   ///< Binary CBOR map (RFC 8949), float32 values
+};
+
+/**
+ * What upload() does when the queue is full.
+ */
+enum UploadOverflowPolicy {
+    UPLOAD_DROP_NEWEST,  ///< Discard the reading that did not fit
+    UPLOAD_COALESCE      ///< Hold the newest reading aside, replacing older overflow
+};
+
+/**
+ * Counters describing the upload path. Producer-side and worker-side
+ * fields each have a single writer, so they can be read from any task.
+ */
+struct UploadStats {
+    uint32_t enqueued;        ///< Readings accepted into the queue
+    uint32_t dropped;         ///< Readings discarded because the queue was full
+    uint32_t coalesced;       ///< Overflow readings superseded by a newer one
+    uint32_t expired;         ///< Readings older than UPLOAD_DEADLINE when dequeued
+    uint32_t suppressed;      ///< Readings not sent: no channel beyond its deadband
+    uint32_t heartbeats;      ///< Readings sent only because the node was silent too long
+    uint32_t sent;            ///< Successful requests
+    uint32_t failed;          ///< Failed or timed out requests
+    uint32_t replayed;        ///< Replayed readings confirmed delivered (QoS 1: acknowledged)
+    uint32_t replayFailed;    ///< Replayed readings whose request failed
+    uint32_t queueDepth;      ///< Readings currently queued
+    uint32_t maxQueueDepth;   ///< Highest queue depth observed
+    uint32_t lastLatencyMs;   ///< Duration of the last request
+    uint32_t maxLatencyMs;    ///< Longest request
+    uint64_t totalLatencyMs;  ///< Sum of request durations (for the mean)
+};
+
+/**
+ * Snapshot of registry channels queued by uploadChannels(). Specs are
+ * static; only the values are copied.
+ */
+struct ChannelFrame {
+    uint32_t timestamp;                 ///< millis() when the frame was taken
+    size_t count;                       ///< Channels (at most SENSOR_MAX_CHANNELS)
+    const ChannelSpec *const *specs;
+    float values[SENSOR_MAX_CHANNELS];
+    ChannelMask mask;                   ///< Channels to send
+};
+
+/**
+ * One update of a ThingSpeak bulk update: a reading (fields 1-3) or a
+ * channel frame (fields 1-8).
+ */
+struct BulkEntry {
+    uint32_t timestamp;     ///< millis() of the values
+    uint8_t flags;          ///< SensorReadingFlag bits of a reading, 0 for a frame
+    uint8_t count;          ///< Fields in use
+    ChannelMask mask;       ///< Fields to send, bit f for field f + 1
+    float fields[8];        ///< NAN where a field has no value
+};
+
+/**
+ * A message queued by uploadHistory() or uploadProfile(). The bytes are
+ * not copied; their owner keeps them intact long enough to send them
+ * (History a sealed block, LoopProfiler the payload of a period).
+ */
+struct MessageUpload {
+    const char *topic;
+    const uint8_t *payload;
+    size_t length;
+};
 
 /**
  * @class CloudUploader
@@ -24,30 +152,292 @@
 class CloudUploader {
 public:
     CloudUploader();
-    
+
     /**
      * Initialise internal clients. Should be called after WiFi is up.
+     * With UPLOAD_ASYNC on the ESP32 this also starts the upload worker
+     * task.
      */
     void begin();
 
     /**
-     * Upload a new set of sensor readings. Depending on configuration
-     * this will either perform an HTTP GET request to ThingSpeak or
-     * publish values to multiple MQTT topics.
+     * Upload a new set of sensor readings. With UPLOAD_ASYNC the reading is
+     * queued and this returns immediately; otherwise it is sent inline
+     * (see send()). When reporting on delta, a reading with no channel
+     * beyond its deadband is suppressed.
      *
      * @param temperature Filtered temperature reading in °C
      * @param humidity    Filtered humidity reading in %
-     * @param light       Filtered light reading (0‑4095)
+     * @param light       Filtered light reading (mV)
      */
     void upload(float temperature, float humidity, int light);
 
+    /**
+     * Hand over a reading replayed from the flash log. Unlike upload() this
+     * never coalesces or drops: it fails instead, so the caller keeps the
+     * reading stored. Must be called from the same task as upload().
+     *
+     * Acceptance is not delivery: the outcome shows in the replayed and
+     * replayFailed counters of getStats() once the request was made (a
+     * ThingSpeak bulk update, or at QoS 1 the broker's PUBACK). The caller
+     * keeps the reading in flash until then.
+     *
+     * @return true if the reading was accepted (queued, or handed to the
+     *         send path when UPLOAD_ASYNC is off)
+     */
+    bool enqueueReplay(const SensorReading &reading);
+
+    /**
+     * Upload the current value of every registry channel (up to
+     * SENSOR_MAX_CHANNELS), or when reporting on delta of the channels
+     * that moved beyond their deadband (nothing if none did). With
+     * UPLOAD_ASYNC the frame is queued (and dropped if the frame queue is
+     * full); otherwise it is sent inline.
+     *
+     * @param channels Filtered values from SensorRegistry::view()
+     */
+    void uploadChannels(const ChannelView &channels);
+
+    /**
+     * Send registry channels synchronously: one MQTT message on
+     * MQTT_TOPIC_DATA, or one ThingSpeak update with fields 1-8.
+     *
+     * @param timestamp millis() of the values
+     * @param mask      Channels to include
+     * @return true if the server accepted them
+     */
+    bool sendChannels(const ChannelView &channels, uint32_t timestamp,
+                      ChannelMask mask = CHANNEL_MASK_ALL);
+
+    /**
+     * Upload a sealed history block (see History::lastSealed()). With
+     * UPLOAD_ASYNC the block is queued, otherwise it is sent inline.
+     * ThingSpeak has no binary upload; the block then counts as failed.
+     */
+    void uploadHistory(const uint8_t *block, size_t length);
+
+    /**
+     * Publish one history block on MQTT_TOPIC_HISTORY synchronously.
+     *
+     * @return true if the broker accepted it
+     */
+    bool sendHistory(const uint8_t *block, size_t length);
+
+    /**
+     * Upload a loop profile (see LoopProfiler::closePeriod()) like a
+     * history block: queued with UPLOAD_ASYNC, MQTT only.
+     */
+    void uploadProfile(const char *payload, size_t length);
+
+    /**
+     * @return Readings currently waiting in the upload queue.
+     */
+    size_t queueDepth() const;
+
+    /**
+     * Send a set of readings synchronously. Depending on configuration
+     * this will either perform an HTTP GET request to ThingSpeak or
+     * publish one message to MQTT_TOPIC_DATA.
+     *
+     * @return true if the server accepted the reading
+     */
+    bool send(float temperature, float humidity, int light);
+
+    /**
+     * Send stored readings synchronously, oldest first: ThingSpeak bulk
+     * updates of up to the batch size, or one MQTT message per reading.
+     * Stops at the first failure. At QoS 1 this waits up to
+     * UPLOAD_REQUEST_TIMEOUT for the PUBACKs of its own messages; those
+     * still unacknowledged are withdrawn from the session, so the caller,
+     * which keeps the readings, owns their retry.
+     *
+     * Uses the same request buffers, MQTT session and statistics as the
+     * upload worker, so it only runs with UPLOAD_ASYNC off (as low-power
+     * mode requires); with the worker started it sends nothing.
+     *
+     * @return Number of readings the server accepted (a prefix of @p readings)
+     */
+    size_t sendBatch(const SensorReading *readings, size_t count);
+
+    /**
+     * Close the MQTT and HTTP connections, e.g. before the radio is
+     * powered down. QoS 1 messages in flight get UPLOAD_REQUEST_TIMEOUT
+     * to be acknowledged first.
+     */
+    void disconnect();
+
+    /**
+     * Service the MQTT session between uploads: acknowledgements,
+     * keep-alive, retransmissions and reconnects; also sends a ThingSpeak
+     * batch that has waited THINGSPEAK_BATCH_MAX_AGE. process() does this
+     * first; call it from the main loop when UPLOAD_ASYNC is off.
+     */
+    void loop();
+
+    /**
+     * Service the MQTT session, then send at most one queued reading.
+     * Called in a loop by the worker task; host builds without FreeRTOS
+     * call it directly.
+     *
+     * @return true if a reading was dequeued (sent, failed or expired)
+     */
+    bool process();
+
+    /**
+     * Force a specific upload mechanism instead of deriving it from the
+     * configured API key. Mainly useful for host benchmarks.
+     *
+     * @param target Mechanism to use for subsequent uploads
+     */
+    void setTarget(UploadTarget target);
+
+    /**
+     * @param policy Behaviour of upload() when the queue is full
+     */
+    void setOverflowPolicy(UploadOverflowPolicy policy);
+
+    /**
+     * Readings per ThingSpeak bulk update. 1 restores one GET request per
+     * reading. Clamped to THINGSPEAK_BATCH_SIZE; set before begin().
+     */
+    void setBatchSize(size_t readings);
+
+    /**
+     * Serialise readings as a ThingSpeak bulk-update JSON body. Each entry
+     * carries its created_at time once the clock is set (see WallClock),
+     * otherwise delta_t, the seconds elapsed since the previous entry.
+     *
+     * @param readings Oldest first, at most THINGSPEAK_BATCH_SIZE
+     * @param out      Destination buffer, NUL-terminated on success
+     * @param size     Size of @p out in bytes
+     * @return Length of the body, or 0 if it did not fit
+     */
+    size_t serializeBulkUpdate(const SensorReading *readings, size_t count, char *out,
+                               size_t size) const;
+
+    /**
+     * Serialise readings and channel frames alike. Fields outside an
+     * entry's mask or without a value are left out of it.
+     */
+    size_t serializeBulkUpdate(const BulkEntry *entries, size_t count, char *out,
+                               size_t size) const;
+
+    /**
+     * Report by exception (see DeltaReporter) or send every reading.
+     * Defaults to REPORT_ON_DELTA; switching resets the reported values.
+     */
+    void setReportOnDelta(bool enabled);
+
+    /**
+     * @param format Encoding of subsequent MQTT messages
+     */
+    void setPayloadFormat(MqttPayloadFormat format);
+
+    /** QoS of subsequent data messages, 0 or 1. Defaults to MQTT_QOS. */
+    void setMqttQos(uint8_t qos);
+
+    /** QoS 1 data messages allowed in flight (see MqttSession::setWindow()). */
+    void setMqttWindow(size_t messages);
+
+    /**
+     * Encode one reading as an MQTT message body.
+     *
+     * @param sequence Message sequence number
+     * @param out      Destination buffer (JSON is NUL-terminated)
+     * @param size     Size of @p out in bytes
+     * @return Length of the payload, or 0 if it did not fit
+     */
+    size_t encodePayload(const SensorReading &reading, uint32_t sequence,
+                         MqttPayloadFormat format, uint8_t *out, size_t size) const;
+
+    /**
+     * Encode registry channels as an MQTT message body: seq, ts, then one
+     * entry per channel in @p mask under its upload key. Channels shown
+     * without decimals are encoded as integers, missing values as null
+     * (JSON) or NaN (CBOR). Cost is linear in the channel count.
+     *
+     * @return Length of the payload, or 0 if it did not fit
+     */
+    size_t encodeChannels(const ChannelView &channels, uint32_t timestamp, uint32_t sequence,
+                          MqttPayloadFormat format, uint8_t *out, size_t size,
+                          ChannelMask mask = CHANNEL_MASK_ALL) const;
+
+    /**
+     * @return Snapshot of the upload counters.
+     */
+    UploadStats getStats() const;
+
+    /**
+     * @return Snapshot of the MQTT session counters.
+     */
+    MqttSessionStats mqttStats() const { return _mqtt.getStats(); }
+
 private:
-    WiFiClient _wifiClient;
-    HTTPClient _httpClient;
-    PubSubClient _mqttClient;
+    MqttSession _mqtt;         ///< Persistent session with the broker
+    uint8_t _mqttQos;           ///< QoS of data messages
+    UploadTarget _target;
+    UploadOverflowPolicy _policy;
+    MqttPayloadFormat _payloadFormat;
+    uint32_t _mqttSequence;     ///< Sequence number of the next MQTT message
+
+    SpscRing<SensorReading, UPLOAD_QUEUE_DEPTH> _queue;
+    SpscRing<ChannelFrame, UPLOAD_QUEUE_DEPTH> _frames;   ///< Queued uploadChannels()
+    SpscRing<MessageUpload, UPLOAD_QUEUE_DEPTH> _messages; ///< Queued history and profiles
+    SensorReading _overflow;   ///< Reading held aside under UPLOAD_COALESCE
+    bool _hasOverflow;
+    UploadStats _stats;
+    DeltaReporter _reporter;   ///< Values last delivered, for report by exception
+#if UPLOAD_ASYNC
+    SpscRing<ChannelFrame, UPLOAD_QUEUE_DEPTH> _delivered; ///< Worker to producer, for _reporter
+#endif
+    bool _reportOnDelta;
+
+    /** Fields of a ThingSpeak channel. */
+    static const size_t kThingSpeakFields = 8;
+    /** Bulk-update body: key and framing plus one entry of up to eight fields per update. */
+    static const size_t kBulkBodySize = 64 + 192 * THINGSPEAK_BATCH_SIZE;
+
+    BulkEntry _batch[THINGSPEAK_BATCH_SIZE]; ///< Readings and frames awaiting a bulk update
+    size_t _batchCount;
+    size_t _batchSize;          ///< Readings per bulk update
+    uint32_t _batchStarted;     ///< millis() when the first reading was batched
+    char _bulkBody[kBulkBodySize];
+    uint32_t _lastHeapReport;   ///< millis() of the last heap report
+    // Packet IDs of replayed QoS 1 messages awaiting their PUBACK, in
+    // publish order; all lie in the session window, so it bounds them
+    uint16_t _replayAcks[MQTT_INFLIGHT_MAX];
+    size_t _replayAckHead;
+    size_t _replayAckCount;
+    HttpConnection _http;       ///< Kept-alive connection to ThingSpeak
 
-    void uploadThingSpeak(float temperature, float humidity, int light);
-    void uploadMQTT(float temperature, float humidity, int light);
+    void enqueue(const SensorReading &reading);
+    void deliver(const SensorReading &reading);
+    void deliverChannels(const ChannelView &channels, uint32_t timestamp, ChannelMask mask);
+    void addToBatch(const BulkEntry &entry);
+    void flushBatch();
+    void flushStaleBatch();
+    bool useThingSpeak() const;
+    bool sendReading(const SensorReading &reading);
+    void recordLatency(uint32_t latencyMs);
+    void settleReplay(uint8_t flags, bool ok);
+    void reportDelivered(const BulkEntry &entry);
+    void reportDelivered(const float *values, size_t count, ChannelMask mask, uint32_t timestamp);
+    void applyDelivered();
+    void collectReplayAcks();
+    void reportHeap();
+    bool uploadThingSpeak(float temperature, float humidity, int light);
+    bool uploadThingSpeakBulk(const SensorReading *readings, size_t count);
+    bool uploadThingSpeakBulk(const BulkEntry *entries, size_t count);
+    static BulkEntry bulkEntry(const SensorReading &reading);
+    bool uploadMQTT(const SensorReading &reading);
+    bool uploadThingSpeakChannels(const ChannelView &channels, ChannelMask mask);
+    bool connectMQTT();
+    bool publishData(const uint8_t *payload, size_t length);
+    void uploadMessage(const MessageUpload &message);
+    bool sendMessage(const MessageUpload &message);
+#ifdef ARDUINO_ARCH_ESP32
+    static void workerTask(void *arg);
+#endif
 };
 
-#endif // CLOUD_UPLOADER_H
\ No newline at end of file
+#endif // CLOUD_UPLOADER_H
@@ -0,0 +1,99 @@
+/**
+ * @file DeltaReporter.h
+ * @brief Report-by-exception: which channels have changed enough to send.
+ *
+ * Most uploads of a node repeat the previous values. A DeltaReporter
+ * remembers the value each channel was last delivered with and selects a
+ * channel again only once its filtered value has moved by more than the
+ * channel's deadband (kDeltaRules), or became or stopped being NAN.
+ * Channels without a rule have no deadband: any change is reported.
+ *
+ * So that a silent node can be told from a dead one, every channel is
+ * reported once REPORT_HEARTBEAT_INTERVAL has passed without a delivered
+ * report. A consumer that keeps the last value of each channel is then
+ * never further than the deadband from the node's filtered value, and
+ * hears from the node at least once per heartbeat interval.
+ */
+
+#ifndef DELTA_REPORTER_H
+#define DELTA_REPORTER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensors/Sensor.h"
+
+/**
+ * One entry of the deadband table.
+ */
+struct DeltaRule {
+    uint8_t channel;    ///< Registry channel (StandardChannel for the node's own)
+    float deadband;     ///< Change since the last report that is not reported
+};
+
+/**
+ * Deadbands of the node, a little above what the filtered values wander
+ * on a quiet day; add rules for extra channels.
+ */
+inline constexpr DeltaRule kDeltaRules[] = {
+    {CHANNEL_TEMPERATURE, TEMP_DEADBAND},
+    {CHANNEL_HUMIDITY, HUMID_DEADBAND},
+    {CHANNEL_LIGHT, LIGHT_DEADBAND},
+};
+
+/**
+ * @return true if no deadband is negative or NAN.
+ */
+template <size_t N>
+constexpr bool deltaRulesValid(const DeltaRule (&rules)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+        if (!(rules[i].deadband >= 0.0f) || rules[i].channel >= SENSOR_MAX_CHANNELS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(deltaRulesValid(kDeltaRules), "Invalid rule in kDeltaRules");
+
+/**
+ * @class DeltaReporter
+ * @brief Last reported value per channel and the deadband test.
+ *
+ * Only the first SENSOR_MAX_CHANNELS channels are tracked, as many as
+ * CloudUploader sends.
+ */
+class DeltaReporter {
+public:
+    DeltaReporter();
+
+    /** Forget what was reported: the next changed() selects every channel. */
+    void reset();
+
+    /**
+     * @param values Filtered values, one per channel
+     * @param count  Channels in @p values
+     * @return Channels to report at @p nowMs, 0 if the report can be
+     *         suppressed; every channel when the heartbeat is due
+     */
+    ChannelMask changed(const float *values, size_t count, uint32_t nowMs) const;
+
+    /** @return true if nothing was reported for REPORT_HEARTBEAT_INTERVAL. */
+    bool heartbeatDue(uint32_t nowMs) const;
+
+    /**
+     * Record that the channels in @p mask were delivered with @p values.
+     * Call it once the send succeeded, not when the report was queued: a
+     * report that is dropped or fails must leave its change pending, so
+     * the next changed() selects it again.
+     */
+    void reported(const float *values, size_t count, ChannelMask mask, uint32_t nowMs);
+
+private:
+    float _deadband[SENSOR_MAX_CHANNELS];
+    float _last[SENSOR_MAX_CHANNELS];     ///< Value last reported per channel
+    ChannelMask _known;                   ///< Channels reported at least once
+    uint32_t _lastReportMs;
+    bool _started;                        ///< Anything reported since reset()
+};
+
+#endif // DELTA_REPORTER_H
@@ -0,0 +1,74 @@
+/**
+ * @file HttpConnection.h
+ * @brief Minimal HTTP/1.1 client over a persistent WiFiClient connection.
+ *
+ * Replaces HTTPClient on the upload path. The request head is formatted
+ * into a fixed member buffer and the response is parsed byte by byte, so a
+ * request performs no heap allocation. The connection is kept alive and
+ * reopened transparently when the server has closed it.
+ */
+
+#ifndef HTTP_CONNECTION_H
+#define HTTP_CONNECTION_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+
+/**
+ * Negative results of HttpConnection::request().
+ */
+enum HttpError {
+    HTTP_ERROR_CONNECT  = -1,   ///< TCP connection could not be opened
+    HTTP_ERROR_SEND     = -2,   ///< Request head or body could not be written
+    HTTP_ERROR_OVERFLOW = -3,   ///< Request head did not fit HTTP_HEAD_MAX
+    HTTP_ERROR_PROTOCOL = -4,   ///< Malformed status line
+    HTTP_ERROR_TIMEOUT  = -11   ///< No response within the response timeout
+};
+
+/**
+ * @class HttpConnection
+ * @brief Sends requests to one host and returns the response status.
+ */
+class HttpConnection {
+public:
+    /**
+     * @param host Server name; the pointer must stay valid
+     * @param port Server port
+     */
+    HttpConnection(const char *host, uint16_t port);
+
+    /**
+     * @param connectMs  Deadline for opening the TCP connection
+     * @param responseMs Deadline for the complete response
+     */
+    void setTimeouts(uint32_t connectMs, uint32_t responseMs);
+
+    /**
+     * Send one request and wait for the response.
+     *
+     * @param method      "GET" or "POST"
+     * @param uri         Path and query string
+     * @param contentType Content-Type of @p body, or nullptr without a body
+     * @param body        Request body, may be nullptr
+     * @param length      Length of @p body
+     * @return HTTP status code, or a negative HttpError
+     */
+    int request(const char *method, const char *uri, const char *contentType,
+                const uint8_t *body, size_t length);
+
+    /** Close the connection. */
+    void stop();
+
+private:
+    bool readLine(unsigned long start, size_t &length);
+
+    WiFiClient _client;
+    const char *_host;
+    uint16_t _port;
+    uint32_t _connectTimeout;
+    uint32_t _responseTimeout;
+    char _buffer[HTTP_HEAD_MAX];   ///< Request head, then response lines
+};
+
+#endif // HTTP_CONNECTION_H
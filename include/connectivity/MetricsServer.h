@@ -0,0 +1,114 @@
+/**
+ * @file MetricsServer.h
+ * @brief Local HTTP endpoint for current readings, counters and history.
+ *
+ * Two resources are served on METRICS_HTTP_PORT:
+ *
+ *   - GET /metrics: Prometheus text exposition (version 0.0.4) of the
+ *     filtered and last raw value of every registry channel, the alert
+ *     rules and state, the upload and history counters, heap and uptime.
+ *   - GET /history?from=&to=&last=&step=&agg=: CSV of the History rows
+ *     in a time range, "timestamp_ms,<key>,..." with empty fields for
+ *     failed reads. `from`/`to` are millis() timestamps, `last` selects
+ *     the final milliseconds up to now instead. With `step` (ms) the rows
+ *     are reduced on the node to one per step, the average (`agg=avg`,
+ *     default), `min` or `max` of each channel, stamped with the start
+ *     of the step.
+ *
+ * Responses are generated while they are sent: values are formatted
+ * straight from the registry, the counters and the compressed blocks
+ * (decoded one row at a time) into one METRICS_CHUNK_BYTES buffer on the
+ * stack, so the size of a response has no bearing on RAM. The body ends
+ * when the connection closes. Per connection only the request line is
+ * kept; nothing is allocated.
+ *
+ * loop() is polled: it accepts connections, collects request heads
+ * without blocking and answers each complete request before returning.
+ */
+
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+#include "connectivity/CloudUploader.h"
+#include "sensors/SensorRegistry.h"
+#include "storage/History.h"
+#include "utils/AlertManager.h"
+
+/**
+ * Counters describing the requests served since begin().
+ */
+struct MetricsServerStats {
+    uint32_t requests;     ///< Requests answered, errors included
+    uint32_t notFound;     ///< Requests for an unknown path (404)
+    uint32_t badRequests;  ///< Malformed, overlong or non-GET requests
+    uint32_t rejected;     ///< Connections refused because all slots were busy (503)
+    uint32_t timeouts;     ///< Connections closed before a complete request
+    uint64_t bytesSent;    ///< Response bytes, headers included
+};
+
+/**
+ * @class MetricsServer
+ * @brief Serves /metrics and /history from the in-memory sample store.
+ */
+class MetricsServer {
+public:
+    /**
+     * @param registry Channels and their current values
+     * @param alerts   Alert rules and state
+     * @param uploader Source of the upload counters
+     * @param history  Raw sample history, or nullptr to answer /history with 404
+     * @param port     TCP port to listen on
+     */
+    MetricsServer(const SensorRegistry<> &registry, const AlertManager &alerts,
+                  const CloudUploader &uploader, const History *history,
+                  uint16_t port = METRICS_HTTP_PORT);
+
+    /** Start listening. */
+    void begin();
+
+    /** Close every connection and stop listening. */
+    void end();
+
+    /** Accept connections, read requests and answer the complete ones. */
+    void loop();
+
+    /** @return Connections currently open. */
+    size_t openConnections() const;
+
+    const MetricsServerStats &getStats() const { return _stats; }
+
+    /** @return RAM held per connection slot, in bytes. */
+    static constexpr size_t connectionBytes() { return sizeof(Connection); }
+
+private:
+    struct Connection {
+        WiFiClient client;
+        uint32_t openedAt;                  ///< millis() at accept
+        uint16_t length;                    ///< Bytes of the request line kept
+        uint8_t newlines;                   ///< Consecutive line ends seen (2 ends the head)
+        bool active;
+        bool lineDone;                      ///< Request line complete
+        bool overlong;                      ///< Request line did not fit
+        char line[METRICS_REQUEST_MAX];     ///< Request line, without the line end
+    };
+
+    const SensorRegistry<> &_registry;
+    const AlertManager &_alerts;
+    const CloudUploader &_uploader;
+    const History *_history;
+    WiFiServer _server;
+    bool _listening;
+    Connection _connections[METRICS_MAX_CLIENTS];
+    MetricsServerStats _stats;
+
+    void accept();
+    /** @return true once the request head of @p c is complete. */
+    bool receive(Connection &c);
+    void respond(Connection &c);
+    void close(Connection &c);
+};
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,131 @@
+/**
+ * @file MqttCodec.h
+ * @brief Minimal MQTT 3.1.1 packet encoder and decoder.
+ *
+ * Covers what a telemetry client needs: CONNECT, PUBLISH (QoS 0 and 1),
+ * PUBACK, SUBSCRIBE, PINGREQ and DISCONNECT out; CONNACK, PUBLISH,
+ * PUBACK, SUBACK and PINGRESP in. Packets are written into and parsed
+ * from caller buffers: nothing is allocated and no I/O is done, so the
+ * same code serves the firmware and host tools (e.g. the load generator).
+ */
+
+#ifndef MQTT_CODEC_H
+#define MQTT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Control packet types (high nibble of the first byte).
+ */
+enum MqttPacketType {
+    MQTT_CONNECT     = 1,
+    MQTT_CONNACK     = 2,
+    MQTT_PUBLISH     = 3,
+    MQTT_PUBACK      = 4,
+    MQTT_SUBSCRIBE   = 8,
+    MQTT_SUBACK      = 9,
+    MQTT_PINGREQ     = 12,
+    MQTT_PINGRESP    = 13,
+    MQTT_DISCONNECT  = 14
+};
+
+/**
+ * One control packet located in a receive buffer by MqttCodec::parse().
+ */
+struct MqttPacket {
+    uint8_t type;          ///< MqttPacketType
+    uint8_t flags;         ///< Low nibble of the first byte
+    const uint8_t *body;   ///< Variable header and payload
+    size_t length;         ///< Remaining length: bytes at @p body
+    size_t size;           ///< Whole packet, fixed header included
+};
+
+/**
+ * Fields of a received PUBLISH; topic and payload point into the packet.
+ */
+struct MqttPublish {
+    const char *topic;     ///< Not NUL-terminated
+    size_t topicLength;
+    const uint8_t *payload;
+    size_t payloadLength;
+    uint8_t qos;
+    bool dup;
+    bool retain;
+    uint16_t packetId;     ///< 0 at QoS 0
+};
+
+/**
+ * Results of MqttCodec::parse().
+ */
+enum MqttParseResult {
+    MQTT_PARSE_MALFORMED  = -1,   ///< Not an MQTT stream: close the connection
+    MQTT_PARSE_INCOMPLETE = 0,    ///< Wait for more bytes
+    MQTT_PARSE_OK         = 1
+};
+
+/**
+ * @class MqttCodec
+ * @brief Stateless packet encoding and decoding.
+ *
+ * Every encoder returns the packet length, or 0 if it did not fit
+ * @p size (nothing usable is written then).
+ */
+class MqttCodec {
+public:
+    /** Largest remaining length MQTT can express. */
+    static const size_t kMaxRemaining = 268435455;
+
+    /**
+     * @param keepAliveS   Seconds the broker waits for a packet before
+     *                     dropping the client (0: never)
+     * @param cleanSession false to resume the broker's session of
+     *                     @p clientId (subscriptions, unacknowledged QoS 1)
+     * @param user         Optional user name (nullptr for none)
+     * @param password     Optional password, only with a user name
+     */
+    static size_t connect(uint8_t *out, size_t size, const char *clientId, uint16_t keepAliveS,
+                          bool cleanSession, const char *user = nullptr,
+                          const char *password = nullptr);
+
+    /**
+     * @param qos      0 or 1
+     * @param packetId Non-zero identifier at QoS 1, ignored at QoS 0
+     * @param dup      Set on a retransmission
+     */
+    static size_t publish(uint8_t *out, size_t size, const char *topic, const uint8_t *payload,
+                          size_t length, uint8_t qos, uint16_t packetId, bool dup = false,
+                          bool retain = false);
+
+    /** Fixed header and topic of a PUBLISH, for payloads sent separately. */
+    static size_t publishHeader(uint8_t *out, size_t size, const char *topic, size_t length,
+                                uint8_t qos, uint16_t packetId, bool dup = false,
+                                bool retain = false);
+
+    static size_t puback(uint8_t *out, size_t size, uint16_t packetId);
+    static size_t subscribe(uint8_t *out, size_t size, uint16_t packetId, const char *topic,
+                            uint8_t qos);
+    static size_t pingreq(uint8_t *out, size_t size);
+    static size_t disconnect(uint8_t *out, size_t size);
+
+    /**
+     * Locate the first packet in @p data.
+     *
+     * @param available Bytes received so far
+     */
+    static MqttParseResult parse(const uint8_t *data, size_t available, MqttPacket &packet);
+
+    /** @return false if @p packet is not a well-formed PUBLISH. */
+    static bool parsePublish(const MqttPacket &packet, MqttPublish &publish);
+
+    /**
+     * @param returnCode 0 when the connection was accepted
+     * @return false if @p packet is not a well-formed CONNACK
+     */
+    static bool parseConnack(const MqttPacket &packet, bool &sessionPresent, uint8_t &returnCode);
+
+    /** @return false unless @p packet is a PUBACK or SUBACK with an identifier. */
+    static bool parseAck(const MqttPacket &packet, uint16_t &packetId);
+};
+
+#endif // MQTT_CODEC_H
@@ -0,0 +1,176 @@
+/**
+ * @file MqttSession.h
+ * @brief Persistent MQTT 3.1.1 session with a window of QoS 1 messages.
+ *
+ * Replaces PubSubClient on the upload path. The session is meant to be
+ * serviced continuously (loop()), not only when a message is due: it reads
+ * acknowledgements as they arrive, sends PINGREQ before the keep-alive
+ * lapses and reconnects with backoff when the connection is lost.
+ *
+ * QoS 1 messages are pipelined: publish() copies the packet into one of
+ * MQTT_INFLIGHT_MAX slots, writes it and returns without waiting for the
+ * PUBACK. A slot is freed by its PUBACK. Unacknowledged packets are sent
+ * again with the DUP flag after MQTT_RETRY_INTERVAL, and all of them after
+ * a reconnect, as the persistent session (clean session off) requires, so
+ * delivery is at least once. Packets are built with MqttCodec into fixed
+ * buffers; nothing is allocated.
+ */
+
+#ifndef MQTT_SESSION_H
+#define MQTT_SESSION_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+
+/**
+ * Counters of one MqttSession.
+ */
+struct MqttSessionStats {
+    uint32_t connects;          ///< Sessions opened (CONNACK accepted)
+    uint32_t connectFailures;   ///< Attempts refused or timed out while WiFi was up
+    uint32_t disconnects;       ///< Open sessions lost: write error, broker or keep-alive
+    uint32_t published;         ///< PUBLISH packets written, retransmissions excluded
+    uint32_t acknowledged;      ///< QoS 1 messages confirmed by a PUBACK
+    uint32_t retransmitted;     ///< PUBLISH packets written again with DUP
+    uint32_t windowFull;        ///< QoS 1 publishes refused: no slot freed in time
+    uint32_t inFlight;          ///< Unacknowledged QoS 1 messages now
+    uint32_t maxAckMs;          ///< Longest first send to PUBACK
+};
+
+/**
+ * @class MqttSession
+ * @brief Publishes to one broker over a kept-alive WiFiClient connection.
+ */
+class MqttSession {
+public:
+    /**
+     * @param host Broker name; the pointer must stay valid
+     * @param port Broker port
+     */
+    MqttSession(const char *host, uint16_t port);
+
+    /**
+     * Client identifier; must be stable across reconnects for the broker
+     * to resume the session. Copied; set before the first connect.
+     */
+    void setClientId(const char *clientId);
+
+    /**
+     * @param connectMs  Deadline for opening the TCP connection
+     * @param responseMs Deadline for a CONNACK, a PINGRESP or a free slot
+     */
+    void setTimeouts(uint32_t connectMs, uint32_t responseMs);
+
+    /** QoS 1 messages allowed in flight, 1 to MQTT_INFLIGHT_MAX. */
+    void setWindow(size_t messages);
+
+    /**
+     * Open the session unless it is open. Does nothing while WiFi is down
+     * and, after failures, until the reconnect backoff has elapsed.
+     *
+     * @return true if the session is open
+     */
+    bool connect();
+
+    /**
+     * Service the session without blocking (apart from a reconnect):
+     * handle acknowledgements, keep it alive, retransmit and reconnect.
+     * Call often; at least every half keep-alive interval.
+     */
+    void loop();
+
+    /**
+     * Publish one message on an open session. At QoS 1 this waits, servicing
+     * the session, while the window is full.
+     *
+     * @param qos 0, or 1 for a packet of at most MQTT_INFLIGHT_PACKET_MAX bytes
+     * @return true once the packet was written (QoS 0) or taken into the
+     *         window (QoS 1)
+     */
+    bool publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos);
+
+    /**
+     * Service the session until every QoS 1 message is acknowledged.
+     *
+     * @return true if none is left in flight
+     */
+    bool flush(uint32_t timeoutMs);
+
+    /**
+     * Send DISCONNECT and close. Unacknowledged messages stay in the
+     * window for the next session; loop() will not reconnect before the
+     * next connect() or publish().
+     */
+    void disconnect();
+
+    bool connected() { return _open && _client.connected(); }
+    size_t inFlight() const { return _inFlight; }
+    /**
+     * QoS 1 messages from the oldest unacknowledged one to the newest, in
+     * publish order; 0 when everything is acknowledged.
+     */
+    size_t backlog() const { return _count; }
+    /** Identifier of the latest QoS 1 message taken into the window. */
+    uint16_t lastPacketId() const { return _packetId; }
+
+    /** @return true if the QoS 1 message @p packetId awaits its PUBACK */
+    bool pending(uint16_t packetId) const;
+
+    /**
+     * Withdraw an unacknowledged message from the window: it is neither
+     * sent again nor counted as acknowledged. For a caller that keeps the
+     * payload itself and will publish it again as a new message.
+     */
+    void abandon(uint16_t packetId);
+    MqttSessionStats getStats() const;
+
+private:
+    /** A QoS 1 PUBLISH awaiting its PUBACK. */
+    struct Slot {
+        uint16_t packetId;   ///< 0 once acknowledged
+        bool written;        ///< Sent at least once; later copies carry DUP
+        uint32_t firstSent;  ///< millis() of the first write
+        uint32_t lastSent;   ///< millis() of the latest write
+        size_t length;
+        uint8_t packet[MQTT_INFLIGHT_PACKET_MAX];
+    };
+
+    Slot &slot(size_t index) { return _slots[(_head + index) % MQTT_INFLIGHT_MAX]; }
+    const Slot &slot(size_t index) const { return _slots[(_head + index) % MQTT_INFLIGHT_MAX]; }
+    bool open();
+    void close(bool lost);
+    bool write(const uint8_t *data, size_t length);
+    bool transmit(Slot &slot);
+    bool receive();
+    void acknowledge(uint16_t packetId);
+    void release(size_t index);
+    uint16_t nextPacketId();
+
+    WiFiClient _client;
+    const char *_host;
+    uint16_t _port;
+    char _clientId[48];
+    uint32_t _connectTimeout;
+    uint32_t _responseTimeout;
+    size_t _window;
+    bool _open;
+    bool _wanted;              ///< Reconnect from loop(); cleared by disconnect()
+    uint32_t _failedAt;        ///< millis() of the last failed connect
+    uint32_t _backoff;         ///< Delay before the next connect (ms), 0 after a success
+    uint32_t _lastSend;        ///< millis() of the last packet written
+    uint32_t _pingSent;        ///< millis() of an unanswered PINGREQ
+    bool _pingPending;
+    uint16_t _packetId;        ///< Last identifier used
+    uint8_t _in[8];            ///< Partial packet from the broker
+    size_t _inLength;
+    MqttSessionStats _stats;
+    // Ring of slots in publish order; acknowledged slots are reclaimed from
+    // the oldest, so retransmissions keep the original order
+    Slot _slots[MQTT_INFLIGHT_MAX];
+    size_t _head;              ///< Oldest slot
+    size_t _count;             ///< Slots taken, acknowledged ones behind an older included
+    size_t _inFlight;          ///< Slots not acknowledged
+};
+
+#endif // MQTT_SESSION_H
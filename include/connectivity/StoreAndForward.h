@@ -0,0 +1,89 @@
+/**
+ * @file StoreAndForward.h
+ * @brief Keeps readings in the flash log while offline and replays them
+ *        once the uplink is back.
+ */
+
+#ifndef STORE_AND_FORWARD_H
+#define STORE_AND_FORWARD_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "connectivity/CloudUploader.h"
+#include "sensors/SensorReading.h"
+#include "storage/FlashLog.h"
+
+/**
+ * @class StoreAndForward
+ * @brief Routes live readings either to the CloudUploader or to a FlashLog
+ *        and drains the log in the background.
+ *
+ * Replay is paced: at most REPLAY_BATCH_SIZE readings every
+ * REPLAY_INTERVAL, and only while the upload queue is at most half full,
+ * so live readings always find room and are never delayed behind a long
+ * backlog.
+ *
+ * A batch stays in the log until the uploader reports every reading of it
+ * delivered; only then is it committed. If one of them fails, or the ring
+ * overwrote records meanwhile, the batch is left in flash and replayed
+ * again, so a reading may arrive twice but is never lost to a failed send
+ * or a reset. After a failure replay pauses for REPLAY_RETRY_INTERVAL.
+ */
+class StoreAndForward {
+public:
+    StoreAndForward(FlashLog &log, CloudUploader &uploader);
+
+    /**
+     * Mount the flash log. Without a usable log, offline readings are
+     * dropped as before.
+     *
+     * @return true if the log is usable
+     */
+    bool begin();
+
+    /**
+     * Upload a live reading when connected, store it otherwise.
+     *
+     * @param reading   Filtered reading to deliver
+     * @param connected Whether the uplink is currently available
+     */
+    void submit(const SensorReading &reading, bool connected);
+
+    /**
+     * Upload every registry channel when connected. Otherwise store the
+     * first three, temperature, humidity and light: a flash record has no
+     * room for more. Nothing is stored until all three have a valid average.
+     *
+     * @param channels  Moving averages of the registry
+     * @param timestamp millis() of the averages
+     * @param connected Whether the uplink is currently available
+     */
+    void submit(const ChannelView &channels, uint32_t timestamp, bool connected);
+
+    /**
+     * Replay step; call as often as convenient from the task that calls
+     * submit(). Never blocks on the network.
+     *
+     * @param connected Whether the uplink is currently available
+     * @return Number of stored readings confirmed delivered and committed
+     */
+    size_t loop(bool connected);
+
+    /** @return Stored readings still waiting to be sent. */
+    size_t pending() const { return _log.pending(); }
+
+private:
+    FlashLog &_log;
+    CloudUploader &_uploader;
+    unsigned long _lastReplay;   ///< millis() of the last replay step
+    unsigned long _interval;     ///< Wait before the next step (ms), longer after a failure
+    bool _ready;                 ///< Log mounted
+    size_t _inFlight;            ///< Readings of the batch handed over, not yet settled
+    uint32_t _replayedBase;      ///< Uploader's replayed count at the handover
+    uint32_t _failedBase;        ///< Uploader's replayFailed count at the handover
+    uint32_t _overwrittenBase;   ///< Log's overwritten count at the handover
+
+    size_t settle();
+};
+
+#endif // STORE_AND_FORWARD_H
@@ -3,6 +3,15 @@
  * @brief Helper class to manage WiFi connectivity for the ESP32.
  *
  * Provides a non‑blocking API to connect and maintain a WiFi connection.
+ * Connection progress is driven by the ESP32 WiFi event callbacks; loop()
+ * only inspects flags set by those callbacks and never waits, so a
+ * reconnect attempt costs the caller microseconds instead of seconds.
+ *
+ * With WIFI_FAST_CONNECT the BSSID, channel and IP configuration of the last
+ * successful connection are kept in RTC memory (and NVS for cold boots).
+ * The next attempt joins that access point directly, skipping the channel
+ * scan and, with WIFI_CACHE_STATIC_IP, the DHCP exchange. If it fails the
+ * cache is dropped and a full scan follows immediately.
  */
 
 #ifndef WIFI_MANAGER_H
@@ -10,8 +19,38 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <atomic>
 #include "config.h"
 
+/**
+ * Connection states of the WiFiManager state machine.
+ */
+enum WiFiState {
+    WIFI_STATE_IDLE,        ///< connect() not called yet
+    WIFI_STATE_CONNECTING,  ///< Association/DHCP in progress
+    WIFI_STATE_CONNECTED,   ///< Station has an IP address
+    WIFI_STATE_BACKOFF      ///< Waiting before the next attempt
+};
+
+/**
+ * Listener invoked from WiFiManager::loop() whenever the state changes.
+ *
+ * @param state   The new state
+ * @param context Pointer supplied at registration
+ */
+typedef void (*WiFiStateCallback)(WiFiState state, void *context);
+
+/**
+ * Connection attempt counters and the duration of the last connection.
+ */
+struct WiFiConnectStats {
+    uint32_t fastAttempts;        ///< Attempts using the cached BSSID/channel/IP
+    uint32_t fastFallbacks;       ///< Fast attempts that failed and fell back to a scan
+    uint32_t scanAttempts;        ///< Attempts with a full scan
+    unsigned long lastConnectMs;  ///< Start of the attempt (fallback included) to GOT_IP
+    bool lastFast;                ///< Last connection used the cached link
+};
+
 /**
  * @class WiFiManager
  * @brief Encapsulates connection and reconnection logic for WiFi.
@@ -19,29 +58,97 @@
 class WiFiManager {
 public:
     WiFiManager();
+    ~WiFiManager();
 
     /**
-     * Attempt to connect to the configured WiFi network. This method
-     * blocks until either a connection is established or the timeout
-     * defined in config.h expires.
+     * Start connecting to the configured WiFi network. This method returns
+     * immediately; completion is reported through loop() and the state
+     * change listeners.
      *
-     * @return true if connected, false otherwise
+     * @return true if already connected, false otherwise
      */
     bool connect();
 
+    /**
+     * Drop the connection and power the radio down. connect() brings it
+     * back up.
+     */
+    void disconnect();
+
     /**
      * Return whether the device is currently connected to WiFi.
      */
     bool isConnected() const;
 
     /**
-     * Should be called frequently in loop(). Handles reconnection
-     * attempts if the connection is lost.
+     * Should be called frequently in loop(). Processes pending WiFi events,
+     * times out stalled attempts and starts retries once the backoff delay
+     * has elapsed. Never blocks.
      */
     void loop();
 
+    /**
+     * @return Current state of the connection state machine.
+     */
+    WiFiState getState() const;
+
+    /**
+     * Register a listener for state changes. Listeners run in the context
+     * of the task calling loop(), not in the WiFi event task.
+     *
+     * @param callback Function to invoke
+     * @param context  Opaque pointer passed back to the callback
+     * @return false if WIFI_MAX_LISTENERS listeners are already registered
+     */
+    bool onStateChange(WiFiStateCallback callback, void *context = nullptr);
+
+    /**
+     * @return Number of consecutive failed attempts since the last success.
+     */
+    uint32_t getFailures() const;
+
+    /**
+     * @return Attempt counters and the time the last connection took.
+     */
+    const WiFiConnectStats &getStats() const;
+
+    /**
+     * Drop the cached link from RTC memory, as a power loss would. The NVS
+     * copy is kept. Host simulations use this to model a cold boot.
+     */
+    static void forgetRetainedLink();
+
 private:
-    unsigned long _lastAttempt; ///< Time of the last reconnection attempt
+    /** Bits set by the WiFi event task and consumed by loop(). */
+    enum EventFlag : uint32_t {
+        EVENT_GOT_IP       = 1u << 0,
+        EVENT_DISCONNECTED = 1u << 1
+    };
+
+    struct Listener {
+        WiFiStateCallback callback;
+        void *context;
+    };
+
+    void onWiFiEvent(WiFiEvent_t event);
+    void startAttempt(unsigned long now);
+    void scheduleRetry(unsigned long now);
+    void fallBack(unsigned long now);
+    void setState(WiFiState state);
+
+    std::atomic<uint32_t> _events;   ///< Pending EventFlag bits
+    WiFiState _state;                ///< Current state
+    bool _handlerRegistered;         ///< WiFi.onEvent() done
+    wifi_event_id_t _handlerId;      ///< Registration to remove on destruction
+    unsigned long _lastAttempt;      ///< Start of the current attempt or backoff
+    unsigned long _retryDelay;       ///< Backoff delay before the next attempt
+    uint32_t _failures;              ///< Consecutive failed attempts
+    unsigned long _attemptStart;     ///< Start of the attempt, before any fallback
+    bool _fastPath;                  ///< Current attempt uses the cached link
+    bool _fallingBack;               ///< Next attempt is the scan after a failed fast path
+    WiFiConnectStats _stats;
+    Listener _listeners[WIFI_MAX_LISTENERS];
+    size_t _listenerCount;
 };
 
-#endif // WIFI_MANAGER_H
\ No newline at end of file
+#endif // WIFI_MANAGER_H
@@ -5,6 +5,11 @@
  * This class handles initialization of the display, rendering of sensor
  * readings and status messages. It relies on the global configuration
  * constants defined in config.h.
+ *
+ * Frames are rendered into the driver's framebuffer as before, but are not
+ * pushed with display(): a shadow copy of the panel RAM is kept and only
+ * the changed column span of each changed page is sent. When the formatted
+ * text is identical to the previous frame, nothing is rendered or sent.
  */
 
 #ifndef OLED_DISPLAY_H
@@ -15,6 +20,20 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include "config.h"
+#include "sensors/Sensor.h"
+
+/**
+ * Rendering and bus counters since begin().
+ */
+struct DisplayStats {
+    uint32_t frames;        ///< showReadings()/showStatus() calls
+    uint32_t flushes;       ///< Frames that sent data over I2C
+    uint32_t skipped;       ///< Frames with unchanged text (nothing rendered)
+    uint64_t i2cBytes;      ///< Bytes sent, including address and control bytes
+    uint32_t lastFrameUs;   ///< Render + transfer time of the last frame
+    uint32_t maxFrameUs;
+    uint64_t totalFrameUs;
+};
 
 /**
  * @class OledDisplay
@@ -41,10 +60,23 @@ public:
      *
      * @param temperature Filtered temperature reading in °C
      * @param humidity    Filtered humidity reading in %
-     * @param light       Filtered light reading (0‑4095)
+     * @param light       Filtered light reading (mV)
      */
     void showReadings(float temperature, float humidity, int light);
 
+    /**
+     * Render registry channels as "Label: value unit" lines. When there
+     * are more channels than text lines, they are split into pages with a
+     * page indicator on the last line; callers rotate @p page.
+     *
+     * @param channels Filtered values from SensorRegistry::view()
+     * @param page     Page to show, modulo channelPages()
+     */
+    void showChannels(const ChannelView &channels, size_t page = 0);
+
+    /** @return Pages showChannels() needs for @p channels channels. */
+    static size_t channelPages(size_t channels);
+
     /**
      * Show a status message on the display. This will clear the screen
      * before rendering the message.
@@ -53,9 +85,38 @@ public:
      */
     void showStatus(const String &status);
 
+    /**
+     * Change the I2C clock, e.g. to compare standard and fast mode.
+     *
+     * @param hz Bus clock in Hz
+     */
+    void setClock(uint32_t hz);
+
+    /** @return Rendered frame, in SSD1306 page layout. */
+    const uint8_t *frameBuffer() { return _display.getBuffer(); }
+
+    /** @return Counters since begin(). */
+    const DisplayStats &getStats() const { return _stats; }
+
 private:
+    static const size_t kPages = (OLED_HEIGHT + 7) / 8;
+    static const size_t kMaxLines = OLED_HEIGHT / 8;    ///< 8 px per text line
+    static const size_t kLineMax = OLED_WIDTH / 6 + 1;   ///< 6 px per character
+
     Adafruit_SSD1306 _display; ///< Display driver object
+    uint8_t _shadow[OLED_WIDTH * kPages];  ///< What the panel currently shows
+    char _lines[kMaxLines][kLineMax];      ///< Text of the last readings frame
+    size_t _lineCount;
+    bool _linesValid;                      ///< _lines matches the panel
+    DisplayStats _stats;
+
     void clear();              ///< Clear the display buffer and send to screen
+    void render(const char *const *lines, size_t count);
+    void showLines(char (*lines)[kLineMax], size_t count, uint32_t startUs);
+    void flush(bool full);
+    void sendCommands(const uint8_t *commands, size_t count);
+    void sendData(const uint8_t *data, size_t count);
+    void recordFrame(uint32_t startUs);
 };
 
-#endif // OLED_DISPLAY_H
\ No newline at end of file
+#endif // OLED_DISPLAY_H
@@ -0,0 +1,87 @@
+/**
+ * @file TaskPipeline.h
+ * @brief FreeRTOS task pipeline: sensing, display/alerting and uplink run as
+ *        independent tasks connected by lock-free queues.
+ *
+ * The sensing task owns the SensorRegistry, samples every channel at a
+ * fixed cadence and evaluates the alert rules on every sample. A snapshot
+ * of the channel averages is pushed into one SPSC ring per consumer, so a
+ * blocking WiFi connect or HTTP request in the uplink task can no longer
+ * delay sampling or the display.
+ */
+
+#ifndef TASK_PIPELINE_H
+#define TASK_PIPELINE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+
+#include "sensors/SensorRegistry.h"
+#include "display/OledDisplay.h"
+#include "connectivity/WiFiManager.h"
+#include "connectivity/CloudUploader.h"
+#include "connectivity/StoreAndForward.h"
+#include "utils/AlertManager.h"
+#include "utils/JitterMonitor.h"
+#include "utils/SpscRing.h"
+
+/**
+ * @class TaskPipeline
+ * @brief Creates and runs the sensing, display and uplink tasks.
+ */
+class TaskPipeline {
+public:
+    TaskPipeline(SensorRegistry<> &registry, OledDisplay &display,
+                 AlertManager &alertManager, WiFiManager &wifiManager,
+                 CloudUploader &cloudUploader,
+                 StoreAndForward *storeAndForward = nullptr);
+
+    /**
+     * Create the three tasks, pinned to the cores configured in config.h.
+     * Call once at the end of setup(), after every sensor has been added
+     * to the registry.
+     *
+     * @return true if all tasks were created
+     */
+    bool begin();
+
+    /**
+     * Print the worst-case jitter and run time of every task.
+     */
+    void reportJitter() const;
+
+    /** Snapshots dropped because the display queue was full. */
+    uint32_t displayDrops() const { return _displayDrops; }
+    /** Snapshots dropped because the uplink queue was full. */
+    uint32_t uplinkDrops() const { return _uplinkDrops; }
+
+private:
+    static void senseTask(void *arg);
+    static void displayTask(void *arg);
+    static void uplinkTask(void *arg);
+
+    void runSense();
+    void runDisplay();
+    void runUplink();
+    ChannelFrame sample();
+
+    SensorRegistry<> &_registry;   ///< Touched by the sensing task only
+    OledDisplay &_display;
+    AlertManager &_alertManager;
+    WiFiManager &_wifiManager;
+    CloudUploader &_cloudUploader;
+    StoreAndForward *_storeAndForward;   ///< Offline buffering, may be nullptr
+
+    SpscRing<ChannelFrame, PIPELINE_QUEUE_DEPTH> _displayQueue; ///< sense -> display
+    SpscRing<ChannelFrame, PIPELINE_QUEUE_DEPTH> _uplinkQueue;  ///< sense -> uplink
+    uint32_t _displayDrops;
+    uint32_t _uplinkDrops;
+
+    JitterMonitor _senseTiming;
+    JitterMonitor _displayTiming;
+    JitterMonitor _uplinkTiming;
+};
+
+#endif // TASK_PIPELINE_H
@@ -0,0 +1,134 @@
+/**
+ * @file PowerManager.h
+ * @brief Duty-cycled low-power operation between sensor samples.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensors/DHTSensor.h"
+#include "sensors/LightSensor.h"
+#include "sensors/SensorReading.h"
+#include "display/OledDisplay.h"
+#include "connectivity/WiFiManager.h"
+#include "connectivity/CloudUploader.h"
+#include "utils/AlertManager.h"
+#include "utils/DataFilter.h"
+
+/**
+ * Sleep used between samples.
+ */
+enum PowerMode {
+    POWER_ALWAYS_ON   = LOW_POWER_OFF,    ///< No sleep; runCycle() only
+    POWER_LIGHT_SLEEP = LOW_POWER_LIGHT,  ///< RAM retained, execution resumes
+    POWER_DEEP_SLEEP  = LOW_POWER_DEEP    ///< Only RTC memory retained, reboots on wake
+};
+
+/**
+ * Time and estimated energy of one wake/sleep cycle.
+ */
+struct CycleReport {
+    uint32_t cycle;         ///< Wake-ups since the last cold boot
+    uint32_t awakeMs;       ///< CPU awake, including the radio-on time
+    uint32_t radioMs;       ///< WiFi powered
+    uint32_t connectMs;     ///< Radio on to WiFi connected, 0 without a connection
+    uint32_t firstUploadMs; ///< Wake-up (boot in deep sleep) to the upload
+                            ///< completing, 0 if nothing was sent
+    uint32_t sleepMs;       ///< Programmed sleep
+    uint32_t energyUj;      ///< Estimated energy of the whole cycle
+    uint32_t alwaysOnUj;    ///< Same period in the always-on loop
+    uint8_t uploaded;       ///< Readings delivered this cycle
+    uint8_t pending;        ///< Readings still waiting for an upload
+};
+
+/**
+ * @class PowerManager
+ * @brief Runs one sample (and, when due, one upload) per wake-up.
+ *
+ * Each wake-up samples the sensors into the filters, refreshes the display
+ * and alert LED, and every CLOUD_UPLOAD_INTERVAL adds the filtered reading
+ * to a small pending list. The radio is powered only while that list is
+ * being uploaded and is switched off again before sleeping; readings that
+ * could not be sent stay pending for the next upload cycle. The list, not
+ * the MQTT session, owns that retry: a QoS 1 message still unacknowledged
+ * when the radio goes off is withdrawn from the session (see
+ * CloudUploader::sendBatch()) and sent again from the list. After a
+ * failed connection attempt the following upload cycles leave the radio
+ * off, with exponential backoff up to LOW_POWER_MAX_BACKOFF cycles.
+ *
+ * In deep sleep only RTC memory survives, so sleep() copies the filter
+ * windows, alert state, pending readings and schedule into an
+ * RTC_DATA_ATTR block and begin() restores them after the wake-up reset.
+ * Node time continues across resets from the retained clock.
+ */
+class PowerManager {
+public:
+    typedef DataFilter<FILTER_WINDOW_SIZE> Filter;
+
+    PowerManager(DHTSensor &dht, LightSensor &light, Filter &tempFilter, Filter &humidFilter,
+                 Filter &lightFilter, OledDisplay &display, AlertManager &alerts,
+                 WiFiManager &wifi, CloudUploader &uploader,
+                 PowerMode mode = static_cast<PowerMode>(LOW_POWER_MODE));
+
+    /**
+     * Restore the retained state after a deep sleep wake-up, or start
+     * fresh after a cold boot. Call after the peripherals' begin().
+     *
+     * @return true on a cold boot
+     */
+    bool begin();
+
+    /**
+     * Sample, display, evaluate alerts and upload if due.
+     *
+     * @return Time to sleep until the next sample (ms)
+     */
+    uint32_t runCycle();
+
+    /**
+     * Sleep for @p ms and account the cycle. In deep sleep mode this saves
+     * the retained state and does not return on the target.
+     */
+    void sleep(uint32_t ms);
+
+    /** @return Milliseconds since the last cold boot, across deep sleeps. */
+    uint32_t nodeMillis() const;
+
+    /** @return Report of the last completed cycle. */
+    const CycleReport &lastReport() const;
+
+    /** @return Energy of all cycles since the last cold boot (uJ). */
+    uint64_t totalEnergyUj() const;
+
+    /** @return Sleep plus awake time of those cycles (ms). */
+    uint64_t totalTimeMs() const;
+
+    /** Discard the retained state, as a power loss would. */
+    static void forgetRetainedState();
+
+private:
+    void sample();
+    uint8_t upload();
+    void save();
+    void restore();
+
+    DHTSensor &_dht;
+    LightSensor &_light;
+    Filter &_tempFilter;
+    Filter &_humidFilter;
+    Filter &_lightFilter;
+    OledDisplay &_display;
+    AlertManager &_alerts;
+    WiFiManager &_wifi;
+    CloudUploader &_uploader;
+    PowerMode _mode;
+    uint32_t _wakeAt;        ///< millis() when the current cycle started
+    uint32_t _radioMs;       ///< Radio-on time of the current cycle
+    uint32_t _connectMs;     ///< WiFi connection time of the current cycle
+    uint32_t _firstUploadMs; ///< Time to first upload of the current cycle
+    uint8_t _uploaded;       ///< Readings delivered in the current cycle
+};
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,229 @@
+/**
+ * @file AdaptiveSampler.h
+ * @brief Per-channel sampling intervals driven by the signal's variance.
+ *
+ * Instead of reading every sensor each SENSOR_READ_INTERVAL, every channel
+ * with a rule in kSamplingRules gets its own interval, adjusted after each
+ * read from the registry's moving-average window:
+ *
+ * - an event (a step from the previous read of at least `eventStep`, or a
+ *   window standard deviation of at least `eventStdDev`) drops the
+ *   interval to SAMPLE_FAST_INTERVAL at once;
+ * - a full window with a standard deviation of at most `quietStdDev`
+ *   doubles it, up to the rule's `maxInterval`;
+ * - anything in between moves it back towards SENSOR_READ_INTERVAL.
+ *
+ * A quiet room is thus read every 10 to 20 s and a door opening or a
+ * heater switching on is followed every two seconds. Since the step is
+ * taken over the current interval, it bounds the rate of change a channel
+ * may show before it is sampled faster; `maxInterval` bounds how late an
+ * event is noticed, and is kept within four fixed periods so that the
+ * worst case stays close to the fixed cadence. Channels without a rule keep
+ * SENSOR_READ_INTERVAL. A sensor is read when the shortest interval of its
+ * channels is due, so both DHT channels share a read.
+ */
+
+#ifndef ADAPTIVE_SAMPLER_H
+#define ADAPTIVE_SAMPLER_H
+
+#include <Arduino.h>
+#include <math.h>
+#include "config.h"
+#include "sensors/Sensor.h"
+#include "sensors/SensorRegistry.h"
+
+/**
+ * One entry of the sampling table.
+ */
+struct SamplingRule {
+    uint8_t channel;       ///< Registry channel (StandardChannel for the node's own)
+    float quietStdDev;     ///< Window deviation at or below which the interval stretches
+    float eventStdDev;     ///< Window deviation at or above which it drops to fast
+    float eventStep;       ///< Change between reads at or above which it drops to fast
+    uint32_t maxInterval;  ///< Longest interval while quiet (ms); bounds the event delay
+};
+
+/**
+ * Sampling rules of the node. Thresholds sit above the sensor noise and
+ * resolution (whole units on the DHT11); add rules for extra channels.
+ */
+inline constexpr SamplingRule kSamplingRules[] = {
+    {CHANNEL_TEMPERATURE, TEMP_QUIET_STDDEV, TEMP_EVENT_STDDEV, TEMP_EVENT_STEP,
+     TEMP_MAX_INTERVAL},
+    {CHANNEL_HUMIDITY, HUMID_QUIET_STDDEV, HUMID_EVENT_STDDEV, HUMID_EVENT_STEP,
+     HUMID_MAX_INTERVAL},
+    {CHANNEL_LIGHT, LIGHT_QUIET_STDDEV, LIGHT_EVENT_STDDEV, LIGHT_EVENT_STEP,
+     LIGHT_MAX_INTERVAL},
+};
+
+/**
+ * @return true if every rule is usable: quiet below event, positive step,
+ *         maximum interval between one and four SENSOR_READ_INTERVAL.
+ */
+template <size_t N>
+constexpr bool samplingRulesValid(const SamplingRule (&rules)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+        const SamplingRule &r = rules[i];
+        if (!(r.quietStdDev >= 0.0f) || !(r.eventStdDev > r.quietStdDev) ||
+            !(r.eventStep > 0.0f) || r.maxInterval < SENSOR_READ_INTERVAL ||
+            r.maxInterval > 4u * SENSOR_READ_INTERVAL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(samplingRulesValid(kSamplingRules), "Invalid rule in kSamplingRules");
+static_assert(SAMPLE_FAST_INTERVAL > 0 && SAMPLE_FAST_INTERVAL <= SENSOR_READ_INTERVAL,
+              "SAMPLE_FAST_INTERVAL must not exceed SENSOR_READ_INTERVAL");
+
+/**
+ * Read counters.
+ */
+struct SamplingStats {
+    uint32_t reads;       ///< Sensor reads, all sensors
+    uint32_t events;      ///< Channel reads that dropped the interval to fast
+    uint32_t stretches;   ///< Channel reads that stretched the interval
+};
+
+/**
+ * @class AdaptiveSampler
+ * @brief Decides which sensors of a SensorRegistry to read and when.
+ *
+ * Usage per loop: `mask = sampler.due(now)`; if not 0, read and add those
+ * sensors (readSensors(mask), addSamples(row, mask)), then
+ * `sampler.update(mask, now)`.
+ *
+ * @tparam Registry A SensorRegistry instantiation
+ */
+template <class Registry = SensorRegistry<>>
+class AdaptiveSampler {
+public:
+    explicit AdaptiveSampler(const Registry &registry) : _registry(registry), _stats() {
+        for (size_t c = 0; c < Registry::capacity(); ++c) {
+            _rule[c] = -1;
+        }
+    }
+
+    /**
+     * Start every channel at SENSOR_READ_INTERVAL with all sensors due.
+     * Call after the sensors are registered.
+     */
+    void begin(uint32_t nowMs) {
+        for (size_t c = 0; c < Registry::capacity(); ++c) {
+            _rule[c] = -1;
+            _interval[c] = SENSOR_READ_INTERVAL;
+            _previous[c] = NAN;
+        }
+        for (size_t i = 0; i < sizeof(kSamplingRules) / sizeof(kSamplingRules[0]); ++i) {
+            if (kSamplingRules[i].channel < _registry.channelCount()) {
+                _rule[kSamplingRules[i].channel] = static_cast<int8_t>(i);
+            }
+        }
+        for (size_t s = 0; s < _registry.sensorCount(); ++s) {
+            _sensorInterval[s] = SENSOR_READ_INTERVAL;
+            _lastRead[s] = nowMs - SENSOR_READ_INTERVAL;
+        }
+        _stats = SamplingStats();
+    }
+
+    /** @return Sensors whose interval has elapsed at @p nowMs. */
+    SensorMask due(uint32_t nowMs) const {
+        SensorMask mask = 0;
+        for (size_t s = 0; s < _registry.sensorCount(); ++s) {
+            if (nowMs - _lastRead[s] >= _sensorInterval[s]) {
+                mask |= SensorMask(1) << s;
+            }
+        }
+        return mask;
+    }
+
+    /**
+     * @return Milliseconds until the next sensor is due, 0 if one is
+     *         (UINT32_MAX without sensors)
+     */
+    uint32_t untilDue(uint32_t nowMs) const {
+        uint32_t wait = UINT32_MAX;
+        for (size_t s = 0; s < _registry.sensorCount(); ++s) {
+            const uint32_t elapsed = nowMs - _lastRead[s];
+            const uint32_t left = elapsed >= _sensorInterval[s] ? 0 : _sensorInterval[s] - elapsed;
+            wait = left < wait ? left : wait;
+        }
+        return wait;
+    }
+
+    /**
+     * Adjust the intervals of the channels just read, after their samples
+     * were added to the registry.
+     *
+     * @param sensors Sensors read at @p nowMs
+     */
+    void update(SensorMask sensors, uint32_t nowMs) {
+        for (size_t s = 0; s < _registry.sensorCount(); ++s) {
+            if (!((sensors >> s) & 1u)) {
+                continue;
+            }
+            ++_stats.reads;
+            _lastRead[s] = nowMs;
+            const size_t first = _registry.firstChannel(s);
+            const size_t last = first + _registry.sensorChannels(s);
+            uint32_t shortest = UINT32_MAX;
+            for (size_t c = first; c < last; ++c) {
+                adapt(c);
+                shortest = _interval[c] < shortest ? _interval[c] : shortest;
+            }
+            _sensorInterval[s] = shortest;
+        }
+    }
+
+    /** @return Current interval of @p channel in ms. */
+    uint32_t interval(size_t channel) const { return _interval[channel]; }
+
+    /** @return Current read interval of sensor @p index in ms. */
+    uint32_t sensorInterval(size_t index) const { return _sensorInterval[index]; }
+
+    const SamplingStats &getStats() const { return _stats; }
+
+private:
+    void adapt(size_t c) {
+        if (_rule[c] < 0) {
+            return;
+        }
+        const float v = _registry.latest(c);
+        if (v != v) {
+            // A failed read says nothing about the signal
+            return;
+        }
+        const SamplingRule &rule = kSamplingRules[_rule[c]];
+        const float step = fabsf(v - _previous[c]);   // NAN on the first read
+        _previous[c] = v;
+        const float deviation = sqrtf(_registry.variance(c));   // NAN below two samples
+        uint32_t interval = _interval[c];
+        if (step >= rule.eventStep || deviation >= rule.eventStdDev) {
+            if (interval != SAMPLE_FAST_INTERVAL) {
+                ++_stats.events;
+            }
+            interval = SAMPLE_FAST_INTERVAL;
+        } else if (deviation <= rule.quietStdDev && _registry.validCount(c) == Registry::window()) {
+            if (interval != rule.maxInterval) {
+                ++_stats.stretches;
+            }
+            interval = interval * 2 < rule.maxInterval ? interval * 2 : rule.maxInterval;
+        } else if (interval < SENSOR_READ_INTERVAL) {
+            interval = interval * 2 < SENSOR_READ_INTERVAL ? interval * 2 : SENSOR_READ_INTERVAL;
+        } else if (interval > SENSOR_READ_INTERVAL) {
+            interval = interval / 2 > SENSOR_READ_INTERVAL ? interval / 2 : SENSOR_READ_INTERVAL;
+        }
+        _interval[c] = interval;
+    }
+
+    const Registry &_registry;
+    int8_t _rule[Registry::capacity()];             ///< Index in kSamplingRules, -1 for none
+    uint32_t _interval[Registry::capacity()];       ///< Current interval per channel
+    float _previous[Registry::capacity()];          ///< Last valid read per channel
+    uint32_t _sensorInterval[Registry::sensorCapacity()];   ///< Shortest of its channels
+    uint32_t _lastRead[Registry::sensorCapacity()];
+    SamplingStats _stats;
+};
+
+#endif // ADAPTIVE_SAMPLER_H
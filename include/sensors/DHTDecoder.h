@@ -0,0 +1,62 @@
+/**
+ * @file DHTDecoder.h
+ * @brief Decoding of a captured DHT pulse train into temperature and
+ *        humidity.
+ *
+ * The decoder works on pulse durations only, so the same code decodes
+ * frames captured by the RMT peripheral and recordings replayed on the
+ * host.
+ */
+
+#ifndef DHT_DECODER_H
+#define DHT_DECODER_H
+
+#include <Arduino.h>
+#include <DHT.h>
+
+/** Outcome of one sensor transfer. */
+enum DHTStatus {
+    DHT_OK = 0,
+    DHT_PENDING,         ///< Transfer started, frame not received yet
+    DHT_ERROR_TIMEOUT,   ///< Sensor did not answer the start pulse
+    DHT_ERROR_PULSES,    ///< Frame truncated or pulse timing out of range
+    DHT_ERROR_CHECKSUM   ///< Frame complete but the checksum does not match
+};
+
+/** Both values of one transfer; NAN unless status is DHT_OK. */
+struct DHTReading {
+    float temperature;   ///< Degrees Celsius
+    float humidity;      ///< Percent relative humidity
+    DHTStatus status;
+};
+
+/** Pulse durations in a complete frame: response low/high, 40 bits, final low. */
+const size_t DHT_FRAME_PULSES = 83;
+
+/**
+ * Decode a pulse train.
+ *
+ * @p durations alternate low and high levels in microseconds and end with
+ * the sensor's final low; only the last DHT_FRAME_PULSES entries are used,
+ * so anything captured before the response is ignored. A bit is 1 when its
+ * high level lasts longer than 48 us (26-28 us for 0, 70 us for 1).
+ *
+ * @param durations Low/high durations (us), starting with a low level
+ * @param count     Number of durations
+ * @param type      Sensor type (DHT11, DHT12, DHT21 or DHT22)
+ * @param reading   Decoded values and status
+ * @return true if the frame decoded and its checksum matched
+ */
+bool decodeDhtPulses(const uint16_t *durations, size_t count, uint8_t type, DHTReading &reading);
+
+/**
+ * Convert the five frame bytes (checksum last) into values.
+ *
+ * @return true if the checksum matched
+ */
+bool decodeDhtBytes(const uint8_t data[5], uint8_t type, DHTReading &reading);
+
+/** Short name of a status, for logs. */
+const char *dhtStatusName(DHTStatus status);
+
+#endif // DHT_DECODER_H
@@ -1,10 +1,21 @@
 /**
  * @file DHTSensor.h
- * @brief Wrapper class around the Adafruit DHT library for reading
- *        temperature and humidity from a DHT11 sensor.
+ * @brief Driver for a DHT temperature/humidity sensor.
  *
- * The class encapsulates initialization, reading and basic validation of
- * sensor values. It defers filtering and thresholding to other modules.
+ * One transfer returns both temperature and humidity, so read() hands
+ * them back together instead of triggering a transfer per value.
+ *
+ * With DHT_USE_RMT the pulse train is captured by the RMT peripheral and
+ * decoded afterwards (see DHTDecoder.h): the CPU is only busy for the start
+ * pulse edges and the decoding, never spins on the data line and never
+ * disables interrupts, which the bit-banged Adafruit driver does for the
+ * ~4 ms of every frame. startRead() and poll() split a transfer so that a
+ * caller can do other work while the sensor answers. Without DHT_USE_RMT
+ * the Adafruit library is used.
+ *
+ * Transfers are rate limited to the sensor's sampling period (1 s for the
+ * DHT11 family, 2 s otherwise); reads within it return the last reading.
+ * The class defers filtering and thresholding to other modules.
  */
 
 #ifndef DHT_SENSOR_H
@@ -13,37 +24,63 @@
 #include <Arduino.h>
 #include <DHT.h>
 #include "config.h"
+#include "sensors/DHTDecoder.h"
+#include "sensors/Sensor.h"
+
+#if DHT_USE_RMT
+#include <driver/rmt.h>
+#endif
 
 /**
  * @class DHTSensor
  * @brief Provides an interface to a DHT temperature/humidity sensor.
  */
-class DHTSensor {
+class DHTSensor : public Sensor {
 public:
     /**
      * Construct a new DHTSensor object.
      *
-     * @param pin  The GPIO pin used for the sensor data line.
-     * @param type The DHT sensor type (e.g. DHT11 or DHT22).
+     * @param pin      The GPIO pin used for the sensor data line.
+     * @param type     The DHT sensor type (e.g. DHT11 or DHT22).
+     * @param channels Registry descriptions of temperature and humidity
+     *                 (two entries); nullptr for the defaults, keys "t"
+     *                 and "h". Additional sensors need their own keys.
      */
-    DHTSensor(uint8_t pin = DHT_PIN, uint8_t type = DHT_TYPE);
+    DHTSensor(uint8_t pin = DHT_PIN, uint8_t type = DHT_TYPE,
+              const ChannelSpec *channels = nullptr);
 
     /**
-     * Initialise the underlying DHT library. Must be called in setup().
+     * Initialise the data line and the capture channel. Must be called in
+     * setup().
      */
     void begin();
 
     /**
-     * Read the temperature in degrees Celsius.
-     * @return The measured temperature, or NAN if invalid.
+     * Read temperature and humidity in one transfer. Blocks (yielding) for
+     * the start pulse and the frame, about 25 ms for a DHT11 and 6 ms for
+     * a DHT22.
+     *
+     * @return The reading; values are NAN unless status is DHT_OK
+     */
+    DHTReading read();
+
+    /**
+     * Start a transfer without waiting for it. Returns false, leaving
+     * lastReading() as is, if a transfer is in progress or the sampling
+     * period has not elapsed.
      */
-    float readTemperature();
+    bool startRead();
 
     /**
-     * Read the relative humidity in percent.
-     * @return The measured humidity, or NAN if invalid.
+     * Advance the transfer started by startRead() without blocking.
+     *
+     * @return DHT_PENDING while the transfer is in progress, then its
+     *         final status (also in lastReading())
      */
-    float readHumidity();
+    DHTStatus poll();
+
+    /** Result of the last completed transfer. */
+    const DHTReading &lastReading() const { return _last; }
 
     /**
      * Helper to test whether a value lies within a valid range.
@@ -55,8 +92,42 @@ public:
      */
     static bool isValid(float value, float minValid, float maxValid);
 
+    /** Sensor interface: temperature, then humidity, from one read(). */
+    size_t channelCount() const override { return 2; }
+    const ChannelSpec &channel(size_t index) const override;
+    void sample(float *values) override;
+
 private:
+    /** Minimum time between two transfers (ms). */
+    unsigned long samplingPeriod() const;
+
+    /** Record a finished transfer. */
+    void finish(const DHTReading &reading);
+
+#if DHT_USE_RMT
+    enum Phase { IDLE, START_PULSE, RECEIVING };
+
+    /** Length of the start pulse the sensor expects (us). */
+    uint32_t startPulseMicros() const;
+
+    /** Release the line and let the RMT channel capture the answer. */
+    void release();
+
+    /** Take the captured frame from the ring buffer, waiting up to @p ticks. */
+    DHTStatus receive(TickType_t ticks);
+
+    RingbufHandle_t _ring;   ///< RMT receive buffer
+    Phase _phase;
+    uint32_t _phaseStart;    ///< micros() at the start of the current phase
+#else
     DHT dht;  ///< Instance of the Adafruit DHT driver
+#endif
+    uint8_t _pin;
+    uint8_t _type;
+    const ChannelSpec *_channels;
+    bool _hasRead;
+    unsigned long _lastReadMs;
+    DHTReading _last;
 };
 
-#endif // DHT_SENSOR_H
\ No newline at end of file
+#endif // DHT_SENSOR_H
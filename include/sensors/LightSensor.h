@@ -3,8 +3,16 @@
  * @brief Simple driver for an analog light sensor (LDR).
  *
  * The light sensor consists of a voltage divider formed by an LDR and a resistor
- * connected to an ADC pin. This class abstracts the raw analog reading
- * and provides basic range checking.
+ * connected to an ADC pin. This class abstracts the raw analog reading,
+ * converts it to millivolts with the eFuse ADC calibration and provides
+ * basic range checking. The registry channel is the calibrated voltage.
+ *
+ * With LIGHT_ADC_CONTINUOUS each reading is a DMA burst of LIGHT_ADC_WINDOW
+ * conversions at LIGHT_ADC_SAMPLE_RATE instead of a single analogRead().
+ * The burst is decimated into one oversampled value and checked for lamp
+ * flicker that a single conversion cannot see; the flicker is logged when
+ * it starts and stops. The CPU only runs the decimation; the read blocks
+ * (yielding) for the duration of the window.
  */
 
 #ifndef LIGHT_SENSOR_H
@@ -12,19 +20,35 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "sensors/Sensor.h"
+#include "utils/Oversampling.h"
+#include <esp_adc_cal.h>
+
+/**
+ * Result of the last reading.
+ */
+struct LightWindow {
+    uint32_t conversions;   ///< Conversions averaged (1 for a single-shot read)
+    float raw;              ///< Mean level (ADC counts, fractional when oversampled)
+    uint32_t millivolts;    ///< Calibrated mean voltage
+    float flickerPercent;   ///< Percent flicker, 0 for a single-shot read
+    float flickerHz;        ///< Flicker frequency, 0 below LIGHT_FLICKER_MIN_PERCENT
+};
 
 /**
  * @class LightSensor
  * @brief Reads an analog value from a light dependent resistor (LDR).
  */
-class LightSensor {
+class LightSensor : public Sensor {
 public:
     /**
      * Construct a new LightSensor object.
      *
-     * @param pin The ADC pin connected to the LDR voltage divider.
+     * @param pin  The ADC pin connected to the LDR voltage divider.
+     * @param spec Registry channel description; nullptr for the default
+     *             "Light" channel (key "l").
      */
-    explicit LightSensor(uint8_t pin = LDR_PIN);
+    explicit LightSensor(uint8_t pin = LDR_PIN, const ChannelSpec *spec = nullptr);
 
     /**
      * Initialise the ADC resolution. Call this once in setup().
@@ -32,21 +56,58 @@ public:
     void begin();
 
     /**
-     * Read the raw ADC value from the LDR. The result is clipped to
-     * LIGHT_MIN_VALID/LIGHT_MAX_VALID.
+     * Read the raw ADC value from the LDR, without calibration.
      * @return A value between 0 and 4095 (12‑bit resolution).
      */
     int readRaw();
 
     /**
-     * Read the normalised light level. Currently this simply returns
-     * the raw value but could be extended to return a percentage or lux.
-     * @return The processed light level.
+     * Read the calibrated LDR voltage. The result is clipped to
+     * LIGHT_MIN_VALID/LIGHT_MAX_VALID.
+     * @return The divider voltage in mV.
+     */
+    int readMillivolts();
+
+    /**
+     * Read the calibrated light level as a percentage of the divider
+     * supply (LDR_FULL_SCALE_MV).
+     * @return The processed light level, 0..100.
      */
     int readNormalized();
 
+    /**
+     * @return Details of the last reading.
+     */
+    const LightWindow &getWindow() const;
+
+    /**
+     * @return Whether readings use the continuous ADC (false if the
+     *         driver could not be set up and analogRead() is used).
+     */
+    bool isContinuous() const;
+
+    /** Sensor interface: one channel, the calibrated reading (mV). */
+    size_t channelCount() const override { return 1; }
+    const ChannelSpec &channel(size_t index) const override;
+    void sample(float *values) override;
+
 private:
+    void readSingle();
+#if LIGHT_ADC_CONTINUOUS
+    bool readWindow();
+#endif
+    uint32_t toMillivolts(float raw) const;
+
     uint8_t _pin; ///< ADC pin used to sample the LDR
+    const ChannelSpec *_spec;
+    LightWindow _window;
+    bool _continuous;
+    bool _flickering;   ///< Last window showed flicker (logged on change)
+    esp_adc_cal_characteristics_t _calibration;
+#if LIGHT_ADC_CONTINUOUS
+    uint16_t _frames[LIGHT_ADC_WINDOW];
+    uint32_t _blocks[LIGHT_ADC_WINDOW / LIGHT_ADC_DECIMATION];
+#endif
 };
 
-#endif // LIGHT_SENSOR_H
\ No newline at end of file
+#endif // LIGHT_SENSOR_H
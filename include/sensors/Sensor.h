@@ -0,0 +1,85 @@
+/**
+ * @file Sensor.h
+ * @brief Common interface of sensors that feed the SensorRegistry.
+ *
+ * A sensor exposes one or more channels (a DHT has two, an LDR one). Each
+ * channel is described by a ChannelSpec: how it is labelled on the display
+ * and in uploads and which range is plausible. Specs are static data; the
+ * registry keeps pointers to them. Alerts refer to channels by index (see
+ * AlertRule).
+ */
+
+#ifndef SENSOR_H
+#define SENSOR_H
+
+#include <Arduino.h>
+
+/**
+ * Static description of one channel.
+ */
+struct ChannelSpec {
+    const char *label;      ///< Display label, e.g. "Temp"
+    const char *key;        ///< Upload key, short and unique per node, e.g. "t"
+    const char *unit;       ///< Display unit, may be empty
+    uint8_t decimals;       ///< Decimals shown on the display (0 or 1)
+    float minValid;         ///< Samples outside [minValid, maxValid] are discarded
+    float maxValid;
+};
+
+/**
+ * Channel indices of the standard node: the DHT registered first, then
+ * the LDR. The default alert rules and the three-value paths use them.
+ */
+enum StandardChannel : uint8_t {
+    CHANNEL_TEMPERATURE,
+    CHANNEL_HUMIDITY,
+    CHANNEL_LIGHT
+};
+
+/**
+ * Filtered values of all registered channels, in registration order. The
+ * arrays belong to the registry and stay valid until its next update.
+ */
+struct ChannelView {
+    size_t count;
+    const ChannelSpec *const *specs;
+    const float *values;    ///< Moving averages, NAN while a channel has no valid sample
+};
+
+/**
+ * Set of channels, bit c for channel c. Channels from 32 up cannot be
+ * masked out.
+ */
+typedef uint32_t ChannelMask;
+
+/** Every channel. */
+#define CHANNEL_MASK_ALL 0xFFFFFFFFu
+
+/** @return true if @p mask selects @p channel. */
+inline bool channelSelected(ChannelMask mask, size_t channel) {
+    return channel >= 32 || ((mask >> channel) & 1u);
+}
+
+/**
+ * @class Sensor
+ * @brief A source of one or more channels, sampled once per cycle.
+ */
+class Sensor {
+public:
+    virtual ~Sensor() {}
+
+    /** @return Number of channels this sensor provides. */
+    virtual size_t channelCount() const = 0;
+
+    /** @return Description of channel @p index (< channelCount()). */
+    virtual const ChannelSpec &channel(size_t index) const = 0;
+
+    /**
+     * Take one sample of every channel.
+     *
+     * @param values channelCount() slots; NAN marks a failed read
+     */
+    virtual void sample(float *values) = 0;
+};
+
+#endif // SENSOR_H
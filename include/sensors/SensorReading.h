@@ -0,0 +1,28 @@
+/**
+ * @file SensorReading.h
+ * @brief Plain snapshot of one set of filtered sensor values.
+ */
+
+#ifndef SENSOR_READING_H
+#define SENSOR_READING_H
+
+#include <Arduino.h>
+
+/** Bits in SensorReading::flags. */
+enum SensorReadingFlag : uint8_t {
+    READING_REPLAYED = 1u << 0   ///< Stored while offline and sent later
+};
+
+/**
+ * One filtered reading of all channels, as handed between pipeline stages.
+ * Trivially copyable so it can travel through lock-free queues.
+ */
+struct SensorReading {
+    uint32_t timestamp;   ///< millis() of the current boot when the sample was taken
+    float temperature;    ///< Filtered temperature in °C
+    float humidity;       ///< Filtered humidity in %
+    int light;            ///< Filtered light reading (mV)
+    uint8_t flags;        ///< SensorReadingFlag bits
+};
+
+#endif // SENSOR_READING_H
@@ -0,0 +1,267 @@
+/**
+ * @file SensorRegistry.h
+ * @brief Registry of sensors with a struct-of-arrays sample store.
+ *
+ * Sensors are registered once at start-up; their channels are numbered in
+ * registration order. Each cycle, sample() collects one row of values
+ * (one per channel) and folds it into a moving average per channel.
+ *
+ * Storage is struct-of-arrays: the sample window is a ring of rows, each
+ * row holding one value per channel contiguously, and the running sums,
+ * valid counts and averages are separate per-channel arrays. Adding a row
+ * is therefore a handful of straight passes over contiguous floats, and
+ * consumers (AlertManager, OledDisplay, CloudUploader) walk the averages
+ * through a ChannelView. Cost per cycle is linear in the channel count;
+ * everything is inline, nothing is allocated.
+ *
+ * Unlike DataFilter, a failed or out-of-range sample still takes its slot
+ * in the window (as a gap), so a channel's window covers its last Window
+ * reads. Sensors can also be read selectively (see AdaptiveSampler): each
+ * channel's window then advances only when its sensor was read.
+ */
+
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensors/Sensor.h"
+
+/** Set of registered sensors, bit s for the s-th sensor added. */
+typedef uint32_t SensorMask;
+
+/** Every registered sensor. */
+#define SENSOR_MASK_ALL 0xFFFFFFFFu
+
+/**
+ * @class SensorRegistry
+ * @brief Fixed-capacity set of sensors and their filtered channel values.
+ *
+ * @tparam MaxChannels Channel capacity
+ * @tparam MaxSensors  Sensor capacity
+ * @tparam Window      Moving average window, in cycles
+ */
+template <size_t MaxChannels = SENSOR_MAX_CHANNELS, size_t MaxSensors = SENSOR_MAX_SENSORS,
+          size_t Window = FILTER_WINDOW_SIZE>
+class SensorRegistry {
+    static_assert(MaxChannels > 0 && MaxSensors > 0, "SensorRegistry needs capacity");
+    static_assert(Window > 0 && Window < 256, "Window must fit the valid counters");
+    static_assert(MaxSensors <= 32, "Sensors must fit a SensorMask");
+
+public:
+    SensorRegistry() : _sensorCount(0), _channelCount(0) { reset(); }
+
+    /**
+     * Register a sensor and append its channels.
+     *
+     * @return false if the sensor or channel capacity would be exceeded
+     */
+    bool add(Sensor &sensor) {
+        const size_t channels = sensor.channelCount();
+        if (_sensorCount == MaxSensors || _channelCount + channels > MaxChannels) {
+            return false;
+        }
+        _sensors[_sensorCount] = &sensor;
+        _firstChannel[_sensorCount] = _channelCount;
+        _sensorChannels[_sensorCount] = channels;
+        ++_sensorCount;
+        for (size_t i = 0; i < channels; ++i) {
+            registerChannel(sensor.channel(i));
+        }
+        return true;
+    }
+
+    /**
+     * Register a channel that is fed through addSamples() rather than by a
+     * Sensor (e.g. values computed from other channels, or benchmarks).
+     *
+     * @return Channel index, or -1 if the registry is full
+     */
+    int addChannel(const ChannelSpec &spec) {
+        if (_channelCount == MaxChannels) {
+            return -1;
+        }
+        registerChannel(spec);
+        return static_cast<int>(_channelCount - 1);
+    }
+
+    /**
+     * Sample every registered sensor once and add the row to the window.
+     * Channels added with addChannel() get a gap this cycle.
+     */
+    void sample() { addSamples(readSensors()); }
+
+    /**
+     * First half of sample(): read the sensors without touching the
+     * window, so the two halves can be timed separately.
+     *
+     * @param sensors Sensors to read; the other channels are NAN in the row
+     * @return Row for addSamples(), valid until the next call
+     */
+    const float *readSensors(SensorMask sensors = SENSOR_MASK_ALL) {
+        for (size_t c = 0; c < _channelCount; ++c) {
+            _row[c] = NAN;
+        }
+        for (size_t s = 0; s < _sensorCount; ++s) {
+            if ((sensors >> s) & 1u) {
+                _sensors[s]->sample(&_row[_firstChannel[s]]);
+            }
+        }
+        return _row;
+    }
+
+    /**
+     * Add one cycle of raw samples, one per channel in channel order. NAN
+     * and values outside the channel's valid range count as gaps.
+     */
+    void addSamples(const float *values) { addRange(values, 0, _channelCount); }
+
+    /**
+     * Add the samples of the channels of @p sensors only, as read by
+     * readSensors(sensors). The windows of the other channels (including
+     * those added with addChannel()) do not move.
+     */
+    void addSamples(const float *values, SensorMask sensors) {
+        for (size_t s = 0; s < _sensorCount; ++s) {
+            if ((sensors >> s) & 1u) {
+                addRange(values, _firstChannel[s], _firstChannel[s] + _sensorChannels[s]);
+            }
+        }
+    }
+
+    /** Discard all samples; registrations are kept. */
+    void reset() {
+        for (size_t c = 0; c < MaxChannels; ++c) {
+            for (size_t w = 0; w < Window; ++w) {
+                _window[w][c] = NAN;
+            }
+            _head[c] = 0;
+            _sum[c] = 0.0;
+            _sumSq[c] = 0.0;
+            _valid[c] = 0;
+            _samples[c] = 0;
+            _latest[c] = NAN;
+            _average[c] = NAN;
+        }
+    }
+
+    /** @return Filtered values of all channels. */
+    ChannelView view() const { return ChannelView{_channelCount, _specs, _average}; }
+
+    size_t channelCount() const { return _channelCount; }
+    size_t sensorCount() const { return _sensorCount; }
+    const ChannelSpec &spec(size_t channel) const { return *_specs[channel]; }
+
+    /** @return Moving average of @p channel, NAN without valid samples. */
+    float average(size_t channel) const { return _average[channel]; }
+
+    /** @return Last raw sample of @p channel, NAN if it failed. */
+    float latest(size_t channel) const { return _latest[channel]; }
+
+    /** @return Raw samples of the last cycle, one per channel in channel order. */
+    const float *latestRow() const { return _latest; }
+
+    /** @return Valid samples of @p channel in the window. */
+    size_t validCount(size_t channel) const { return _valid[channel]; }
+
+    /** @return Samples added to @p channel since reset(), failed ones included. */
+    uint32_t sampleCount(size_t channel) const { return _samples[channel]; }
+
+    /**
+     * @return Variance of the valid samples of @p channel in the window,
+     *         NAN with fewer than two
+     */
+    float variance(size_t channel) const {
+        const size_t n = _valid[channel];
+        if (n < 2) {
+            return NAN;
+        }
+        const double mean = _sum[channel] / n;
+        const double variance = _sumSq[channel] / n - mean * mean;
+        // Running sums can leave a tiny negative residue
+        return variance > 0.0 ? static_cast<float>(variance) : 0.0f;
+    }
+
+    /** @return First channel of sensor @p index. */
+    size_t firstChannel(size_t index) const { return _firstChannel[index]; }
+
+    /** @return Number of channels of sensor @p index. */
+    size_t sensorChannels(size_t index) const { return _sensorChannels[index]; }
+
+    /**
+     * @return Channels of @p sensors, e.g. those a readSensors(sensors)
+     *         sampled; channels from 32 up are always selected anyway
+     */
+    ChannelMask channelMask(SensorMask sensors) const {
+        ChannelMask mask = 0;
+        for (size_t s = 0; s < _sensorCount; ++s) {
+            if (!((sensors >> s) & 1u)) {
+                continue;
+            }
+            const size_t last = _firstChannel[s] + _sensorChannels[s];
+            for (size_t c = _firstChannel[s]; c < last && c < 32; ++c) {
+                mask |= ChannelMask(1) << c;
+            }
+        }
+        return mask;
+    }
+
+    static constexpr size_t capacity() { return MaxChannels; }
+    static constexpr size_t sensorCapacity() { return MaxSensors; }
+    static constexpr size_t window() { return Window; }
+
+private:
+    /** Fold values[first, last) into the windows of those channels. */
+    void addRange(const float *values, size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            const float v = values[c];
+            // NAN fails both comparisons
+            const bool valid = v >= _min[c] && v <= _max[c];
+            float &slot = _window[_head[c]][c];
+            const float old = slot;
+            if (old == old) {
+                _sum[c] -= old;
+                _sumSq[c] -= static_cast<double>(old) * old;
+                --_valid[c];
+            }
+            slot = valid ? v : NAN;
+            if (valid) {
+                _sum[c] += v;
+                _sumSq[c] += static_cast<double>(v) * v;
+                ++_valid[c];
+            }
+            _head[c] = static_cast<uint8_t>(_head[c] + 1 == Window ? 0 : _head[c] + 1);
+            ++_samples[c];
+            _latest[c] = v;
+            _average[c] = _valid[c] > 0 ? static_cast<float>(_sum[c] / _valid[c]) : NAN;
+        }
+    }
+
+    void registerChannel(const ChannelSpec &spec) {
+        _specs[_channelCount] = &spec;
+        _min[_channelCount] = spec.minValid;
+        _max[_channelCount] = spec.maxValid;
+        ++_channelCount;
+    }
+
+    Sensor *_sensors[MaxSensors];
+    size_t _firstChannel[MaxSensors];       ///< First channel of each sensor
+    size_t _sensorChannels[MaxSensors];     ///< Channel count of each sensor
+    size_t _sensorCount;
+    size_t _channelCount;
+
+    const ChannelSpec *_specs[MaxChannels];
+    float _min[MaxChannels];                ///< Valid range, copied from the specs
+    float _max[MaxChannels];
+    float _window[Window][MaxChannels];    ///< Ring of rows, NAN marks a gap
+    uint8_t _head[MaxChannels];             ///< Row written next, per channel
+    double _sum[MaxChannels];               ///< Sum of the valid samples in the window
+    double _sumSq[MaxChannels];             ///< Sum of their squares
+    uint8_t _valid[MaxChannels];            ///< Number of valid samples in the window
+    uint32_t _samples[MaxChannels];         ///< Samples added since reset()
+    float _latest[MaxChannels];
+    float _average[MaxChannels];
+    float _row[MaxChannels];                ///< Staging row for sample()
+};
+
+#endif // SENSOR_REGISTRY_H
@@ -0,0 +1,138 @@
+/**
+ * @file FlashLog.h
+ * @brief Crash-safe, wear-levelled append-only ring log of sensor readings.
+ */
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "sensors/SensorReading.h"
+#include "storage/FlashStorage.h"
+
+/**
+ * Counters describing the log since begin().
+ */
+struct FlashLogStats {
+    uint32_t appended;      ///< Records written
+    uint32_t overwritten;   ///< Unsent records lost because the log was full
+    uint32_t replayed;      ///< Records handed out and committed
+    uint32_t corrupt;       ///< Torn or damaged records skipped
+    uint32_t stale;         ///< Records of an earlier boot with no calendar time, discarded
+    uint32_t erases;        ///< Sector erases performed
+};
+
+/**
+ * @class FlashLog
+ * @brief Stores readings in flash while offline and hands them back in order.
+ *
+ * Sectors are used strictly round-robin, so every sector is erased equally
+ * often (wear levelling comes for free from the ring). Each sector starts
+ * with a header carrying a monotonically increasing sequence number; each
+ * record carries its own CRC. After a power loss begin() rebuilds the ring
+ * from the headers, ignores a torn final record and resumes after the last
+ * record marked as consumed.
+ *
+ * Replay works in batches: peek() returns the oldest unsent records and
+ * commit() marks them consumed with a single flash write. When the log is
+ * full, the oldest sector is erased and its unsent records are counted as
+ * overwritten.
+ *
+ * Timestamps are millis() and restart at every boot, so each record also
+ * carries the boot it was written in and, once SNTP has set the clock, its
+ * calendar time. peek() hands back readings of an earlier boot with their
+ * timestamp moved into the current boot's millis(); those stored before the
+ * clock was ever set cannot be placed and are discarded.
+ */
+class FlashLog {
+public:
+    explicit FlashLog(FlashStorage &storage);
+
+    /**
+     * Mount the log, recovering state from flash, or format it if no valid
+     * log is found.
+     *
+     * @return true if the log is usable
+     */
+    bool begin();
+
+    /**
+     * Erase the whole log.
+     *
+     * @return true on success
+     */
+    bool format();
+
+    /**
+     * Append one reading.
+     *
+     * @return true if the record was written
+     */
+    bool append(const SensorReading &reading);
+
+    /**
+     * Copy up to @p max of the oldest unsent readings without consuming
+     * them. A second peek() without commit() returns the same readings.
+     * Readings of an earlier boot wait until the clock is set.
+     *
+     * @return Number of readings copied
+     */
+    size_t peek(SensorReading *out, size_t max);
+
+    /**
+     * Mark the readings returned by the last peek() as consumed.
+     *
+     * @return true on success
+     */
+    bool commit();
+
+    /** @return Number of unsent readings stored. */
+    size_t pending() const { return _pending; }
+
+    /** @return Readings that are guaranteed to fit before overwriting. */
+    size_t capacity() const;
+
+    /** @return Counters since begin(). */
+    const FlashLogStats &getStats() const { return _stats; }
+
+private:
+    /** Location of a record slot. */
+    struct Position {
+        uint32_t sector;
+        uint32_t slot;
+        bool operator==(const Position &o) const { return sector == o.sector && slot == o.slot; }
+        bool operator!=(const Position &o) const { return !(*this == o); }
+    };
+
+    /** Result of reading one slot. */
+    enum SlotState { SLOT_ERASED, SLOT_VALID, SLOT_CORRUPT };
+
+    struct SectorHeader;
+    struct Record;
+
+    size_t slotOffset(const Position &pos) const;
+    void advance(Position &pos) const;
+    SlotState readSlot(const Position &pos, Record &record);
+    bool readHeader(uint32_t sector, uint32_t &sequence);
+    bool startSector(uint32_t sector, uint32_t sequence);
+    bool openNextSector();
+
+    FlashStorage &_storage;
+    uint32_t _sectors;         ///< Sectors in the storage region
+    uint32_t _slotsPerSector;  ///< Records per sector
+    Position _write;           ///< Next slot to program
+    Position _read;            ///< Oldest unsent slot
+    Position _batchEnd;        ///< Slot after the last peeked record
+    Position _batchLast;       ///< Last peeked record (marked on commit)
+    size_t _batchCount;        ///< Records returned by the last peek()
+    uint32_t _sectorSequence;  ///< Sequence number of the head sector
+    uint32_t _recordSequence;  ///< Sequence number of the next record
+    uint32_t _boot;            ///< One past the boot of the newest stored record
+    size_t _batchStale;        ///< Records the last peek() discarded as stale
+    size_t _pending;           ///< Unsent records
+    bool _mounted;
+    FlashLogStats _stats;
+};
+
+#endif // FLASH_LOG_H
@@ -0,0 +1,49 @@
+/**
+ * @file FlashStorage.h
+ * @brief Minimal interface to a region of NOR flash.
+ */
+
+#ifndef FLASH_STORAGE_H
+#define FLASH_STORAGE_H
+
+#include <Arduino.h>
+
+/**
+ * @class FlashStorage
+ * @brief Sector-erasable storage with NOR flash semantics.
+ *
+ * Erasing a sector sets every byte to 0xFF; writes can only clear bits, so
+ * a location must be erased before it can be rewritten with arbitrary
+ * data. Implemented by PartitionFlash on the ESP32 and by a file-backed
+ * stand-in on the host.
+ */
+class FlashStorage {
+public:
+    virtual ~FlashStorage() {}
+
+    /** @return Size of one erase unit in bytes. */
+    virtual size_t sectorSize() const = 0;
+
+    /** @return Number of sectors available. */
+    virtual size_t sectorCount() const = 0;
+
+    /**
+     * Read @p length bytes starting at byte @p offset.
+     * @return true on success
+     */
+    virtual bool read(size_t offset, void *buffer, size_t length) = 0;
+
+    /**
+     * Program @p length bytes starting at byte @p offset.
+     * @return true on success
+     */
+    virtual bool write(size_t offset, const void *buffer, size_t length) = 0;
+
+    /**
+     * Erase one sector to 0xFF.
+     * @return true on success
+     */
+    virtual bool eraseSector(size_t sector) = 0;
+};
+
+#endif // FLASH_STORAGE_H
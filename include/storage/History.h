@@ -0,0 +1,97 @@
+/**
+ * @file History.h
+ * @brief Compressed in-RAM history of raw sample rows.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "storage/HistoryCodec.h"
+
+/**
+ * Counters describing the history since begin().
+ */
+struct HistoryStats {
+    uint32_t rows;          ///< Rows appended
+    uint32_t sealed;        ///< Blocks filled
+    uint32_t overwritten;   ///< Sealed blocks dropped to make room
+    uint32_t droppedRows;   ///< Rows in the dropped blocks
+};
+
+/**
+ * @class History
+ * @brief Ring of HISTORY_BLOCKS compressed blocks (see HistoryCodec.h).
+ *
+ * Rows go into the open block until the next row might not fit; the block
+ * is then sealed and the next one opened, overwriting the oldest block
+ * once the ring is full. Blocks are self-contained, so each one can be
+ * decoded, or uploaded as is, without the others. A sealed block stays
+ * untouched until HISTORY_BLOCKS - 1 further blocks have been sealed,
+ * which leaves the uplink hours to send it.
+ */
+class History {
+    static_assert(HISTORY_BLOCKS >= 2, "History needs an open and a sealed block");
+
+public:
+    History();
+
+    /**
+     * Clear the history and fix the number of values per row.
+     *
+     * @return false if @p channels is 0 or above SENSOR_MAX_CHANNELS
+     */
+    bool begin(size_t channels);
+
+    /**
+     * Append one row of raw samples.
+     *
+     * @param timestamp Sample time in ms
+     * @param values    channels() values, NAN for a failed read
+     * @return true if the previous block was sealed to make room for this
+     *         row; it is then available through lastSealed()
+     */
+    bool append(uint32_t timestamp, const float *values);
+
+    /** @return Blocks holding rows, the open block included. */
+    size_t blockCount() const;
+
+    /**
+     * @param index  Block, 0 is the oldest, blockCount() - 1 the open one
+     * @param length Receives the encoded length in bytes
+     * @return The encoded block, or nullptr if @p index is out of range
+     */
+    const uint8_t *block(size_t index, size_t &length) const;
+
+    /**
+     * @param length Receives the encoded length in bytes
+     * @return The most recently sealed block, or nullptr if none
+     */
+    const uint8_t *lastSealed(size_t &length) const;
+
+    /** @return Rows currently held. */
+    size_t rows() const;
+
+    /** @return Encoded bytes currently held, headers included. */
+    size_t encodedBytes() const;
+
+    size_t channels() const { return _channels; }
+
+    const HistoryStats &getStats() const { return _stats; }
+
+private:
+    uint8_t _blocks[HISTORY_BLOCKS][HISTORY_BLOCK_BYTES];
+    uint16_t _lengths[HISTORY_BLOCKS];   ///< Encoded length of each sealed block
+    uint16_t _rows[HISTORY_BLOCKS];      ///< Rows of each sealed block
+    size_t _open;                        ///< Slot of the open block
+    size_t _sealedCount;                 ///< Sealed blocks held (< HISTORY_BLOCKS)
+    bool _hasSealed;
+    size_t _channels;
+    HistoryEncoder _encoder;
+    HistoryStats _stats;
+
+    void seal();
+};
+
+#endif // HISTORY_H
@@ -0,0 +1,158 @@
+/**
+ * @file HistoryCodec.h
+ * @brief Gorilla-style compression of sample rows into self-contained blocks.
+ *
+ * A block holds rows of one timestamp and a fixed number of float
+ * channels. Timestamps are stored as delta-of-delta, so a steady sampling
+ * period costs one bit per row. Past the first row they are kept in units
+ * of a block-wide time unit: the few milliseconds a polled loop adds to
+ * each period would otherwise cost nine bits per row. Each value is XORed with the previous
+ * value of its channel: an unchanged value costs one bit, a change only
+ * the bits between the leading and trailing zeros of the XOR.
+ *
+ * Block layout (little endian):
+ *
+ *     0  u8   HISTORY_BLOCK_MAGIC
+ *     1  u8   HISTORY_BLOCK_VERSION
+ *     2  u8   channels
+ *     3  u8   time unit in ms (1 keeps timestamps exact)
+ *     4  u16  rows
+ *     6  u16  length in bytes, header included
+ *     8  u32  timestamp of the first row (ms)
+ *    12  bit stream, most significant bit first
+ *
+ * Row 0 stores its values as raw IEEE-754 bits. Each later row stores
+ *
+ *   - the delta-of-delta of its time since row 0, in time units: '0' for 0, '10' + 7 bits for
+ *     [-63, 64], '110' + 9 bits for [-255, 256], '1110' + 12 bits for
+ *     [-2047, 2048], else '1111' + 32 bits (offset binary except the last);
+ *   - per channel, the XOR with the previous value: '0' if zero, '10' +
+ *     the meaningful bits if they fit the previous leading/trailing zero
+ *     window, else '11' + 5 bits leading zeros + 5 bits (length - 1) + the
+ *     meaningful bits.
+ *
+ * The header is rewritten on every append, so an open block is always a
+ * valid block and can be decoded or uploaded as is.
+ */
+
+#ifndef HISTORY_CODEC_H
+#define HISTORY_CODEC_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define HISTORY_BLOCK_MAGIC   0x47   // 'G'
+#define HISTORY_BLOCK_VERSION 1
+#define HISTORY_HEADER_BYTES  12
+
+/**
+ * @class HistoryEncoder
+ * @brief Appends rows to a block in a caller-provided buffer.
+ */
+class HistoryEncoder {
+public:
+    HistoryEncoder();
+
+    /**
+     * Start a new block.
+     *
+     * @param buffer   Block storage, at least HISTORY_HEADER_BYTES
+     * @param capacity Size of @p buffer (at most 65535)
+     * @param channels Values per row (1 to SENSOR_MAX_CHANNELS)
+     * @param timeUnit Resolution of timestamps after the first row, in ms
+     * @return false if the parameters are out of range
+     */
+    bool begin(uint8_t *buffer, size_t capacity, size_t channels, uint8_t timeUnit = 1);
+
+    /**
+     * Append one row. Rows are only accepted while the worst-case encoding
+     * still fits, so a row is never split.
+     *
+     * @param timestamp Sample time in ms (wraps like millis())
+     * @param values    One value per channel; NAN is stored as is
+     * @return false if the block is full (nothing is written)
+     */
+    bool append(uint32_t timestamp, const float *values);
+
+    /** @return Bytes used by the block so far, header included. */
+    size_t length() const { return _buffer ? (_bits + 7) / 8 : 0; }
+
+    /** @return Rows in the block. */
+    size_t rows() const { return _rows; }
+
+    /** @return Largest encoding of one row of @p channels values, in bits. */
+    static size_t maxRowBits(size_t channels) { return 36 + channels * 44; }
+
+private:
+    uint8_t *_buffer;
+    size_t _capacityBits;
+    size_t _bits;                              ///< Write position
+    size_t _channels;
+    uint8_t _timeUnit;
+    uint16_t _rows;
+    uint32_t _firstTimestamp;
+    uint32_t _lastTime;                        ///< Time units since the first row
+    uint32_t _lastDelta;
+    uint32_t _last[SENSOR_MAX_CHANNELS];       ///< Previous value bits per channel
+    uint8_t _leading[SENSOR_MAX_CHANNELS];     ///< XOR window of the previous change
+    uint8_t _trailing[SENSOR_MAX_CHANNELS];
+
+    void write(uint32_t value, unsigned bits);
+    void writeTime(uint32_t time);
+    void writeValue(size_t channel, uint32_t bits);
+    void writeHeader();
+};
+
+/**
+ * @class HistoryDecoder
+ * @brief Reads the rows of one block back, oldest first.
+ */
+class HistoryDecoder {
+public:
+    /**
+     * @param block  Encoded block
+     * @param length Bytes available at @p block (may exceed the block)
+     */
+    HistoryDecoder(const uint8_t *block, size_t length);
+
+    /** @return true if the header is valid and the block fits @p length. */
+    bool valid() const { return _valid; }
+
+    size_t channels() const { return _channels; }
+    size_t rows() const { return _rows; }
+    uint8_t timeUnit() const { return _timeUnit; }
+
+    /** @return Length of the block in bytes, header included. */
+    size_t blockLength() const { return _length; }
+
+    /**
+     * Decode the next row.
+     *
+     * @param timestamp Receives the sample time
+     * @param values    Receives channels() values
+     * @return false after the last row, or on a corrupt block
+     */
+    bool next(uint32_t &timestamp, float *values);
+
+private:
+    const uint8_t *_block;
+    bool _valid;
+    size_t _length;
+    size_t _channels;
+    uint8_t _timeUnit;
+    size_t _rows;
+    size_t _row;                               ///< Rows decoded so far
+    size_t _bits;                              ///< Read position
+    uint32_t _firstTimestamp;
+    uint32_t _lastTime;                        ///< Time units since the first row
+    uint32_t _lastDelta;
+    uint32_t _last[SENSOR_MAX_CHANNELS];
+    uint8_t _leading[SENSOR_MAX_CHANNELS];
+    uint8_t _trailing[SENSOR_MAX_CHANNELS];
+
+    bool read(unsigned bits, uint32_t &value);
+    bool readTime(uint32_t &time);
+    bool readValue(size_t channel, uint32_t &bits);
+};
+
+#endif // HISTORY_CODEC_H
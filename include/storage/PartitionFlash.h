@@ -0,0 +1,45 @@
+/**
+ * @file PartitionFlash.h
+ * @brief FlashStorage backed by a raw data partition of the ESP32 flash.
+ */
+
+#ifndef PARTITION_FLASH_H
+#define PARTITION_FLASH_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "storage/FlashStorage.h"
+
+struct esp_partition_t;
+
+/**
+ * @class PartitionFlash
+ * @brief Accesses the partition named by FLASH_LOG_PARTITION in
+ *        partitions.csv through the esp_partition API.
+ */
+class PartitionFlash : public FlashStorage {
+public:
+    /**
+     * @param label Partition label to look up in begin().
+     */
+    explicit PartitionFlash(const char *label = FLASH_LOG_PARTITION);
+
+    /**
+     * Locate the partition. Must succeed before any other call.
+     *
+     * @return true if the partition exists
+     */
+    bool begin();
+
+    size_t sectorSize() const override;
+    size_t sectorCount() const override;
+    bool read(size_t offset, void *buffer, size_t length) override;
+    bool write(size_t offset, const void *buffer, size_t length) override;
+    bool eraseSector(size_t sector) override;
+
+private:
+    const char *_label;                  ///< Partition label
+    const esp_partition_t *_partition;   ///< Resolved partition or nullptr
+};
+
+#endif // PARTITION_FLASH_H
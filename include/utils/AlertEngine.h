@@ -0,0 +1,219 @@
+/**
+ * @file AlertEngine.h
+ * @brief Table-driven alert rules with hysteresis, debounce and rate-of-change.
+ *
+ * Rules are plain data in a constexpr table; each watches one channel of a
+ * value row (the registry order, see StandardChannel) for a level or a rate
+ * of change. An AlertEngine evaluates every rule on every sample and keeps
+ * one bit per rule, so all active alerts are visible at once, not just the
+ * most severe one.
+ *
+ * A rule turns on once the condition has held for `debounce` consecutive
+ * samples, and off once the value has moved back past the threshold by
+ * more than `hysteresis` for as many samples. A value wandering around the
+ * threshold therefore cannot toggle the alert on every sample. Missing
+ * values (NAN) neither count towards nor reset a transition, and neither
+ * do channels the caller marks as not sampled: when sensors are read at
+ * different rates, re-evaluating a value that has not changed would count
+ * it again towards the debounce.
+ *
+ * Rate rules compare the value with the one seen at least `windowMs`
+ * earlier and express the change per second; they are judged once per
+ * window.
+ */
+
+#ifndef ALERT_ENGINE_H
+#define ALERT_ENGINE_H
+
+#include <Arduino.h>
+#include <math.h>
+#include "sensors/Sensor.h"
+
+/**
+ * What a rule compares against its threshold.
+ */
+enum AlertCondition : uint8_t {
+    ALERT_ABOVE,     ///< Value at or above the threshold
+    ALERT_BELOW,     ///< Value at or below the threshold
+    ALERT_RISING,    ///< Change per second at or above the threshold
+    ALERT_FALLING    ///< Change per second at or below the (negative) threshold
+};
+
+/**
+ * One entry of a rule table.
+ */
+struct AlertRule {
+    uint8_t channel;          ///< Index into the value row
+    AlertCondition condition;
+    uint8_t debounce;         ///< Consecutive samples before the state changes (>= 1)
+    uint8_t code;             ///< Caller-defined code reported for this rule
+    float threshold;          ///< Level, or units per second for rate rules
+    float hysteresis;         ///< Distance back past the threshold needed to clear (>= 0)
+    uint32_t windowMs;        ///< Rate rules: time span of one rate measurement
+};
+
+constexpr AlertRule alertAbove(uint8_t channel, float threshold, float hysteresis,
+                               uint8_t debounce, uint8_t code) {
+    return AlertRule{channel, ALERT_ABOVE, debounce, code, threshold, hysteresis, 0};
+}
+
+constexpr AlertRule alertBelow(uint8_t channel, float threshold, float hysteresis,
+                               uint8_t debounce, uint8_t code) {
+    return AlertRule{channel, ALERT_BELOW, debounce, code, threshold, hysteresis, 0};
+}
+
+constexpr AlertRule alertRising(uint8_t channel, float perSecond, float hysteresis,
+                                uint32_t windowMs, uint8_t debounce, uint8_t code) {
+    return AlertRule{channel, ALERT_RISING, debounce, code, perSecond, hysteresis, windowMs};
+}
+
+constexpr AlertRule alertFalling(uint8_t channel, float perSecond, float hysteresis,
+                                 uint32_t windowMs, uint8_t debounce, uint8_t code) {
+    return AlertRule{channel, ALERT_FALLING, debounce, code, perSecond, hysteresis, windowMs};
+}
+
+/**
+ * Compile-time check of a rule table, for use in static_assert.
+ *
+ * @return true if every rule has a debounce of at least one sample, a
+ *         finite threshold and a non-negative hysteresis
+ */
+template <size_t N>
+constexpr bool alertRulesValid(const AlertRule (&rules)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+        const AlertRule &r = rules[i];
+        if (r.debounce == 0 || r.threshold != r.threshold || !(r.hysteresis >= 0.0f) ||
+            r.condition > ALERT_FALLING) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @class AlertEngine
+ * @brief Evaluates a fixed rule table against one value row per sample.
+ *
+ * State is kept per rule in separate arrays and is trivially copyable, so
+ * it can be retained across deep sleep by copying its bytes. The table
+ * itself is only referenced and must outlive the engine.
+ *
+ * @tparam N Number of rules
+ */
+template <size_t N>
+class AlertEngine {
+    static_assert(N > 0, "AlertEngine needs at least one rule");
+
+public:
+    /** Number of 32-bit words in the active mask. */
+    static constexpr size_t kWords = (N + 31) / 32;
+
+    explicit AlertEngine(const AlertRule (&rules)[N]) : _rules(rules) { reset(); }
+
+    /**
+     * Evaluate every rule against one sample.
+     *
+     * @param values Value row, NAN where a channel has no value
+     * @param count  Number of values; rules on later channels are skipped
+     * @param nowMs  Sample time, for rate rules
+     * @param sampled Channels with a new sample; rules on the others keep
+     *                their state
+     * @return true if any rule changed state
+     */
+    bool update(const float *values, size_t count, uint32_t nowMs,
+                ChannelMask sampled = CHANNEL_MASK_ALL) {
+        bool changed = false;
+        for (size_t i = 0; i < N; ++i) {
+            const AlertRule &r = _rules[i];
+            if (r.channel >= count || !channelSelected(sampled, r.channel)) {
+                continue;
+            }
+            float x = values[r.channel];
+            if (isnan(x)) {
+                continue;
+            }
+            if (r.condition >= ALERT_RISING) {
+                if (isnan(_base[i])) {
+                    _base[i] = x;
+                    _baseMs[i] = nowMs;
+                    continue;
+                }
+                const uint32_t elapsed = nowMs - _baseMs[i];
+                if (elapsed == 0 || elapsed < r.windowMs) {
+                    continue;
+                }
+                const float rate = (x - _base[i]) * 1000.0f / static_cast<float>(elapsed);
+                _base[i] = x;
+                _baseMs[i] = nowMs;
+                x = rate;
+            }
+            // BELOW and FALLING are ABOVE and RISING with the sign flipped
+            const bool upward = r.condition == ALERT_ABOVE || r.condition == ALERT_RISING;
+            const float level = upward ? x : -x;
+            const float threshold = upward ? r.threshold : -r.threshold;
+            const uint32_t bit = 1UL << (i % 32);
+            const bool on = (_mask[i / 32] & bit) != 0;
+            const bool toward = on ? level < threshold - r.hysteresis : level >= threshold;
+            if (!toward) {
+                _count[i] = 0;
+            } else if (++_count[i] >= r.debounce) {
+                _mask[i / 32] ^= bit;
+                _count[i] = 0;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    /** Clear all alerts and pending transitions. */
+    void reset() {
+        for (size_t w = 0; w < kWords; ++w) {
+            _mask[w] = 0;
+        }
+        for (size_t i = 0; i < N; ++i) {
+            _count[i] = 0;
+            _base[i] = NAN;
+            _baseMs[i] = 0;
+        }
+    }
+
+    /** @return true if rule @p rule is active. */
+    bool active(size_t rule) const { return (_mask[rule / 32] >> (rule % 32)) & 1; }
+
+    /** @return true if any rule is active. */
+    bool any() const {
+        for (size_t w = 0; w < kWords; ++w) {
+            if (_mask[w] != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** @return Index of the first active rule in table order, or -1. */
+    int first() const {
+        for (size_t w = 0; w < kWords; ++w) {
+            if (_mask[w] != 0) {
+                return static_cast<int>(w * 32 + __builtin_ctz(_mask[w]));
+            }
+        }
+        return -1;
+    }
+
+    /** @return Active rules, bit i % 32 of word i / 32 for rule i. */
+    const uint32_t *mask() const { return _mask; }
+
+    /** @return Rule @p index of the table. */
+    const AlertRule &rule(size_t index) const { return _rules[index]; }
+
+    static constexpr size_t ruleCount() { return N; }
+
+private:
+    const AlertRule *_rules;   ///< Rule table (not owned)
+    uint32_t _mask[kWords];    ///< Active rules
+    uint8_t _count[N];         ///< Consecutive samples towards a state change
+    float _base[N];            ///< Rate rules: value at the start of the window
+    uint32_t _baseMs[N];       ///< Rate rules: time of _base
+};
+
+#endif // ALERT_ENGINE_H
@@ -1,6 +1,6 @@
 /**
  * @file AlertManager.h
- * @brief Evaluates sensor values against thresholds and drives an alert LED.
+ * @brief Evaluates sensor values against the alert rule table and drives an alert LED.
  */
 
 #ifndef ALERT_MANAGER_H
@@ -8,9 +8,11 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "sensors/Sensor.h"
+#include "utils/AlertEngine.h"
 
 /**
- * Enumeration of possible alert conditions.
+ * Enumeration of possible alert conditions, used as rule codes.
  */
 enum AlertState {
     ALERT_OK,          ///< All readings within thresholds
@@ -18,15 +20,42 @@ enum AlertState {
     ALERT_TEMP_LOW,    ///< Temperature below low threshold
     ALERT_HUMID_HIGH,  ///< Humidity above high threshold
     ALERT_HUMID_LOW,   ///< Humidity below low threshold
-    ALERT_LIGHT_LOW    ///< Light intensity below low threshold
+    ALERT_LIGHT_LOW,   ///< Light intensity below low threshold
+    ALERT_TEMP_RISING  ///< Temperature rising faster than the rate threshold
 };
 
+/**
+ * Alert rules of the node, most severe first. Channels follow the
+ * registry order (StandardChannel); add rules here for extra channels.
+ */
+inline constexpr AlertRule kAlertRules[] = {
+    alertAbove(CHANNEL_TEMPERATURE, TEMP_HIGH_THRESHOLD, TEMP_HYSTERESIS,
+               ALERT_DEBOUNCE_SAMPLES, ALERT_TEMP_HIGH),
+    alertBelow(CHANNEL_TEMPERATURE, TEMP_LOW_THRESHOLD, TEMP_HYSTERESIS,
+               ALERT_DEBOUNCE_SAMPLES, ALERT_TEMP_LOW),
+    alertAbove(CHANNEL_HUMIDITY, HUMID_HIGH_THRESHOLD, HUMID_HYSTERESIS,
+               ALERT_DEBOUNCE_SAMPLES, ALERT_HUMID_HIGH),
+    alertBelow(CHANNEL_HUMIDITY, HUMID_LOW_THRESHOLD, HUMID_HYSTERESIS,
+               ALERT_DEBOUNCE_SAMPLES, ALERT_HUMID_LOW),
+    alertBelow(CHANNEL_LIGHT, LIGHT_LOW_THRESHOLD, LIGHT_HYSTERESIS,
+               ALERT_DEBOUNCE_SAMPLES, ALERT_LIGHT_LOW),
+    alertRising(CHANNEL_TEMPERATURE, TEMP_RISE_THRESHOLD, TEMP_RISE_HYSTERESIS,
+                TEMP_RISE_WINDOW, ALERT_DEBOUNCE_SAMPLES, ALERT_TEMP_RISING),
+};
+
+static_assert(alertRulesValid(kAlertRules), "Invalid rule in kAlertRules");
+
 /**
  * @class AlertManager
  * @brief Monitors sensor readings and indicates abnormal conditions via an LED.
+ *
+ * update() is meant to be called on every sample. The LED is lit while
+ * any rule is active and is only written when that changes.
  */
 class AlertManager {
 public:
+    typedef AlertEngine<sizeof(kAlertRules) / sizeof(kAlertRules[0])> Engine;
+
     /**
      * Create a new AlertManager object.
      *
@@ -40,26 +69,67 @@ public:
     void begin();
 
     /**
-     * Update the alert state based on the latest sensor values. This will
-     * set the LED accordingly.
+     * Evaluate the rules against the standard channels.
      *
      * @param temperature Filtered temperature reading
      * @param humidity    Filtered humidity reading
      * @param light       Filtered light reading
-     * @return The new alert state
+     * @param nowMs       Sample time, for rate rules
+     * @return The most severe active alert
      */
-    AlertState update(float temperature, float humidity, int light);
+    AlertState update(float temperature, float humidity, int light, uint32_t nowMs = millis());
 
     /**
-     * Get the current alert state without modifying it.
+     * Evaluate the rules against all registry channels.
      *
-     * @return The current alert state
+     * @param channels Filtered values from SensorRegistry::view()
+     * @param nowMs    Sample time, for rate rules
+     * @param sampled  Channels that got a new sample, e.g.
+     *                 SensorRegistry::channelMask() of the sensors read;
+     *                 rules on the others are not advanced or reset
+     * @return The most severe active alert
+     */
+    AlertState update(const ChannelView &channels, uint32_t nowMs = millis(),
+                      ChannelMask sampled = CHANNEL_MASK_ALL);
+
+    /**
+     * Get the most severe active alert without modifying the state.
+     *
+     * @return Code of the first active rule, or ALERT_OK
      */
     AlertState getState() const;
 
+    /**
+     * @return All active alerts, bit i for kAlertRules[i]
+     */
+    uint32_t activeMask() const { return _engine.mask()[0]; }
+
+    /**
+     * @return Channel of the most severe active alert, or -1
+     */
+    int alertChannel() const;
+
+    /**
+     * @return Rule state, for retaining it across a reset
+     */
+    const Engine &engine() const { return _engine; }
+
+    /**
+     * Re-apply rule state saved before a reset (e.g. across deep sleep),
+     * including the LED.
+     *
+     * @param saved Copy of engine() taken before the reset
+     */
+    void restore(const Engine &saved);
+
 private:
+    static_assert(Engine::kWords == 1, "activeMask() covers 32 rules");
+
     uint8_t _ledPin;         ///< Pin connected to the LED
-    AlertState _state;       ///< Current alert state
+    Engine _engine;          ///< Rule state
+
+    /** Run the rules on one value row and follow up on the LED. */
+    AlertState evaluate(const float *values, size_t count, uint32_t nowMs, ChannelMask sampled);
 
     /**
      * Turn the LED on or off.
@@ -69,4 +139,4 @@ private:
     void setLED(bool on);
 };
 
-#endif // ALERT_MANAGER_H
\ No newline at end of file
+#endif // ALERT_MANAGER_H
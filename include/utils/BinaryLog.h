@@ -0,0 +1,281 @@
+/**
+ * @file BinaryLog.h
+ * @brief Non-blocking binary logger behind the LOG_* macros.
+ *
+ * Printing text to a 115200 baud UART costs about 87 us per character once
+ * the 128-byte TX FIFO is full, and Serial.printf() then blocks whichever
+ * task logged. LOG_INFO("fmt", args...) instead stores a fixed-size
+ * record in a lock-free ring: the 32-bit FNV-1a hash of the format string
+ * (computed at compile time), micros(), the level and the raw arguments.
+ * Formatting never happens on the device. A drain task at idle priority
+ * writes the records to Serial as COBS frames, only as many as fit in the
+ * TX FIFO, and tools/logdecode.py maps the hashes back to the format
+ * strings found in the sources and prints the lines.
+ *
+ * Arguments are stored by type: integers as 4 bytes (8 for long long),
+ * floating point as float, strings as a length byte and up to the
+ * remaining record space. The compiler checks the arguments against the
+ * format as for printf(). When the ring is full the record is dropped and
+ * counted; the decoder shows the count. Levels can be switched on and off
+ * at run time; levels above LOG_MAX_LEVEL are compiled out, and with
+ * DEBUG_ENABLED false every LOG_* call is.
+ */
+
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <Arduino.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+#include "config.h"
+#include "utils/MpscRing.h"
+
+/**
+ * Log levels, most severe first.
+ */
+enum LogLevel : uint8_t {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVELS
+};
+
+/** Set in LogRecord::level when arguments did not fit the record. */
+#define LOG_TRUNCATED 0x80
+
+/**
+ * One log call as stored in the ring and sent in a frame.
+ */
+struct LogRecord {
+    uint32_t id;                      ///< logFormatId() of the format string
+    uint32_t micros;                  ///< micros() at the call
+    uint8_t level;                    ///< LogLevel, LOG_TRUNCATED if arguments were cut
+    uint8_t length;                   ///< Bytes used in args
+    uint8_t args[LOG_RECORD_ARGS];    ///< Encoded arguments
+};
+
+/**
+ * Drain side counters.
+ */
+struct LogStats {
+    uint32_t records;    ///< Records written out
+    uint32_t dropped;    ///< Records lost to a full ring
+    uint32_t bytes;      ///< Frame bytes written, delimiters included
+    uint32_t maxDepth;   ///< Most records seen waiting at a drain
+};
+
+/**
+ * 32-bit FNV-1a hash of @p format, the record id. 0 is reserved for the
+ * drop notice. tools/logdecode.py computes the same hash.
+ */
+constexpr uint32_t logFormatId(const char *format) {
+    uint32_t hash = 2166136261u;
+    for (; *format; ++format) {
+        hash = (hash ^ static_cast<uint8_t>(*format)) * 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+/** Lets the compiler check LOG_* arguments against the format; never runs. */
+inline void logCheckFormat(const char *format, ...) __attribute__((format(printf, 1, 2)));
+inline void logCheckFormat(const char *, ...) {}
+
+/**
+ * @class BinaryLog
+ * @brief Ring of log records, drained to a Print by a low-priority task.
+ *
+ * write() may be called from any task (not from ISRs) and never blocks.
+ * drain() is the consumer: the drain task started by begin() on the ESP32,
+ * or the caller's loop on the host.
+ */
+class BinaryLog {
+public:
+    /** Largest frame: header, arguments, CRC, COBS overhead and delimiter. */
+    static constexpr size_t kFrameMax = 9 + LOG_RECORD_ARGS + 1 + 1 + 1;
+
+    BinaryLog();
+
+    /**
+     * Write a frame delimiter so the decoder can synchronise and, on the
+     * ESP32, start the drain task.
+     *
+     * @param out Where frames go, normally Serial
+     */
+    void begin(Print &out = Serial);
+
+    /** @return true if records of @p level are kept. */
+    bool enabled(LogLevel level) const {
+        return (_levels.load(std::memory_order_relaxed) >> level) & 1u;
+    }
+
+    /** Keep records of @p level and all more severe ones, drop the rest. */
+    void setLevel(LogLevel level) { setLevels(static_cast<uint8_t>((2u << level) - 1)); }
+
+    /** Keep or drop records of @p level alone. */
+    void enable(LogLevel level, bool on) {
+        const uint8_t bit = static_cast<uint8_t>(1u << level);
+        if (on) {
+            _levels.fetch_or(bit, std::memory_order_relaxed);
+        } else {
+            _levels.fetch_and(static_cast<uint8_t>(~bit), std::memory_order_relaxed);
+        }
+    }
+
+    /** Set the enabled levels, bit i for LogLevel i. */
+    void setLevels(uint8_t mask) { _levels.store(mask, std::memory_order_relaxed); }
+
+    uint8_t levels() const { return _levels.load(std::memory_order_relaxed); }
+
+#if LOG_BINARY
+    /**
+     * Store one record. Use the LOG_* macros, which compute @p id from the
+     * format at compile time and check the argument types.
+     */
+    template <typename... Args>
+    void write(LogLevel level, uint32_t id, const Args &...args) {
+        LogRecord record;
+        record.id = id;
+        record.micros = micros();
+        record.level = level;
+        record.length = 0;
+        (put(record, args), ...);
+        if (!_ring.push(record)) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Write waiting records as frames, as many as the output can take
+     * without blocking. Consumer side only.
+     *
+     * @param maxRecords Stop after this many records
+     * @return Records written
+     */
+    size_t drain(size_t maxRecords = static_cast<size_t>(-1));
+
+    /** @return Records waiting in the ring. */
+    size_t pending() const { return _ring.size(); }
+
+    /**
+     * Wait up to LOG_FLUSH_TIMEOUT for the waiting records to be written,
+     * e.g. before deep sleep clears the ring. Serial.flush() then waits
+     * for the UART.
+     */
+    void flush();
+
+    /**
+     * Encode @p record as a COBS frame with CRC-8 and trailing 0.
+     *
+     * @return Frame length, at most kFrameMax
+     */
+    static size_t encodeFrame(const LogRecord &record, uint8_t *out);
+
+    LogStats getStats() const;
+#else
+    void flush() {}
+#endif
+
+private:
+    std::atomic<uint8_t> _levels;
+#if LOG_BINARY
+    MpscRing<LogRecord, LOG_RING_SLOTS> _ring;
+    std::atomic<uint32_t> _dropped;   ///< Records lost, any producer
+    uint32_t _reportedDrops;          ///< Drops already announced in a frame
+    Print *_out;
+    LogStats _stats;
+
+    static void putBytes(LogRecord &record, const void *data, size_t size) {
+        if (record.length + size > LOG_RECORD_ARGS) {
+            record.level |= LOG_TRUNCATED;
+            return;
+        }
+        memcpy(record.args + record.length, data, size);
+        record.length = static_cast<uint8_t>(record.length + size);
+    }
+
+    static void putString(LogRecord &record, const char *text) {
+        const size_t room = LOG_RECORD_ARGS - record.length;
+        if (room == 0) {
+            record.level |= LOG_TRUNCATED;
+            return;
+        }
+        size_t size = text ? strlen(text) : 0;
+        if (size > room - 1) {
+            size = room - 1;
+            record.level |= LOG_TRUNCATED;
+        }
+        record.args[record.length] = static_cast<uint8_t>(size);
+        memcpy(record.args + record.length + 1, text, size);
+        record.length = static_cast<uint8_t>(record.length + 1 + size);
+    }
+
+    template <typename T>
+    static void put(LogRecord &record, const T &value) {
+        if constexpr (std::is_floating_point<T>::value) {
+            const float f = static_cast<float>(value);
+            putBytes(record, &f, sizeof(f));
+        } else if constexpr (std::is_same<T, long long>::value ||
+                             std::is_same<T, unsigned long long>::value) {
+            const uint64_t v = static_cast<uint64_t>(value);
+            putBytes(record, &v, sizeof(v));
+        } else if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+            // long is 32 bits on the ESP32; the host's 64-bit long is cut to match
+            const uint32_t v = static_cast<uint32_t>(value);
+            putBytes(record, &v, sizeof(v));
+        } else if constexpr (std::is_convertible<const T &, const char *>::value) {
+            putString(record, value);
+        } else if constexpr (std::is_pointer<T>::value) {
+            const uint32_t v = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(value));
+            putBytes(record, &v, sizeof(v));
+        } else {
+            static_assert(sizeof(T) == 0, "LOG_* argument type cannot be logged");
+        }
+    }
+
+    bool writeFrame(const LogRecord &record);
+#ifdef ARDUINO_ARCH_ESP32
+    static void drainTask(void *arg);
+#endif
+#endif
+};
+
+/** The logger all LOG_* macros write to. */
+extern BinaryLog binaryLog;
+
+#if DEBUG_ENABLED && LOG_BINARY
+#define LOG_AT(level, format, ...)                                          \
+    do {                                                                    \
+        if ((level) <= LOG_MAX_LEVEL && binaryLog.enabled(level)) {         \
+            constexpr uint32_t logId = logFormatId(format);                 \
+            if (false) {                                                    \
+                logCheckFormat(format, ##__VA_ARGS__);                      \
+            }                                                               \
+            binaryLog.write(level, logId, ##__VA_ARGS__);                   \
+        }                                                                   \
+    } while (0)
+#elif DEBUG_ENABLED
+#define LOG_AT(level, format, ...)                                          \
+    do {                                                                    \
+        if ((level) <= LOG_MAX_LEVEL && binaryLog.enabled(level)) {         \
+            DEBUG_PRINTF(format "\n", ##__VA_ARGS__);                       \
+        }                                                                   \
+    } while (0)
+#else
+// Arguments stay referenced (and checked) but nothing is evaluated
+#define LOG_AT(level, format, ...)                                          \
+    do {                                                                    \
+        if (false) {                                                        \
+            logCheckFormat(format, ##__VA_ARGS__);                          \
+        }                                                                   \
+    } while (0)
+#endif
+
+/** Log with a printf format (string literal) and no trailing newline. */
+#define LOG_ERROR(...)  LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)   LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)   LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...)  LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#endif // BINARY_LOG_H
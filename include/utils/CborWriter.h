@@ -0,0 +1,110 @@
+/**
+ * @file CborWriter.h
+ * @brief Minimal CBOR (RFC 8949) encoder writing into a caller buffer.
+ *
+ * Covers the subset needed for telemetry payloads: maps, text strings,
+ * integers and single-precision floats. Nothing is allocated; once the
+ * buffer is full further writes are ignored and overflowed() reports it.
+ */
+
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @class CborWriter
+ * @brief Appends CBOR data items to a fixed buffer.
+ */
+class CborWriter {
+public:
+    CborWriter(uint8_t *buffer, size_t size)
+        : _buffer(buffer), _size(size), _length(0), _overflowed(false) {}
+
+    /** Start a map of @p pairs key/value pairs (definite length). */
+    void beginMap(size_t pairs) { head(5, pairs); }
+
+    /** Start an array of @p items items (definite length). */
+    void beginArray(size_t items) { head(4, items); }
+
+    /** Text string, also used for map keys. */
+    void text(const char *value) {
+        const size_t length = strlen(value);
+        head(3, length);
+        put(reinterpret_cast<const uint8_t *>(value), length);
+    }
+
+    /** Unsigned integer in the shortest encoding. */
+    void uint(uint64_t value) { head(0, value); }
+
+    /** Signed integer in the shortest encoding. */
+    void integer(int64_t value) {
+        if (value < 0) {
+            head(1, static_cast<uint64_t>(-(value + 1)));
+        } else {
+            head(0, static_cast<uint64_t>(value));
+        }
+    }
+
+    /** IEEE 754 single-precision float. */
+    void float32(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        const uint8_t bytes[5] = {0xFA, static_cast<uint8_t>(bits >> 24),
+                                  static_cast<uint8_t>(bits >> 16),
+                                  static_cast<uint8_t>(bits >> 8), static_cast<uint8_t>(bits)};
+        put(bytes, sizeof(bytes));
+    }
+
+    /** @return Bytes written so far. */
+    size_t length() const { return _length; }
+
+    /** @return true if an item did not fit; the output is then incomplete. */
+    bool overflowed() const { return _overflowed; }
+
+private:
+    /** Initial byte plus big-endian argument, in the shortest form. */
+    void head(uint8_t major, uint64_t value) {
+        uint8_t bytes[9];
+        size_t count;
+        const uint8_t type = static_cast<uint8_t>(major << 5);
+        if (value < 24) {
+            bytes[0] = static_cast<uint8_t>(type | value);
+            count = 1;
+        } else if (value <= 0xFF) {
+            bytes[0] = type | 24;
+            count = 2;
+        } else if (value <= 0xFFFF) {
+            bytes[0] = type | 25;
+            count = 3;
+        } else if (value <= 0xFFFFFFFFu) {
+            bytes[0] = type | 26;
+            count = 5;
+        } else {
+            bytes[0] = type | 27;
+            count = 9;
+        }
+        for (size_t i = 1; i < count; ++i) {
+            bytes[i] = static_cast<uint8_t>(value >> (8 * (count - 1 - i)));
+        }
+        put(bytes, count);
+    }
+
+    void put(const uint8_t *data, size_t count) {
+        if (_overflowed || _length + count > _size) {
+            _overflowed = true;
+            return;
+        }
+        memcpy(_buffer + _length, data, count);
+        _length += count;
+    }
+
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _length;
+    bool _overflowed;
+};
+
+#endif // CBOR_WRITER_H
@@ -0,0 +1,123 @@
+/**
+ * @file CycleHistogram.h
+ * @brief Fixed-bucket latency histogram of CPU cycle counts.
+ */
+
+#ifndef CYCLE_HISTOGRAM_H
+#define CYCLE_HISTOGRAM_H
+
+#include <Arduino.h>
+
+/**
+ * @class CycleHistogram
+ * @brief Log-linear histogram with four buckets per power of two.
+ *
+ * Values 0 to 3 have a bucket each; above that every octave [2^k, 2^k+1)
+ * is split into four equal buckets, so a bucket is at most a quarter of
+ * its lower bound wide and a percentile read from the histogram is within
+ * 25% of the exact value over the whole 32-bit range. record() is a count
+ * of leading zeros, two shifts and an increment; nothing is allocated and
+ * the size is fixed (124 counters).
+ *
+ * Counters saturate at 65535 samples per bucket; reset() the histogram
+ * once per reporting period.
+ */
+class CycleHistogram {
+public:
+    static constexpr unsigned kSubBits = 2;
+    static constexpr uint32_t kSubBuckets = 1u << kSubBits;
+    static constexpr size_t kBuckets = (32 - kSubBits + 1) * kSubBuckets;
+
+    CycleHistogram() { reset(); }
+
+    /** Add one sample of @p cycles. */
+    void record(uint32_t cycles) {
+        uint16_t &bucket = _counts[bucketOf(cycles)];
+        if (bucket != 0xFFFF) {
+            ++bucket;
+        }
+        ++_count;
+        if (cycles < _min) {
+            _min = cycles;
+        }
+        if (cycles > _max) {
+            _max = cycles;
+        }
+    }
+
+    /** Discard all samples. */
+    void reset() {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            _counts[i] = 0;
+        }
+        _count = 0;
+        _min = 0xFFFFFFFFu;
+        _max = 0;
+    }
+
+    uint32_t count() const { return _count; }
+
+    /** @return Smallest sample, 0 without samples. */
+    uint32_t min() const { return _count ? _min : 0; }
+
+    /** @return Largest sample. */
+    uint32_t max() const { return _max; }
+
+    /**
+     * @param perMille Percentile in thousandths, e.g. 500 for the median
+     * @return Upper bound of the bucket holding that rank, clamped to the
+     *         observed range; 0 without samples
+     */
+    uint32_t percentile(uint32_t perMille) const {
+        if (_count == 0) {
+            return 0;
+        }
+        uint32_t total = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            total += _counts[i];
+        }
+        // Smallest rank r with r >= perMille / 1000 of the samples
+        uint64_t rank = (static_cast<uint64_t>(total) * perMille + 999) / 1000;
+        if (rank == 0) {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += _counts[i];
+            if (seen >= rank) {
+                const uint32_t upper = bucketUpper(i);
+                return upper < _min ? _min : upper > _max ? _max : upper;
+            }
+        }
+        return _max;
+    }
+
+    /** @return Bucket index of @p value. */
+    static size_t bucketOf(uint32_t value) {
+        if (value < kSubBuckets) {
+            return value;
+        }
+        const unsigned msb = 31 - static_cast<unsigned>(__builtin_clz(value));
+        return (msb - kSubBits + 1) * kSubBuckets +
+               ((value >> (msb - kSubBits)) & (kSubBuckets - 1));
+    }
+
+    /** @return Largest value that falls into bucket @p index. */
+    static uint32_t bucketUpper(size_t index) {
+        if (index < kSubBuckets) {
+            return static_cast<uint32_t>(index);
+        }
+        const unsigned msb = static_cast<unsigned>(index / kSubBuckets) + kSubBits - 1;
+        const uint32_t width = 1u << (msb - kSubBits);
+        const uint32_t lower = (kSubBuckets + index % kSubBuckets) * width;
+        return lower + (width - 1);
+    }
+
+private:
+    uint16_t _counts[kBuckets];
+    uint32_t _count;     ///< Samples since reset(), not saturated
+    uint32_t _min;
+    uint32_t _max;
+};
+
+#endif // CYCLE_HISTOGRAM_H
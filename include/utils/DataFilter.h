@@ -1,31 +1,45 @@
 /**
  * @file DataFilter.h
- * @brief Implements a simple moving average filter for float values.
+ * @brief Implements a fixed-size moving average filter.
+ *
+ * The window is sized at compile time and stored inline, so a filter needs
+ * no heap allocation. A running sum makes both addValue() and getAverage()
+ * O(1) regardless of the window size.
+ *
+ * EmaFilter, MedianFilter and KalmanFilter1D provide the same
+ * addValue()/getAverage()/reset()/count() interface and can be swapped in
+ * wherever a DataFilter is used.
  */
 
 #ifndef DATA_FILTER_H
 #define DATA_FILTER_H
 
 #include <Arduino.h>
+#include <type_traits>
 #include "config.h"
 
+/**
+ * Accumulator type used for running sums of T. Floating point samples are
+ * summed in double so that subtracting evicted samples does not drift over
+ * millions of updates; integral samples use a 64-bit integer.
+ */
+template <typename T>
+using FilterAccumulator =
+    typename std::conditional<std::is_floating_point<T>::value, double, int64_t>::type;
+
 /**
  * @class DataFilter
  * @brief Maintains a circular buffer and computes a moving average.
+ *
+ * @tparam N Number of samples to average over.
+ * @tparam T Sample type.
  */
+template <size_t N = FILTER_WINDOW_SIZE, typename T = float>
 class DataFilter {
-public:
-    /**
-     * Construct a new DataFilter object.
-     *
-     * @param windowSize Number of samples to average over.
-     */
-    explicit DataFilter(size_t windowSize = FILTER_WINDOW_SIZE);
+    static_assert(N > 0, "DataFilter window must hold at least one sample");
 
-    /**
-     * Destructor to free allocated buffer.
-     */
-    ~DataFilter();
+public:
+    DataFilter() { reset(); }
 
     /**
      * Add a new value to the filter. The oldest value will be dropped
@@ -33,25 +47,56 @@ public:
      *
      * @param value The new value to insert.
      */
-    void addValue(float value);
+    void addValue(T value) {
+        if (_count == N) {
+            _sum -= _buffer[_index];
+        } else {
+            ++_count;
+        }
+        _buffer[_index] = value;
+        _sum += value;
+        _index = (_index + 1 == N) ? 0 : _index + 1;
+    }
 
     /**
      * Compute the current average of the values stored in the buffer.
      *
      * @return The average or 0 if no samples have been added.
      */
-    float getAverage() const;
+    T getAverage() const {
+        if (_count == 0) {
+            return T(0);
+        }
+        return static_cast<T>(_sum / static_cast<FilterAccumulator<T>>(_count));
+    }
 
     /**
      * Reset the filter, discarding all stored samples.
      */
-    void reset();
+    void reset() {
+        _index = 0;
+        _count = 0;
+        _sum = 0;
+        for (size_t i = 0; i < N; ++i) {
+            _buffer[i] = T(0);
+        }
+    }
+
+    /**
+     * @return Number of samples currently stored (at most N).
+     */
+    size_t count() const { return _count; }
+
+    /**
+     * @return Window size the filter was instantiated with.
+     */
+    static constexpr size_t windowSize() { return N; }
 
 private:
-    size_t _windowSize; ///< Maximum number of samples to average
-    float *_buffer;     ///< Pointer to dynamic array storing samples
-    size_t _index;      ///< Current insertion index
-    size_t _count;      ///< Number of samples currently stored
+    T _buffer[N];                 ///< Circular sample window
+    size_t _index;                ///< Current insertion index
+    size_t _count;                ///< Number of samples currently stored
+    FilterAccumulator<T> _sum;    ///< Sum of the samples in the window
 };
 
-#endif // DATA_FILTER_H
\ No newline at end of file
+#endif // DATA_FILTER_H
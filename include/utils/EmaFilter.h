@@ -0,0 +1,70 @@
+/**
+ * @file EmaFilter.h
+ * @brief Exponential moving average with the DataFilter interface.
+ */
+
+#ifndef EMA_FILTER_H
+#define EMA_FILTER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * @class EmaFilter
+ * @brief Smooths samples with y += alpha * (x - y).
+ *
+ * Uses constant memory and reacts to changes with a time constant of roughly
+ * 1/alpha samples. The first sample seeds the average directly so there is
+ * no ramp-up from zero.
+ *
+ * @tparam T Sample type (floating point).
+ */
+template <typename T = float>
+class EmaFilter {
+public:
+    /**
+     * @param alpha Smoothing factor in (0, 1]; higher reacts faster.
+     */
+    explicit EmaFilter(T alpha = FILTER_EMA_ALPHA) : _alpha(alpha) { reset(); }
+
+    /**
+     * Fold a new value into the average.
+     *
+     * @param value The new value to insert.
+     */
+    void addValue(T value) {
+        if (_count == 0) {
+            _value = value;
+        } else {
+            _value += _alpha * (value - _value);
+        }
+        if (_count < SIZE_MAX) {
+            ++_count;
+        }
+    }
+
+    /**
+     * @return The smoothed value or 0 if no samples have been added.
+     */
+    T getAverage() const { return _value; }
+
+    /**
+     * Reset the filter, discarding its state.
+     */
+    void reset() {
+        _value = T(0);
+        _count = 0;
+    }
+
+    /**
+     * @return Number of samples folded in since the last reset.
+     */
+    size_t count() const { return _count; }
+
+private:
+    T _alpha;       ///< Smoothing factor
+    T _value;       ///< Current smoothed value
+    size_t _count;  ///< Samples seen since reset
+};
+
+#endif // EMA_FILTER_H
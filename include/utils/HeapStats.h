@@ -0,0 +1,34 @@
+/**
+ * @file HeapStats.h
+ * @brief Snapshot of heap health for fragmentation telemetry.
+ */
+
+#ifndef HEAP_STATS_H
+#define HEAP_STATS_H
+
+#include <Arduino.h>
+
+/**
+ * Free heap alone hides fragmentation: a node can have plenty of free
+ * bytes but no block large enough for a TLS handshake. The largest free
+ * block shows that, and the minimum since boot shows the worst case.
+ */
+struct HeapStats {
+    uint32_t freeBytes;          ///< Currently free heap
+    uint32_t largestFreeBlock;   ///< Largest block that can be allocated
+    uint32_t minFreeBytes;       ///< Lowest free heap since boot
+};
+
+/**
+ * @return Current heap statistics.
+ */
+HeapStats readHeapStats();
+
+/**
+ * Format @p stats as a compact JSON object.
+ *
+ * @return Length written, or 0 if @p size was too small
+ */
+size_t formatHeapStats(const HeapStats &stats, char *out, size_t size);
+
+#endif // HEAP_STATS_H
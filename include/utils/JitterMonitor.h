@@ -0,0 +1,67 @@
+/**
+ * @file JitterMonitor.h
+ * @brief Tracks scheduling jitter and run time of a periodic task.
+ */
+
+#ifndef JITTER_MONITOR_H
+#define JITTER_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * @class JitterMonitor
+ * @brief Compares the actual wake-up times of a periodic task against its
+ *        ideal schedule and records the worst deviation.
+ *
+ * Owned and updated by a single task; other tasks may read the counters
+ * for reporting (32-bit reads are atomic on the ESP32).
+ */
+class JitterMonitor {
+public:
+    /**
+     * @param name     Label used in reports
+     * @param periodMs Nominal period of the task
+     */
+    JitterMonitor(const char *name, uint32_t periodMs);
+
+    /**
+     * Call at the start of every cycle.
+     *
+     * @param nowUs Current time from micros()
+     */
+    void onWake(uint32_t nowUs);
+
+    /**
+     * Call when the cycle's work is finished.
+     *
+     * @param nowUs Current time from micros()
+     */
+    void onDone(uint32_t nowUs);
+
+    /**
+     * Print the statistics collected so far over Serial.
+     */
+    void report() const;
+
+    /**
+     * Discard the statistics collected so far.
+     */
+    void reset();
+
+    const char *name() const { return _name; }
+    uint32_t cycles() const { return _cycles; }
+    uint32_t maxJitterUs() const { return _maxJitterUs; }
+    uint32_t maxRunUs() const { return _maxRunUs; }
+
+private:
+    const char *_name;        ///< Label used in reports
+    uint32_t _periodUs;       ///< Nominal period
+    uint32_t _expectedUs;     ///< Ideal time of the next wake-up
+    uint32_t _wakeUs;         ///< Actual time of the current wake-up
+    uint32_t _cycles;         ///< Completed wake-ups
+    uint32_t _maxJitterUs;    ///< Largest |actual - ideal| wake-up time
+    uint32_t _maxRunUs;       ///< Longest time between onWake and onDone
+};
+
+#endif // JITTER_MONITOR_H
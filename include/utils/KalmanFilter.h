@@ -0,0 +1,88 @@
+/**
+ * @file KalmanFilter.h
+ * @brief Scalar (one-dimensional) Kalman filter with the DataFilter interface.
+ */
+
+#ifndef KALMAN_FILTER_H
+#define KALMAN_FILTER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * @class KalmanFilter1D
+ * @brief Estimates a slowly varying quantity from noisy measurements.
+ *
+ * Models the signal as a random walk: the process noise @c q controls how
+ * quickly the estimate may move, the measurement noise @c r how much a
+ * single reading is trusted. Constant time and memory per sample.
+ *
+ * @tparam T Sample type (floating point).
+ */
+template <typename T = float>
+class KalmanFilter1D {
+public:
+    /**
+     * @param processNoise     Variance added to the estimate per sample (q)
+     * @param measurementNoise Variance of a single measurement (r)
+     */
+    explicit KalmanFilter1D(T processNoise = KALMAN_PROCESS_NOISE,
+                            T measurementNoise = KALMAN_MEASUREMENT_NOISE)
+        : _q(processNoise), _r(measurementNoise) {
+        reset();
+    }
+
+    /**
+     * Correct the estimate with a new measurement.
+     *
+     * @param value The new measurement.
+     */
+    void addValue(T value) {
+        if (_count == 0) {
+            // Seed with the first measurement, trusting it as much as r
+            _x = value;
+            _p = _r;
+        } else {
+            _p += _q;
+            const T gain = _p / (_p + _r);
+            _x += gain * (value - _x);
+            _p *= (T(1) - gain);
+        }
+        if (_count < SIZE_MAX) {
+            ++_count;
+        }
+    }
+
+    /**
+     * @return The current estimate or 0 if no samples have been added.
+     */
+    T getAverage() const { return _x; }
+
+    /**
+     * @return Variance of the current estimate.
+     */
+    T getVariance() const { return _p; }
+
+    /**
+     * Reset the filter, discarding its state.
+     */
+    void reset() {
+        _x = T(0);
+        _p = T(0);
+        _count = 0;
+    }
+
+    /**
+     * @return Number of measurements folded in since the last reset.
+     */
+    size_t count() const { return _count; }
+
+private:
+    T _q;           ///< Process noise variance
+    T _r;           ///< Measurement noise variance
+    T _x;           ///< State estimate
+    T _p;           ///< Estimate variance
+    size_t _count;  ///< Measurements seen since reset
+};
+
+#endif // KALMAN_FILTER_H
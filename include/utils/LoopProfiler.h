@@ -0,0 +1,123 @@
+/**
+ * @file LoopProfiler.h
+ * @brief Per-stage cycle-count histograms of the polling loop.
+ *
+ * The stages of loop() are timed with the CPU cycle counter
+ * (ESP.getCycleCount(), one instruction on the ESP32) and every duration
+ * goes into the stage's CycleHistogram. Once per PROFILER_REPORT_INTERVAL
+ * the histograms are printed over Serial as min/p50/p99/max, encoded as
+ * a JSON message for MQTT_TOPIC_PROFILE and cleared.
+ *
+ * Timing a stage costs two cycle-counter reads and a histogram update.
+ * The PROFILE_* macros expand to nothing with LOOP_PROFILER set to 0, so
+ * a disabled profiler leaves no code or data behind.
+ *
+ * On the host the cycle counter follows the virtual clock, so stages show
+ * the bus, sensor and network time the stand-ins simulate.
+ */
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "utils/CycleHistogram.h"
+
+/**
+ * Timed stages of the polling loop.
+ */
+enum ProfileStage : uint8_t {
+    PROFILE_LOOP,      ///< Whole loop() body, without the trailing delay
+    PROFILE_WIFI,      ///< wifiManager.loop()
+    PROFILE_METRICS,   ///< metricsServer.loop()
+    PROFILE_SENSORS,   ///< Sensor reads
+    PROFILE_FILTER,    ///< Moving average update
+    PROFILE_ALERTS,    ///< alertManager.update()
+    PROFILE_HISTORY,   ///< History append
+    PROFILE_DISPLAY,   ///< Display update
+    PROFILE_UPLOAD,    ///< Upload hand-over
+    PROFILE_REPLAY,    ///< Store-and-forward replay
+    PROFILE_STAGES
+};
+
+/**
+ * @class LoopProfiler
+ * @brief Cycle histograms of the loop stages, reported once per period.
+ *
+ * Stages are timed as laps: mark() starts a lap, lap() ends it in a stage
+ * and starts the next one, so consecutive stages need one counter read
+ * each.
+ */
+class LoopProfiler {
+public:
+    LoopProfiler();
+
+    /** Start the loop and its first lap. */
+    void beginLoop() {
+        _loopStart = ESP.getCycleCount();
+        _mark = _loopStart;
+    }
+
+    /** Record the loop since beginLoop(). */
+    void endLoop() { record(PROFILE_LOOP, ESP.getCycleCount() - _loopStart); }
+
+    /** Start a lap, e.g. at the start of a stage that does not always run. */
+    void mark() { _mark = ESP.getCycleCount(); }
+
+    /** Record the lap since the last mark() or lap() as @p stage. */
+    void lap(ProfileStage stage) {
+        const uint32_t now = ESP.getCycleCount();
+        record(stage, now - _mark);
+        _mark = now;
+    }
+
+    void record(ProfileStage stage, uint32_t cycles) { _histograms[stage].record(cycles); }
+
+    const CycleHistogram &histogram(ProfileStage stage) const { return _histograms[stage]; }
+
+    /** @return Name of @p stage in reports. */
+    static const char *stageName(ProfileStage stage);
+
+    /** @return true once PROFILER_REPORT_INTERVAL has passed since the period began. */
+    bool due(uint32_t nowMs) const { return nowMs - _periodStart >= PROFILER_REPORT_INTERVAL; }
+
+    /**
+     * End the period: print the stages that ran over Serial, encode them
+     * into payload() and clear the histograms.
+     *
+     * @return Length of payload(), 0 if it did not fit
+     */
+    size_t closePeriod(uint32_t nowMs);
+
+    /**
+     * Encode the current histograms as JSON: period_ms, cpu_mhz and, per
+     * stage that ran, [count, min, p50, p99, max] in cycles.
+     *
+     * @return Length written, or 0 if @p size was too small
+     */
+    size_t format(uint32_t nowMs, char *out, size_t size) const;
+
+    /** @return Message of the last closed period; valid until the next one. */
+    const char *payload() const { return _payload; }
+
+private:
+    CycleHistogram _histograms[PROFILE_STAGES];
+    uint32_t _loopStart;
+    uint32_t _mark;
+    uint32_t _periodStart;    ///< millis() when the period began
+    char _payload[PROFILER_PAYLOAD_MAX];
+};
+
+#if LOOP_PROFILER
+#define PROFILE_LOOP_BEGIN(profiler)  (profiler).beginLoop()
+#define PROFILE_LOOP_END(profiler)    (profiler).endLoop()
+#define PROFILE_MARK(profiler)        (profiler).mark()
+#define PROFILE_LAP(profiler, stage)  (profiler).lap(stage)
+#else
+#define PROFILE_LOOP_BEGIN(profiler)  ((void)0)
+#define PROFILE_LOOP_END(profiler)    ((void)0)
+#define PROFILE_MARK(profiler)        ((void)0)
+#define PROFILE_LAP(profiler, stage)  ((void)0)
+#endif
+
+#endif // LOOP_PROFILER_H
@@ -0,0 +1,116 @@
+/**
+ * @file MedianFilter.h
+ * @brief Sliding median-of-N filter with the DataFilter interface.
+ */
+
+#ifndef MEDIAN_FILTER_H
+#define MEDIAN_FILTER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * @class MedianFilter
+ * @brief Reports the median of the last N samples.
+ *
+ * Rejects isolated spikes (e.g. a bad DHT read) that would skew a mean. The
+ * window is kept both in arrival order and sorted; addValue() moves one
+ * element within the sorted copy (O(N) memmove, no allocation) and
+ * getAverage() is O(1).
+ *
+ * @tparam N Number of samples in the window.
+ * @tparam T Sample type.
+ */
+template <size_t N = FILTER_WINDOW_SIZE, typename T = float>
+class MedianFilter {
+    static_assert(N > 0, "MedianFilter window must hold at least one sample");
+
+public:
+    MedianFilter() { reset(); }
+
+    /**
+     * Add a new value to the filter, evicting the oldest once full.
+     *
+     * @param value The new value to insert.
+     */
+    void addValue(T value) {
+        if (_count == N) {
+            removeSorted(_ring[_index]);
+        } else {
+            ++_count;
+        }
+        _ring[_index] = value;
+        _index = (_index + 1 == N) ? 0 : _index + 1;
+        insertSorted(value);
+    }
+
+    /**
+     * @return The median of the stored samples (mean of the two middle
+     *         samples for even counts) or 0 if no samples have been added.
+     */
+    T getAverage() const {
+        if (_count == 0) {
+            return T(0);
+        }
+        const size_t mid = _count / 2;
+        if (_count & 1) {
+            return _sorted[mid];
+        }
+        return (_sorted[mid - 1] + _sorted[mid]) / T(2);
+    }
+
+    /**
+     * Reset the filter, discarding all stored samples.
+     */
+    void reset() {
+        _index = 0;
+        _count = 0;
+    }
+
+    /**
+     * @return Number of samples currently stored (at most N).
+     */
+    size_t count() const { return _count; }
+
+    /**
+     * @return Window size the filter was instantiated with.
+     */
+    static constexpr size_t windowSize() { return N; }
+
+private:
+    /** Index of the first sorted element not less than value. */
+    size_t lowerBound(T value, size_t size) const {
+        size_t lo = 0;
+        size_t hi = size;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            if (_sorted[mid] < value) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    /** Insert into the sorted copy; _count already includes the new value. */
+    void insertSorted(T value) {
+        const size_t size = _count - 1;
+        const size_t pos = lowerBound(value, size);
+        memmove(&_sorted[pos + 1], &_sorted[pos], (size - pos) * sizeof(T));
+        _sorted[pos] = value;
+    }
+
+    /** Remove one occurrence of value from the full sorted copy. */
+    void removeSorted(T value) {
+        const size_t pos = lowerBound(value, N);
+        memmove(&_sorted[pos], &_sorted[pos + 1], (N - pos - 1) * sizeof(T));
+    }
+
+    T _ring[N];     ///< Samples in arrival order
+    T _sorted[N];   ///< Same samples in ascending order
+    size_t _index;  ///< Next slot in _ring
+    size_t _count;  ///< Number of samples currently stored
+};
+
+#endif // MEDIAN_FILTER_H
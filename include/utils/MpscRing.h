@@ -0,0 +1,107 @@
+/**
+ * @file MpscRing.h
+ * @brief Lock-free multi-producer/single-consumer ring buffer.
+ */
+
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @class MpscRing
+ * @brief Bounded FIFO that any number of tasks may push to while one
+ *        consumer pops.
+ *
+ * Every slot carries a sequence number (Vyukov's bounded queue). A
+ * producer claims a slot by advancing the head with a compare-and-swap,
+ * copies the element in and publishes it with a release store of the
+ * slot's sequence; the consumer acquires that sequence before reading.
+ * A producer preempted between claim and publish only delays the consumer
+ * at that slot, it never blocks other producers. Not for use from ISRs.
+ *
+ * @tparam T Element type (copied in and out).
+ * @tparam N Capacity, must be a power of two.
+ */
+template <typename T, size_t N>
+class MpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscRing capacity must be a power of two");
+
+public:
+    MpscRing() : _head(0), _tail(0) {
+        for (size_t i = 0; i < N; ++i) {
+            _slots[i].sequence.store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Append an element. Safe from several tasks at once.
+     *
+     * @param value Element to copy into the ring
+     * @return false if the ring is full (the element is not stored)
+     */
+    bool push(const T &value) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = _slots[head & (N - 1)];
+            const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const int32_t lag = static_cast<int32_t>(sequence - head);
+            if (lag == 0) {
+                if (_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(head + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false;
+            } else {
+                head = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Remove the oldest element. Consumer side only.
+     *
+     * @param out Receives the element
+     * @return false if the ring is empty or the oldest element is still
+     *         being written
+     */
+    bool pop(T &out) {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        Slot &slot = _slots[tail & (N - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+            return false;
+        }
+        out = slot.value;
+        slot.sequence.store(tail + static_cast<uint32_t>(N), std::memory_order_release);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @return Number of claimed slots, including ones still being written.
+     *         Approximate while producers are active.
+     */
+    size_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;   ///< Position + 1 once written, + N once read
+        T value;
+    };
+
+    Slot _slots[N];                  ///< Element storage
+    std::atomic<uint32_t> _head;     ///< Total slots claimed by producers
+    std::atomic<uint32_t> _tail;     ///< Total elements popped (consumer owned)
+};
+
+#endif // MPSC_RING_H
@@ -0,0 +1,48 @@
+/**
+ * @file Oversampling.h
+ * @brief Decimation of a burst of ADC conversions into one value, with
+ *        flicker measurement.
+ */
+
+#ifndef OVERSAMPLING_H
+#define OVERSAMPLING_H
+
+#include <Arduino.h>
+
+/**
+ * Summary of one window of conversions. Averaging N conversions with
+ * uncorrelated noise lowers the noise by sqrt(N), so the mean carries
+ * fractional counts. The extremes and the modulation frequency come from
+ * the decimated signal, where block averaging has already removed most
+ * of that noise.
+ */
+struct OversampledWindow {
+    uint32_t conversions;   ///< Conversions used (whole blocks only)
+    float mean;             ///< Mean level (ADC counts), over whole periods if modulated
+    float min;              ///< Lowest decimated sample (ADC counts)
+    float max;              ///< Highest decimated sample (ADC counts)
+    float flickerPercent;   ///< Percent flicker, 100 * (max - min) / (max + min)
+    float flickerHz;        ///< Modulation frequency from mean crossings, 0 if none
+};
+
+/**
+ * Decimate @p count conversions by @p decimation and summarise them.
+ *
+ * The inner loop is branch-free integer accumulation over four
+ * independent sums: the ESP32's Xtensa core has no SIMD unit, so this is
+ * what keeps its load pipeline busy. Bits above the low 12 (the channel
+ * tag of a DMA frame) are masked off, so DMA buffers can be passed as is.
+ *
+ * @param samples      12-bit conversions
+ * @param count        Number of conversions; a trailing partial block is ignored
+ * @param decimation   Conversions per decimated sample, a multiple of 4
+ * @param blocks       Scratch for count / decimation decimated sums
+ * @param sampleRateHz Conversion rate, for the flicker frequency
+ * @param minFlickerPercent Smaller swings count as noise: no frequency is
+ *                     measured and the mean covers the whole window
+ */
+OversampledWindow oversampleWindow(const uint16_t *samples, size_t count, unsigned decimation,
+                                   uint32_t *blocks, uint32_t sampleRateHz,
+                                   float minFlickerPercent);
+
+#endif // OVERSAMPLING_H
@@ -0,0 +1,81 @@
+/**
+ * @file SpscRing.h
+ * @brief Lock-free single-producer/single-consumer ring buffer.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @class SpscRing
+ * @brief Bounded FIFO safe for exactly one producer and one consumer running
+ *        concurrently (e.g. two FreeRTOS tasks on different cores).
+ *
+ * Head and tail are free-running counters; the producer publishes a slot
+ * with a release store of the head and the consumer acquires it, so no lock
+ * or critical section is needed. Storage is inline, no heap allocation.
+ *
+ * @tparam T Element type (copied in and out).
+ * @tparam N Capacity, must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : _head(0), _tail(0) {}
+
+    /**
+     * Append an element. Producer side only.
+     *
+     * @param value Element to copy into the ring
+     * @return false if the ring is full (the element is not stored)
+     */
+    bool push(const T &value) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        _slots[head & (N - 1)] = value;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Remove the oldest element. Consumer side only.
+     *
+     * @param out Receives the element
+     * @return false if the ring is empty
+     */
+    bool pop(T &out) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = _slots[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @return Number of queued elements. Exact from either endpoint's own
+     *         perspective, approximate for third parties.
+     */
+    size_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T _slots[N];                 ///< Element storage
+    std::atomic<size_t> _head;   ///< Total elements pushed (producer owned)
+    std::atomic<size_t> _tail;   ///< Total elements popped (consumer owned)
+};
+
+#endif // SPSC_RING_H
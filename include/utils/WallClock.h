@@ -0,0 +1,41 @@
+/**
+ * @file WallClock.h
+ * @brief Calendar time once SNTP has set the system clock.
+ */
+
+#ifndef WALL_CLOCK_H
+#define WALL_CLOCK_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "config.h"
+
+/**
+ * millis() restarts at every boot, so on its own it cannot tell when a
+ * reading stored before a reset was taken. WiFiManager starts SNTP on the
+ * first connection; the ESP32 keeps the clock across resets and deep sleep,
+ * but not across a power loss.
+ *
+ * @return Seconds since the Unix epoch, or 0 while the clock is not set
+ */
+inline uint32_t wallClock() {
+    const time_t now = time(nullptr);
+    return now >= static_cast<time_t>(WALL_CLOCK_VALID_AFTER) ? static_cast<uint32_t>(now) : 0;
+}
+
+/**
+ * Calendar time of a millis() timestamp of the current boot.
+ *
+ * @return Seconds since the Unix epoch, or 0 while the clock is not set
+ */
+inline uint32_t wallClockAt(uint32_t timestamp) {
+    const uint32_t now = wallClock();
+    if (now == 0) {
+        return 0;
+    }
+    // Signed: a timestamp may lie slightly ahead of a millis() read earlier
+    const int32_t ageMs = static_cast<int32_t>(millis() - timestamp);
+    return now - static_cast<uint32_t>(ageMs / 1000);
+}
+
+#endif // WALL_CLOCK_H
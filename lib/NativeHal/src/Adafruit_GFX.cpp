@@ -0,0 +1,66 @@
+/**
+ * @file Adafruit_GFX.cpp
+ * @brief Implementation of the host Adafruit GFX stand-in.
+ */
+
+#include "Adafruit_GFX.h"
+
+namespace {
+
+/** Deterministic 7-pixel column for a printable character. */
+uint8_t glyphColumn(unsigned char c, uint8_t column) {
+    if (c <= ' ' || c > '~') {
+        return 0;
+    }
+    return static_cast<uint8_t>((c * 0x9Du) ^ (column * 0x35u) ^ (c >> 2)) & 0x7F;
+}
+
+} // namespace
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    for (int16_t i = x; i < x + w; ++i) {
+        for (int16_t j = y; j < y + h; ++j) {
+            drawPixel(i, j, color);
+        }
+    }
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                            uint16_t bg, uint8_t size) {
+    for (uint8_t i = 0; i < 5; ++i) {
+        uint8_t line = glyphColumn(c, i);
+        for (uint8_t j = 0; j < 8; ++j, line >>= 1) {
+            if (line & 1) {
+                if (size == 1) {
+                    drawPixel(x + i, y + j, color);
+                } else {
+                    fillRect(x + i * size, y + j * size, size, size, color);
+                }
+            } else if (bg != color) {
+                if (size == 1) {
+                    drawPixel(x + i, y + j, bg);
+                } else {
+                    fillRect(x + i * size, y + j * size, size, size, bg);
+                }
+            }
+        }
+    }
+    if (bg != color) {
+        fillRect(x + 5 * size, y, size, 8 * size, bg);
+    }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+    if (c == '\n') {
+        _cursorX = 0;
+        _cursorY += _textSize * 8;
+    } else if (c != '\r') {
+        if (_wrap && (_cursorX + _textSize * 6) > _width) {
+            _cursorX = 0;
+            _cursorY += _textSize * 8;
+        }
+        drawChar(_cursorX, _cursorY, c, _textColor, _textBg, _textSize);
+        _cursorX += _textSize * 6;
+    }
+    return 1;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file Adafruit_GFX.h
+ * @brief Host stand-in for the text-rendering part of Adafruit GFX.
+ *
+ * Characters are drawn from a synthetic 5x7 glyph generator rather than the
+ * real bitmap font; pixel count and per-character cost match closely enough
+ * for benchmarking, but the framebuffer is not a faithful screenshot.
+ */
+
+#ifndef NATIVE_ADAFRUIT_GFX_H
+#define NATIVE_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+class Adafruit_GFX : public Print {
+public:
+    Adafruit_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg,
+                  uint8_t size);
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    void setCursor(int16_t x, int16_t y) {
+        _cursorX = x;
+        _cursorY = y;
+    }
+    int16_t getCursorX() const { return _cursorX; }
+    int16_t getCursorY() const { return _cursorY; }
+    void setTextSize(uint8_t s) { _textSize = s > 0 ? s : 1; }
+    void setTextColor(uint16_t c) { _textColor = _textBg = c; }
+    void setTextColor(uint16_t c, uint16_t bg) {
+        _textColor = c;
+        _textBg = bg;
+    }
+    void setTextWrap(bool w) { _wrap = w; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+protected:
+    int16_t _width;
+    int16_t _height;
+    int16_t _cursorX = 0;
+    int16_t _cursorY = 0;
+    uint16_t _textColor = 0xFFFF;
+    uint16_t _textBg = 0xFFFF;
+    uint8_t _textSize = 1;
+    bool _wrap = true;
+};
+
+#endif // NATIVE_ADAFRUIT_GFX_H
@@ -0,0 +1,132 @@
+/**
+ * @file Adafruit_SSD1306.cpp
+ * @brief Implementation of the host SSD1306 stand-in.
+ */
+
+#include "Adafruit_SSD1306.h"
+
+namespace {
+
+const size_t kWireChunk = 32;  ///< Arduino Wire buffer size used by the driver
+
+} // namespace
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rstPin,
+                                   uint32_t clkDuring, uint32_t clkAfter)
+    : Adafruit_GFX(w, h), _wire(twi), _clkDuring(clkDuring), _clkAfter(clkAfter) {
+    (void)rstPin;
+}
+
+Adafruit_SSD1306::~Adafruit_SSD1306() { free(_buffer); }
+
+bool Adafruit_SSD1306::begin(uint8_t switchvcc, uint8_t i2caddr, bool reset, bool periphBegin) {
+    (void)switchvcc;
+    (void)reset;
+    if (!_buffer) {
+        _buffer = static_cast<uint8_t *>(malloc(_width * ((_height + 7) / 8)));
+        if (!_buffer) {
+            return false;
+        }
+    }
+    clearDisplay();
+    if (i2caddr) {
+        _address = i2caddr;
+    }
+    if (periphBegin) {
+        _wire->begin();
+    }
+    // Same initialisation sequence as the Arduino driver for a 128x64 panel
+    const uint8_t init[] = {SSD1306_DISPLAYOFF, 0xD5, 0x80, 0xA8,
+                            static_cast<uint8_t>(_height - 1), 0xD3, 0x00, 0x40, 0x8D,
+                            static_cast<uint8_t>(switchvcc == SSD1306_EXTERNALVCC ? 0x10 : 0x14),
+                            SSD1306_MEMORYMODE, 0x00, 0xA1, 0xC8, 0xDA, 0x12, 0x81, 0xCF,
+                            0xD9, 0xF1, 0xDB, 0x40, 0xA4, 0xA6, 0x2E, SSD1306_DISPLAYON};
+    _wire->setClock(_clkDuring);
+    commandList(init, sizeof(init));
+    _wire->setClock(_clkAfter);
+    return true;
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+    if (_buffer) {
+        memset(_buffer, 0, _width * ((_height + 7) / 8));
+    }
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (!_buffer || x < 0 || x >= _width || y < 0 || y >= _height) {
+        return;
+    }
+    uint8_t &cell = _buffer[x + (y / 8) * _width];
+    const uint8_t bit = static_cast<uint8_t>(1 << (y & 7));
+    switch (color) {
+    case SSD1306_WHITE:
+        cell |= bit;
+        break;
+    case SSD1306_BLACK:
+        cell &= static_cast<uint8_t>(~bit);
+        break;
+    case SSD1306_INVERSE:
+        cell ^= bit;
+        break;
+    }
+}
+
+bool Adafruit_SSD1306::getPixel(int16_t x, int16_t y) const {
+    if (!_buffer || x < 0 || x >= _width || y < 0 || y >= _height) {
+        return false;
+    }
+    return (_buffer[x + (y / 8) * _width] & (1 << (y & 7))) != 0;
+}
+
+void Adafruit_SSD1306::ssd1306_command(uint8_t c) {
+    _wire->beginTransmission(_address);
+    _wire->write(static_cast<uint8_t>(0x00));  // Co = 0, D/C = 0
+    _wire->write(c);
+    _wire->endTransmission();
+}
+
+void Adafruit_SSD1306::commandList(const uint8_t *c, uint8_t n) {
+    _wire->beginTransmission(_address);
+    _wire->write(static_cast<uint8_t>(0x00));
+    size_t bytesOut = 1;
+    while (n--) {
+        if (bytesOut >= kWireChunk) {
+            _wire->endTransmission();
+            _wire->beginTransmission(_address);
+            _wire->write(static_cast<uint8_t>(0x00));
+            bytesOut = 1;
+        }
+        _wire->write(*c++);
+        ++bytesOut;
+    }
+    _wire->endTransmission();
+}
+
+void Adafruit_SSD1306::display() {
+    if (!_buffer) {
+        return;
+    }
+    const uint8_t dlist[] = {SSD1306_PAGEADDR, 0, 0xFF, SSD1306_COLUMNADDR, 0,
+                             static_cast<uint8_t>(_width - 1)};
+    _wire->setClock(_clkDuring);
+    commandList(dlist, sizeof(dlist));
+
+    size_t count = _width * ((_height + 7) / 8);
+    const uint8_t *ptr = _buffer;
+    _wire->beginTransmission(_address);
+    _wire->write(static_cast<uint8_t>(0x40));
+    size_t bytesOut = 1;
+    while (count--) {
+        if (bytesOut >= kWireChunk) {
+            _wire->endTransmission();
+            _wire->beginTransmission(_address);
+            _wire->write(static_cast<uint8_t>(0x40));
+            bytesOut = 1;
+        }
+        _wire->write(*ptr++);
+        ++bytesOut;
+    }
+    _wire->endTransmission();
+    _wire->setClock(_clkAfter);
+}
@@ -0,0 +1,54 @@
+/**
+ * @file Adafruit_SSD1306.h
+ * @brief Host stand-in for the Adafruit SSD1306 driver.
+ *
+ * Renders into a real 1-bit framebuffer and pushes it through the host
+ * TwoWire on display(), using the same command sequence and 32-byte chunking
+ * as the Arduino driver so I2C byte counts are representative.
+ */
+
+#ifndef NATIVE_ADAFRUIT_SSD1306_H
+#define NATIVE_ADAFRUIT_SSD1306_H
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_BLACK               0
+#define SSD1306_WHITE               1
+#define SSD1306_INVERSE             2
+
+#define SSD1306_EXTERNALVCC         0x01
+#define SSD1306_SWITCHCAPVCC        0x02
+
+#define SSD1306_MEMORYMODE          0x20
+#define SSD1306_COLUMNADDR          0x21
+#define SSD1306_PAGEADDR            0x22
+#define SSD1306_DISPLAYOFF          0xAE
+#define SSD1306_DISPLAYON           0xAF
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+    Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi = &Wire, int8_t rstPin = -1,
+                     uint32_t clkDuring = 400000UL, uint32_t clkAfter = 100000UL);
+    ~Adafruit_SSD1306();
+
+    bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0,
+               bool reset = true, bool periphBegin = true);
+    void display();
+    void clearDisplay();
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    bool getPixel(int16_t x, int16_t y) const;
+    uint8_t *getBuffer() { return _buffer; }
+    void ssd1306_command(uint8_t c);
+
+private:
+    void commandList(const uint8_t *c, uint8_t n);
+
+    TwoWire *_wire;
+    uint8_t *_buffer = nullptr;
+    uint8_t _address = 0x3C;
+    uint32_t _clkDuring;
+    uint32_t _clkAfter;
+};
+
+#endif // NATIVE_ADAFRUIT_SSD1306_H
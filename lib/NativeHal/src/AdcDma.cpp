@@ -0,0 +1,183 @@
+/**
+ * @file AdcDma.cpp
+ * @brief Host stand-ins for the continuous ADC driver, ADC calibration and
+ *        the analog signal shared with analogRead().
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <random>
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+
+namespace {
+
+const int kPinCount = 40;
+const double kPi = 3.14159265358979323846;
+
+/** GPIO of each ADC1 channel on the ESP32. */
+const uint8_t kAdc1Pins[8] = {36, 37, 38, 39, 32, 33, 34, 35};
+
+struct Waveform {
+    float amplitude;    ///< Peak modulation (ADC counts)
+    float frequencyHz;
+    float noise;        ///< Standard deviation of the conversion noise (counts)
+};
+
+Waveform s_waveforms[kPinCount] = {};
+std::mt19937 s_rng(12345);
+uint32_t s_efuseVref = 1114;
+
+// Continuous driver state
+bool s_initialized = false;
+bool s_running = false;
+uint32_t s_storeFrames = 0;
+uint32_t s_sampleRate = 0;
+uint8_t s_channel = 0;
+uint64_t s_startMicros = 0;
+uint64_t s_produced = 0;   ///< Conversions delivered or dropped since start
+uint64_t s_conversions = 0;
+uint64_t s_dropped = 0;
+
+uint64_t dueConversions() {
+    return (hal::nowMicros() - s_startMicros) * s_sampleRate / 1000000ULL;
+}
+
+} // namespace
+
+namespace hal {
+
+void setAnalogWaveform(uint8_t pin, float amplitude, float frequencyHz, float noise) {
+    if (pin < kPinCount) {
+        s_waveforms[pin] = Waveform{amplitude, frequencyHz, noise};
+    }
+}
+
+void setAdcEfuseVref(uint32_t mv) { s_efuseVref = mv; }
+
+uint64_t adcConversions() { return s_conversions; }
+
+uint64_t adcDroppedConversions() { return s_dropped; }
+
+} // namespace hal
+
+int hal::detail::analogSample(uint8_t pin, int level, uint64_t atMicros) {
+    if (pin >= kPinCount) {
+        return 0;
+    }
+    const Waveform &w = s_waveforms[pin];
+    double value = level;
+    if (w.amplitude != 0.0f) {
+        value += w.amplitude * sin(2.0 * kPi * w.frequencyHz * (atMicros / 1e6));
+    }
+    if (w.noise > 0.0f) {
+        std::normal_distribution<double> noise(0.0, w.noise);
+        value += noise(s_rng);
+    }
+    const long rounded = lround(value);
+    return rounded < 0 ? 0 : rounded > 4095 ? 4095 : static_cast<int>(rounded);
+}
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *init_config) {
+    if (init_config == nullptr || init_config->max_store_buf_size < ADC_RESULT_BYTE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_storeFrames = init_config->max_store_buf_size / ADC_RESULT_BYTE;
+    s_initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config) {
+    if (!s_initialized || config == nullptr || config->pattern_num != 1 ||
+        config->adc_pattern[0].unit != 0 || config->adc_pattern[0].channel >= 8 ||
+        config->sample_freq_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW ||
+        config->sample_freq_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_channel = config->adc_pattern[0].channel;
+    s_sampleRate = config->sample_freq_hz;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_start(void) {
+    if (!s_initialized || s_sampleRate == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_running = true;
+    s_startMicros = hal::nowMicros();
+    s_produced = 0;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_stop(void) {
+    s_running = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max, uint32_t *out_length,
+                              uint32_t timeout_ms) {
+    *out_length = 0;
+    if (!s_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const uint32_t wanted = length_max / ADC_RESULT_BYTE;
+    uint64_t pending = dueConversions() - s_produced;
+    if (pending < wanted) {
+        // Block until the DMA delivered enough, or the timeout expires
+        const uint64_t waitUs = ((wanted - pending) * 1000000ULL + s_sampleRate - 1) / s_sampleRate;
+        const uint64_t timeoutUs = static_cast<uint64_t>(timeout_ms) * 1000ULL;
+        hal::advanceMicros(waitUs < timeoutUs ? waitUs : timeoutUs);
+        pending = dueConversions() - s_produced;
+    }
+    if (pending > s_storeFrames) {
+        // The store buffer filled up: later conversions were lost
+        s_dropped += pending - s_storeFrames;
+    }
+    const uint64_t available = pending < s_storeFrames ? pending : s_storeFrames;
+    const uint32_t count = static_cast<uint32_t>(available < wanted ? available : wanted);
+    const uint8_t pin = kAdc1Pins[s_channel];
+    const int level = hal::detail::analogLevel(pin);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint64_t at = s_startMicros + (s_produced + i) * 1000000ULL / s_sampleRate;
+        adc_digi_output_data_t frame;
+        frame.val = 0;
+        frame.type1.data = static_cast<uint16_t>(hal::detail::analogSample(pin, level, at));
+        frame.type1.channel = s_channel;
+        memcpy(buf + i * ADC_RESULT_BYTE, &frame, ADC_RESULT_BYTE);
+    }
+    s_conversions += count;
+    s_produced += pending > s_storeFrames ? pending : count;
+    *out_length = count * ADC_RESULT_BYTE;
+    return count > 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t adc_digi_deinitialize(void) {
+    s_running = false;
+    s_initialized = false;
+    return ESP_OK;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten,
+                                             adc_bits_width_t bit_width, uint32_t default_vref,
+                                             esp_adc_cal_characteristics_t *chars) {
+    memset(chars, 0, sizeof(*chars));
+    chars->adc_num = adc_num;
+    chars->atten = atten;
+    chars->bit_width = bit_width;
+    chars->vref = s_efuseVref != 0 ? s_efuseVref : default_vref;
+    // Full-scale input per attenuation, in multiples of Vref (x1000)
+    static const uint32_t kScale[4] = {1000, 1334, 1995, 3550};
+    chars->coeff_a = static_cast<uint32_t>((static_cast<uint64_t>(chars->vref) *
+                                            kScale[atten & 3] * 65536ULL) / (1000ULL * 4095ULL));
+    chars->coeff_b = atten == ADC_ATTEN_DB_11 ? 142 : 75;
+    return s_efuseVref != 0 ? ESP_ADC_CAL_VAL_EFUSE_VREF : ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading,
+                                    const esp_adc_cal_characteristics_t *chars) {
+    return ((chars->coeff_a * adc_reading) + 32768) / 65536 + chars->coeff_b;
+}
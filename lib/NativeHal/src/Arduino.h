@@ -0,0 +1,92 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the subset of the Arduino core used by the firmware.
+ *
+ * Time is virtual (see NativeHal.h): delay() advances the clock instead of
+ * sleeping, which lets host programs run firmware logic faster than real time.
+ */
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Esp.h"
+#include "esp_attr.h"
+#include "Print.h"
+#include "WString.h"
+
+#define HIGH    0x1
+#define LOW     0x0
+
+#define INPUT           0x01
+#define OUTPUT          0x03
+#define INPUT_PULLUP    0x05
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// Sketch entry points, called by the host program that runs the firmware
+void setup();
+void loop();
+
+// Timing
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+/**
+ * Start SNTP. The host has no server: the system clock behind time() is set
+ * at once (see hal::setWallClock()) and follows the virtual clock.
+ */
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char *server1,
+                const char *server2 = nullptr, const char *server3 = nullptr);
+
+// GPIO / ADC
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+
+// Random numbers (deterministic on the host)
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+// AVR libc helpers provided by the ESP32 core
+char *dtostrf(double val, signed char width, unsigned char prec, char *sout);
+char *itoa(int value, char *str, int base);
+char *ltoa(long value, char *str, int base);
+char *ultoa(unsigned long value, char *str, int base);
+
+/**
+ * Host serial port; output goes to stdout. After begin() writes are paced
+ * like the UART: bytes leave the 128-byte TX FIFO at the baud rate in
+ * virtual time, and a write that does not fit advances the clock until it
+ * does, as the blocking driver would. end() turns pacing off again.
+ */
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud);
+    void end();
+    int available() { return 0; }
+    int read() { return -1; }
+    int availableForWrite() override;
+    void flush();
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,159 @@
+/**
+ * @file DHT.cpp
+ * @brief Implementation of the host DHT stand-in and the simulated sensor
+ *        behind it.
+ */
+
+#include "DHT.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+
+namespace {
+
+float s_temperature = 22.0f;
+float s_humidity = 45.0f;
+uint8_t s_type = DHT11;
+uint16_t s_capture[hal::detail::kDhtMaxPulses];
+size_t s_captureLength = 0;
+uint32_t s_jitter = 1;
+hal::DHTBusStats s_stats = {0, 0, 0};
+
+// Datasheet timing (us)
+const uint16_t kResponseLow = 80;
+const uint16_t kResponseHigh = 80;
+const uint16_t kBitLow = 50;
+const uint16_t kZeroHigh = 26;
+const uint16_t kOneHigh = 70;
+const uint32_t kPullTime = 55;             ///< Adafruit waits this long after release
+const uint32_t kAdafruitTimeout = 1000;    ///< Per-pulse timeout of expectPulse()
+const uint32_t kAverageFrame = kResponseLow + kResponseHigh + 40 * (kBitLow + 48) + kBitLow;
+
+bool isDht11Family(uint8_t type) { return type == DHT11 || type == DHT12; }
+
+uint64_t minStartLow(uint8_t type) { return isDht11Family(type) ? 18000 : 800; }
+
+/** Small deterministic timing spread, as seen on real sensors. */
+uint16_t jitter(uint16_t us) {
+    s_jitter = s_jitter * 1103515245u + 12345u;
+    return static_cast<uint16_t>(us + ((s_jitter >> 16) % 7) - 3);
+}
+
+void encode(uint8_t data[5]) {
+    const long t = lroundf(s_temperature * 10.0f);
+    const long h = lroundf(s_humidity * 10.0f);
+    if (isDht11Family(s_type)) {
+        data[0] = static_cast<uint8_t>(h / 10);
+        data[1] = static_cast<uint8_t>(h % 10);
+        if (t >= 0) {
+            data[2] = static_cast<uint8_t>(t / 10);
+            data[3] = static_cast<uint8_t>(t % 10);
+        } else {
+            // Integer part is -1 - data[2], plus the positive tenths
+            const long whole = (t - 9) / 10;
+            data[2] = static_cast<uint8_t>(-1 - whole);
+            data[3] = static_cast<uint8_t>((t - whole * 10) | 0x80);
+        }
+    } else {
+        const long magnitude = t < 0 ? -t : t;
+        data[0] = static_cast<uint8_t>(h >> 8);
+        data[1] = static_cast<uint8_t>(h);
+        data[2] = static_cast<uint8_t>((magnitude >> 8) | (t < 0 ? 0x80 : 0));
+        data[3] = static_cast<uint8_t>(magnitude);
+    }
+    data[4] = static_cast<uint8_t>(data[0] + data[1] + data[2] + data[3]);
+}
+
+} // namespace
+
+namespace hal {
+
+void setDHTReading(float temperature, float humidity) {
+    s_temperature = temperature;
+    s_humidity = humidity;
+}
+
+void setDHTType(uint8_t type) { s_type = type; }
+
+void setDHTCapture(const uint16_t *durations, size_t count) {
+    s_captureLength = count < detail::kDhtMaxPulses ? count : detail::kDhtMaxPulses;
+    memcpy(s_capture, durations, s_captureLength * sizeof(uint16_t));
+}
+
+const DHTBusStats &dhtBusStats() { return s_stats; }
+
+void detail::resetDhtStats() { s_stats = DHTBusStats{0, 0, 0}; }
+
+size_t detail::dhtAnswer(uint64_t startLowMicros, uint16_t *durations, size_t max) {
+    if (s_captureLength > 0) {
+        const size_t n = s_captureLength < max ? s_captureLength : max;
+        memcpy(durations, s_capture, n * sizeof(uint16_t));
+        s_captureLength = 0;
+        return n;
+    }
+    if (startLowMicros < minStartLow(s_type) || isnan(s_temperature) || isnan(s_humidity) ||
+        max < 83) {
+        return 0;
+    }
+    uint8_t data[5];
+    encode(data);
+    size_t n = 0;
+    durations[n++] = jitter(kResponseLow);
+    durations[n++] = jitter(kResponseHigh);
+    for (int bit = 0; bit < 40; ++bit) {
+        durations[n++] = jitter(kBitLow);
+        durations[n++] = jitter((data[bit / 8] >> (7 - bit % 8)) & 1 ? kOneHigh : kZeroHigh);
+    }
+    durations[n++] = jitter(kBitLow);
+    return n;
+}
+
+} // namespace hal
+
+DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) : _pin(pin), _type(type) { (void)count; }
+
+void DHT::begin(uint8_t usec) { (void)usec; }
+
+float DHT::readTemperature(bool fahrenheit, bool force) {
+    if (!read(force)) {
+        return NAN;
+    }
+    return fahrenheit ? s_temperature * 1.8f + 32.0f : s_temperature;
+}
+
+float DHT::readHumidity(bool force) {
+    if (!read(force)) {
+        return NAN;
+    }
+    return s_humidity;
+}
+
+bool DHT::read(bool force) {
+    const unsigned long now = millis();
+    if (!force && _hasRead && now - _lastReadMs < 2000) {
+        return _lastResult;
+    }
+    _hasRead = true;
+    // Start pulse: delay() for the DHT11 family, delayMicroseconds() (a
+    // busy wait) for the others
+    const bool dht11 = isDht11Family(_type);
+    delay(1);
+    if (dht11) {
+        delay(20);
+    } else {
+        delayMicroseconds(1100);
+        s_stats.busyWaitMicros += 1100;
+    }
+    // Release, then time the pulse train with interrupts disabled
+    _lastResult = !isnan(s_temperature) && !isnan(s_humidity);
+    const uint32_t irqOff = kPullTime + (_lastResult ? kAverageFrame : kAdafruitTimeout);
+    hal::advanceMicros(irqOff);
+    s_stats.busyWaitMicros += irqOff;
+    s_stats.irqOffMicros += irqOff;
+    ++s_stats.transfers;
+    _lastReadMs = millis();
+    return _lastResult;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file DHT.h
+ * @brief Host stand-in for the Adafruit DHT sensor library.
+ *
+ * Readings are injected with hal::setDHTReading(). Like the real driver, a
+ * read within two seconds of the previous one returns the cached result.
+ * Otherwise the virtual clock advances by the start pulse and the pulse
+ * train, and the time the real driver spends spinning on the data line
+ * (with interrupts disabled for the pulse train) is added to
+ * hal::dhtBusStats().
+ */
+
+#ifndef NATIVE_DHT_H
+#define NATIVE_DHT_H
+
+#include <Arduino.h>
+
+#define DHT11 11
+#define DHT12 12
+#define DHT21 21
+#define DHT22 22
+
+class DHT {
+public:
+    DHT(uint8_t pin, uint8_t type, uint8_t count = 6);
+    void begin(uint8_t usec = 55);
+    float readTemperature(bool fahrenheit = false, bool force = false);
+    float readHumidity(bool force = false);
+    bool read(bool force = false);
+
+private:
+    uint8_t _pin;
+    uint8_t _type;
+    bool _hasRead = false;
+    bool _lastResult = false;
+    unsigned long _lastReadMs = 0;
+};
+
+#endif // NATIVE_DHT_H
@@ -0,0 +1,47 @@
+/**
+ * @file Esp.cpp
+ * @brief Implementation of the host EspClass stand-in.
+ */
+
+#include "Esp.h"
+
+#include <stdlib.h>
+
+#include "NativeHal.h"
+
+EspClass ESP;
+
+namespace {
+
+uint32_t s_heapSize = 327680;
+uint32_t s_freeHeap = 250000;
+uint32_t s_largestBlock = 110592;
+uint32_t s_minFreeHeap = 250000;
+
+} // namespace
+
+namespace hal {
+
+void setHeapStats(uint32_t freeBytes, uint32_t largestFreeBlock) {
+    s_freeHeap = freeBytes;
+    s_largestBlock = largestFreeBlock;
+    if (freeBytes < s_minFreeHeap) {
+        s_minFreeHeap = freeBytes;
+    }
+}
+
+} // namespace hal
+
+uint32_t EspClass::getHeapSize() { return s_heapSize; }
+
+uint32_t EspClass::getFreeHeap() { return s_freeHeap; }
+
+uint32_t EspClass::getMinFreeHeap() { return s_minFreeHeap; }
+
+uint32_t EspClass::getMaxAllocHeap() { return s_largestBlock; }
+
+uint32_t EspClass::getCycleCount() {
+    return static_cast<uint32_t>(hal::nowMicros() * getCpuFreqMHz());
+}
+
+void EspClass::restart() { exit(0); }
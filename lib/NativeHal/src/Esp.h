@@ -0,0 +1,30 @@
+/**
+ * @file Esp.h
+ * @brief Host stand-in for the ESP32 core's EspClass (the ESP object).
+ *
+ * Heap figures are simulated: they come from hal::setHeapStats() and the
+ * minimum is tracked across reads, as on the device. The cycle counter
+ * runs at getCpuFreqMHz() on the virtual clock.
+ */
+
+#ifndef NATIVE_ESP_H
+#define NATIVE_ESP_H
+
+#include <stdint.h>
+
+class EspClass {
+public:
+    uint32_t getHeapSize();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 240; }
+    /** Factory MAC address, fixed on the host. */
+    uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+    void restart();
+};
+
+extern EspClass ESP;
+
+#endif // NATIVE_ESP_H
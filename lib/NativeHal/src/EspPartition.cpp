@@ -0,0 +1,78 @@
+/**
+ * @file EspPartition.cpp
+ * @brief Implementation of the host partition stand-in.
+ */
+
+#include "esp_partition.h"
+
+#include <string.h>
+
+#include <vector>
+
+namespace {
+
+/** Data partitions of partitions.csv. */
+const esp_partition_t kPartitions[] = {
+    {ESP_PARTITION_TYPE_DATA, 0x40, 0x290000, 0x160000, "datalog", false},
+};
+const size_t kPartitionCount = sizeof(kPartitions) / sizeof(kPartitions[0]);
+
+/** Contents of each partition, allocated (erased) on first use. */
+std::vector<uint8_t> s_contents[kPartitionCount];
+
+std::vector<uint8_t> *contents(const esp_partition_t *partition, size_t offset, size_t size) {
+    if (partition == nullptr || offset > partition->size || size > partition->size - offset) {
+        return nullptr;
+    }
+    std::vector<uint8_t> &image = s_contents[partition - kPartitions];
+    if (image.empty()) {
+        image.assign(partition->size, 0xFF);
+    }
+    return &image;
+}
+
+} // namespace
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, uint8_t subtype,
+                                                const char *label) {
+    for (const esp_partition_t &p : kPartitions) {
+        if (p.type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || p.subtype == subtype) &&
+            (label == nullptr || strcmp(label, p.label) == 0)) {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst,
+                             size_t size) {
+    std::vector<uint8_t> *image = contents(partition, src_offset, size);
+    if (image == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, image->data() + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset,
+                              const void *src, size_t size) {
+    std::vector<uint8_t> *image = contents(partition, dst_offset, size);
+    if (image == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(src);
+    for (size_t i = 0; i < size; ++i) {
+        (*image)[dst_offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset,
+                                    size_t size) {
+    std::vector<uint8_t> *image = contents(partition, offset, size);
+    if (image == nullptr || offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(image->data() + offset, 0xFF, size);
+    return ESP_OK;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file EspSleep.cpp
+ * @brief Implementation of the host sleep stand-ins.
+ */
+
+#include "esp_sleep.h"
+
+#include "NativeHal.h"
+
+namespace {
+
+uint64_t s_timerUs = 0;
+uint32_t s_lightSleeps = 0;
+uint32_t s_deepSleeps = 0;
+uint64_t s_sleptUs = 0;
+
+} // namespace
+
+namespace hal {
+
+uint32_t lightSleepCount() { return s_lightSleeps; }
+
+uint32_t deepSleepCount() { return s_deepSleeps; }
+
+uint64_t sleptMicros() { return s_sleptUs; }
+
+} // namespace hal
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+    s_timerUs = time_in_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start() {
+    ++s_lightSleeps;
+    s_sleptUs += s_timerUs;
+    hal::advanceMicros(s_timerUs);
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+    ++s_deepSleeps;
+    s_sleptUs += s_timerUs;
+    hal::setMillis(0);
+}
@@ -0,0 +1,112 @@
+/**
+ * @file FileFlash.cpp
+ * @brief Implementation of the host flash stand-in.
+ */
+
+#include "FileFlash.h"
+
+#include <algorithm>
+#include <string.h>
+
+FileFlash::FileFlash(const std::string &path, size_t sectorCount, size_t sectorSize)
+    : _file(nullptr), _sectorCount(sectorCount), _sectorSize(sectorSize),
+      _image(sectorCount * sectorSize, 0xFF), _eraseCounts(sectorCount, 0),
+      _bytesWritten(0), _cutArmed(false), _cutBudget(0), _powerLost(false) {
+    _file = fopen(path.c_str(), "r+b");
+    bool fresh = true;
+    if (_file) {
+        fseek(_file, 0, SEEK_END);
+        if (static_cast<size_t>(ftell(_file)) == _image.size()) {
+            fseek(_file, 0, SEEK_SET);
+            fresh = fread(_image.data(), 1, _image.size(), _file) != _image.size();
+        }
+        if (fresh) {
+            fclose(_file);
+            _file = nullptr;
+        }
+    }
+    if (fresh) {
+        std::fill(_image.begin(), _image.end(), 0xFF);
+        _file = fopen(path.c_str(), "w+b");
+        flush(0, _image.size());
+    }
+}
+
+FileFlash::~FileFlash() {
+    if (_file) {
+        fclose(_file);
+    }
+}
+
+bool FileFlash::flush(size_t offset, size_t length) {
+    if (!_file) {
+        return false;
+    }
+    fseek(_file, static_cast<long>(offset), SEEK_SET);
+    const bool ok = fwrite(_image.data() + offset, 1, length, _file) == length;
+    fflush(_file);
+    return ok;
+}
+
+bool FileFlash::read(size_t offset, void *buffer, size_t length) {
+    if (offset + length > _image.size()) {
+        return false;
+    }
+    memcpy(buffer, _image.data() + offset, length);
+    return true;
+}
+
+bool FileFlash::write(size_t offset, const void *buffer, size_t length) {
+    if (_powerLost || offset + length > _image.size()) {
+        return false;
+    }
+    size_t applied = length;
+    if (_cutArmed && length > _cutBudget) {
+        applied = _cutBudget;
+        _powerLost = true;
+        _cutArmed = false;
+    } else if (_cutArmed) {
+        _cutBudget -= length;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(buffer);
+    for (size_t i = 0; i < applied; ++i) {
+        _image[offset + i] &= bytes[i];   // programming can only clear bits
+    }
+    _bytesWritten += applied;
+    flush(offset, applied);
+    return applied == length;
+}
+
+bool FileFlash::eraseSector(size_t sector) {
+    if (_powerLost || sector >= _sectorCount) {
+        return false;
+    }
+    size_t length = _sectorSize;
+    if (_cutArmed && _cutBudget == 0) {
+        length = _sectorSize / 2;
+        _powerLost = true;
+        _cutArmed = false;
+    }
+    memset(_image.data() + sector * _sectorSize, 0xFF, length);
+    ++_eraseCounts[sector];
+    flush(sector * _sectorSize, length);
+    return !_powerLost;
+}
+
+void FileFlash::cutPowerAfter(size_t bytes) {
+    _cutArmed = true;
+    _cutBudget = bytes;
+}
+
+void FileFlash::powerCycle() {
+    _cutArmed = false;
+    _powerLost = false;
+}
+
+uint32_t FileFlash::maxEraseCount() const {
+    return *std::max_element(_eraseCounts.begin(), _eraseCounts.end());
+}
+
+uint32_t FileFlash::minEraseCount() const {
+    return *std::min_element(_eraseCounts.begin(), _eraseCounts.end());
+}
@@ -0,0 +1,66 @@
+/**
+ * @file FileFlash.h
+ * @brief Host stand-in for a flash partition, backed by a regular file.
+ *
+ * Implements NOR semantics (erase to 0xFF, writes can only clear bits) so
+ * FlashLog behaves on the host exactly as on the ESP32. The file survives
+ * the process, and a power cut can be injected after a given number of
+ * programmed bytes to test recovery.
+ */
+
+#ifndef NATIVE_FILE_FLASH_H
+#define NATIVE_FILE_FLASH_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "storage/FlashStorage.h"
+
+class FileFlash : public FlashStorage {
+public:
+    /**
+     * Open @p path, creating an erased image of @p sectorCount sectors if
+     * it does not exist yet or has a different size.
+     */
+    FileFlash(const std::string &path, size_t sectorCount, size_t sectorSize = 4096);
+    ~FileFlash() override;
+
+    size_t sectorSize() const override { return _sectorSize; }
+    size_t sectorCount() const override { return _sectorCount; }
+    bool read(size_t offset, void *buffer, size_t length) override;
+    bool write(size_t offset, const void *buffer, size_t length) override;
+    bool eraseSector(size_t sector) override;
+
+    /**
+     * Cut power once @p bytes more bytes have been programmed: the write
+     * in progress is applied only partially and every later write or erase
+     * fails until powerCycle(). An erase hit by the cut is left half done.
+     */
+    void cutPowerAfter(size_t bytes);
+    /** Restore power. */
+    void powerCycle();
+    /** @return true once an injected power cut has happened. */
+    bool powerLost() const { return _powerLost; }
+
+    /** @return Erase count of the most and least worn sector. */
+    uint32_t maxEraseCount() const;
+    uint32_t minEraseCount() const;
+    /** @return Bytes programmed since construction. */
+    uint64_t bytesWritten() const { return _bytesWritten; }
+
+private:
+    bool flush(size_t offset, size_t length);
+
+    FILE *_file;
+    size_t _sectorCount;
+    size_t _sectorSize;
+    std::vector<uint8_t> _image;          ///< Contents mirrored in memory
+    std::vector<uint32_t> _eraseCounts;   ///< Erases per sector
+    uint64_t _bytesWritten;
+    bool _cutArmed;
+    size_t _cutBudget;                    ///< Bytes left before the cut
+    bool _powerLost;
+};
+
+#endif // NATIVE_FILE_FLASH_H
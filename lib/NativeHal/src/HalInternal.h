@@ -0,0 +1,105 @@
+/**
+ * @file HalInternal.h
+ * @brief Hooks shared between the host stand-ins; not for firmware code.
+ */
+
+#ifndef NATIVE_HAL_INTERNAL_H
+#define NATIVE_HAL_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hal {
+namespace detail {
+
+void resetHttpStats();
+void resetMqttStats();
+void resetI2cStats();
+void resetDhtStats();
+
+/** TCP/IP header bytes per segment, and segments to open and close a connection. */
+const unsigned kTcpIpHeaderBytes = 40;
+const unsigned kTcpMss = 1460;
+const unsigned kTcpSetupSegments = 4;   // SYN, ACK, FIN, ACK
+
+/** Estimated TCP/IP bytes to send @p payload bytes. */
+inline unsigned long tcpWireBytes(unsigned long payload) {
+    return payload + ((payload + kTcpMss - 1) / kTcpMss) * kTcpIpHeaderBytes;
+}
+
+/** Idle time after which the HTTP server closes a keep-alive connection. */
+const unsigned long kHttpKeepAliveMs = 5000;
+
+/** Account a new TCP connection to the HTTP server. */
+void httpConnected();
+
+/**
+ * Account one complete HTTP request of @p requestBytes and let the server
+ * latency elapse, but no longer than @p timeoutMs.
+ *
+ * @return Response status code, or 0 if the client timed out first
+ */
+int httpServe(size_t requestBytes, unsigned long timeoutMs);
+
+/**
+ * Loopback sockets behind WiFiServer and the clients it accepts
+ * (WiFiServer.cpp). Reads and the state checks never block; writes block
+ * until everything is sent or the peer is gone.
+ */
+bool socketConnected(int socket);
+int socketAvailable(int socket);
+int socketRead(int socket, uint8_t *buffer, size_t size);
+size_t socketWrite(int socket, const uint8_t *buffer, size_t size);
+void socketNoDelay(int socket, bool noDelay);
+void socketClose(int socket);
+
+/**
+ * Connections to the MQTT broker stand-in (MqttBroker.cpp), by handle.
+ * Writes take whole packets as the broker would; replies become readable
+ * once their latency has elapsed on the virtual clock. A handle the broker
+ * has closed reads as disconnected.
+ *
+ * @return mqttOpen(): a handle, or -1 if the broker is unavailable
+ */
+int mqttOpen();
+bool mqttConnected(int handle);
+size_t mqttWrite(int handle, const uint8_t *data, size_t size);
+int mqttAvailable(int handle);
+int mqttRead(int handle, uint8_t *buffer, size_t size);
+void mqttClose(int handle);
+
+/** Let a network request take @p ms (virtual and optionally real time). */
+void networkDelay(unsigned long ms);
+
+/** Hand a completed I2C write transaction to the simulated devices. */
+void i2cReceive(uint8_t address, const uint8_t *data, size_t length);
+
+/** Level set with hal::setAnalogValue() for @p pin. */
+int analogLevel(uint8_t pin);
+
+/**
+ * One conversion of @p pin at @p atMicros: @p level plus the waveform and
+ * noise set with hal::setAnalogWaveform(), clipped to 12 bits.
+ */
+int analogSample(uint8_t pin, int level, uint64_t atMicros);
+
+/** Longest pulse train the simulated DHT returns. */
+const size_t kDhtMaxPulses = 128;
+
+/**
+ * Answer of the simulated DHT to a start pulse held low for
+ * @p startLowMicros: alternating low/high durations in microseconds, from
+ * the response low to the final low. A capture set with
+ * hal::setDHTCapture() is returned (once) instead of the encoded reading.
+ *
+ * @return Number of durations, 0 if the sensor does not answer
+ */
+size_t dhtAnswer(uint64_t startLowMicros, uint16_t *durations, size_t max);
+
+/** Raise any peripheral events that became due on the virtual clock. */
+void onClockAdvanced();
+
+} // namespace detail
+} // namespace hal
+
+#endif // NATIVE_HAL_INTERNAL_H
@@ -0,0 +1,49 @@
+/**
+ * @file HttpServer.cpp
+ * @brief Simulated HTTP server behind the host WiFiClient.
+ *
+ * WiFiClient hands every complete request to httpServe(), which accounts
+ * the traffic and lets the configured latency elapse before the response
+ * becomes readable.
+ */
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+
+namespace {
+
+int s_responseCode = 200;
+unsigned long s_latency = 0;
+hal::NetStats s_stats = {0, 0, 0, 0};
+
+} // namespace
+
+namespace hal {
+
+void setHttpResponse(int code) { s_responseCode = code; }
+
+void setHttpLatency(unsigned long ms) { s_latency = ms; }
+
+const NetStats &httpStats() { return s_stats; }
+
+} // namespace hal
+
+void hal::detail::resetHttpStats() { s_stats = hal::NetStats{0, 0, 0, 0}; }
+
+void hal::detail::httpConnected() {
+    ++s_stats.connects;
+    s_stats.wireBytes += kTcpSetupSegments * kTcpIpHeaderBytes;
+}
+
+int hal::detail::httpServe(size_t requestBytes, unsigned long timeoutMs) {
+    ++s_stats.requests;
+    s_stats.bytesSent += requestBytes;
+    s_stats.wireBytes += tcpWireBytes(requestBytes);
+    if (s_latency > timeoutMs) {
+        // The client gives up before the server answers
+        networkDelay(timeoutMs);
+        return 0;
+    }
+    networkDelay(s_latency);
+    return s_responseCode;
+}
@@ -0,0 +1,322 @@
+/**
+ * @file MqttBroker.cpp
+ * @brief MQTT broker stand-in behind WiFiClient connections to port 1883.
+ *
+ * Speaks enough MQTT 3.1.1 for a telemetry client: CONNECT (with persistent
+ * sessions remembered by client ID), PUBLISH at QoS 0 and 1, SUBSCRIBE,
+ * PINGREQ and DISCONNECT. Replies become readable hal::setMqttLatency()
+ * after the packet they answer, on the virtual clock. Like a real broker
+ * it drops a client that stays silent for 1.5 times its keep-alive.
+ */
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+const size_t kConnections = 8;
+const size_t kPacketMax = 2048;   ///< Larger packets are counted and discarded
+const size_t kReplies = 32;       ///< Replies queued per connection
+const size_t kSessions = 8;       ///< Persistent sessions remembered
+const size_t kClientIdMax = 64;
+
+struct Reply {
+    uint64_t dueMicros;
+    uint8_t bytes[5];
+    uint8_t length;
+};
+
+struct Connection {
+    int handle;                 ///< 0 while the slot is free
+    bool connected;             ///< CONNECT accepted
+    uint16_t keepAliveS;
+    uint64_t lastPacketMicros;  ///< Last packet received
+    uint8_t in[kPacketMax];
+    size_t inLength;
+    size_t discard;             ///< Bytes of an oversized packet still to skip
+    Reply replies[kReplies];
+    size_t replyHead;
+    size_t replyCount;
+    size_t replyPos;            ///< Bytes of the oldest reply already read
+};
+
+bool s_available = true;
+unsigned long s_latency = 0;
+float s_loss = 0.0f;
+uint32_t s_lossState = 1;
+hal::NetStats s_stats = {0, 0, 0, 0};
+hal::MqttPublishHook s_hook = nullptr;
+Connection s_connections[kConnections];
+int s_lastHandle = 0;
+char s_sessions[kSessions][kClientIdMax];
+size_t s_nextSession = 0;
+
+/** Deterministic loss decision (xorshift32). */
+bool lost() {
+    if (s_loss <= 0.0f) {
+        return false;
+    }
+    s_lossState ^= s_lossState << 13;
+    s_lossState ^= s_lossState >> 17;
+    s_lossState ^= s_lossState << 5;
+    return static_cast<float>(s_lossState >> 8) / 16777216.0f < s_loss;
+}
+
+Connection *find(int handle) {
+    for (Connection &c : s_connections) {
+        if (handle > 0 && c.handle == handle) {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+/** The connection behind @p handle, unless the broker has closed it. */
+Connection *live(int handle) {
+    Connection *c = find(handle);
+    if (!c) {
+        return nullptr;
+    }
+    const uint64_t now = hal::nowMicros();
+    if (!s_available || (c->connected && c->keepAliveS > 0 &&
+                         now - c->lastPacketMicros > c->keepAliveS * 1500000ULL)) {
+        c->handle = 0;
+        return nullptr;
+    }
+    return c;
+}
+
+void reply(Connection &c, const uint8_t *bytes, uint8_t length) {
+    if (lost() || c.replyCount == kReplies) {
+        return;
+    }
+    Reply &r = c.replies[(c.replyHead + c.replyCount++) % kReplies];
+    r.dueMicros = hal::nowMicros() + s_latency * 1000ULL;
+    memcpy(r.bytes, bytes, length);
+    r.length = length;
+}
+
+/** Remember or forget the persistent session of @p clientId. @return it existed */
+bool session(const char *clientId, bool clean) {
+    for (char *id : s_sessions) {
+        if (strcmp(id, clientId) == 0) {
+            if (clean) {
+                id[0] = '\0';
+            }
+            return !clean;
+        }
+    }
+    if (!clean) {
+        snprintf(s_sessions[s_nextSession], kClientIdMax, "%s", clientId);
+        s_nextSession = (s_nextSession + 1) % kSessions;
+    }
+    return false;
+}
+
+uint16_t readU16(const uint8_t *p) { return static_cast<uint16_t>(p[0] << 8 | p[1]); }
+
+void receive(Connection &c, uint8_t type, uint8_t flags, const uint8_t *body, size_t length) {
+    switch (type) {
+    case 1: {   // CONNECT: protocol name, level, flags, keep-alive, client ID
+        if (length < 12) {
+            return;
+        }
+        const uint8_t connectFlags = body[7];
+        const size_t idLength = readU16(body + 10);
+        char clientId[kClientIdMax] = {0};
+        memcpy(clientId, body + 12,
+               idLength < kClientIdMax - 1 && 12 + idLength <= length ? idLength : 0);
+        c.connected = true;
+        c.keepAliveS = readU16(body + 8);
+        ++s_stats.connects;
+        const bool present = session(clientId, connectFlags & 0x02);
+        const uint8_t connack[4] = {0x20, 0x02, static_cast<uint8_t>(present ? 1 : 0), 0x00};
+        reply(c, connack, sizeof(connack));
+        break;
+    }
+    case 3: {   // PUBLISH
+        const uint8_t qos = (flags >> 1) & 0x03;
+        if (!c.connected || length < 2) {
+            return;
+        }
+        const size_t topicLength = readU16(body);
+        size_t offset = 2 + topicLength + (qos > 0 ? 2 : 0);
+        if (offset > length) {
+            return;
+        }
+        char topic[128] = {0};
+        memcpy(topic, body + 2, topicLength < sizeof(topic) - 1 ? topicLength : 0);
+        ++s_stats.requests;
+        s_stats.bytesSent += topicLength + (length - offset);
+        if (s_hook) {
+            s_hook(topic, body + offset, length - offset);
+        }
+        if (qos == 1) {
+            const uint8_t puback[4] = {0x40, 0x02, body[2 + topicLength],
+                                       body[3 + topicLength]};
+            reply(c, puback, sizeof(puback));
+        }
+        break;
+    }
+    case 8: {   // SUBSCRIBE: granted at QoS 0, nothing is forwarded
+        if (length >= 2) {
+            const uint8_t suback[5] = {0x90, 0x03, body[0], body[1], 0x00};
+            reply(c, suback, sizeof(suback));
+        }
+        break;
+    }
+    case 12: {  // PINGREQ
+        const uint8_t pingresp[2] = {0xD0, 0x00};
+        reply(c, pingresp, sizeof(pingresp));
+        break;
+    }
+    case 14:    // DISCONNECT
+        c.handle = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace
+
+namespace hal {
+
+void setMqttAvailable(bool available) { s_available = available; }
+
+void setMqttLatency(unsigned long ms) { s_latency = ms; }
+
+void setMqttPacketLoss(float probability) {
+    s_loss = probability;
+    s_lossState = 0x9E3779B9u;
+}
+
+const NetStats &mqttStats() { return s_stats; }
+
+void setMqttPublishHook(MqttPublishHook hook) { s_hook = hook; }
+
+} // namespace hal
+
+void hal::detail::resetMqttStats() { s_stats = hal::NetStats{0, 0, 0, 0}; }
+
+int hal::detail::mqttOpen() {
+    if (!s_available) {
+        return -1;
+    }
+    // Reuse a closed slot, or the connection silent the longest
+    Connection *slot = &s_connections[0];
+    for (Connection &c : s_connections) {
+        if (c.handle == 0) {
+            slot = &c;
+            break;
+        }
+        if (c.lastPacketMicros < slot->lastPacketMicros) {
+            slot = &c;
+        }
+    }
+    slot->handle = ++s_lastHandle;
+    slot->connected = false;
+    slot->keepAliveS = 0;
+    slot->lastPacketMicros = hal::nowMicros();
+    slot->inLength = 0;
+    slot->discard = 0;
+    slot->replyHead = slot->replyCount = slot->replyPos = 0;
+    s_stats.wireBytes += kTcpSetupSegments * kTcpIpHeaderBytes;
+    return slot->handle;
+}
+
+bool hal::detail::mqttConnected(int handle) { return live(handle) != nullptr; }
+
+size_t hal::detail::mqttWrite(int handle, const uint8_t *data, size_t size) {
+    Connection *c = live(handle);
+    if (!c) {
+        return 0;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        if (c->discard > 0) {
+            --c->discard;
+            continue;
+        }
+        c->in[c->inLength++] = data[i];
+        // Fixed header: type and flags, then up to four length bytes
+        size_t remaining = 0;
+        size_t header = 0;
+        for (size_t k = 1, multiplier = 1; k < c->inLength && k <= 4; ++k, multiplier *= 128) {
+            remaining += (c->in[k] & 0x7F) * multiplier;
+            if (!(c->in[k] & 0x80)) {
+                header = k + 1;
+                break;
+            }
+        }
+        if (header == 0) {
+            continue;
+        }
+        const size_t total = header + remaining;
+        if (total > kPacketMax) {
+            s_stats.wireBytes += tcpWireBytes(total);
+            c->discard = total - c->inLength;
+            c->inLength = 0;
+        } else if (c->inLength == total) {
+            s_stats.wireBytes += tcpWireBytes(total);
+            c->inLength = 0;
+            // A lost packet never reached the broker
+            if (!lost()) {
+                c->lastPacketMicros = hal::nowMicros();
+                receive(*c, c->in[0] >> 4, c->in[0] & 0x0F, c->in + header, remaining);
+            }
+            if (c->handle != handle) {
+                return i + 1;   // DISCONNECT
+            }
+        }
+    }
+    return size;
+}
+
+int hal::detail::mqttAvailable(int handle) {
+    Connection *c = live(handle);
+    if (!c) {
+        return 0;
+    }
+    const uint64_t now = hal::nowMicros();
+    int bytes = 0;
+    for (size_t i = 0; i < c->replyCount; ++i) {
+        const Reply &r = c->replies[(c->replyHead + i) % kReplies];
+        if (r.dueMicros > now) {
+            break;
+        }
+        bytes += r.length - (i == 0 ? static_cast<int>(c->replyPos) : 0);
+    }
+    return bytes;
+}
+
+int hal::detail::mqttRead(int handle, uint8_t *buffer, size_t size) {
+    Connection *c = live(handle);
+    if (!c) {
+        return -1;
+    }
+    const uint64_t now = hal::nowMicros();
+    size_t n = 0;
+    while (n < size && c->replyCount > 0) {
+        const Reply &r = c->replies[c->replyHead];
+        if (r.dueMicros > now) {
+            break;
+        }
+        buffer[n++] = r.bytes[c->replyPos++];
+        if (c->replyPos == r.length) {
+            c->replyHead = (c->replyHead + 1) % kReplies;
+            --c->replyCount;
+            c->replyPos = 0;
+        }
+    }
+    return n > 0 ? static_cast<int>(n) : -1;
+}
+
+void hal::detail::mqttClose(int handle) {
+    Connection *c = find(handle);
+    if (c) {
+        c->handle = 0;
+    }
+}
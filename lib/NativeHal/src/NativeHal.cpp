@@ -0,0 +1,268 @@
+/**
+ * @file NativeHal.cpp
+ * @brief Virtual clock, GPIO/ADC and Serial stand-ins for host builds.
+ */
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+
+HardwareSerial Serial;
+
+namespace {
+
+const int kPinCount = 40;  ///< ESP32 exposes GPIO0..GPIO39
+
+std::atomic<uint64_t> s_nowMicros(0);  ///< Advanced by network worker threads too
+int s_analog[kPinCount] = {0};
+int s_levels[kPinCount] = {0};
+uint32_t s_digitalWrites = 0;
+bool s_serialEcho = true;
+bool s_realTimeNetwork = false;
+uint64_t s_serialBytes = 0;
+const uint64_t kSerialFifoBytes = 128;  ///< ESP32 UART TX FIFO
+uint64_t s_serialByteNanos = 0;        ///< 10 bit times per byte; 0 while unpaced
+uint64_t s_serialTxEndNanos = 0;       ///< Virtual time the last queued byte is sent
+uint64_t s_serialBlockedMicros = 0;
+int64_t s_wallClockOffset = 0;          ///< time() minus seconds of virtual time
+
+/** Bytes still in the TX FIFO at the current virtual time. */
+uint64_t serialQueued() {
+    const uint64_t now = hal::nowMicros() * 1000ULL;
+    if (s_serialByteNanos == 0 || s_serialTxEndNanos <= now) {
+        return 0;
+    }
+    return (s_serialTxEndNanos - now + s_serialByteNanos - 1) / s_serialByteNanos;
+}
+
+} // namespace
+
+namespace hal {
+
+uint64_t nowMicros() { return s_nowMicros; }
+
+void setMillis(unsigned long ms) {
+    s_nowMicros = static_cast<uint64_t>(ms) * 1000ULL;
+    detail::onClockAdvanced();
+}
+
+void advanceMillis(unsigned long ms) {
+    s_nowMicros += static_cast<uint64_t>(ms) * 1000ULL;
+    detail::onClockAdvanced();
+}
+
+void advanceMicros(uint64_t us) {
+    s_nowMicros += us;
+    detail::onClockAdvanced();
+}
+
+void setWallClock(uint32_t epoch) {
+    s_wallClockOffset = epoch == 0 ? 0 : epoch - static_cast<int64_t>(s_nowMicros / 1000000ULL);
+}
+
+void setAnalogValue(uint8_t pin, int value) {
+    if (pin < kPinCount) {
+        s_analog[pin] = value;
+    }
+}
+
+int pinLevel(uint8_t pin) { return pin < kPinCount ? s_levels[pin] : LOW; }
+
+uint32_t digitalWriteCount() { return s_digitalWrites; }
+
+void setNetworkLatencyRealTime(bool enabled) { s_realTimeNetwork = enabled; }
+
+void setSerialEcho(bool enabled) { s_serialEcho = enabled; }
+
+uint64_t serialBytesWritten() { return s_serialBytes; }
+
+uint64_t serialBlockedMicros() { return s_serialBlockedMicros; }
+
+void resetStats() {
+    s_digitalWrites = 0;
+    s_serialBytes = 0;
+    s_serialBlockedMicros = 0;
+    detail::resetHttpStats();
+    detail::resetMqttStats();
+    detail::resetI2cStats();
+    detail::resetDhtStats();
+}
+
+} // namespace hal
+
+void hal::detail::networkDelay(unsigned long ms) {
+    if (s_realTimeNetwork) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+    hal::advanceMillis(ms);
+}
+
+unsigned long millis() { return static_cast<unsigned long>(s_nowMicros / 1000ULL); }
+
+unsigned long micros() { return static_cast<unsigned long>(s_nowMicros); }
+
+void delay(unsigned long ms) { hal::advanceMillis(ms); }
+
+void delayMicroseconds(unsigned int us) { hal::advanceMicros(us); }
+
+void yield() {}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char *server1,
+                const char *server2, const char *server3) {
+    (void)gmtOffsetSec;
+    (void)daylightOffsetSec;
+    (void)server1;
+    (void)server2;
+    (void)server3;
+    if (s_wallClockOffset == 0) {
+        hal::setWallClock(hal::kSntpEpoch);
+    }
+}
+
+// Replaces the C library's time() so the system clock runs on virtual time
+extern "C" time_t time(time_t *out) {
+    const time_t now =
+        static_cast<time_t>(s_wallClockOffset + static_cast<int64_t>(s_nowMicros / 1000000ULL));
+    if (out) {
+        *out = now;
+    }
+    return now;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    ++s_digitalWrites;
+    if (pin < kPinCount) {
+        s_levels[pin] = val ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) { return hal::pinLevel(pin); }
+
+int hal::detail::analogLevel(uint8_t pin) { return pin < kPinCount ? s_analog[pin] : 0; }
+
+uint16_t analogRead(uint8_t pin) {
+    return pin < kPinCount
+               ? static_cast<uint16_t>(hal::detail::analogSample(pin, s_analog[pin], s_nowMicros))
+               : 0;
+}
+
+void analogReadResolution(uint8_t bits) { (void)bits; }
+
+namespace {
+
+uint32_t s_randomState = 0x2545F491u;
+
+} // namespace
+
+void randomSeed(unsigned long seed) {
+    if (seed != 0) {
+        s_randomState = static_cast<uint32_t>(seed);
+    }
+}
+
+uint32_t esp_random() {
+    // xorshift32: deterministic across runs so host results are reproducible
+    uint32_t x = s_randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    s_randomState = x;
+    return x;
+}
+
+long random(long howbig) {
+    if (howbig <= 0) {
+        return 0;
+    }
+    return static_cast<long>(esp_random() % static_cast<uint32_t>(howbig));
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) {
+        return howsmall;
+    }
+    return howsmall + random(howbig - howsmall);
+}
+
+char *dtostrf(double val, signed char width, unsigned char prec, char *sout) {
+    sprintf(sout, "%*.*f", width, prec, val);
+    return sout;
+}
+
+char *ultoa(unsigned long value, char *str, int base) {
+    char tmp[8 * sizeof(value) + 1];
+    char *p = &tmp[sizeof(tmp) - 1];
+    *p = '\0';
+    if (base < 2 || base > 36) {
+        base = 10;
+    }
+    do {
+        unsigned digit = static_cast<unsigned>(value % base);
+        *--p = static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value);
+    strcpy(str, p);
+    return str;
+}
+
+char *ltoa(long value, char *str, int base) {
+    if (value < 0 && base == 10) {
+        str[0] = '-';
+        ultoa(static_cast<unsigned long>(-value), str + 1, base);
+        return str;
+    }
+    return ultoa(static_cast<unsigned long>(value), str, base);
+}
+
+char *itoa(int value, char *str, int base) { return ltoa(value, str, base); }
+
+void HardwareSerial::flush() {
+    if (s_serialEcho) {
+        fflush(stdout);
+    }
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+    s_serialByteNanos = baud > 0 ? 10000000000ULL / baud : 0;
+    s_serialTxEndNanos = 0;
+}
+
+void HardwareSerial::end() { s_serialByteNanos = 0; }
+
+int HardwareSerial::availableForWrite() {
+    return static_cast<int>(kSerialFifoBytes - serialQueued());
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    s_serialBytes += size;
+    if (s_serialByteNanos > 0) {
+        const uint64_t now = hal::nowMicros() * 1000ULL;
+        const uint64_t start = s_serialTxEndNanos > now ? s_serialTxEndNanos : now;
+        s_serialTxEndNanos = start + size * s_serialByteNanos;
+        // Block until everything but the last FIFO-full has gone out
+        const uint64_t fifoNanos = kSerialFifoBytes * s_serialByteNanos;
+        if (s_serialTxEndNanos > now + fifoNanos) {
+            const uint64_t waitMicros = (s_serialTxEndNanos - fifoNanos - now + 999) / 1000;
+            s_serialBlockedMicros += waitMicros;
+            hal::advanceMicros(waitMicros);
+        }
+    }
+    if (s_serialEcho) {
+        fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+}
@@ -0,0 +1,231 @@
+/**
+ * @file NativeHal.h
+ * @brief Control surface of the host hardware abstraction layer.
+ *
+ * When the firmware is built for the `native` environment the Arduino core
+ * and the peripheral drivers (DHT, SSD1306, WiFi, HTTP, MQTT) are replaced by
+ * the stand-ins in this library. They keep the exact API the firmware uses so
+ * no module needs conditional code. This header lets host programs
+ * (benchmarks, simulators) drive those stand-ins: advance the virtual clock,
+ * inject sensor values and inspect what the firmware sent to the peripherals.
+ */
+
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hal {
+
+// ----------------------------------------------------------------------------
+// Virtual clock. millis()/micros() read it and delay() advances it, so
+// firmware timing runs as fast as the host can execute it.
+// ----------------------------------------------------------------------------
+
+/** Current virtual time in microseconds. */
+uint64_t nowMicros();
+/** Jump the virtual clock to an absolute time in milliseconds. */
+void setMillis(unsigned long ms);
+/** Advance the virtual clock by the given number of milliseconds. */
+void advanceMillis(unsigned long ms);
+/** Advance the virtual clock by the given number of microseconds. */
+void advanceMicros(uint64_t us);
+/**
+ * Set the system clock behind time() to @p epoch seconds now; 0 unsets it,
+ * as a power loss does. Until it is set time() counts seconds since boot,
+ * like the ESP32's. configTime() sets it to kSntpEpoch.
+ */
+void setWallClock(uint32_t epoch);
+/** Calendar time configTime() sets the clock to: 2026-01-01 00:00:00 UTC. */
+const uint32_t kSntpEpoch = 1767225600;
+
+// ----------------------------------------------------------------------------
+// GPIO and ADC
+// ----------------------------------------------------------------------------
+
+/** Value returned by analogRead() for the given pin. */
+void setAnalogValue(uint8_t pin, int value);
+/**
+ * Add a sine modulation of @p amplitude counts at @p frequencyHz (e.g. lamp
+ * flicker) and Gaussian conversion noise of @p noise counts to the pin's
+ * level, for analogRead() and the continuous ADC stand-in alike.
+ */
+void setAnalogWaveform(uint8_t pin, float amplitude, float frequencyHz, float noise);
+/** Vref "burnt into eFuse" for esp_adc_cal_characterize(); 0 for none. */
+void setAdcEfuseVref(uint32_t mv);
+/** Conversions delivered by the continuous ADC stand-in since start. */
+uint64_t adcConversions();
+/** Conversions lost because the driver's store buffer was full. */
+uint64_t adcDroppedConversions();
+/** Last level written to a pin with digitalWrite(). */
+int pinLevel(uint8_t pin);
+/** Number of digitalWrite() calls since start. */
+uint32_t digitalWriteCount();
+
+// ----------------------------------------------------------------------------
+// Serial port
+// ----------------------------------------------------------------------------
+
+/** Whether Serial output is echoed to stdout (benchmarks usually mute it). */
+void setSerialEcho(bool enabled);
+/** Bytes written to Serial since start, echoed or not. */
+uint64_t serialBytesWritten();
+/** Virtual time writers spent waiting for room in the TX FIFO (us). */
+uint64_t serialBlockedMicros();
+
+// ----------------------------------------------------------------------------
+// DHT sensor
+// ----------------------------------------------------------------------------
+
+/** Reading reported by the DHT stand-in; pass NAN to simulate a failure. */
+void setDHTReading(float temperature, float humidity);
+/** Model of the simulated sensor (DHT11, DHT22, ...): frame encoding and start pulse. */
+void setDHTType(uint8_t type);
+/**
+ * Replay a recorded pulse train on the next RMT capture instead of the
+ * encoded reading: alternating low/high durations in microseconds,
+ * starting with the sensor's response low.
+ */
+void setDHTCapture(const uint16_t *durations, size_t count);
+
+/** Bus cost of the bit-banged (Adafruit) DHT driver stand-in. */
+struct DHTBusStats {
+    uint32_t transfers;       ///< Start pulses sent (cached reads excluded)
+    uint64_t busyWaitMicros;  ///< CPU spinning on the data line
+    uint64_t irqOffMicros;    ///< Part of that with interrupts disabled
+};
+/** DHT driver cost since start or the last reset. */
+const DHTBusStats &dhtBusStats();
+
+// ----------------------------------------------------------------------------
+// WiFi
+// ----------------------------------------------------------------------------
+
+/** Whether the access point can currently be joined. */
+void setWiFiAvailable(bool available);
+/** Time WiFi.begin() needs for a full scan, association and DHCP. */
+void setWiFiAssociationDelay(unsigned long ms);
+/**
+ * Time WiFi.begin() with a channel needs to join the access point, and the
+ * DHCP exchange that follows unless a static address is configured.
+ */
+void setWiFiFastPathTiming(unsigned long joinMs, unsigned long dhcpMs);
+/** BSSID and channel of the access point (e.g. after it changed channel). */
+void setWiFiAccessPoint(const uint8_t bssid[6], int32_t channel);
+
+// ----------------------------------------------------------------------------
+// NVS (Preferences)
+// ----------------------------------------------------------------------------
+
+/** Drop every stored key, as on a freshly flashed chip. */
+void eraseNvs();
+/** Preferences put/remove operations since start (flash writes). */
+uint32_t nvsWrites();
+
+// ----------------------------------------------------------------------------
+// HTTP / MQTT servers
+// ----------------------------------------------------------------------------
+
+/**
+ * Counters describing the traffic the firmware generated towards one of the
+ * network stand-ins.
+ */
+struct NetStats {
+    uint32_t requests;   ///< HTTP requests or MQTT publishes
+    uint32_t connects;   ///< TCP/MQTT sessions opened
+    uint64_t bytesSent;  ///< Application bytes (HTTP request, or MQTT topic+payload)
+    uint64_t wireBytes;  ///< Estimated bytes on the wire: protocol headers,
+                         ///< TCP/IP headers and connection set-up included
+};
+
+/** Response code returned by the HTTP stand-in. */
+void setHttpResponse(int code);
+/** Virtual time the HTTP stand-in takes to answer a request. */
+void setHttpLatency(unsigned long ms);
+/** HTTP traffic sent through WiFiClient since start or the last reset. */
+const NetStats &httpStats();
+
+/**
+ * By default a slow server only advances the virtual clock. When enabled,
+ * the calling thread also sleeps for the latency in real time, so
+ * multi-threaded host programs can observe genuinely blocking requests.
+ */
+void setNetworkLatencyRealTime(bool enabled);
+
+/**
+ * Whether the MQTT broker stand-in accepts connections; turning it off
+ * also drops the open ones.
+ */
+void setMqttAvailable(bool available);
+/**
+ * Round-trip time of the MQTT stand-in: CONNACK, PUBACK and PINGRESP become
+ * readable this long after the packet they answer, on the virtual clock.
+ */
+void setMqttLatency(unsigned long ms);
+/**
+ * Probability that the MQTT stand-in loses a packet, in either direction.
+ * A lost PUBLISH is neither delivered nor acknowledged; a lost PUBACK
+ * leaves a delivered message unacknowledged, so its retransmission arrives
+ * as a duplicate. Deterministic: each call restarts the sequence.
+ */
+void setMqttPacketLoss(float probability);
+/**
+ * Traffic the MQTT stand-in received since start or the last reset:
+ * requests are accepted PUBLISH packets, duplicates included, and connects
+ * accepted CONNECTs.
+ */
+const NetStats &mqttStats();
+
+/** Receives every message the MQTT stand-in accepts, as a broker would. */
+typedef void (*MqttPublishHook)(const char *topic, const uint8_t *payload, size_t length);
+/** Install @p hook for accepted publishes (nullptr: none). */
+void setMqttPublishHook(MqttPublishHook hook);
+
+/**
+ * Loopback port the most recent WiFiServer::begin() listens on, e.g. after
+ * binding port 0; 0 if none is listening.
+ */
+uint16_t serverPort();
+
+// ----------------------------------------------------------------------------
+// Heap
+// ----------------------------------------------------------------------------
+
+/** Values reported by ESP.getFreeHeap() and ESP.getMaxAllocHeap(). */
+void setHeapStats(uint32_t freeBytes, uint32_t largestFreeBlock);
+
+// ----------------------------------------------------------------------------
+// I2C bus
+// ----------------------------------------------------------------------------
+
+/** Bytes (address + data) clocked onto the I2C bus since start. */
+uint64_t i2cBytesWritten();
+/** Number of I2C transactions since start. */
+uint32_t i2cTransactions();
+/** Bus time of those transactions at the configured clock (microseconds). */
+uint64_t i2cBusMicros();
+
+/**
+ * GDDRAM of the simulated 128x64 SSD1306 at 0x3C/0x3D (1 KB, same layout
+ * as the Adafruit framebuffer), as written over I2C.
+ */
+const uint8_t *ssd1306Ram();
+
+// ----------------------------------------------------------------------------
+// Sleep
+// ----------------------------------------------------------------------------
+
+/** esp_light_sleep_start() calls since start. */
+uint32_t lightSleepCount();
+/** esp_deep_sleep_start() calls since start. */
+uint32_t deepSleepCount();
+/** Total programmed sleep time of those calls (microseconds). */
+uint64_t sleptMicros();
+
+/** Reset every counter above without touching configured behaviour. */
+void resetStats();
+
+} // namespace hal
+
+#endif // NATIVE_HAL_H
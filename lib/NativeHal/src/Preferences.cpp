@@ -0,0 +1,96 @@
+/**
+ * @file Preferences.cpp
+ * @brief Implementation of the host Preferences stand-in.
+ */
+
+#include "Preferences.h"
+
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "NativeHal.h"
+
+namespace {
+
+std::map<std::string, std::vector<uint8_t>> s_nvs;
+uint32_t s_writes = 0;
+
+std::string fullKey(const char *ns, const char *key) {
+    return std::string(ns) + '/' + key;
+}
+
+} // namespace
+
+namespace hal {
+
+void eraseNvs() { s_nvs.clear(); }
+
+uint32_t nvsWrites() { return s_writes; }
+
+} // namespace hal
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partitionLabel) {
+    (void)partitionLabel;
+    if (name == nullptr || strlen(name) >= sizeof(_namespace)) {
+        return false;
+    }
+    strcpy(_namespace, name);
+    _readOnly = readOnly;
+    _open = true;
+    return true;
+}
+
+void Preferences::end() { _open = false; }
+
+size_t Preferences::getBytesLength(const char *key) {
+    if (!_open) {
+        return 0;
+    }
+    const auto it = s_nvs.find(fullKey(_namespace, key));
+    return it == s_nvs.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+    const size_t length = getBytesLength(key);
+    if (length == 0 || length > maxLen) {
+        return 0;
+    }
+    memcpy(buf, s_nvs[fullKey(_namespace, key)].data(), length);
+    return length;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+    if (!_open || _readOnly || len == 0) {
+        return 0;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    s_nvs[fullKey(_namespace, key)].assign(bytes, bytes + len);
+    ++s_writes;
+    return len;
+}
+
+bool Preferences::remove(const char *key) {
+    if (!_open || _readOnly) {
+        return false;
+    }
+    if (s_nvs.erase(fullKey(_namespace, key)) == 0) {
+        return false;
+    }
+    ++s_writes;
+    return true;
+}
+
+bool Preferences::clear() {
+    if (!_open || _readOnly) {
+        return false;
+    }
+    const std::string prefix = std::string(_namespace) + '/';
+    for (auto it = s_nvs.begin(); it != s_nvs.end();) {
+        it = it->first.compare(0, prefix.size(), prefix) == 0 ? s_nvs.erase(it) : std::next(it);
+    }
+    ++s_writes;
+    return true;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file Preferences.h
+ * @brief Host stand-in for the ESP32 Preferences (NVS key/value) library.
+ *
+ * Values live in process memory and survive simulated resets and deep
+ * sleep, like NVS flash. hal::eraseNvs() simulates a fresh chip and
+ * hal::nvsWrites() counts put/remove operations to track flash wear.
+ */
+
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+    void end();
+
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+    size_t putBytes(const char *key, const void *value, size_t len);
+    bool remove(const char *key);
+    bool clear();
+
+private:
+    char _namespace[16] = {0};
+    bool _open = false;
+    bool _readOnly = false;
+};
+
+#endif // NATIVE_PREFERENCES_H
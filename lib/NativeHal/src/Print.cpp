@@ -0,0 +1,95 @@
+/**
+ * @file Print.cpp
+ * @brief Implementation of the host Print class.
+ */
+
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::write(const char *str) {
+    if (str == nullptr) {
+        return 0;
+    }
+    return write(reinterpret_cast<const uint8_t *>(str), strlen(str));
+}
+
+size_t Print::print(const char *str) { return write(str); }
+
+size_t Print::print(const String &str) { return write(str.c_str(), str.length()); }
+
+size_t Print::print(char c) { return write(static_cast<uint8_t>(c)); }
+
+size_t Print::print(unsigned char value, int base) {
+    return printNumber(value, base, false);
+}
+
+size_t Print::print(int value, int base) { return print(static_cast<long long>(value), base); }
+
+size_t Print::print(unsigned int value, int base) { return printNumber(value, base, false); }
+
+size_t Print::print(long value, int base) { return print(static_cast<long long>(value), base); }
+
+size_t Print::print(unsigned long value, int base) { return printNumber(value, base, false); }
+
+size_t Print::print(long long value, int base) {
+    if (base == DEC && value < 0) {
+        return printNumber(static_cast<unsigned long long>(-value), base, true);
+    }
+    return printNumber(static_cast<unsigned long long>(value), base, false);
+}
+
+size_t Print::print(unsigned long long value, int base) { return printNumber(value, base, false); }
+
+size_t Print::print(double value, int digits) {
+    char buf[48];
+    int len = snprintf(buf, sizeof(buf), "%.*f", digits, value);
+    return write(buf, len > 0 ? static_cast<size_t>(len) : 0);
+}
+
+size_t Print::print(const Printable &value) { return value.printTo(*this); }
+
+size_t Print::println() { return write("\r\n"); }
+
+size_t Print::printf(const char *format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len <= 0) {
+        return 0;
+    }
+    if (static_cast<size_t>(len) >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    return write(buf, static_cast<size_t>(len));
+}
+
+size_t Print::printNumber(unsigned long long value, int base, bool negative) {
+    char buf[8 * sizeof(value) + 2];
+    char *p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    if (base < 2) {
+        base = DEC;
+    }
+    do {
+        unsigned digit = static_cast<unsigned>(value % base);
+        *--p = static_cast<char>(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        value /= base;
+    } while (value);
+    if (negative) {
+        *--p = '-';
+    }
+    return write(p);
+}
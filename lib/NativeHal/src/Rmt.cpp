@@ -0,0 +1,236 @@
+/**
+ * @file Rmt.cpp
+ * @brief GPIO, RMT receive and ring buffer stand-ins.
+ *
+ * The GPIO side tracks how long each line was driven low; rmt_rx_start()
+ * hands that start pulse to the simulated DHT and encodes its answer as
+ * RMT items, due on the virtual clock once the line has been idle for the
+ * configured threshold.
+ */
+
+#include "driver/gpio.h"
+#include "driver/rmt.h"
+#include "freertos/ringbuf.h"
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+
+namespace {
+
+const int kPinCount = 40;
+const size_t kMaxItems = 64;
+const uint16_t kReleaseToResponse = 30;  ///< Pull-up high before the sensor answers (us)
+
+struct Line {
+    gpio_mode_t mode;
+    bool low;
+    uint64_t lowSince;
+    uint64_t lastLowMicros;  ///< Length of the last completed low pulse
+};
+
+struct Channel {
+    bool configured;
+    bool installed;
+    bool running;
+    bool pending;
+    gpio_num_t pin;
+    uint8_t clkDiv;
+    uint16_t idleThreshold;
+    uint64_t dueMicros;
+    size_t count;
+    rmt_item32_t items[kMaxItems];
+};
+
+Line s_lines[kPinCount];
+Channel s_channels[RMT_CHANNEL_MAX];
+
+bool validPin(gpio_num_t pin) { return pin >= 0 && pin < kPinCount; }
+
+bool drives(gpio_mode_t mode) { return (mode & GPIO_MODE_OUTPUT) != 0; }
+
+void release(Line &line) {
+    if (line.low) {
+        line.low = false;
+        line.lastLowMicros = hal::nowMicros() - line.lowSince;
+    }
+}
+
+/** Append one level/duration half to the channel's items. */
+void pushHalf(Channel &ch, size_t &halves, uint8_t level, uint32_t ticks) {
+    rmt_item32_t &item = ch.items[halves / 2];
+    if (halves % 2 == 0) {
+        item.val = 0;
+        item.level0 = level;
+        item.duration0 = ticks;
+    } else {
+        item.level1 = level;
+        item.duration1 = ticks;
+    }
+    ++halves;
+}
+
+} // namespace
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+    if (!validPin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    Line &line = s_lines[gpio_num];
+    line.mode = mode;
+    if (!drives(mode)) {
+        release(line);
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (!validPin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    Line &line = s_lines[gpio_num];
+    if (!drives(line.mode)) {
+        return ESP_OK;
+    }
+    if (level == 0 && !line.low) {
+        line.low = true;
+        line.lowSince = hal::nowMicros();
+    } else if (level != 0) {
+        release(line);
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    if (!validPin(gpio_num)) {
+        return 0;
+    }
+    return s_lines[gpio_num].low ? 0 : 1;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull) {
+    (void)pull;
+    return validPin(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_hold_en(gpio_num_t gpio_num) {
+    return validPin(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_hold_dis(gpio_num_t gpio_num) {
+    return validPin(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void gpio_deep_sleep_hold_en(void) {}
+
+esp_err_t rmt_config(const rmt_config_t *rmt_param) {
+    if (!rmt_param || rmt_param->channel >= RMT_CHANNEL_MAX || rmt_param->rmt_mode != RMT_MODE_RX ||
+        !validPin(rmt_param->gpio_num) || rmt_param->clk_div == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    Channel &ch = s_channels[rmt_param->channel];
+    ch.configured = true;
+    ch.pin = rmt_param->gpio_num;
+    ch.clkDiv = rmt_param->clk_div;
+    ch.idleThreshold = rmt_param->rx_config.idle_threshold;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags) {
+    (void)intr_alloc_flags;
+    if (channel >= RMT_CHANNEL_MAX || !s_channels[channel].configured || rx_buf_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_channels[channel].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_channels[channel].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) {
+    if (channel >= RMT_CHANNEL_MAX || !s_channels[channel].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_channels[channel] = Channel();
+    return ESP_OK;
+}
+
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t *buf_handle) {
+    if (channel >= RMT_CHANNEL_MAX || !buf_handle || !s_channels[channel].installed) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *buf_handle = &s_channels[channel];
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool rx_idx_rst) {
+    (void)rx_idx_rst;
+    if (channel >= RMT_CHANNEL_MAX || !s_channels[channel].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    Channel &ch = s_channels[channel];
+    Line &line = s_lines[ch.pin];
+    ch.running = true;
+    ch.pending = false;
+    ch.count = 0;
+    if (line.low) {
+        return ESP_OK;  // still driven low: nothing answers
+    }
+    uint16_t durations[hal::detail::kDhtMaxPulses];
+    const size_t n = hal::detail::dhtAnswer(line.lastLowMicros, durations,
+                                            hal::detail::kDhtMaxPulses);
+    line.lastLowMicros = 0;
+    if (n == 0) {
+        return ESP_OK;
+    }
+    // 80 MHz APB clock divided by clk_div
+    const uint32_t ticksPerMicro = 80 / ch.clkDiv > 0 ? 80 / ch.clkDiv : 1;
+    size_t halves = 0;
+    uint64_t frameMicros = kReleaseToResponse;
+    pushHalf(ch, halves, 1, kReleaseToResponse * ticksPerMicro);
+    for (size_t i = 0; i < n && halves < kMaxItems * 2 - 1; ++i) {
+        pushHalf(ch, halves, i % 2 == 0 ? 0 : 1, durations[i] * ticksPerMicro);
+        frameMicros += durations[i];
+    }
+    // Zero duration marks the end of the frame after the idle threshold
+    pushHalf(ch, halves, 1, 0);
+    ch.count = (halves + 1) / 2;
+    ch.dueMicros = hal::nowMicros() + frameMicros + ch.idleThreshold / ticksPerMicro;
+    ch.pending = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_stop(rmt_channel_t channel) {
+    if (channel >= RMT_CHANNEL_MAX || !s_channels[channel].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_channels[channel].running = false;
+    return ESP_OK;
+}
+
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *item_size, TickType_t ticks_to_wait) {
+    Channel *ch = static_cast<Channel *>(ringbuf);
+    const uint64_t now = hal::nowMicros();
+    const uint64_t budget = ticks_to_wait == portMAX_DELAY
+                                ? UINT64_MAX
+                                : static_cast<uint64_t>(ticks_to_wait) * portTICK_PERIOD_MS * 1000;
+    const uint64_t wait = ch && ch->dueMicros > now ? ch->dueMicros - now : 0;
+    if (!ch || !ch->running || !ch->pending || wait > budget) {
+        // Nothing arrives within the wait: the task blocks for all of it
+        if (budget != UINT64_MAX) {
+            hal::advanceMicros(budget);
+        }
+        return nullptr;
+    }
+    hal::advanceMicros(wait);
+    ch->pending = false;
+    if (item_size) {
+        *item_size = ch->count * sizeof(rmt_item32_t);
+    }
+    return ch->items;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item) {
+    (void)ringbuf;
+    (void)item;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file Ssd1306Panel.cpp
+ * @brief Simulated SSD1306 controller on the host I2C bus.
+ *
+ * Decodes the command stream (addressing mode, column and page windows) and
+ * writes data bytes into a GDDRAM array, so host code can check that what
+ * reached the panel matches what was rendered.
+ */
+
+#include <string.h>
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+
+namespace {
+
+const uint8_t kWidth = 128;
+const uint8_t kPages = 8;
+
+const uint8_t kControlCommand = 0x00;
+const uint8_t kControlData = 0x40;
+
+uint8_t s_ram[kWidth * kPages];
+uint8_t s_mode = 0x02;                  ///< Page addressing after reset
+uint8_t s_colStart = 0, s_colEnd = kWidth - 1;
+uint8_t s_pageStart = 0, s_pageEnd = kPages - 1;
+uint8_t s_col = 0, s_page = 0;
+
+// A command and its arguments may be split across transactions
+uint8_t s_command = 0;
+uint8_t s_args[2];
+uint8_t s_argCount = 0;
+uint8_t s_argsNeeded = 0;
+
+/** Number of argument bytes following command @p c. */
+uint8_t argumentsOf(uint8_t c) {
+    switch (c) {
+    case 0x21:  // Column address
+    case 0x22:  // Page address
+        return 2;
+    case 0x20:  // Memory addressing mode
+    case 0x81:  // Contrast
+    case 0x8D:  // Charge pump
+    case 0xA8:  // Multiplex ratio
+    case 0xD3:  // Display offset
+    case 0xD5:  // Clock divide
+    case 0xD9:  // Pre-charge
+    case 0xDA:  // COM pins
+    case 0xDB:  // VCOMH deselect
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+void execute() {
+    switch (s_command) {
+    case 0x20:
+        s_mode = s_args[0] & 0x03;
+        break;
+    case 0x21:
+        s_colStart = s_col = s_args[0] & 0x7F;
+        s_colEnd = s_args[1] & 0x7F;
+        break;
+    case 0x22:
+        s_pageStart = s_page = s_args[0] & 0x07;
+        s_pageEnd = s_args[1] & 0x07;
+        break;
+    default:
+        if (s_command >= 0xB0 && s_command <= 0xB7) {
+            s_page = s_command & 0x07;  // Page start in page addressing mode
+        }
+        break;
+    }
+}
+
+void command(uint8_t c) {
+    if (s_argsNeeded > 0) {
+        s_args[s_argCount++] = c;
+        if (--s_argsNeeded == 0) {
+            execute();
+        }
+        return;
+    }
+    s_command = c;
+    s_argCount = 0;
+    s_argsNeeded = argumentsOf(c);
+    if (s_argsNeeded == 0) {
+        execute();
+    }
+}
+
+void data(uint8_t d) {
+    s_ram[s_page * kWidth + s_col] = d;
+    if (s_mode == 0x02) {
+        // Page addressing: the column pointer wraps within the page
+        s_col = s_col < kWidth - 1 ? s_col + 1 : 0;
+        return;
+    }
+    // Horizontal addressing within the column and page windows
+    if (s_col < s_colEnd) {
+        ++s_col;
+        return;
+    }
+    s_col = s_colStart;
+    s_page = s_page < s_pageEnd ? s_page + 1 : s_pageStart;
+}
+
+} // namespace
+
+const uint8_t *hal::ssd1306Ram() { return s_ram; }
+
+void hal::detail::i2cReceive(uint8_t address, const uint8_t *bytes, size_t length) {
+    if ((address != 0x3C && address != 0x3D) || length == 0) {
+        return;
+    }
+    const bool isData = bytes[0] == kControlData;
+    if (!isData && bytes[0] != kControlCommand) {
+        return;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        if (isData) {
+            data(bytes[i]);
+        } else {
+            command(bytes[i]);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/**
+ * @file WString.cpp
+ * @brief Implementation of the host String class.
+ */
+
+#include "WString.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+std::string formatUnsigned(unsigned long long value, unsigned char base) {
+    if (base < 2) {
+        base = 10;
+    }
+    char buf[8 * sizeof(value) + 1];
+    char *p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    do {
+        unsigned digit = static_cast<unsigned>(value % base);
+        *--p = static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value);
+    return std::string(p);
+}
+
+std::string formatSigned(long long value, unsigned char base) {
+    if (base == 10 && value < 0) {
+        return "-" + formatUnsigned(static_cast<unsigned long long>(-value), base);
+    }
+    return formatUnsigned(static_cast<unsigned long long>(value), base);
+}
+
+std::string formatFloat(double value, unsigned int decimalPlaces) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(decimalPlaces), value);
+    return std::string(buf);
+}
+
+} // namespace
+
+String::String(unsigned char value, unsigned char base) : _str(formatUnsigned(value, base)) {}
+String::String(int value, unsigned char base) : _str(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _str(formatUnsigned(value, base)) {}
+String::String(long value, unsigned char base) : _str(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _str(formatUnsigned(value, base)) {}
+String::String(float value, unsigned int decimalPlaces) : _str(formatFloat(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : _str(formatFloat(value, decimalPlaces)) {}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t pos = _str.find(c, from);
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+int String::indexOf(const char *s, unsigned int from) const {
+    size_t pos = _str.find(s, from);
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from >= _str.size() || to <= from) {
+        return String();
+    }
+    return String(_str.substr(from, to - from).c_str());
+}
+
+long String::toInt() const { return strtol(_str.c_str(), nullptr, 10); }
+
+float String::toFloat() const { return strtof(_str.c_str(), nullptr); }
@@ -0,0 +1,96 @@
+/**
+ * @file WString.h
+ * @brief Host version of the Arduino String class.
+ *
+ * Backed by std::string, so it allocates on the heap exactly where the
+ * Arduino implementation would.
+ */
+
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <stddef.h>
+#include <string>
+
+/** Marker type used by the F() macro; flash strings are plain on the host. */
+class __FlashStringHelper;
+#define F(string_literal) (string_literal)
+
+class String {
+public:
+    String(const char *cstr = "") : _str(cstr ? cstr : "") {}
+    String(const String &other) = default;
+    String(String &&other) = default;
+    explicit String(char c) : _str(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String &operator=(const String &other) = default;
+    String &operator=(String &&other) = default;
+    String &operator=(const char *cstr) {
+        _str = cstr ? cstr : "";
+        return *this;
+    }
+
+    bool reserve(unsigned int size) {
+        _str.reserve(size);
+        return true;
+    }
+    unsigned int length() const { return static_cast<unsigned int>(_str.size()); }
+    const char *c_str() const { return _str.c_str(); }
+    char operator[](unsigned int index) const { return _str[index]; }
+
+    String &concat(const String &s) {
+        _str += s._str;
+        return *this;
+    }
+    String &concat(const char *cstr) {
+        _str += cstr ? cstr : "";
+        return *this;
+    }
+    String &concat(char c) {
+        _str += c;
+        return *this;
+    }
+    template <typename T>
+    String &concat(T value) { return concat(String(value)); }
+
+    template <typename T>
+    String &operator+=(const T &value) { return concat(value); }
+
+    bool equals(const String &s) const { return _str == s._str; }
+    bool equals(const char *cstr) const { return _str == (cstr ? cstr : ""); }
+    bool operator==(const String &s) const { return equals(s); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &s) const { return !equals(s); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const char *s, unsigned int from = 0) const;
+    String substring(unsigned int from, unsigned int to = static_cast<unsigned int>(-1)) const;
+    long toInt() const;
+    float toFloat() const;
+
+private:
+    std::string _str;
+};
+
+template <typename T>
+inline String operator+(const String &lhs, const T &rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const char *lhs, const String &rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+#endif // NATIVE_WSTRING_H
@@ -0,0 +1,371 @@
+/**
+ * @file WiFi.cpp
+ * @brief Implementation of the host WiFi stand-in.
+ */
+
+#include "WiFi.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <vector>
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+
+WiFiClass WiFi;
+
+namespace {
+
+struct EventHandler {
+    WiFiEventFuncCb callback;
+    arduino_event_id_t event;
+};
+
+bool s_available = true;
+unsigned long s_associationDelay = 1500;
+unsigned long s_joinDelay = 200;
+unsigned long s_dhcpDelay = 600;
+uint8_t s_bssid[6] = {0x24, 0x0A, 0xC4, 0x11, 0x22, 0x33};
+int32_t s_channel = 6;
+std::vector<EventHandler> s_handlers;
+
+} // namespace
+
+namespace hal {
+
+void setWiFiAvailable(bool available) {
+    s_available = available;
+    WiFi.tick();
+}
+
+void setWiFiAssociationDelay(unsigned long ms) { s_associationDelay = ms; }
+
+void setWiFiFastPathTiming(unsigned long joinMs, unsigned long dhcpMs) {
+    s_joinDelay = joinMs;
+    s_dhcpDelay = dhcpMs;
+}
+
+void setWiFiAccessPoint(const uint8_t bssid[6], int32_t channel) {
+    memcpy(s_bssid, bssid, sizeof(s_bssid));
+    s_channel = channel;
+}
+
+} // namespace hal
+
+void hal::detail::onClockAdvanced() { WiFi.tick(); }
+
+String IPAddress::toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buf);
+}
+
+size_t IPAddress::printTo(Print &p) const { return p.print(toString()); }
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+    (void)host;
+    stop();
+    _connected = WiFi.status() == WL_CONNECTED;
+    _http = port != 1883;
+    _lastActivity = millis();
+    _responseLength = _responsePos = 0;
+    resetRequest();
+    if (_connected && _http) {
+        hal::detail::httpConnected();
+    } else if (_connected) {
+        _mqtt = hal::detail::mqttOpen();
+        _connected = _mqtt >= 0;
+    }
+    return _connected ? 1 : 0;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeoutMs) {
+    (void)timeoutMs;
+    return connect(host, port);
+}
+
+uint8_t WiFiClient::connected() {
+    if (_socket >= 0) {
+        return hal::detail::socketConnected(_socket) ? 1 : 0;
+    }
+    if (_connected && (WiFi.status() != WL_CONNECTED ||
+                       (_http && millis() - _lastActivity > hal::detail::kHttpKeepAliveMs) ||
+                       (_mqtt >= 0 && !hal::detail::mqttConnected(_mqtt)))) {
+        stop();
+    }
+    return _connected ? 1 : 0;
+}
+
+void WiFiClient::resetRequest() {
+    _lineLength = 0;
+    _requestBytes = 0;
+    _bodyRemaining = 0;
+    _inBody = false;
+}
+
+void WiFiClient::onRequestByte(char c) {
+    ++_requestBytes;
+    bool complete = false;
+    if (_inBody) {
+        complete = --_bodyRemaining == 0;
+    } else if (c == '\n') {
+        if (_lineLength == 0 || (_lineLength == 1 && _line[0] == '\r')) {
+            // End of the head; a body follows if Content-Length was set
+            _inBody = _bodyRemaining > 0;
+            complete = !_inBody;
+        } else if (_lineLength > 15 && strncasecmp(_line, "Content-Length:", 15) == 0) {
+            _line[_lineLength < sizeof(_line) ? _lineLength : sizeof(_line) - 1] = '\0';
+            _bodyRemaining = strtoul(_line + 15, nullptr, 10);
+        }
+        _lineLength = 0;
+    } else if (_lineLength < sizeof(_line) - 1) {
+        _line[_lineLength++] = c;
+    }
+    if (complete) {
+        const int code = hal::detail::httpServe(_requestBytes, _timeoutMs);
+        _lastActivity = millis();
+        if (code > 0) {
+            const int length = snprintf(_response, sizeof(_response),
+                                        "HTTP/1.1 %d OK\r\nContent-Length: 1\r\n\r\n0", code);
+            _responseLength = static_cast<size_t>(length);
+            _responsePos = 0;
+        }
+        resetRequest();
+    }
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size) {
+    if (_socket >= 0) {
+        return hal::detail::socketWrite(_socket, buffer, size);
+    }
+    if (!connected()) {
+        return 0;
+    }
+    _lastActivity = millis();
+    if (_mqtt >= 0) {
+        return hal::detail::mqttWrite(_mqtt, buffer, size);
+    }
+    if (_http) {
+        for (size_t i = 0; i < size; ++i) {
+            onRequestByte(static_cast<char>(buffer[i]));
+        }
+    }
+    return size;
+}
+
+int WiFiClient::available() {
+    if (_socket >= 0) {
+        return hal::detail::socketAvailable(_socket);
+    }
+    if (_mqtt >= 0) {
+        return hal::detail::mqttAvailable(_mqtt);
+    }
+    return _connected ? static_cast<int>(_responseLength - _responsePos) : 0;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    if (_socket >= 0) {
+        return read(&c, 1) == 1 ? c : -1;
+    }
+    if (_mqtt >= 0) {
+        return hal::detail::mqttRead(_mqtt, &c, 1) == 1 ? c : -1;
+    }
+    if (!_connected || _responsePos >= _responseLength) {
+        return -1;
+    }
+    _lastActivity = millis();
+    return static_cast<unsigned char>(_response[_responsePos++]);
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size) {
+    if (_socket >= 0) {
+        return hal::detail::socketRead(_socket, buffer, size);
+    }
+    if (_mqtt >= 0) {
+        return hal::detail::mqttRead(_mqtt, buffer, size);
+    }
+    size_t n = 0;
+    while (n < size && available() > 0) {
+        buffer[n++] = static_cast<uint8_t>(read());
+    }
+    return n > 0 ? static_cast<int>(n) : -1;
+}
+
+void WiFiClient::stop() {
+    if (_socket >= 0) {
+        hal::detail::socketClose(_socket);
+        _socket = -1;
+    }
+    if (_mqtt >= 0) {
+        hal::detail::mqttClose(_mqtt);
+        _mqtt = -1;
+    }
+    _connected = false;
+}
+
+void WiFiClient::setNoDelay(bool noDelay) {
+    if (_socket >= 0) {
+        hal::detail::socketNoDelay(_socket, noDelay);
+    }
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    _mode = mode;
+    if (mode == WIFI_OFF) {
+        disconnect();
+    }
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel,
+                             const uint8_t *bssid, bool connect) {
+    (void)ssid;
+    (void)passphrase;
+    if (_mode == WIFI_OFF) {
+        _mode = WIFI_STA;
+    }
+    if (!connect) {
+        return status();
+    }
+    if (channel > 0) {
+        // Only the given channel is probed; no scan
+        const bool found =
+            channel == s_channel && (bssid == nullptr || memcmp(bssid, s_bssid, 6) == 0);
+        startAssociation(s_joinDelay + (static_cast<uint32_t>(_staticIp) ? 0 : s_dhcpDelay),
+                         found);
+    } else {
+        startAssociation(s_associationDelay, true);
+    }
+    return status();
+}
+
+bool WiFiClass::config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1,
+                       IPAddress dns2) {
+    (void)dns2;
+    _staticIp = localIp;
+    _staticGateway = gateway;
+    _staticSubnet = subnet;
+    _staticDns = dns1;
+    return true;
+}
+
+void WiFiClass::startAssociation(unsigned long delayMs, bool targetFound) {
+    _phase = PHASE_ASSOCIATING;
+    _dueAt = millis() + delayMs;
+    _targetFound = targetFound;
+}
+
+bool WiFiClass::disconnect(bool wifiOff) {
+    const Phase previous = _phase;
+    _phase = PHASE_IDLE;
+    if (wifiOff) {
+        _mode = WIFI_OFF;
+    }
+    if (previous == PHASE_CONNECTED || previous == PHASE_ASSOCIATING) {
+        raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    }
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    startAssociation(s_associationDelay, true);
+    return true;
+}
+
+void WiFiClass::tick() {
+    const unsigned long now = millis();
+    switch (_phase) {
+    case PHASE_ASSOCIATING:
+        if (static_cast<long>(now - _dueAt) >= 0) {
+            if (s_available && _targetFound) {
+                _phase = PHASE_CONNECTED;
+                raise(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+                raise(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+            } else {
+                _phase = PHASE_FAILED;
+                raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+            }
+        }
+        break;
+    case PHASE_CONNECTED:
+        if (!s_available) {
+            _phase = PHASE_FAILED;
+            raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+        }
+        break;
+    default:
+        break;
+    }
+    if (_phase == PHASE_FAILED && _autoReconnect) {
+        reconnect();
+    }
+}
+
+wl_status_t WiFiClass::status() {
+    tick();
+    switch (_phase) {
+    case PHASE_CONNECTED:
+        return WL_CONNECTED;
+    case PHASE_FAILED:
+        return s_available ? WL_CONNECT_FAILED : WL_NO_SSID_AVAIL;
+    default:
+        return WL_DISCONNECTED;
+    }
+}
+
+IPAddress WiFiClass::localIP() {
+    if (status() != WL_CONNECTED) {
+        return IPAddress();
+    }
+    return static_cast<uint32_t>(_staticIp) ? _staticIp : IPAddress(192, 168, 1, 50);
+}
+
+IPAddress WiFiClass::gatewayIP() {
+    if (status() != WL_CONNECTED) {
+        return IPAddress();
+    }
+    return static_cast<uint32_t>(_staticIp) ? _staticGateway : IPAddress(192, 168, 1, 1);
+}
+
+IPAddress WiFiClass::subnetMask() {
+    if (status() != WL_CONNECTED) {
+        return IPAddress();
+    }
+    return static_cast<uint32_t>(_staticIp) ? _staticSubnet : IPAddress(255, 255, 255, 0);
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t dnsNo) {
+    if (status() != WL_CONNECTED || dnsNo > 0) {
+        return IPAddress();
+    }
+    return static_cast<uint32_t>(_staticIp) ? _staticDns : IPAddress(192, 168, 1, 1);
+}
+
+uint8_t *WiFiClass::BSSID() { return status() == WL_CONNECTED ? s_bssid : nullptr; }
+
+int32_t WiFiClass::channel() { return status() == WL_CONNECTED ? s_channel : 0; }
+
+int8_t WiFiClass::RSSI() { return status() == WL_CONNECTED ? -55 : 0; }
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback, arduino_event_id_t event) {
+    s_handlers.push_back(EventHandler{callback, event});
+    return s_handlers.size();
+}
+
+void WiFiClass::removeEvent(wifi_event_id_t id) {
+    if (id > 0 && id <= s_handlers.size()) {
+        s_handlers[id - 1].callback = nullptr;
+    }
+}
+
+void WiFiClass::raise(arduino_event_id_t event) {
+    arduino_event_info_t info = {0};
+    for (const EventHandler &handler : s_handlers) {
+        if (handler.callback && (handler.event == ARDUINO_EVENT_MAX || handler.event == event)) {
+            handler.callback(event, info);
+        }
+    }
+}
@@ -0,0 +1,228 @@
+/**
+ * @file WiFi.h
+ * @brief Host stand-in for the ESP32 WiFi station API and WiFiClient.
+ *
+ * Association is simulated against the virtual clock: after WiFi.begin() the
+ * station reports WL_CONNECTED once the configured association delay has
+ * elapsed, provided hal::setWiFiAvailable(true). Otherwise the attempt fails
+ * after the same delay. Events registered with WiFi.onEvent() are raised as
+ * the virtual clock advances or availability changes, mimicking the ESP32
+ * WiFi event task.
+ *
+ * WiFi.begin() without a channel models a full scan plus DHCP and takes
+ * the association delay. With a channel (and optionally a BSSID) only that
+ * channel is probed: the attempt takes the join delay, plus the DHCP delay
+ * unless WiFi.config() set a static address, and fails if the access point
+ * configured with hal::setWiFiAccessPoint() is not there.
+ *
+ * WiFiServer listens on a real TCP socket on 127.0.0.1, so host programs
+ * can drive a server on the node with ordinary HTTP clients; the clients
+ * it accepts are WiFiClients bound to that socket.
+ */
+
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include <Arduino.h>
+#include <functional>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_READY = 0,
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_STOP = 3,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 9,
+    ARDUINO_EVENT_MAX = 44
+} arduino_event_id_t;
+
+typedef struct {
+    uint8_t reason;   ///< Disconnect reason (simplified)
+} arduino_event_info_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef std::function<void(arduino_event_id_t, arduino_event_info_t)> WiFiEventFuncCb;
+typedef size_t wifi_event_id_t;
+
+/** IPv4 address that prints itself in dotted-quad form. */
+class IPAddress : public Printable {
+public:
+    IPAddress() : _addr(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _addr(static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) |
+                (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24)) {}
+    explicit IPAddress(uint32_t addr) : _addr(addr) {}
+
+    operator uint32_t() const { return _addr; }
+    uint8_t operator[](int index) const { return static_cast<uint8_t>(_addr >> (8 * index)); }
+    String toString() const;
+    size_t printTo(Print &p) const override;
+
+private:
+    uint32_t _addr;  ///< Network byte order, as on the ESP32
+};
+
+/** Byte-stream connection interface (Arduino's Client). */
+class Client : public Print {
+public:
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    virtual operator bool() = 0;
+    using Print::write;
+};
+
+/**
+ * TCP client stand-in. Connections to port 1883 reach the MQTT broker
+ * stand-in (MqttBroker.cpp); any other port reaches a simulated HTTP server that parses
+ * each request, answers after hal::setHttpLatency() with the code from
+ * hal::setHttpResponse() and closes idle keep-alive connections. Clients
+ * returned by WiFiServer::available() talk to a loopback socket instead.
+ * Nothing here allocates, so host checks can count allocations of the
+ * caller.
+ */
+class WiFiClient : public Client {
+public:
+    int connect(const char *host, uint16_t port) override;
+    int connect(const char *host, uint16_t port, int32_t timeoutMs);
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buffer, size_t size);
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected() != 0; }
+    /** Response timeout, in seconds as on the ESP32. */
+    void setTimeout(uint32_t seconds) { _timeoutMs = seconds * 1000UL; }
+    void setNoDelay(bool noDelay);
+
+private:
+    friend class WiFiServer;
+
+    void resetRequest();
+    void onRequestByte(char c);
+
+    int _socket = -1;           ///< Accepted loopback connection, -1 if simulated
+    int _mqtt = -1;             ///< MQTT broker stand-in connection, -1 if none
+    bool _connected = false;
+    bool _http = false;
+    unsigned long _lastActivity = 0;
+    unsigned long _timeoutMs = 5000;
+
+    // Request parsing
+    char _line[64];
+    size_t _lineLength = 0;
+    size_t _requestBytes = 0;
+    size_t _bodyRemaining = 0;
+    bool _inBody = false;
+
+    // Pending response
+    char _response[64];
+    size_t _responseLength = 0;
+    size_t _responsePos = 0;
+};
+
+/**
+ * TCP server stand-in on a loopback socket. Port 0 binds a free port,
+ * reported by hal::serverPort(). available() never blocks; the accepted
+ * clients block on write() until the peer has taken the data, as the
+ * ESP32 client does once the lwIP send buffer is full.
+ */
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port = 80, uint8_t maxClients = 4)
+        : _port(port), _maxClients(maxClients) {}
+    ~WiFiServer() { end(); }
+
+    void begin(uint16_t port = 0);
+    void end();
+    void stop() { end(); }
+    /** @return The next pending connection, or an unconnected client. */
+    WiFiClient available();
+    WiFiClient accept() { return available(); }
+    bool hasClient();
+    void setNoDelay(bool noDelay) { _noDelay = noDelay; }
+    operator bool() const { return _listener >= 0; }
+
+private:
+    uint16_t _port;
+    uint8_t _maxClients;
+    bool _noDelay = false;
+    int _listener = -1;
+};
+
+/** Station-mode subset of the ESP32 WiFi object. */
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t mode);
+    wifi_mode_t getMode() const { return _mode; }
+    wl_status_t begin(const char *ssid, const char *passphrase = nullptr, int32_t channel = 0,
+                      const uint8_t *bssid = nullptr, bool connect = true);
+    /** Static address; all-zero @p localIp re-enables DHCP. */
+    bool config(IPAddress localIp, IPAddress gateway, IPAddress subnet,
+                IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    bool disconnect(bool wifiOff = false);
+    bool reconnect();
+    bool setAutoReconnect(bool autoReconnect) {
+        _autoReconnect = autoReconnect;
+        return true;
+    }
+    bool getAutoReconnect() const { return _autoReconnect; }
+    wl_status_t status();
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t dnsNo = 0);
+    uint8_t *BSSID();
+    int32_t channel();
+    int8_t RSSI();
+
+    wifi_event_id_t onEvent(WiFiEventFuncCb callback,
+                            arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    void removeEvent(wifi_event_id_t id);
+
+    /** Host only: advance the association state machine to the current time. */
+    void tick();
+
+private:
+    enum Phase { PHASE_IDLE, PHASE_ASSOCIATING, PHASE_CONNECTED, PHASE_FAILED };
+
+    void raise(arduino_event_id_t event);
+    void startAssociation(unsigned long delayMs, bool targetFound);
+
+    wifi_mode_t _mode = WIFI_OFF;
+    Phase _phase = PHASE_IDLE;
+    bool _autoReconnect = true;
+    unsigned long _dueAt = 0;
+    bool _targetFound = true;   ///< Probed channel/BSSID matches the access point
+    IPAddress _staticIp;        ///< Zero while DHCP is used
+    IPAddress _staticGateway;
+    IPAddress _staticSubnet;
+    IPAddress _staticDns;
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H
@@ -0,0 +1,131 @@
+/**
+ * @file WiFiServer.cpp
+ * @brief Host WiFiServer on a loopback TCP socket.
+ *
+ * The listening socket is non-blocking, so available() can be polled from
+ * loop() like on the ESP32. Accepted sockets stay blocking for send(); the
+ * reads and state checks use MSG_DONTWAIT or FIONREAD instead.
+ */
+
+#include "WiFi.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+
+namespace {
+
+uint16_t s_serverPort = 0;
+
+} // namespace
+
+namespace hal {
+
+uint16_t serverPort() { return s_serverPort; }
+
+} // namespace hal
+
+bool hal::detail::socketConnected(int socket) {
+    uint8_t c;
+    const ssize_t n = recv(socket, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    // 0 is an orderly shutdown by the peer; pending data still counts
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+int hal::detail::socketAvailable(int socket) {
+    int pending = 0;
+    return ioctl(socket, FIONREAD, &pending) == 0 ? pending : 0;
+}
+
+int hal::detail::socketRead(int socket, uint8_t *buffer, size_t size) {
+    const ssize_t n = recv(socket, buffer, size, MSG_DONTWAIT);
+    return n > 0 ? static_cast<int>(n) : -1;
+}
+
+size_t hal::detail::socketWrite(int socket, const uint8_t *buffer, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+        const ssize_t n = send(socket, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return sent;
+}
+
+void hal::detail::socketNoDelay(int socket, bool noDelay) {
+    const int flag = noDelay ? 1 : 0;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+void hal::detail::socketClose(int socket) { close(socket); }
+
+void WiFiServer::begin(uint16_t port) {
+    end();
+    if (port != 0) {
+        _port = port;
+    }
+    _listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listener < 0) {
+        return;
+    }
+    const int reuse = 1;
+    setsockopt(_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(_port);
+    socklen_t length = sizeof(address);
+    if (bind(_listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(_listener, 64) != 0 ||
+        getsockname(_listener, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+        end();
+        return;
+    }
+    fcntl(_listener, F_SETFL, fcntl(_listener, F_GETFL) | O_NONBLOCK);
+    s_serverPort = ntohs(address.sin_port);
+}
+
+void WiFiServer::end() {
+    if (_listener >= 0) {
+        close(_listener);
+        _listener = -1;
+        s_serverPort = 0;
+    }
+}
+
+WiFiClient WiFiServer::available() {
+    WiFiClient client;
+    if (_listener < 0) {
+        return client;
+    }
+    const int socket = ::accept(_listener, nullptr, nullptr);
+    if (socket >= 0) {
+        client._socket = socket;
+        client._connected = true;
+        if (_noDelay) {
+            hal::detail::socketNoDelay(socket, true);
+        }
+    }
+    return client;
+}
+
+bool WiFiServer::hasClient() {
+    if (_listener < 0) {
+        return false;
+    }
+    pollfd entry = {_listener, POLLIN, 0};
+    return poll(&entry, 1, 0) > 0;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file Wire.cpp
+ * @brief Implementation of the host TwoWire stand-in.
+ */
+
+#include "Wire.h"
+
+#include "HalInternal.h"
+#include "NativeHal.h"
+
+TwoWire Wire;
+
+namespace {
+
+uint64_t s_bytes = 0;
+uint32_t s_transactions = 0;
+uint64_t s_busNanos = 0;     ///< Bus time not yet applied to the clock
+uint64_t s_busMicros = 0;
+
+} // namespace
+
+namespace hal {
+
+uint64_t i2cBytesWritten() { return s_bytes; }
+
+uint32_t i2cTransactions() { return s_transactions; }
+
+uint64_t i2cBusMicros() { return s_busMicros; }
+
+} // namespace hal
+
+void hal::detail::resetI2cStats() {
+    s_bytes = 0;
+    s_transactions = 0;
+    s_busMicros = 0;
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void)sda;
+    (void)scl;
+    if (frequency) {
+        _frequency = frequency;
+    }
+    return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+    _frequency = frequency;
+    return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    _address = address;
+    _length = 0;
+    _transmitting = true;
+    ++s_transactions;
+    ++s_bytes;  // address byte
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    if (!_transmitting) {
+        return 4;
+    }
+    _transmitting = false;
+    hal::detail::i2cReceive(_address, _buffer, _length);
+
+    // Nine clocks per byte (eight bits plus ACK), plus start and stop
+    const uint64_t bits = (_length + 1) * 9 + 2;
+    s_busNanos += bits * 1000000000ULL / _frequency;
+    const uint64_t us = s_busNanos / 1000;
+    s_busNanos -= us * 1000;
+    s_busMicros += us;
+    hal::advanceMicros(us);
+    return 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (!_transmitting || _length >= sizeof(_buffer)) {
+        return 0;
+    }
+    _buffer[_length++] = data;
+    ++s_bytes;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity) {
+    size_t written = 0;
+    while (written < quantity && write(data[written])) {
+        ++written;
+    }
+    return written;
+}
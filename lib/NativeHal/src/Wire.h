@@ -0,0 +1,42 @@
+/**
+ * @file Wire.h
+ * @brief Host stand-in for the ESP32 I2C master (TwoWire).
+ *
+ * Every transmitted byte is counted so display traffic can be measured
+ * without a bus analyser; see hal::i2cBytesWritten(). Transactions to the
+ * SSD1306 address are decoded into a simulated panel RAM
+ * (hal::ssd1306Ram()), and each transaction advances the virtual clock by
+ * its bus time at the configured clock rate.
+ */
+
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include <Arduino.h>
+
+/** Bytes buffered per transaction, as in the ESP32 core. */
+#define I2C_BUFFER_LENGTH 128
+
+class TwoWire : public Print {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    bool setClock(uint32_t frequency);
+    uint32_t getClock() const { return _frequency; }
+
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool sendStop = true);
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t *data, size_t quantity) override;
+    using Print::write;
+
+private:
+    uint32_t _frequency = 100000;
+    bool _transmitting = false;
+    uint8_t _address = 0;
+    uint8_t _buffer[I2C_BUFFER_LENGTH];
+    size_t _length = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_WIRE_H
@@ -0,0 +1,91 @@
+/**
+ * @file adc.h
+ * @brief Host stand-in for the ESP-IDF 4.4 continuous (DMA) ADC driver.
+ *
+ * Only ADC1 in single-unit mode with TYPE1 output frames is supported,
+ * which is what the ESP32 offers. Conversions happen on the virtual clock
+ * at the configured rate: adc_digi_read_bytes() returns the frames that
+ * became due since the previous read and, like the blocking driver call,
+ * advances the clock until @p length_max bytes are available or the
+ * timeout expires. Frames that do not fit the store buffer are dropped.
+ *
+ * The signal of a pin is its hal::setAnalogValue() level plus the
+ * modulation and noise set with hal::setAnalogWaveform().
+ */
+
+#ifndef NATIVE_DRIVER_ADC_H
+#define NATIVE_DRIVER_ADC_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum { ADC_UNIT_1 = 1, ADC_UNIT_2 = 2 } adc_unit_t;
+
+typedef enum {
+    ADC_ATTEN_DB_0 = 0,
+    ADC_ATTEN_DB_2_5 = 1,
+    ADC_ATTEN_DB_6 = 2,
+    ADC_ATTEN_DB_11 = 3
+} adc_atten_t;
+
+typedef enum {
+    ADC_WIDTH_BIT_9 = 0,
+    ADC_WIDTH_BIT_10 = 1,
+    ADC_WIDTH_BIT_11 = 2,
+    ADC_WIDTH_BIT_12 = 3
+} adc_bits_width_t;
+
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW 20000
+#define SOC_ADC_SAMPLE_FREQ_THRES_HIGH 2000000
+
+typedef enum { ADC_CONV_SINGLE_UNIT_1 = 1 } adc_digi_convert_mode_t;
+typedef enum { ADC_DIGI_OUTPUT_FORMAT_TYPE1 = 0 } adc_digi_output_format_t;
+
+typedef struct {
+    uint32_t max_store_buf_size;  ///< Bytes of converted frames buffered by the driver
+    uint32_t conv_num_each_intr;  ///< Bytes per DMA interrupt
+    uint32_t adc1_chan_mask;
+    uint32_t adc2_chan_mask;
+} adc_digi_init_config_t;
+
+typedef struct {
+    uint8_t atten;
+    uint8_t channel;
+    uint8_t unit;
+    uint8_t bit_width;
+} adc_digi_pattern_config_t;
+
+typedef struct {
+    bool conv_limit_en;
+    uint32_t conv_limit_num;
+    uint32_t pattern_num;
+    adc_digi_pattern_config_t *adc_pattern;
+    uint32_t sample_freq_hz;
+    adc_digi_convert_mode_t conv_mode;
+    adc_digi_output_format_t format;
+} adc_digi_configuration_t;
+
+/** One conversion as written by DMA. */
+typedef struct {
+    union {
+        struct {
+            uint16_t data : 12;
+            uint16_t channel : 4;
+        } type1;
+        uint16_t val;
+    };
+} adc_digi_output_data_t;
+
+#define ADC_RESULT_BYTE 2
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *init_config);
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config);
+esp_err_t adc_digi_start(void);
+esp_err_t adc_digi_stop(void);
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max, uint32_t *out_length,
+                              uint32_t timeout_ms);
+esp_err_t adc_digi_deinitialize(void);
+
+#endif // NATIVE_DRIVER_ADC_H
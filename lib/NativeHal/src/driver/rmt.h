@@ -0,0 +1,73 @@
+/**
+ * @file rmt.h
+ * @brief Host stand-in for the ESP-IDF 4.4 RMT driver, receive side only.
+ *
+ * A receive channel on the DHT data pin captures the simulated sensor:
+ * when rmt_rx_start() follows a start pulse driven with gpio_set_level(),
+ * the sensor's answer (or the capture set with hal::setDHTCapture()) is
+ * encoded as RMT items and becomes available from the channel's ring
+ * buffer once the pulse train and the idle threshold have elapsed on the
+ * virtual clock.
+ */
+
+#ifndef NATIVE_DRIVER_RMT_H
+#define NATIVE_DRIVER_RMT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "freertos/ringbuf.h"
+
+typedef enum {
+    RMT_CHANNEL_0 = 0,
+    RMT_CHANNEL_1,
+    RMT_CHANNEL_2,
+    RMT_CHANNEL_3,
+    RMT_CHANNEL_4,
+    RMT_CHANNEL_5,
+    RMT_CHANNEL_6,
+    RMT_CHANNEL_7,
+    RMT_CHANNEL_MAX
+} rmt_channel_t;
+
+typedef enum { RMT_MODE_TX = 0, RMT_MODE_RX, RMT_MODE_MAX } rmt_mode_t;
+
+typedef struct {
+    uint16_t idle_threshold;      ///< Ticks without an edge that end a frame
+    uint8_t filter_ticks_thresh;  ///< Glitch filter, in APB clock ticks
+    bool filter_en;
+} rmt_rx_config_t;
+
+typedef struct {
+    rmt_mode_t rmt_mode;
+    rmt_channel_t channel;
+    gpio_num_t gpio_num;
+    uint8_t clk_div;              ///< 80 gives 1 us ticks
+    uint8_t mem_block_num;
+    uint32_t flags;
+    rmt_rx_config_t rx_config;
+} rmt_config_t;
+
+/** Two level/duration halves, as stored in RMT memory. */
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+esp_err_t rmt_config(const rmt_config_t *rmt_param);
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags);
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel);
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t *buf_handle);
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool rx_idx_rst);
+esp_err_t rmt_rx_stop(rmt_channel_t channel);
+
+#endif // NATIVE_DRIVER_RMT_H
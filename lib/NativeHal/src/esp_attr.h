@@ -0,0 +1,17 @@
+/**
+ * @file esp_attr.h
+ * @brief Host stand-in for the ESP-IDF section attributes.
+ *
+ * On the host every variable lives in ordinary RAM, which a simulated deep
+ * sleep (see esp_sleep.h) leaves untouched, so RTC memory needs no
+ * special placement.
+ */
+
+#ifndef NATIVE_ESP_ATTR_H
+#define NATIVE_ESP_ATTR_H
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+
+#endif // NATIVE_ESP_ATTR_H
@@ -0,0 +1,49 @@
+/**
+ * @file esp_partition.h
+ * @brief Host stand-in for the ESP-IDF partition API.
+ *
+ * The data partitions of partitions.csv that the firmware opens by label
+ * exist in host RAM, erased at start, with NOR semantics as on the chip:
+ * erasing sets bytes to 0xFF and writing can only clear bits.
+ */
+
+#ifndef NATIVE_ESP_PARTITION_H
+#define NATIVE_ESP_PARTITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct esp_partition_t {
+    esp_partition_type_t type;
+    uint8_t subtype;
+    uint32_t address;   ///< Offset in the flash chip
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+/** @return The partition with @p label (any label if nullptr), or nullptr. */
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, uint8_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst,
+                             size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset,
+                              const void *src, size_t size);
+/** Offset and size must be sector aligned. */
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset,
+                                    size_t size);
+
+#endif // NATIVE_ESP_PARTITION_H
@@ -0,0 +1,22 @@
+/**
+ * @file esp_sleep.h
+ * @brief Host stand-in for the ESP-IDF sleep API (timer wake-up only).
+ *
+ * Light sleep advances the virtual clock by the programmed timer and
+ * returns. Deep sleep cannot reboot the host program: it returns after
+ * restarting the virtual clock at 0, as a reset restarts millis(), and the
+ * caller is expected to rebuild its objects to simulate the new boot.
+ */
+
+#ifndef NATIVE_ESP_SLEEP_H
+#define NATIVE_ESP_SLEEP_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+esp_err_t esp_light_sleep_start();
+void esp_deep_sleep_start();
+
+#endif // NATIVE_ESP_SLEEP_H
@@ -0,0 +1,23 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS tick definitions.
+ *
+ * One tick is one millisecond of virtual time, as with the default
+ * CONFIG_FREERTOS_HZ of the Arduino core.
+ */
+
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+
+#endif // NATIVE_FREERTOS_H
@@ -0,0 +1,21 @@
+/**
+ * @file ringbuf.h
+ * @brief Host stand-in for the ESP-IDF ring buffer, receive side only.
+ *
+ * Used by the RMT stand-in to hand over captured frames. Waiting advances
+ * the virtual clock.
+ */
+
+#ifndef NATIVE_RINGBUF_H
+#define NATIVE_RINGBUF_H
+
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *RingbufHandle_t;
+
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *item_size, TickType_t ticks_to_wait);
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item);
+
+#endif // NATIVE_RINGBUF_H
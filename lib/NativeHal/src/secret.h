@@ -0,0 +1,19 @@
+/**
+ * @file secret.h
+ * @brief Placeholder credentials for host builds.
+ *
+ * The firmware sources include "secret.h" unconditionally. A project copy in
+ * include/ takes precedence; this fallback only keeps the native environment
+ * buildable on machines that do not have real credentials.
+ */
+
+#ifndef SECRET_H
+#define SECRET_H
+
+#define WIFI_SSID           "native-ssid"
+#define WIFI_PASSWORD       "native-password"
+#define THINGSPEAK_API_KEY  "YourThingSpeakAPIKey"
+#define THINGSPEAK_CHANNEL_ID "0"
+#define MQTT_SERVER         "127.0.0.1"
+
+#endif // SECRET_H
@@ -0,0 +1,405 @@
+/**
+ * @file Fleet.cpp
+ * @brief Virtual nodes of the load generator on one event loop.
+ */
+
+#include "LoadGen.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <functional>
+
+#include "connectivity/MqttCodec.h"
+#include "utils/HeapStats.h"
+
+namespace loadgen {
+
+namespace {
+
+const size_t kChannels = 3;
+
+/** The node's own channels, as DHTSensor and LightSensor declare them. */
+const ChannelSpec kSpecs[kChannels] = {
+    {"Temp", "t", "C", 1, TEMP_MIN_VALID, TEMP_MAX_VALID},
+    {"Hum", "h", "%", 1, HUMID_MIN_VALID, HUMID_MAX_VALID},
+    {"Light", "l", "mV", 0, LIGHT_MIN_VALID, LIGHT_MAX_VALID},
+};
+const ChannelSpec *const kSpecPointers[kChannels] = {&kSpecs[0], &kSpecs[1], &kSpecs[2]};
+
+const size_t kBacklogMax = 64 * 1024;   ///< Unsent bytes before a node stops queueing
+const uint64_t kReconnectUs = 1000000;
+
+} // namespace
+
+struct Fleet::Node {
+    enum State { IDLE, CONNECTING, WAIT_CONNACK, READY };
+
+    struct InFlight {
+        uint16_t packetId;
+        uint64_t sentUs;
+    };
+
+    State state = IDLE;
+    uint32_t epoch = 0;
+    std::vector<uint8_t> out;
+    size_t outPos = 0;
+    uint8_t in[512];
+    size_t inLength = 0;
+    uint64_t lastSendUs = 0;
+    uint32_t random = 1;
+    float values[kChannels];
+    uint16_t nextPacketId = 1;
+    InFlight inflight[kWindow];
+    size_t inflightCount = 0;
+    char clientId[40];
+
+    /** Uniform in [0, 1), deterministic per node. */
+    float uniform() {
+        random = random * 1664525u + 1013904223u;
+        return static_cast<float>(random >> 8) / 16777216.0f;
+    }
+};
+
+int openSocket(const char *host, uint16_t port, bool blocking) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *result = nullptr;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", static_cast<unsigned>(port));
+    if (getaddrinfo(host, service, &hints, &result) != 0) {
+        return -1;
+    }
+    const int fd = socket(result->ai_family, SOCK_STREAM, 0);
+    if (fd >= 0) {
+        if (!blocking) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, result->ai_addr, result->ai_addrlen) != 0 && errno != EINPROGRESS) {
+            close(fd);
+            freeaddrinfo(result);
+            return -1;
+        }
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+Fleet::Fleet(const Options &options, uint32_t firstNode, uint32_t count, SendTimes &sendTimes,
+             Counters &counters)
+    : _options(options), _firstNode(firstNode), _sendTimes(sendTimes), _counters(counters),
+      _nodes(count), _fds(count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        Node &node = _nodes[i];
+        snprintf(node.clientId, sizeof(node.clientId), "%s-%u", MQTT_CLIENT_ID,
+                 static_cast<unsigned>(firstNode + i));
+        node.random = 2654435761u * (firstNode + i + 1);
+        node.values[0] = 18.0f + 6.0f * node.uniform();
+        node.values[1] = 35.0f + 30.0f * node.uniform();
+        node.values[2] = 200.0f + 3000.0f * node.uniform();
+        _fds[i] = pollfd{-1, 0, 0};
+    }
+}
+
+Fleet::~Fleet() {
+    for (const pollfd &p : _fds) {
+        if (p.fd >= 0) {
+            close(p.fd);
+        }
+    }
+}
+
+void Fleet::arm(uint32_t node, TimerKind kind, uint64_t dueUs) {
+    _timers.push_back(Timer{dueUs, node, _nodes[node].epoch, kind});
+    std::push_heap(_timers.begin(), _timers.end(), std::greater<Timer>());
+}
+
+void Fleet::run(const std::atomic<bool> &stop) {
+    const uint64_t start = nowUs();
+    const uint32_t count = static_cast<uint32_t>(_nodes.size());
+    for (uint32_t i = 0; i < count; ++i) {
+        arm(i, TIMER_CONNECT, start + _options.rampUs * i / (count > 0 ? count : 1));
+    }
+    while (!stop.load(std::memory_order_relaxed)) {
+        uint64_t now = nowUs();
+        while (!_timers.empty() && _timers.front().dueUs <= now) {
+            std::pop_heap(_timers.begin(), _timers.end(), std::greater<Timer>());
+            const Timer timer = _timers.back();
+            _timers.pop_back();
+            if (timer.epoch == _nodes[timer.node].epoch) {
+                fire(timer, now);
+            }
+        }
+        int timeout = 100;
+        if (!_timers.empty()) {
+            const uint64_t wait = (_timers.front().dueUs - now + 999) / 1000;
+            timeout = wait < 100 ? static_cast<int>(wait) : 100;
+        }
+        if (poll(_fds.data(), _fds.size(), timeout) <= 0) {
+            continue;
+        }
+        now = nowUs();
+        for (uint32_t i = 0; i < count; ++i) {
+            const short events = _fds[i].revents;
+            if (events == 0 || _fds[i].fd < 0) {
+                continue;
+            }
+            Node &node = _nodes[i];
+            if (node.state == Node::CONNECTING) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(_fds[i].fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (error != 0 || (events & (POLLERR | POLLHUP))) {
+                    drop(i, now);
+                    continue;
+                }
+                uint8_t packet[96];
+                const size_t size = MqttCodec::connect(packet, sizeof(packet), node.clientId,
+                                                       _options.keepAliveS, true);
+                node.state = Node::WAIT_CONNACK;
+                _fds[i].events = POLLIN;
+                queue(i, packet, size);
+                continue;
+            }
+            if (events & POLLIN) {
+                receive(i, now);
+            } else if (events & (POLLERR | POLLHUP)) {
+                drop(i, now);
+            }
+            if (_fds[i].fd >= 0 && (events & POLLOUT)) {
+                flush(i);
+            }
+        }
+    }
+    // Leave politely so the broker does not count the sessions as lost
+    for (uint32_t i = 0; i < count; ++i) {
+        if (_nodes[i].state == Node::READY) {
+            uint8_t packet[2];
+            const size_t size = MqttCodec::disconnect(packet, sizeof(packet));
+            send(_fds[i].fd, packet, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+            _counters.connected.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (_fds[i].fd >= 0) {
+            close(_fds[i].fd);
+            _fds[i].fd = -1;
+        }
+    }
+}
+
+void Fleet::fire(const Timer &timer, uint64_t nowUs) {
+    Node &node = _nodes[timer.node];
+    switch (timer.kind) {
+    case TIMER_CONNECT:
+        startConnect(timer.node, nowUs);
+        break;
+    case TIMER_DATA:
+        publishData(timer.node, nowUs);
+        arm(timer.node, TIMER_DATA, timer.dueUs + _options.intervalUs);
+        break;
+    case TIMER_STATUS:
+        publishStatus(timer.node, nowUs);
+        arm(timer.node, TIMER_STATUS, timer.dueUs + _options.statusIntervalUs);
+        break;
+    case TIMER_PING: {
+        const uint64_t half = _options.keepAliveS * 500000ull;
+        if (node.state == Node::READY && nowUs - node.lastSendUs >= half) {
+            uint8_t packet[2];
+            queue(timer.node, packet, MqttCodec::pingreq(packet, sizeof(packet)));
+        }
+        arm(timer.node, TIMER_PING, nowUs + half);
+        break;
+    }
+    }
+}
+
+void Fleet::startConnect(uint32_t index, uint64_t nowUs) {
+    const int fd = openSocket(_options.host, _options.port, false);
+    if (fd < 0) {
+        _counters.connectFailures.fetch_add(1, std::memory_order_relaxed);
+        arm(index, TIMER_CONNECT, nowUs + kReconnectUs);
+        return;
+    }
+    _nodes[index].state = Node::CONNECTING;
+    _fds[index] = pollfd{fd, POLLOUT, 0};
+}
+
+void Fleet::publishData(uint32_t index, uint64_t nowUs) {
+    Node &node = _nodes[index];
+    if (node.state != Node::READY) {
+        _counters.skipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (_options.qos > 0 && node.inflightCount == kWindow) {
+        _counters.windowFull.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // A slow random walk, so payload lengths vary like the node's
+    node.values[0] += (node.uniform() - 0.5f) * 0.2f;
+    node.values[1] += node.uniform() - 0.5f;
+    node.values[2] += (node.uniform() - 0.5f) * 50.0f;
+
+    const uint32_t sequence = _sendTimes.next();
+    uint8_t payload[MQTT_CHANNEL_PAYLOAD_MAX];
+    const size_t length = _encoder.encodeChannels(
+        ChannelView{kChannels, kSpecPointers, node.values}, static_cast<uint32_t>(nowUs / 1000),
+        sequence, _options.format, payload, sizeof(payload));
+    uint16_t packetId = 0;
+    if (_options.qos > 0) {
+        packetId = node.nextPacketId;
+        node.nextPacketId = static_cast<uint16_t>(packetId == 0xFFFF ? 1 : packetId + 1);
+    }
+    uint8_t packet[MQTT_CHANNEL_PAYLOAD_MAX + sizeof(MQTT_TOPIC_DATA) + 8];
+    const size_t size = MqttCodec::publish(packet, sizeof(packet), MQTT_TOPIC_DATA, payload,
+                                           length, _options.qos, packetId);
+    // Before the write: the probe may see the message before send() returns
+    _sendTimes.record(sequence, nowUs);
+    if (size == 0 || !queue(index, packet, size)) {
+        _sendTimes.take(sequence);
+        _counters.skipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (_options.qos > 0) {
+        node.inflight[node.inflightCount++] = Node::InFlight{packetId, nowUs};
+    }
+    _counters.published.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Fleet::publishStatus(uint32_t index, uint64_t nowUs) {
+    (void)nowUs;
+    Node &node = _nodes[index];
+    if (node.state != Node::READY) {
+        _counters.skipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const uint32_t free = 180000 + static_cast<uint32_t>(node.uniform() * 20000.0f);
+    const HeapStats heap = {free, free / 2, free - 8000};
+    char payload[MQTT_PAYLOAD_MAX];
+    const size_t length = formatHeapStats(heap, payload, sizeof(payload));
+    uint8_t packet[MQTT_PAYLOAD_MAX + sizeof(MQTT_TOPIC_STATUS) + 8];
+    const size_t size =
+        MqttCodec::publish(packet, sizeof(packet), MQTT_TOPIC_STATUS,
+                           reinterpret_cast<const uint8_t *>(payload), length, 0, 0);
+    if (size > 0 && queue(index, packet, size)) {
+        _counters.statusPublished.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool Fleet::queue(uint32_t index, const uint8_t *packet, size_t length) {
+    Node &node = _nodes[index];
+    if (length == 0 || node.out.size() - node.outPos > kBacklogMax) {
+        return false;
+    }
+    node.out.insert(node.out.end(), packet, packet + length);
+    node.lastSendUs = nowUs();
+    _counters.bytes.fetch_add(length, std::memory_order_relaxed);
+    flush(index);
+    return true;
+}
+
+void Fleet::flush(uint32_t index) {
+    Node &node = _nodes[index];
+    while (node.outPos < node.out.size()) {
+        const ssize_t n = send(_fds[index].fd, node.out.data() + node.outPos,
+                               node.out.size() - node.outPos, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            node.outPos += static_cast<size_t>(n);
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            _fds[index].events = POLLIN | POLLOUT;
+            return;
+        } else {
+            drop(index, nowUs());
+            return;
+        }
+    }
+    node.out.clear();
+    node.outPos = 0;
+    _fds[index].events = POLLIN;
+}
+
+void Fleet::receive(uint32_t index, uint64_t nowUs) {
+    Node &node = _nodes[index];
+    const ssize_t n = recv(_fds[index].fd, node.in + node.inLength,
+                           sizeof(node.in) - node.inLength, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        drop(index, nowUs);
+        return;
+    }
+    node.inLength += n > 0 ? static_cast<size_t>(n) : 0;
+    size_t consumed = 0;
+    MqttPacket packet;
+    MqttParseResult result;
+    while ((result = MqttCodec::parse(node.in + consumed, node.inLength - consumed, packet)) ==
+           MQTT_PARSE_OK) {
+        consumed += packet.size;
+        bool sessionPresent;
+        uint8_t returnCode;
+        uint16_t packetId;
+        if (MqttCodec::parseConnack(packet, sessionPresent, returnCode)) {
+            if (returnCode != 0) {
+                drop(index, nowUs);
+                return;
+            }
+            node.state = Node::READY;
+            _counters.connects.fetch_add(1, std::memory_order_relaxed);
+            _counters.connected.fetch_add(1, std::memory_order_relaxed);
+            // Random phases, as nodes booted at different times would have
+            arm(index, TIMER_DATA,
+                nowUs + static_cast<uint64_t>(node.uniform() * _options.intervalUs));
+            if (_options.statusIntervalUs > 0) {
+                arm(index, TIMER_STATUS,
+                    nowUs + static_cast<uint64_t>(node.uniform() * _options.statusIntervalUs));
+            }
+            if (_options.keepAliveS > 0) {
+                arm(index, TIMER_PING, nowUs + _options.keepAliveS * 500000ull);
+            }
+        } else if (packet.type == MQTT_PUBACK && MqttCodec::parseAck(packet, packetId)) {
+            for (size_t k = 0; k < node.inflightCount; ++k) {
+                if (node.inflight[k].packetId == packetId) {
+                    _ackLatencies.push_back(
+                        static_cast<uint32_t>(nowUs - node.inflight[k].sentUs));
+                    node.inflight[k] = node.inflight[--node.inflightCount];
+                    _counters.acked.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+            }
+        }
+    }
+    if (result == MQTT_PARSE_MALFORMED || (consumed == 0 && node.inLength == sizeof(node.in))) {
+        drop(index, nowUs);
+        return;
+    }
+    memmove(node.in, node.in + consumed, node.inLength - consumed);
+    node.inLength -= consumed;
+}
+
+void Fleet::drop(uint32_t index, uint64_t nowUs) {
+    Node &node = _nodes[index];
+    if (node.state == Node::READY) {
+        _counters.disconnects.fetch_add(1, std::memory_order_relaxed);
+        _counters.connected.fetch_sub(1, std::memory_order_relaxed);
+    } else {
+        _counters.connectFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+    close(_fds[index].fd);
+    _fds[index] = pollfd{-1, 0, 0};
+    node.state = Node::IDLE;
+    ++node.epoch;   // cancels the node's timers
+    node.out.clear();
+    node.outPos = 0;
+    node.inLength = 0;
+    node.inflightCount = 0;
+    arm(index, TIMER_CONNECT, nowUs + kReconnectUs);
+}
+
+} // namespace loadgen
@@ -0,0 +1,199 @@
+/**
+ * @file LoadGen.h
+ * @brief Fleet-scale MQTT load generator: shared declarations.
+ *
+ * N virtual nodes, split over one or more event-loop threads (Fleet),
+ * each hold a TCP connection to a real broker (e.g. mosquitto) and publish
+ * what the firmware publishes: a channel frame on MQTT_TOPIC_DATA every
+ * upload interval, encoded by CloudUploader::encodeChannels(), and heap
+ * telemetry on MQTT_TOPIC_STATUS formatted by formatHeapStats(). Packets
+ * are built with MqttCodec. A Probe subscribed to both topics timestamps
+ * every message it receives; data messages carry a sequence number unique
+ * across the fleet, so the end-to-end latency (node publish to subscriber
+ * receive, through the broker) is known per message.
+ */
+
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#include <poll.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "config.h"
+#include "connectivity/CloudUploader.h"
+#include "connectivity/MqttCodec.h"
+
+namespace loadgen {
+
+struct Options {
+    const char *host;
+    uint16_t port;
+    uint32_t nodes;
+    uint32_t threads;            ///< Event loops the nodes are split over
+    uint64_t intervalUs;         ///< Data message period per node
+    uint64_t statusIntervalUs;   ///< Status message period per node, 0: none
+    uint64_t durationUs;         ///< Publishing time, ramp included
+    uint64_t rampUs;             ///< Connections are spread over this time
+    MqttPayloadFormat format;
+    uint8_t qos;                 ///< 0 or 1 for the nodes' publishes
+    uint16_t keepAliveS;
+};
+
+/** Monotonic time in microseconds. */
+inline uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/** Fleet-wide counters, updated by every thread. */
+struct Counters {
+    std::atomic<uint64_t> published{0};         ///< Data messages handed to the socket
+    std::atomic<uint64_t> statusPublished{0};
+    std::atomic<uint64_t> bytes{0};             ///< MQTT bytes written, all packets
+    std::atomic<uint64_t> skipped{0};           ///< Messages due while not connected
+    std::atomic<uint64_t> windowFull{0};        ///< QoS 1 messages due with the window full
+    std::atomic<uint64_t> acked{0};             ///< PUBACKs received
+    std::atomic<uint64_t> connects{0};
+    std::atomic<uint64_t> connectFailures{0};   ///< TCP or CONNACK refused
+    std::atomic<uint64_t> disconnects{0};       ///< Established sessions lost
+    std::atomic<int> connected{0};
+};
+
+/**
+ * Publish time of every data message by sequence number, written by the
+ * fleet threads and consumed by the probe.
+ */
+class SendTimes {
+public:
+    static const uint32_t kSlots = 1u << 20;   ///< Messages that may be in flight
+
+    SendTimes() : _slots(new std::atomic<uint64_t>[kSlots]), _next(1) {
+        for (uint32_t i = 0; i < kSlots; ++i) {
+            _slots[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /** @return Sequence number for the next data message. */
+    uint32_t next() { return _next.fetch_add(1, std::memory_order_relaxed); }
+
+    void record(uint32_t sequence, uint64_t us) {
+        _slots[sequence % kSlots].store(us, std::memory_order_release);
+    }
+
+    /** @return Publish time of @p sequence, 0 if unknown or already taken. */
+    uint64_t take(uint32_t sequence) {
+        return _slots[sequence % kSlots].exchange(0, std::memory_order_acquire);
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> _slots;
+    std::atomic<uint32_t> _next;
+};
+
+/**
+ * Open a TCP connection to @p host:@p port; unless @p blocking, it may
+ * still be in progress on return (poll for POLLOUT).
+ *
+ * @return Socket, or -1
+ */
+int openSocket(const char *host, uint16_t port, bool blocking);
+
+/**
+ * @class Fleet
+ * @brief Virtual nodes driven by one poll() event loop.
+ */
+class Fleet {
+public:
+    static const size_t kWindow = 16;   ///< QoS 1 messages in flight per node
+
+    Fleet(const Options &options, uint32_t firstNode, uint32_t count, SendTimes &sendTimes,
+          Counters &counters);
+    ~Fleet();
+
+    /** Connect, publish and keep the sessions alive until @p stop. */
+    void run(const std::atomic<bool> &stop);
+
+    /** PUBACK delays at QoS 1, in microseconds. */
+    const std::vector<uint32_t> &ackLatencies() const { return _ackLatencies; }
+
+private:
+    struct Node;
+    enum TimerKind { TIMER_CONNECT, TIMER_DATA, TIMER_STATUS, TIMER_PING };
+    struct Timer {
+        uint64_t dueUs;
+        uint32_t node;
+        uint32_t epoch;   ///< Node epoch when armed; stale after a reconnect
+        TimerKind kind;
+        bool operator>(const Timer &other) const { return dueUs > other.dueUs; }
+    };
+
+    void arm(uint32_t node, TimerKind kind, uint64_t dueUs);
+    void fire(const Timer &timer, uint64_t nowUs);
+    void startConnect(uint32_t node, uint64_t nowUs);
+    void publishData(uint32_t node, uint64_t nowUs);
+    void publishStatus(uint32_t node, uint64_t nowUs);
+    bool queue(uint32_t node, const uint8_t *packet, size_t length);
+    void flush(uint32_t node);
+    void receive(uint32_t node, uint64_t nowUs);
+    void drop(uint32_t node, uint64_t nowUs);
+
+    const Options &_options;
+    uint32_t _firstNode;
+    SendTimes &_sendTimes;
+    Counters &_counters;
+    CloudUploader _encoder;   ///< Only its payload encoders are used
+    std::vector<Node> _nodes;
+    std::vector<pollfd> _fds;   ///< One per node, fd -1 while idle
+    std::vector<Timer> _timers;   ///< Min-heap on dueUs
+    std::vector<uint32_t> _ackLatencies;
+};
+
+/**
+ * @class Probe
+ * @brief Subscriber measuring the end-to-end latency of data messages.
+ */
+class Probe {
+public:
+    Probe(const Options &options, SendTimes &sendTimes);
+    ~Probe();
+
+    /**
+     * Connect and subscribe; returns once the broker acknowledged.
+     *
+     * @return false if the broker cannot be reached
+     */
+    bool begin();
+
+    /** Receive until @p stop. */
+    void run(const std::atomic<bool> &stop);
+
+    uint64_t received() const { return _received.load(std::memory_order_relaxed); }
+    uint64_t statusReceived() const { return _status.load(std::memory_order_relaxed); }
+    /** Messages whose sequence number had no publish time (duplicates). */
+    uint64_t unmatched() const { return _unmatched; }
+    /** End-to-end delays of data messages, in microseconds. */
+    std::vector<uint32_t> &latencies() { return _latencies; }
+
+private:
+    void handle(const MqttPacket &packet, uint64_t nowUs);
+
+    const Options &_options;
+    SendTimes &_sendTimes;
+    int _fd;
+    std::vector<uint8_t> _in;
+    size_t _inLength;
+    std::atomic<uint64_t> _received;
+    std::atomic<uint64_t> _status;
+    uint64_t _unmatched;
+    std::vector<uint32_t> _latencies;
+};
+
+} // namespace loadgen
+
+#endif // LOADGEN_H
@@ -0,0 +1,202 @@
+/**
+ * @file Probe.cpp
+ * @brief Subscriber side of the load generator.
+ */
+
+#include "LoadGen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "connectivity/MqttCodec.h"
+
+namespace loadgen {
+
+namespace {
+
+const size_t kInitialBuffer = 64 * 1024;
+const uint16_t kSubscribeId = 1;
+
+/**
+ * Sequence number of an encodeChannels() payload: "seq" is its first key
+ * in both formats.
+ *
+ * @return false if @p payload does not start that way
+ */
+bool parseSequence(const uint8_t *payload, size_t length, uint32_t &sequence) {
+    if (length > 0 && payload[0] == '{') {
+        static const char kKey[] = "{\"seq\":";
+        const size_t keyLength = sizeof(kKey) - 1;
+        if (length <= keyLength || memcmp(payload, kKey, keyLength) != 0) {
+            return false;
+        }
+        uint32_t value = 0;
+        size_t i = keyLength;
+        for (; i < length && payload[i] >= '0' && payload[i] <= '9'; ++i) {
+            value = value * 10 + (payload[i] - '0');
+        }
+        sequence = value;
+        return i > keyLength;
+    }
+    // CBOR: map head with fewer than 24 entries, text(3) "seq", then uint
+    if (length < 6 || (payload[0] & 0xE0) != 0xA0 || memcmp(payload + 1, "\x63seq", 4) != 0) {
+        return false;
+    }
+    const uint8_t *p = payload + 5;
+    const size_t rest = length - 5;
+    const uint8_t head = p[0];
+    if (head <= 0x17) {
+        sequence = head;
+    } else if (head == 0x18 && rest >= 2) {
+        sequence = p[1];
+    } else if (head == 0x19 && rest >= 3) {
+        sequence = static_cast<uint32_t>(p[1] << 8 | p[2]);
+    } else if (head == 0x1A && rest >= 5) {
+        sequence = static_cast<uint32_t>(p[1]) << 24 | static_cast<uint32_t>(p[2]) << 16 |
+                   static_cast<uint32_t>(p[3]) << 8 | p[4];
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool topicIs(const MqttPublish &publish, const char *topic) {
+    return publish.topicLength == strlen(topic) &&
+           memcmp(publish.topic, topic, publish.topicLength) == 0;
+}
+
+} // namespace
+
+Probe::Probe(const Options &options, SendTimes &sendTimes)
+    : _options(options), _sendTimes(sendTimes), _fd(-1), _in(kInitialBuffer), _inLength(0),
+      _received(0), _status(0), _unmatched(0) {}
+
+Probe::~Probe() {
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+bool Probe::begin() {
+    _fd = openSocket(_options.host, _options.port, true);
+    if (_fd < 0) {
+        return false;
+    }
+    // Short receive timeout: run() checks its stop flag between reads
+    timeval timeout = {0, 200000};
+    setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char clientId[40];
+    snprintf(clientId, sizeof(clientId), "%s-probe", MQTT_CLIENT_ID);
+    uint8_t packet[128];
+    size_t length = MqttCodec::connect(packet, sizeof(packet), clientId, _options.keepAliveS, true);
+    length += MqttCodec::subscribe(packet + length, sizeof(packet) - length, kSubscribeId,
+                                   MQTT_TOPIC_DATA, 0);
+    length += MqttCodec::subscribe(packet + length, sizeof(packet) - length, kSubscribeId + 1,
+                                   MQTT_TOPIC_STATUS, 0);
+    if (send(_fd, packet, length, MSG_NOSIGNAL) != static_cast<ssize_t>(length)) {
+        return false;
+    }
+
+    // CONNACK, then both SUBACKs
+    int pending = 3;
+    const uint64_t deadline = nowUs() + 5000000;
+    while (pending > 0 && nowUs() < deadline) {
+        const ssize_t n = recv(_fd, _in.data() + _inLength, _in.size() - _inLength, 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            continue;
+        }
+        _inLength += static_cast<size_t>(n);
+        MqttPacket reply;
+        size_t consumed = 0;
+        while (MqttCodec::parse(_in.data() + consumed, _inLength - consumed, reply) ==
+               MQTT_PARSE_OK) {
+            consumed += reply.size;
+            bool sessionPresent;
+            uint8_t returnCode;
+            uint16_t packetId;
+            if (MqttCodec::parseConnack(reply, sessionPresent, returnCode)) {
+                if (returnCode != 0) {
+                    return false;
+                }
+                --pending;
+            } else if (reply.type == MQTT_SUBACK && MqttCodec::parseAck(reply, packetId)) {
+                --pending;
+            }
+        }
+        memmove(_in.data(), _in.data() + consumed, _inLength - consumed);
+        _inLength -= consumed;
+    }
+    return pending == 0;
+}
+
+void Probe::run(const std::atomic<bool> &stop) {
+    const uint64_t pingUs = _options.keepAliveS * 500000ull;
+    uint64_t lastPing = nowUs();
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (_inLength == _in.size()) {
+            _in.resize(_in.size() * 2);
+        }
+        const ssize_t n = recv(_fd, _in.data() + _inLength, _in.size() - _inLength, 0);
+        const uint64_t now = nowUs();
+        if (pingUs > 0 && now - lastPing >= pingUs) {
+            uint8_t packet[2];
+            send(_fd, packet, MqttCodec::pingreq(packet, sizeof(packet)), MSG_NOSIGNAL);
+            lastPing = now;
+        }
+        if (n == 0) {
+            fprintf(stderr, "probe: broker closed the connection\n");
+            return;
+        }
+        if (n < 0) {
+            continue;
+        }
+        _inLength += static_cast<size_t>(n);
+        size_t consumed = 0;
+        MqttPacket packet;
+        MqttParseResult result;
+        while ((result = MqttCodec::parse(_in.data() + consumed, _inLength - consumed, packet)) ==
+               MQTT_PARSE_OK) {
+            consumed += packet.size;
+            handle(packet, now);
+        }
+        if (result == MQTT_PARSE_MALFORMED) {
+            fprintf(stderr, "probe: malformed packet from the broker\n");
+            return;
+        }
+        memmove(_in.data(), _in.data() + consumed, _inLength - consumed);
+        _inLength -= consumed;
+    }
+}
+
+void Probe::handle(const MqttPacket &packet, uint64_t nowUs) {
+    MqttPublish publish;
+    if (!MqttCodec::parsePublish(packet, publish)) {
+        return;
+    }
+    if (topicIs(publish, MQTT_TOPIC_STATUS)) {
+        _status.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t sequence;
+    if (!topicIs(publish, MQTT_TOPIC_DATA) ||
+        !parseSequence(publish.payload, publish.payloadLength, sequence)) {
+        return;
+    }
+    _received.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t sent = _sendTimes.take(sequence);
+    if (sent == 0) {
+        ++_unmatched;
+        return;
+    }
+    _latencies.push_back(static_cast<uint32_t>(nowUs > sent ? nowUs - sent : 0));
+}
+
+} // namespace loadgen
@@ -0,0 +1,256 @@
+/**
+ * @file loadgen_main.cpp
+ * @brief Fleet-scale MQTT load generator against a real broker.
+ *
+ * Simulates thousands of nodes, each on its own TCP connection, publishing
+ * the firmware's messages at the firmware's rates, and measures what the
+ * broker sustains: delivered messages per second and the end-to-end
+ * latency distribution seen by a subscriber.
+ *
+ * Usage (`pio run -e native_loadgen`, then run .pio/build/native_loadgen/program):
+ *
+ *     program [--host localhost] [--port 1883] [--nodes 1000] [--threads 4]
+ *             [--interval 30s] [--status-interval 60s] [--duration 2m]
+ *             [--ramp 10s] [--format json|cbor] [--qos 0|1]
+ *
+ * Durations take ms, s or m (seconds without a unit); the defaults are
+ * CLOUD_UPLOAD_INTERVAL, HEAP_REPORT_INTERVAL and MQTT_KEEPALIVE from
+ * config.h. Each node needs a file descriptor, as does the broker: raise
+ * its limit too (e.g. mosquitto's max_connections and `ulimit -n`).
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "LoadGen.h"
+
+namespace {
+
+using namespace loadgen;
+
+/** @return false on a malformed duration. */
+bool parseDuration(const char *text, uint64_t &us) {
+    char *unit;
+    const double value = strtod(text, &unit);
+    if (unit == text || value < 0) {
+        return false;
+    }
+    double scale = 1e6;
+    if (strcmp(unit, "ms") == 0) {
+        scale = 1e3;
+    } else if (strcmp(unit, "m") == 0) {
+        scale = 6e7;
+    } else if (*unit != '\0' && strcmp(unit, "s") != 0) {
+        return false;
+    }
+    us = static_cast<uint64_t>(value * scale + 0.5);
+    return true;
+}
+
+/** Nearest-rank percentile of sorted @p values, in milliseconds. */
+double percentileMs(const std::vector<uint32_t> &values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(p / 100.0 * values.size());
+    rank = rank < values.size() ? rank : values.size() - 1;
+    return values[rank] / 1000.0;
+}
+
+void printLatencies(const char *label, std::vector<uint32_t> &values) {
+    std::sort(values.begin(), values.end());
+    printf("%-13s p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f ms (%zu samples)\n",
+           label, percentileMs(values, 50), percentileMs(values, 90), percentileMs(values, 99),
+           percentileMs(values, 99.9), values.empty() ? 0.0 : values.back() / 1000.0,
+           values.size());
+}
+
+/** Allow one descriptor per node plus headroom. */
+void raiseFileLimit(uint32_t nodes) {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return;
+    }
+    const rlim_t wanted = nodes + 64;
+    if (limit.rlim_cur < wanted) {
+        limit.rlim_cur = wanted < limit.rlim_max ? wanted : limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur < wanted) {
+        fprintf(stderr, "warning: %llu file descriptors for %u nodes\n",
+                static_cast<unsigned long long>(limit.rlim_cur), static_cast<unsigned>(nodes));
+    }
+}
+
+int usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--host localhost] [--port %u] [--nodes 1000] [--threads 4]\n"
+            "       [--interval DUR] [--status-interval DUR] [--duration DUR] [--ramp DUR]\n"
+            "       [--format json|cbor] [--qos 0|1]\n",
+            program, static_cast<unsigned>(MQTT_PORT));
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options = {"localhost", MQTT_PORT, 1000, 4,
+                       CLOUD_UPLOAD_INTERVAL * 1000ull, HEAP_REPORT_INTERVAL * 1000ull,
+                       120000000ull, 10000000ull, MQTT_PAYLOAD_JSON, 0, MQTT_KEEPALIVE};
+    for (int i = 1; i < argc; i += 2) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return usage(argv[0]);
+        }
+        bool ok = true;
+        if (strcmp(arg, "--host") == 0) {
+            options.host = value;
+        } else if (strcmp(arg, "--port") == 0) {
+            options.port = static_cast<uint16_t>(atoi(value));
+        } else if (strcmp(arg, "--nodes") == 0) {
+            options.nodes = static_cast<uint32_t>(atoi(value));
+            ok = options.nodes > 0;
+        } else if (strcmp(arg, "--threads") == 0) {
+            options.threads = static_cast<uint32_t>(atoi(value));
+            ok = options.threads > 0;
+        } else if (strcmp(arg, "--interval") == 0) {
+            ok = parseDuration(value, options.intervalUs) && options.intervalUs > 0;
+        } else if (strcmp(arg, "--status-interval") == 0) {
+            ok = parseDuration(value, options.statusIntervalUs);
+        } else if (strcmp(arg, "--duration") == 0) {
+            ok = parseDuration(value, options.durationUs);
+        } else if (strcmp(arg, "--ramp") == 0) {
+            ok = parseDuration(value, options.rampUs);
+        } else if (strcmp(arg, "--format") == 0) {
+            ok = strcmp(value, "json") == 0 || strcmp(value, "cbor") == 0;
+            options.format = value[0] == 'c' ? MQTT_PAYLOAD_CBOR : MQTT_PAYLOAD_JSON;
+        } else if (strcmp(arg, "--qos") == 0) {
+            ok = strcmp(value, "0") == 0 || strcmp(value, "1") == 0;
+            options.qos = static_cast<uint8_t>(value[0] - '0');
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return usage(argv[0]);
+        }
+    }
+    if (options.threads > options.nodes) {
+        options.threads = options.nodes;
+    }
+    raiseFileLimit(options.nodes);
+
+    SendTimes sendTimes;
+    Counters counters;
+    Probe probe(options, sendTimes);
+    if (!probe.begin()) {
+        fprintf(stderr, "cannot subscribe at %s:%u: %s\n", options.host,
+                static_cast<unsigned>(options.port), errno ? strerror(errno) : "refused");
+        return 1;
+    }
+    std::atomic<bool> stopFleet(false);
+    std::atomic<bool> stopProbe(false);
+    std::thread probeThread([&] { probe.run(stopProbe); });
+
+    std::vector<std::unique_ptr<Fleet>> fleets;
+    std::vector<std::thread> threads;
+    uint32_t first = 0;
+    for (uint32_t t = 0; t < options.threads; ++t) {
+        const uint32_t count = (options.nodes - first) / (options.threads - t);
+        fleets.emplace_back(new Fleet(options, first, count, sendTimes, counters));
+        first += count;
+    }
+    const uint64_t start = nowUs();
+    for (auto &fleet : fleets) {
+        Fleet *f = fleet.get();
+        threads.emplace_back([f, &stopFleet] { f->run(stopFleet); });
+    }
+
+    // Progress each second; the rate after the ramp is what the broker sustains
+    uint64_t lastPublished = 0;
+    uint64_t lastReceived = 0;
+    uint64_t rampPublished = 0;
+    uint64_t rampReceived = 0;
+    uint64_t rampBytes = 0;
+    bool rampDone = options.rampUs == 0;
+    for (uint64_t second = 1; second * 1000000 <= options.durationUs; ++second) {
+        const uint64_t due = start + second * 1000000;
+        const uint64_t now = nowUs();
+        if (due > now) {
+            std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+        }
+        const uint64_t published = counters.published.load();
+        const uint64_t received = probe.received();
+        fprintf(stderr, "%4llus  connected %6d  sent %7llu/s  received %7llu/s\n",
+                static_cast<unsigned long long>(second), counters.connected.load(),
+                static_cast<unsigned long long>(published - lastPublished),
+                static_cast<unsigned long long>(received - lastReceived));
+        lastPublished = published;
+        lastReceived = received;
+        if (!rampDone && second * 1000000 >= options.rampUs) {
+            rampDone = true;
+            rampPublished = published;
+            rampReceived = received;
+            rampBytes = counters.bytes.load();
+        }
+    }
+    const uint64_t end = nowUs();
+    stopFleet = true;
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    // Messages still in the broker's queues count as delivered, if late
+    const uint64_t drainEnd = nowUs() + 2000000;
+    while (probe.received() < counters.published.load() && nowUs() < drainEnd) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    stopProbe = true;
+    probeThread.join();
+
+    const uint64_t published = counters.published.load();
+    const uint64_t received = probe.received();
+    const double steadyS = (end - start - (rampDone ? options.rampUs : 0)) / 1e6;
+    printf("nodes         %u on %u threads, QoS %u, %s, every %.1f s\n",
+           static_cast<unsigned>(options.nodes), static_cast<unsigned>(options.threads),
+           static_cast<unsigned>(options.qos),
+           options.format == MQTT_PAYLOAD_CBOR ? "CBOR" : "JSON", options.intervalUs / 1e6);
+    printf("data          %llu published, %llu received, %llu lost (%.3f%%), %llu unmatched\n",
+           static_cast<unsigned long long>(published), static_cast<unsigned long long>(received),
+           static_cast<unsigned long long>(published > received ? published - received : 0),
+           published ? 100.0 * (published > received ? published - received : 0) / published
+                     : 0.0,
+           static_cast<unsigned long long>(probe.unmatched()));
+    printf("status        %llu published, %llu received\n",
+           static_cast<unsigned long long>(counters.statusPublished.load()),
+           static_cast<unsigned long long>(probe.statusReceived()));
+    if (steadyS > 0) {
+        printf("sustained     %.0f msgs/s sent, %.0f msgs/s received, %.0f bytes/s after the ramp\n",
+               (published - rampPublished) / steadyS, (received - rampReceived) / steadyS,
+               (counters.bytes.load() - rampBytes) / steadyS);
+    }
+    printLatencies("latency", probe.latencies());
+    if (options.qos > 0) {
+        std::vector<uint32_t> acks;
+        for (auto &fleet : fleets) {
+            acks.insert(acks.end(), fleet->ackLatencies().begin(), fleet->ackLatencies().end());
+        }
+        printLatencies("puback", acks);
+        printf("window        %llu messages due with %u unacknowledged\n",
+               static_cast<unsigned long long>(counters.windowFull.load()),
+               static_cast<unsigned>(Fleet::kWindow));
+    }
+    printf("sessions      %llu connects, %llu failed, %llu dropped, %llu messages skipped\n",
+           static_cast<unsigned long long>(counters.connects.load()),
+           static_cast<unsigned long long>(counters.connectFailures.load()),
+           static_cast<unsigned long long>(counters.disconnects.load()),
+           static_cast<unsigned long long>(counters.skipped.load()));
+    return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file Scenario.cpp
+ * @brief Implementation of the simulation inputs.
+ */
+
+#include "config.h"
+#include "Scenario.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "NativeHal.h"
+
+namespace sim {
+
+Scenario::Scenario()
+    : _period(0), _repeat(false), _current(0), _passStart(0), _started(false), _wifiDown(false),
+      _brokerDown(false) {}
+
+bool Scenario::loadTrace(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    _rows.clear();
+    char line[160];
+    uint64_t first = 0;
+    float light = 0.0f;
+    while (fgets(line, sizeof(line), file)) {
+        if (!isdigit(static_cast<unsigned char>(line[0]))) {
+            continue;   // header or comment
+        }
+        char *p = line;
+        const uint64_t timestamp = strtoull(p, &p, 10);
+        if (_rows.empty()) {
+            first = timestamp;
+        }
+        float values[3] = {NAN, NAN, NAN};
+        for (float &v : values) {
+            if (*p == ',') {
+                ++p;
+                char *end;
+                const float parsed = strtof(p, &end);
+                if (end != p) {
+                    v = parsed;
+                }
+                p = end;
+            }
+        }
+        light = isnan(values[2]) ? light : values[2];
+        _rows.push_back({timestamp - first, values[0], values[1], light});
+    }
+    fclose(file);
+    finishTrace();
+    return !_rows.empty();
+}
+
+void Scenario::syntheticDay() {
+    _rows.clear();
+    const float pi = 3.14159265f;
+    for (uint32_t minute = 0; minute < 24 * 60; ++minute) {
+        const float hour = minute / 60.0f;
+        // Warmest and driest at 15:00
+        const float swing = cosf(2.0f * pi * (hour - 15.0f) / 24.0f);
+        const float sun = hour > 6.0f && hour < 18.0f ? sinf(pi * (hour - 6.0f) / 12.0f) : 0.0f;
+        const bool lamps = hour >= 8.0f && hour < 18.0f;
+        _rows.push_back({minute * 60000ull, 21.0f + 2.5f * swing, 50.0f - 8.0f * swing,
+                         300.0f + 2500.0f * sun + (lamps ? 800.0f : 0.0f)});
+    }
+    finishTrace();
+}
+
+void Scenario::finishTrace() {
+    const size_t n = _rows.size();
+    const uint64_t step = n > 1 ? _rows[n - 1].ms - _rows[n - 2].ms : 1000;
+    _period = n > 0 ? _rows[n - 1].ms + step : 0;
+    _current = 0;
+    _passStart = 0;
+    _started = false;
+}
+
+bool Scenario::down(bool broker, uint64_t nowMs) const {
+    for (const Outage &o : _outages) {
+        if (o.broker != broker || nowMs < o.startMs) {
+            continue;
+        }
+        const uint64_t t = o.periodMs > 0 ? (nowMs - o.startMs) % o.periodMs : nowMs - o.startMs;
+        if (t < o.durationMs) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scenario::advance(uint64_t nowMs, Timeline &timeline) {
+    if (!_rows.empty()) {
+        bool changed = !_started;
+        _started = true;
+        if (_repeat && nowMs - _passStart >= _period) {
+            _passStart += (nowMs - _passStart) / _period * _period;
+            _current = 0;
+            changed = true;
+        }
+        const uint64_t t = nowMs - _passStart;
+        while (_current + 1 < _rows.size() && _rows[_current + 1].ms <= t) {
+            ++_current;
+            changed = true;
+        }
+        if (changed) {
+            const TraceRow &row = _rows[_current];
+            hal::setDHTReading(row.temperature, row.humidity);
+            hal::setAnalogValue(LDR_PIN, static_cast<int>(lroundf(row.light)));
+        }
+    }
+
+    const bool wifiDown = down(false, nowMs);
+    if (wifiDown != _wifiDown) {
+        _wifiDown = wifiDown;
+        hal::setWiFiAvailable(!wifiDown);
+        timeline.record(nowMs, EVENT_WIFI, wifiDown ? "outage start" : "outage end");
+    }
+    const bool brokerDown = down(true, nowMs);
+    if (brokerDown != _brokerDown) {
+        _brokerDown = brokerDown;
+        hal::setMqttAvailable(!brokerDown);
+        timeline.record(nowMs, EVENT_WIFI, brokerDown ? "broker outage start" : "broker outage end");
+    }
+}
+
+} // namespace sim
@@ -0,0 +1,82 @@
+/**
+ * @file Scenario.h
+ * @brief Scripted inputs of a simulation: sensor trace and outages.
+ *
+ * The trace is a CSV of "timestamp_ms,temperature,humidity,light" rows
+ * (the BENCH_HISTORY_TRACE format; lines not starting with a digit are
+ * skipped), replayed relative to its first row: each row is what the DHT
+ * and the LDR return until the next one. An empty or unparsable
+ * temperature or humidity makes the DHT read fail; an empty light keeps
+ * the previous level. With repeat the trace starts over after its last
+ * row, so a recorded day can drive a simulated week.
+ *
+ * Outages take the access point (or the MQTT broker) away for a while,
+ * once or periodically. Everything is applied to the NativeHal stand-ins
+ * by advance(), which the simulator calls before every loop() pass.
+ */
+
+#ifndef SIM_SCENARIO_H
+#define SIM_SCENARIO_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "Timeline.h"
+
+namespace sim {
+
+struct TraceRow {
+    uint64_t ms;         ///< Relative to the first row
+    float temperature;   ///< NAN: the DHT read fails
+    float humidity;
+    float light;         ///< Raw ADC counts at the LDR pin
+};
+
+struct Outage {
+    bool broker;         ///< MQTT broker instead of the access point
+    uint64_t startMs;
+    uint64_t durationMs;
+    uint64_t periodMs;   ///< 0: once
+};
+
+class Scenario {
+public:
+    Scenario();
+
+    /** @return false if @p path cannot be read or holds no row. */
+    bool loadTrace(const char *path);
+
+    /**
+     * A built-in day without a trace file: temperature and humidity
+     * following the sun, daylight with dusk and dawn, lights off at night.
+     */
+    void syntheticDay();
+
+    void setRepeat(bool repeat) { _repeat = repeat; }
+    void addOutage(const Outage &outage) { _outages.push_back(outage); }
+
+    /** @return Duration of one pass through the trace in ms. */
+    uint64_t traceLength() const { return _period; }
+
+    /** Bring the stand-ins to the scripted state at @p nowMs. */
+    void advance(uint64_t nowMs, Timeline &timeline);
+
+private:
+    void finishTrace();
+    bool down(bool broker, uint64_t nowMs) const;
+
+    std::vector<TraceRow> _rows;
+    uint64_t _period;       ///< Length of the trace, one row step past the last
+    bool _repeat;
+    size_t _current;        ///< Row applied last
+    uint64_t _passStart;    ///< Start of the current repetition
+    bool _started;
+    std::vector<Outage> _outages;
+    bool _wifiDown;
+    bool _brokerDown;
+};
+
+} // namespace sim
+
+#endif // SIM_SCENARIO_H
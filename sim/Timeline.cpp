@@ -0,0 +1,74 @@
+/**
+ * @file Timeline.cpp
+ * @brief Implementation of the simulation timeline.
+ */
+
+#include "Timeline.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+namespace sim {
+
+namespace {
+
+const char *const kNames[EVENT_KINDS] = {"sample", "alert", "display", "upload", "publish",
+                                         "wifi"};
+
+} // namespace
+
+Timeline::Timeline() : _out(nullptr), _selected((1u << EVENT_KINDS) - 1), _counts() {}
+
+Timeline::~Timeline() {
+    if (_out && _out != stdout) {
+        fclose(_out);
+    }
+}
+
+bool Timeline::open(const char *path) {
+    _out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (_out) {
+        fprintf(_out, "time_ms,clock,event,detail\n");
+    }
+    return _out != nullptr;
+}
+
+bool Timeline::select(const char *list) {
+    _selected = 0;
+    while (*list) {
+        const size_t length = strcspn(list, ",");
+        bool known = false;
+        for (unsigned e = 0; e < EVENT_KINDS; ++e) {
+            if (strlen(kNames[e]) == length && strncmp(list, kNames[e], length) == 0) {
+                _selected |= 1u << e;
+                known = true;
+            }
+        }
+        if (!known) {
+            return false;
+        }
+        list += length + (list[length] == ',' ? 1 : 0);
+    }
+    return true;
+}
+
+void Timeline::record(uint64_t ms, TimelineEvent event, const char *format, ...) {
+    ++_counts[event];
+    if (!_out || !((_selected >> event) & 1u)) {
+        return;
+    }
+    const uint64_t s = ms / 1000;
+    fprintf(_out, "%llu,%llu+%02u:%02u:%02u.%03u,%s,", static_cast<unsigned long long>(ms),
+            static_cast<unsigned long long>(s / 86400), static_cast<unsigned>(s / 3600 % 24),
+            static_cast<unsigned>(s / 60 % 60), static_cast<unsigned>(s % 60),
+            static_cast<unsigned>(ms % 1000), kNames[event]);
+    va_list args;
+    va_start(args, format);
+    vfprintf(_out, format, args);
+    va_end(args);
+    fputc('\n', _out);
+}
+
+const char *Timeline::name(TimelineEvent event) { return kNames[event]; }
+
+} // namespace sim
@@ -0,0 +1,69 @@
+/**
+ * @file Timeline.h
+ * @brief Event log of a simulation run.
+ *
+ * One CSV row per event: virtual time in milliseconds, the same time as
+ * day+hh:mm:ss.mmm, the event kind and a space-separated detail, e.g.
+ *
+ *     3600010,0+01:00:00.010,sample,t=21.00 h=45.00
+ *
+ * Events of every kind are counted for the summary; only the selected
+ * kinds are written.
+ */
+
+#ifndef SIM_TIMELINE_H
+#define SIM_TIMELINE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace sim {
+
+enum TimelineEvent {
+    EVENT_SAMPLE,    ///< Sensor read, with the raw values of its channels
+    EVENT_ALERT,     ///< Alert state change and LED level
+    EVENT_DISPLAY,   ///< Display redraw, with a checksum of the frame
+    EVENT_UPLOAD,    ///< Upload attempts and their outcome (uploader counters)
+    EVENT_PUBLISH,   ///< Message accepted by the MQTT stand-in
+    EVENT_WIFI,      ///< Link changes and scripted outages
+    EVENT_KINDS
+};
+
+class Timeline {
+public:
+    Timeline();
+    ~Timeline();
+
+    /**
+     * Write rows to @p path ("-" for stdout).
+     *
+     * @return false if the file cannot be created
+     */
+    bool open(const char *path);
+
+    /**
+     * Write only the kinds in @p list, comma-separated names as in the
+     * rows ("sample,alert").
+     *
+     * @return false on an unknown name
+     */
+    bool select(const char *list);
+
+    /** Count an event at @p ms and write it if selected. */
+    void record(uint64_t ms, TimelineEvent event, const char *format, ...)
+        __attribute__((format(printf, 4, 5)));
+
+    uint64_t count(TimelineEvent event) const { return _counts[event]; }
+    bool writesTo(FILE *stream) const { return _out == stream; }
+
+    static const char *name(TimelineEvent event);
+
+private:
+    FILE *_out;
+    unsigned _selected;   ///< Bit per TimelineEvent
+    uint64_t _counts[EVENT_KINDS];
+};
+
+} // namespace sim
+
+#endif // SIM_TIMELINE_H
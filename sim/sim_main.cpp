@@ -0,0 +1,408 @@
+/**
+ * @file sim_main.cpp
+ * @brief Discrete-event simulation of the firmware on the virtual clock.
+ *
+ * Runs setup() and loop() of src/main.cpp, unchanged, against the
+ * NativeHal stand-ins. Every loop() pass ends in delay(), which advances
+ * the virtual clock instead of waiting, so a simulated week takes seconds.
+ * Before each pass the Scenario brings the sensors and the network to
+ * their scripted state; after it the simulator plays the tasks the ESP32
+ * would run next to loop() (the upload worker and the log drain), then
+ * compares what the firmware did with the previous pass and writes the
+ * differences to the Timeline: sensor reads, alert changes, display
+ * redraws, upload attempts, published messages and link changes.
+ *
+ * Usage (`pio run -e native_sim`, then run .pio/build/native_sim/program):
+ *
+ *     program [--duration 7d] [--trace day.csv] [--repeat]
+ *             [--outage 30h+45m[@1d]] [--broker-outage 2d+10m]
+ *             [--timeline out.csv|-] [--events sample,alert,...]
+ *             [--frames dir] [--serial]
+ *
+ * Durations take ms, s, m, h or d (seconds without a unit). An outage is
+ * START+DURATION, repeated every PERIOD after '@'. Without --trace the
+ * built-in day of Scenario::syntheticDay() repeats. A summary of the run
+ * (speed, CPU time per pass, samples, alerts, frames, uploads, the flash
+ * log and uplink bytes per day) goes to stdout, or to stderr when the timeline does.
+ *
+ * Configuration changes are compile-time, as on the device: build with
+ * other values, e.g. PLATFORMIO_BUILD_FLAGS="-DADAPTIVE_SAMPLING=0".
+ * Only the polled loop can be simulated: the task pipeline needs the
+ * FreeRTOS scheduler, and a deep sleep would have to rebuild every
+ * global object. The upload worker runs between passes rather than
+ * concurrently, so upload latency delays the next pass. Sensor reads are
+ * taken from the SensorRegistry of the polled loop; with light sleep the
+ * timeline has no sample rows.
+ */
+
+#include <Arduino.h>
+#include "config.h"
+
+#include <DHT.h>
+#include <WiFi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <chrono>
+
+#include "NativeHal.h"
+#include "Scenario.h"
+#include "Timeline.h"
+#include "connectivity/CloudUploader.h"
+#include "sensors/SensorRegistry.h"
+#include "utils/AlertManager.h"
+#include "utils/BinaryLog.h"
+#if STORE_AND_FORWARD
+#include "storage/FlashLog.h"
+#endif
+
+#if USE_TASK_PIPELINE
+#error "The simulator runs the polled loop: build with USE_TASK_PIPELINE=0"
+#endif
+#if LOW_POWER_MODE == LOW_POWER_DEEP
+#error "The simulator cannot reboot the firmware after a deep sleep"
+#endif
+
+#if LOW_POWER_MODE == LOW_POWER_OFF
+// Globals of src/main.cpp, observed between passes
+extern SensorRegistry<> sensorRegistry;
+#endif
+extern AlertManager alertManager;
+extern CloudUploader cloudUploader;
+#if STORE_AND_FORWARD
+extern FlashLog flashLog;
+#endif
+
+namespace {
+
+using sim::Timeline;
+
+const char *const kAlertNames[] = {"ok",       "temp_high", "temp_low",   "humid_high",
+                                   "humid_low", "light_low", "temp_rising"};
+
+Timeline s_timeline;
+
+void onPublish(const char *topic, const uint8_t *payload, size_t length) {
+    (void)payload;
+    s_timeline.record(hal::nowMicros() / 1000, sim::EVENT_PUBLISH, "%s %u bytes", topic,
+                      static_cast<unsigned>(length));
+}
+
+/** @return false on a malformed duration. */
+bool parseDuration(const char *text, const char **end, uint64_t &ms) {
+    char *unit;
+    const double value = strtod(text, &unit);
+    if (unit == text || value < 0) {
+        return false;
+    }
+    double scale = 1000.0;
+    if (strncmp(unit, "ms", 2) == 0) {
+        scale = 1.0;
+        unit += 2;
+    } else if (*unit == 's' || *unit == 'm' || *unit == 'h' || *unit == 'd') {
+        scale = *unit == 's' ? 1e3 : *unit == 'm' ? 6e4 : *unit == 'h' ? 3.6e6 : 8.64e7;
+        ++unit;
+    }
+    ms = static_cast<uint64_t>(value * scale + 0.5);
+    if (end) {
+        *end = unit;
+    } else if (*unit != '\0') {
+        return false;
+    }
+    return true;
+}
+
+/** START+DURATION[@PERIOD] */
+bool parseOutage(const char *text, bool broker, sim::Outage &outage) {
+    const char *p;
+    outage = sim::Outage{broker, 0, 0, 0};
+    if (!parseDuration(text, &p, outage.startMs) || *p != '+' ||
+        !parseDuration(p + 1, &p, outage.durationMs)) {
+        return false;
+    }
+    if (*p == '@') {
+        return parseDuration(p + 1, nullptr, outage.periodMs) &&
+               outage.periodMs > outage.durationMs;
+    }
+    return *p == '\0';
+}
+
+uint32_t frameChecksum(const uint8_t *ram) {
+    uint32_t hash = 2166136261u;   // FNV-1a
+    for (size_t i = 0; i < 1024; ++i) {
+        hash = (hash ^ ram[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/** Write the 128x64 GDDRAM (pages of 8 rows, LSB on top) as a PBM image. */
+void writeFrame(const char *dir, uint64_t ms, const uint8_t *ram) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/frame_%010llu.pbm", dir, static_cast<unsigned long long>(ms));
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return;
+    }
+    fprintf(file, "P4\n128 64\n");
+    for (unsigned y = 0; y < 64; ++y) {
+        uint8_t row[16] = {};
+        for (unsigned x = 0; x < 128; ++x) {
+            if ((ram[(y / 8) * 128 + x] >> (y % 8)) & 1u) {
+                row[x / 8] |= static_cast<uint8_t>(0x80u >> (x % 8));
+            }
+        }
+        fwrite(row, 1, sizeof(row), file);
+    }
+    fclose(file);
+}
+
+/** State of the firmware after the previous pass, to report differences. */
+struct Observer {
+#if LOW_POWER_MODE == LOW_POWER_OFF
+    uint32_t samples[SENSOR_MAX_SENSORS];
+#endif
+    AlertState alert;
+    int led;
+    uint32_t i2cTransactions;
+    uint64_t i2cBytes;
+    uint32_t frame;
+    UploadStats uploads;
+    bool connected;
+    const char *framesDir;
+    uint64_t distinctFrames;
+    uint64_t ledOnMs;
+    uint64_t connectedMs;
+
+    /**
+     * @param ms    Start of the pass: when loop() sampled, alerted and drew
+     * @param endMs After the upload worker ran
+     */
+    void observe(uint64_t ms, uint64_t endMs) {
+        ledOnMs += led ? endMs - ms : 0;
+        connectedMs += connected ? endMs - ms : 0;
+#if LOW_POWER_MODE == LOW_POWER_OFF
+        char detail[160];
+        for (size_t s = 0; s < sensorRegistry.sensorCount(); ++s) {
+            const size_t first = sensorRegistry.firstChannel(s);
+            if (sensorRegistry.sampleCount(first) == samples[s]) {
+                continue;
+            }
+            samples[s] = sensorRegistry.sampleCount(first);
+            size_t length = 0;
+            for (size_t c = first; c < first + sensorRegistry.sensorChannels(s); ++c) {
+                length += snprintf(detail + length, sizeof(detail) - length, "%s%s=%.2f",
+                                   c > first ? " " : "", sensorRegistry.spec(c).key,
+                                   sensorRegistry.latest(c));
+                length = length < sizeof(detail) ? length : sizeof(detail) - 1;
+            }
+            s_timeline.record(ms, sim::EVENT_SAMPLE, "%s", detail);
+        }
+#endif
+        const AlertState state = alertManager.getState();
+        const int level = hal::pinLevel(LED_ALERT_PIN);
+        if (state != alert || level != led) {
+            alert = state;
+            led = level;
+            s_timeline.record(ms, sim::EVENT_ALERT, "%s led=%s", kAlertNames[state],
+                              level ? "on" : "off");
+        }
+
+        if (hal::i2cTransactions() != i2cTransactions) {
+            const uint8_t *ram = hal::ssd1306Ram();
+            const uint32_t checksum = frameChecksum(ram);
+            const bool changed = checksum != frame;
+            s_timeline.record(ms, sim::EVENT_DISPLAY, "crc=%08x %s i2c=%llu bytes",
+                              static_cast<unsigned>(checksum), changed ? "changed" : "same",
+                              static_cast<unsigned long long>(hal::i2cBytesWritten() - i2cBytes));
+            if (changed) {
+                ++distinctFrames;
+                if (framesDir) {
+                    writeFrame(framesDir, ms, ram);
+                }
+            }
+            frame = checksum;
+            i2cTransactions = hal::i2cTransactions();
+            i2cBytes = hal::i2cBytesWritten();
+        }
+
+        const UploadStats now = cloudUploader.getStats();
+        if (now.sent != uploads.sent || now.failed != uploads.failed ||
+            now.suppressed != uploads.suppressed || now.dropped != uploads.dropped ||
+            now.expired != uploads.expired) {
+            s_timeline.record(endMs, sim::EVENT_UPLOAD,
+                              "sent=%u failed=%u suppressed=%u dropped=%u expired=%u queued=%u "
+                              "latency=%ums",
+                              static_cast<unsigned>(now.sent - uploads.sent),
+                              static_cast<unsigned>(now.failed - uploads.failed),
+                              static_cast<unsigned>(now.suppressed - uploads.suppressed),
+                              static_cast<unsigned>(now.dropped - uploads.dropped),
+                              static_cast<unsigned>(now.expired - uploads.expired),
+                              static_cast<unsigned>(now.queueDepth),
+                              static_cast<unsigned>(now.lastLatencyMs));
+            uploads = now;
+        }
+
+        const bool link = WiFi.status() == WL_CONNECTED;
+        if (link != connected) {
+            connected = link;
+            s_timeline.record(endMs, sim::EVENT_WIFI, link ? "connected" : "disconnected");
+        }
+    }
+};
+
+Observer s_observer;
+
+void summary(FILE *out, uint64_t virtualMs, double wallSeconds, uint64_t passes,
+             double firmwareSeconds) {
+    const double days = virtualMs / 86400000.0;
+    const UploadStats &u = s_observer.uploads;
+    const hal::NetStats &mqtt = hal::mqttStats();
+    const hal::NetStats &http = hal::httpStats();
+    const LogStats log = binaryLog.getStats();
+    fprintf(out, "virtual time  %.2f days (%llu s)\n", days,
+            static_cast<unsigned long long>(virtualMs / 1000));
+    fprintf(out, "wall time     %.2f s, %.0fx real time\n", wallSeconds,
+            wallSeconds > 0 ? virtualMs / 1000.0 / wallSeconds : 0.0);
+    fprintf(out, "loop passes   %llu, %.0f ns host CPU each (loop, upload worker, log drain)\n",
+            static_cast<unsigned long long>(passes),
+            passes > 0 ? firmwareSeconds * 1e9 / passes : 0.0);
+    fprintf(out, "samples       %llu reads (%.0f/day)\n",
+            static_cast<unsigned long long>(s_timeline.count(sim::EVENT_SAMPLE)),
+            s_timeline.count(sim::EVENT_SAMPLE) / days);
+    fprintf(out, "alerts        %llu changes, LED on %.1f%% of the time\n",
+            static_cast<unsigned long long>(s_timeline.count(sim::EVENT_ALERT)),
+            100.0 * s_observer.ledOnMs / virtualMs);
+    fprintf(out, "display       %llu redraws, %llu changed frames, %.0f I2C bytes/day\n",
+            static_cast<unsigned long long>(s_timeline.count(sim::EVENT_DISPLAY)),
+            static_cast<unsigned long long>(s_observer.distinctFrames),
+            hal::i2cBytesWritten() / days);
+    fprintf(out, "uploads       sent %u, failed %u, suppressed %u, dropped %u, expired %u\n",
+            static_cast<unsigned>(u.sent), static_cast<unsigned>(u.failed),
+            static_cast<unsigned>(u.suppressed), static_cast<unsigned>(u.dropped),
+            static_cast<unsigned>(u.expired));
+#if STORE_AND_FORWARD
+    const FlashLogStats &flash = flashLog.getStats();
+    fprintf(out, "flash log     stored %u, committed %u, pending %u, overwritten %u; "
+                 "replays delivered %u, failed %u\n",
+            static_cast<unsigned>(flash.appended), static_cast<unsigned>(flash.replayed),
+            static_cast<unsigned>(flashLog.pending()), static_cast<unsigned>(flash.overwritten),
+            static_cast<unsigned>(u.replayed), static_cast<unsigned>(u.replayFailed));
+#endif
+    fprintf(out, "uplink/day    MQTT %.0f msgs %.0f wire bytes, HTTP %.0f requests %.0f wire bytes\n",
+            mqtt.requests / days, mqtt.wireBytes / days, http.requests / days,
+            http.wireBytes / days);
+    fprintf(out, "wifi          connected %.1f%% of the time, %llu link events\n",
+            100.0 * s_observer.connectedMs / virtualMs,
+            static_cast<unsigned long long>(s_timeline.count(sim::EVENT_WIFI)));
+    fprintf(out, "serial        %.0f bytes/day, %u log records dropped\n",
+            hal::serialBytesWritten() / days, static_cast<unsigned>(log.dropped));
+}
+
+int usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--duration 7d] [--trace file.csv] [--repeat] [--outage START+DUR[@PERIOD]]\n"
+            "       [--broker-outage START+DUR[@PERIOD]] [--timeline file|-] [--events list]\n"
+            "       [--frames dir] [--serial]\n",
+            program);
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    uint64_t durationMs = 86400000ull;
+    sim::Scenario scenario;
+    bool traced = false;
+    bool repeat = false;
+    bool serial = false;
+    const char *timelinePath = nullptr;
+    const char *events = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        sim::Outage outage;
+        if (strcmp(arg, "--repeat") == 0) {
+            repeat = true;
+        } else if (strcmp(arg, "--serial") == 0) {
+            serial = true;
+        } else if (!value) {
+            return usage(argv[0]);
+        } else if (strcmp(arg, "--duration") == 0) {
+            if (!parseDuration(value, nullptr, durationMs)) {
+                return usage(argv[0]);
+            }
+            ++i;
+        } else if (strcmp(arg, "--trace") == 0) {
+            if (!scenario.loadTrace(value)) {
+                fprintf(stderr, "cannot read trace %s\n", value);
+                return 1;
+            }
+            traced = true;
+            ++i;
+        } else if (strcmp(arg, "--outage") == 0 || strcmp(arg, "--broker-outage") == 0) {
+            if (!parseOutage(value, arg[2] == 'b', outage)) {
+                return usage(argv[0]);
+            }
+            scenario.addOutage(outage);
+            ++i;
+        } else if (strcmp(arg, "--timeline") == 0) {
+            timelinePath = value;
+            ++i;
+        } else if (strcmp(arg, "--events") == 0) {
+            events = value;
+            ++i;
+        } else if (strcmp(arg, "--frames") == 0) {
+            s_observer.framesDir = value;
+            mkdir(value, 0755);
+            ++i;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (!traced) {
+        scenario.syntheticDay();
+        repeat = true;
+    }
+    scenario.setRepeat(repeat);
+    if (timelinePath && !s_timeline.open(timelinePath)) {
+        fprintf(stderr, "cannot write %s\n", timelinePath);
+        return 1;
+    }
+    if (events && !s_timeline.select(events)) {
+        fprintf(stderr, "unknown event in %s\n", events);
+        return usage(argv[0]);
+    }
+
+    // Raw log frames are binary: echo them only on request
+    hal::setSerialEcho(serial);
+    hal::setDHTType(DHT_TYPE);
+    hal::setMqttPublishHook(onPublish);
+    scenario.advance(0, s_timeline);
+
+    const auto wallStart = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration firmware{};
+    uint64_t passes = 0;
+    uint64_t now = 0;
+    setup();
+    while ((now = hal::nowMicros() / 1000) < durationMs) {
+        scenario.advance(now, s_timeline);
+        const auto start = std::chrono::steady_clock::now();
+        loop();
+        // The tasks that run next to loop() on the ESP32
+        while (cloudUploader.process()) {
+        }
+        binaryLog.drain();
+        firmware += std::chrono::steady_clock::now() - start;
+        ++passes;
+        s_observer.observe(now, hal::nowMicros() / 1000);
+    }
+    const double wall =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    hal::setMqttPublishHook(nullptr);
+
+    summary(s_timeline.writesTo(stdout) ? stderr : stdout, now, wall, passes,
+            std::chrono::duration<double>(firmware).count());
+    return 0;
+}
@@ -7,63 +7,848 @@
 #include "secret.h"
 #include "connectivity/CloudUploader.h"
 
-CloudUploader::CloudUploader() : _mqttClient(_wifiClient) {}
+#include <ArduinoJson.h>
+#include "utils/CborWriter.h"
+#include "utils/BinaryLog.h"
+#include "utils/HeapStats.h"
+#include "utils/WallClock.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#ifndef THINGSPEAK_CHANNEL_ID
+#define THINGSPEAK_CHANNEL_ID   "0"     // Set the real channel in secret.h
+#endif
+
+namespace {
+
+const char kBulkUpdateUri[] = "/channels/" THINGSPEAK_CHANNEL_ID "/bulk_update.json";
+
+/** Format @p epoch as ISO 8601 UTC, as ThingSpeak's created_at expects. */
+void formatIsoTime(char *out, size_t size, uint32_t epoch) {
+    const time_t seconds = static_cast<time_t>(epoch);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    strftime(out, size, "%Y-%m-%dT%H:%M:%SZ", &utc);
+}
+
+/** Round to two decimals, the resolution ThingSpeak fields are shown with. */
+float round2(float value) {
+    return roundf(value * 100.0f) / 100.0f;
+}
+
+/**
+ * Format @p value with two decimals using integer arithmetic only; the
+ * printf float path of newlib may allocate on first use.
+ */
+int formatFixed2(char *out, size_t size, float value) {
+    const long hundredths = lroundf(value * 100.0f);
+    const unsigned long magnitude =
+        static_cast<unsigned long>(hundredths < 0 ? -hundredths : hundredths);
+    return snprintf(out, size, "%s%lu.%02lu", hundredths < 0 ? "-" : "", magnitude / 100,
+                    magnitude % 100);
+}
+
+} // namespace
+
+CloudUploader::CloudUploader()
+    : _mqtt(MQTT_SERVER, MQTT_PORT), _mqttQos(MQTT_QOS), _target(UPLOAD_AUTO),
+      _policy(UPLOAD_OVERFLOW_POLICY),
+      _payloadFormat(MQTT_PAYLOAD_FORMAT), _mqttSequence(0), _overflow(), _hasOverflow(false), _stats(),
+      _reportOnDelta(REPORT_ON_DELTA), _batch(), _batchCount(0),
+      _batchSize(THINGSPEAK_BATCH_SIZE), _batchStarted(0), _lastHeapReport(0), _replayAcks(),
+      _replayAckHead(0), _replayAckCount(0),
+      _http(THINGSPEAK_SERVER, THINGSPEAK_PORT) {}
 
 void CloudUploader::begin() {
-    // Configure MQTT server; connection will be attempted lazily on publish
-    _mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
+    // Bound every request so the worker cannot hang on a dead server
+    _http.setTimeouts(UPLOAD_CONNECT_TIMEOUT, UPLOAD_REQUEST_TIMEOUT);
+    _lastHeapReport = millis();
+    _mqtt.setTimeouts(UPLOAD_CONNECT_TIMEOUT, UPLOAD_REQUEST_TIMEOUT);
+    // The broker resumes the session by client ID, so it must survive
+    // reboots: derive it from the MAC, not from the time
+    char clientId[48];
+    snprintf(clientId, sizeof(clientId), "%s-%06lx", MQTT_CLIENT_ID,
+             static_cast<unsigned long>(ESP.getEfuseMac() & 0xFFFFFF));
+    _mqtt.setClientId(clientId);
+#if UPLOAD_ASYNC && defined(ARDUINO_ARCH_ESP32)
+    xTaskCreatePinnedToCore(workerTask, "upload", UPLOAD_TASK_STACK, this,
+                            UPLOAD_TASK_PRIORITY, nullptr, UPLOAD_TASK_CORE);
+#endif
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+void CloudUploader::workerTask(void *arg) {
+    CloudUploader *self = static_cast<CloudUploader *>(arg);
+    for (;;) {
+        if (!self->process()) {
+            vTaskDelay(pdMS_TO_TICKS(UPLOAD_WORKER_IDLE_MS));
+        }
+    }
 }
+#endif
 
 void CloudUploader::upload(float temperature, float humidity, int light) {
-    // Determine whether to use ThingSpeak: require API key not equal to default
-    const bool useThingSpeak = (strlen(THINGSPEAK_API_KEY) > 0 &&
-                                String(THINGSPEAK_API_KEY) != String("YourThingSpeakAPIKey"));
-    if (useThingSpeak) {
-        uploadThingSpeak(temperature, humidity, light);
+    SensorReading reading;
+    reading.timestamp   = millis();
+    reading.temperature = temperature;
+    reading.humidity    = humidity;
+    reading.light       = light;
+    reading.flags       = 0;
+    if (_reportOnDelta) {
+        // The message always carries all three values; they become the
+        // reported ones once it was delivered (reportDelivered())
+        applyDelivered();
+        const float values[3] = {temperature, humidity, static_cast<float>(light)};
+        if (_reporter.changed(values, 3, reading.timestamp) == 0) {
+            ++_stats.suppressed;
+            return;
+        }
+        if (_reporter.heartbeatDue(reading.timestamp)) {
+            ++_stats.heartbeats;
+        }
+    }
+#if UPLOAD_ASYNC
+    enqueue(reading);
+#else
+    deliver(reading);
+    flushStaleBatch();
+#endif
+}
+
+void CloudUploader::enqueue(const SensorReading &reading) {
+    // A reading held aside earlier goes first so ordering is preserved
+    if (_hasOverflow && _queue.push(_overflow)) {
+        _hasOverflow = false;
+        ++_stats.enqueued;
+    }
+    if (!_hasOverflow && _queue.push(reading)) {
+        ++_stats.enqueued;
+    } else if (_policy == UPLOAD_COALESCE) {
+        if (_hasOverflow) {
+            ++_stats.coalesced;
+        }
+        _overflow = reading;
+        _hasOverflow = true;
+    } else {
+        ++_stats.dropped;
+    }
+    const uint32_t depth = static_cast<uint32_t>(_queue.size());
+    if (depth > _stats.maxQueueDepth) {
+        _stats.maxQueueDepth = depth;
+    }
+}
+
+bool CloudUploader::enqueueReplay(const SensorReading &reading) {
+#if UPLOAD_ASYNC
+    // Live readings held aside under UPLOAD_COALESCE take precedence
+    if (_hasOverflow || !_queue.push(reading)) {
+        return false;
+    }
+    ++_stats.enqueued;
+    return true;
+#else
+    // Sent (or batched) now; the outcome is counted by settleReplay()
+    deliver(reading);
+    return true;
+#endif
+}
+
+size_t CloudUploader::queueDepth() const {
+    return _queue.size() + _frames.size() + _messages.size();
+}
+
+void CloudUploader::uploadChannels(const ChannelView &channels) {
+    const uint32_t now = millis();
+    // Channels past the eighth have no ThingSpeak field; they are not sent
+    const size_t limit = useThingSpeak() ? kThingSpeakFields : SENSOR_MAX_CHANNELS;
+    const size_t count = channels.count < limit ? channels.count : limit;
+    ChannelMask mask = CHANNEL_MASK_ALL;
+    if (_reportOnDelta) {
+        applyDelivered();
+        mask = _reporter.changed(channels.values, count, now);
+        if (mask == 0) {
+            ++_stats.suppressed;
+            return;
+        }
+        if (_reporter.heartbeatDue(now)) {
+            ++_stats.heartbeats;
+        }
+    }
+#if UPLOAD_ASYNC
+    ChannelFrame frame;
+    frame.timestamp = now;
+    frame.count = count;
+    frame.specs = channels.specs;
+    frame.mask = mask;
+    memcpy(frame.values, channels.values, frame.count * sizeof(float));
+    if (_frames.push(frame)) {
+        ++_stats.enqueued;
+    } else {
+        ++_stats.dropped;
+    }
+#else
+    deliverChannels(ChannelView{count, channels.specs, channels.values}, now, mask);
+    flushStaleBatch();
+#endif
+}
+
+void CloudUploader::uploadHistory(const uint8_t *block, size_t length) {
+    uploadMessage(MessageUpload{MQTT_TOPIC_HISTORY, block, length});
+}
+
+bool CloudUploader::sendHistory(const uint8_t *block, size_t length) {
+    return sendMessage(MessageUpload{MQTT_TOPIC_HISTORY, block, length});
+}
+
+void CloudUploader::uploadProfile(const char *payload, size_t length) {
+    uploadMessage(
+        MessageUpload{MQTT_TOPIC_PROFILE, reinterpret_cast<const uint8_t *>(payload), length});
+}
+
+void CloudUploader::uploadMessage(const MessageUpload &message) {
+#if UPLOAD_ASYNC
+    if (_messages.push(message)) {
+        ++_stats.enqueued;
+    } else {
+        ++_stats.dropped;
+    }
+#else
+    const uint32_t start = millis();
+    if (sendMessage(message)) {
+        ++_stats.sent;
+    } else {
+        ++_stats.failed;
+    }
+    recordLatency(millis() - start);
+#endif
+}
+
+bool CloudUploader::sendMessage(const MessageUpload &message) {
+    if (useThingSpeak() || !message.payload || message.length == 0 || !connectMQTT()) {
+        return false;
+    }
+    return _mqtt.publish(message.topic, message.payload, message.length, 0);
+}
+
+void CloudUploader::loop() {
+    if (useThingSpeak()) {
+        // Without the worker nothing else sends a partial batch
+        flushStaleBatch();
+        return;
+    }
+    _mqtt.loop();
+    collectReplayAcks();
+}
+
+bool CloudUploader::process() {
+    loop();
+    ChannelFrame frame;
+    if (_frames.pop(frame)) {
+        if (millis() - frame.timestamp > UPLOAD_DEADLINE) {
+            ++_stats.expired;
+            return true;
+        }
+        deliverChannels(ChannelView{frame.count, frame.specs, frame.values}, frame.timestamp,
+                        frame.mask);
+        return true;
+    }
+    SensorReading reading;
+    if (!_queue.pop(reading)) {
+        // History and profiles go after live data; they are old by design, no deadline
+        MessageUpload message;
+        if (_messages.pop(message)) {
+            const uint32_t start = millis();
+            if (sendMessage(message)) {
+                ++_stats.sent;
+            } else {
+                ++_stats.failed;
+            }
+            recordLatency(millis() - start);
+            return true;
+        }
+        // Do not hold a partial batch forever when readings are sparse
+        const size_t batched = _batchCount;
+        flushStaleBatch();
+        return _batchCount != batched;
+    }
+    if (!(reading.flags & READING_REPLAYED) && millis() - reading.timestamp > UPLOAD_DEADLINE) {
+        // Too old to be useful; do not spend radio time on it. Replayed
+        // readings are old by design and exempt.
+        ++_stats.expired;
+        return true;
+    }
+    deliver(reading);
+    return true;
+}
+
+void CloudUploader::deliver(const SensorReading &reading) {
+    if (_batchSize > 1 && useThingSpeak()) {
+        addToBatch(bulkEntry(reading));
+        return;
+    }
+    const uint32_t start = millis();
+    const bool ok = sendReading(reading);
+    if (ok) {
+        ++_stats.sent;
+        reportDelivered(bulkEntry(reading));
+    } else {
+        ++_stats.failed;
+    }
+    settleReplay(reading.flags, ok);
+    recordLatency(millis() - start);
+    reportHeap();
+}
+
+void CloudUploader::deliverChannels(const ChannelView &channels, uint32_t timestamp,
+                                    ChannelMask mask) {
+    if (_batchSize > 1 && useThingSpeak()) {
+        // Fields 1-8 of the same bulk update as the readings
+        BulkEntry entry;
+        entry.timestamp = timestamp;
+        entry.flags = 0;
+        entry.count = static_cast<uint8_t>(channels.count < kThingSpeakFields ? channels.count
+                                                                              : kThingSpeakFields);
+        entry.mask = mask;
+        memcpy(entry.fields, channels.values, entry.count * sizeof(float));
+        addToBatch(entry);
+        return;
+    }
+    const uint32_t start = millis();
+    if (sendChannels(channels, timestamp, mask)) {
+        ++_stats.sent;
+        reportDelivered(channels.values, channels.count, mask, timestamp);
     } else {
-        uploadMQTT(temperature, humidity, light);
+        ++_stats.failed;
+    }
+    recordLatency(millis() - start);
+    reportHeap();
+}
+
+void CloudUploader::addToBatch(const BulkEntry &entry) {
+    if (_batchCount == 0) {
+        _batchStarted = millis();
+    }
+    _batch[_batchCount++] = entry;
+    if (_batchCount >= _batchSize) {
+        flushBatch();
+    }
+}
+
+void CloudUploader::flushBatch() {
+    if (_batchCount == 0) {
+        return;
+    }
+    const uint32_t start = millis();
+    const bool ok = uploadThingSpeakBulk(_batch, _batchCount);
+    if (ok) {
+        _stats.sent += _batchCount;
+    } else {
+        _stats.failed += _batchCount;
+    }
+    for (size_t i = 0; i < _batchCount; ++i) {
+        if (ok) {
+            reportDelivered(_batch[i]);
+        }
+        settleReplay(_batch[i].flags, ok);
+    }
+    recordLatency(millis() - start);
+    _batchCount = 0;
+    reportHeap();
+}
+
+void CloudUploader::reportHeap() {
+#if HEAP_REPORT_INTERVAL > 0
+    if (millis() - _lastHeapReport < HEAP_REPORT_INTERVAL) {
+        return;
+    }
+    _lastHeapReport = millis();
+    const HeapStats heap = readHeapStats();
+    LOG_INFO("Heap: %lu free, %lu largest block, %lu minimum",
+             static_cast<unsigned long>(heap.freeBytes),
+             static_cast<unsigned long>(heap.largestFreeBlock),
+             static_cast<unsigned long>(heap.minFreeBytes));
+    if (!useThingSpeak() && _mqtt.connected()) {
+        char payload[MQTT_PAYLOAD_MAX];
+        const size_t length = formatHeapStats(heap, payload, sizeof(payload));
+        if (length > 0) {
+            _mqtt.publish(MQTT_TOPIC_STATUS, reinterpret_cast<const uint8_t *>(payload), length,
+                          0);
+        }
+    }
+#endif
+}
+
+void CloudUploader::settleReplay(uint8_t flags, bool ok) {
+    if (!(flags & READING_REPLAYED)) {
+        return;
+    }
+    if (!ok) {
+        ++_stats.replayFailed;
+    } else if (!useThingSpeak() && _mqttQos > 0 && _replayAckCount < MQTT_INFLIGHT_MAX) {
+        // In the window only; delivered once the broker acknowledges it
+        _replayAcks[(_replayAckHead + _replayAckCount++) % MQTT_INFLIGHT_MAX] =
+            _mqtt.lastPacketId();
+    } else {
+        ++_stats.replayed;
+    }
+}
+
+void CloudUploader::reportDelivered(const BulkEntry &entry) {
+    // Replayed readings are old; the reported values follow live data
+    if (!(entry.flags & READING_REPLAYED)) {
+        reportDelivered(entry.fields, entry.count, entry.mask, entry.timestamp);
+    }
+}
+
+void CloudUploader::reportDelivered(const float *values, size_t count, ChannelMask mask,
+                                    uint32_t timestamp) {
+    if (!_reportOnDelta) {
+        return;
+    }
+#if UPLOAD_ASYNC
+    // The producer owns the reporter and applies this on its next upload.
+    // If the ring is full the change is only reported once more.
+    ChannelFrame frame;
+    frame.timestamp = timestamp;
+    frame.count = count;
+    frame.specs = nullptr;
+    frame.mask = mask;
+    memcpy(frame.values, values, count * sizeof(float));
+    _delivered.push(frame);
+#else
+    _reporter.reported(values, count, mask, timestamp);
+#endif
+}
+
+void CloudUploader::applyDelivered() {
+#if UPLOAD_ASYNC
+    ChannelFrame frame;
+    while (_delivered.pop(frame)) {
+        _reporter.reported(frame.values, frame.count, frame.mask, frame.timestamp);
+    }
+#endif
+}
+
+void CloudUploader::collectReplayAcks() {
+    while (_replayAckCount > 0 && !_mqtt.pending(_replayAcks[_replayAckHead])) {
+        _replayAckHead = (_replayAckHead + 1) % MQTT_INFLIGHT_MAX;
+        --_replayAckCount;
+        ++_stats.replayed;
+    }
+}
+
+void CloudUploader::flushStaleBatch() {
+    if (_batchCount > 0 && millis() - _batchStarted >= THINGSPEAK_BATCH_MAX_AGE) {
+        flushBatch();
+    }
+}
+
+void CloudUploader::recordLatency(uint32_t latencyMs) {
+    _stats.lastLatencyMs = latencyMs;
+    _stats.totalLatencyMs += latencyMs;
+    if (latencyMs > _stats.maxLatencyMs) {
+        _stats.maxLatencyMs = latencyMs;
+    }
+}
+
+UploadStats CloudUploader::getStats() const {
+    UploadStats stats = _stats;
+    stats.queueDepth = static_cast<uint32_t>(_queue.size() + _frames.size() + _messages.size());
+    return stats;
+}
+
+bool CloudUploader::useThingSpeak() const {
+    if (_target != UPLOAD_AUTO) {
+        return _target == UPLOAD_THINGSPEAK;
+    }
+    // Require an API key that is not the placeholder
+    return strlen(THINGSPEAK_API_KEY) > 0 &&
+           strcmp(THINGSPEAK_API_KEY, "YourThingSpeakAPIKey") != 0;
+}
+
+bool CloudUploader::send(float temperature, float humidity, int light) {
+    SensorReading reading;
+    reading.timestamp   = millis();
+    reading.temperature = temperature;
+    reading.humidity    = humidity;
+    reading.light       = light;
+    reading.flags       = 0;
+    return sendReading(reading);
+}
+
+size_t CloudUploader::sendBatch(const SensorReading *readings, size_t count) {
+#if UPLOAD_ASYNC && defined(ARDUINO_ARCH_ESP32)
+    // The worker task drives the session and updates _stats concurrently
+    LOG_ERROR("sendBatch() needs UPLOAD_ASYNC=0");
+    (void)readings;
+    (void)count;
+    return 0;
+#else
+    // QoS 1 identifiers of this call's newest messages: with at most
+    // MQTT_INFLIGHT_MAX in the window, older ones are acknowledged
+    uint16_t packetIds[MQTT_INFLIGHT_MAX] = {};
+    size_t delivered = 0;
+    while (delivered < count) {
+        const uint32_t start = millis();
+        size_t n = 1;
+        bool ok;
+        if (useThingSpeak()) {
+            n = count - delivered < _batchSize ? count - delivered : _batchSize;
+            ok = n == 1 ? sendReading(readings[delivered])
+                        : uploadThingSpeakBulk(readings + delivered, n);
+        } else {
+            ok = sendReading(readings[delivered]);
+            if (ok && _mqttQos > 0) {
+                packetIds[delivered % MQTT_INFLIGHT_MAX] = _mqtt.lastPacketId();
+            }
+        }
+        recordLatency(millis() - start);
+        if (!ok) {
+            _stats.failed += n;
+            break;
+        }
+        _stats.sent += n;
+        delivered += n;
+    }
+    if (useThingSpeak() || _mqtt.flush(UPLOAD_REQUEST_TIMEOUT)) {
+        return delivered;
+    }
+    // Only a prefix the broker acknowledged counts as delivered; messages
+    // from before this call do not. The caller keeps the rest and owns its
+    // retry, so it is withdrawn from the session rather than sent twice
+    // (in deep sleep the window would not survive anyway)
+    const size_t tracked = delivered < MQTT_INFLIGHT_MAX ? delivered : MQTT_INFLIGHT_MAX;
+    size_t confirmed = delivered;
+    for (size_t i = delivered - tracked; i < delivered; ++i) {
+        const uint16_t packetId = packetIds[i % MQTT_INFLIGHT_MAX];
+        if (_mqtt.pending(packetId)) {
+            confirmed = confirmed < i ? confirmed : i;
+            _mqtt.abandon(packetId);
+        }
+    }
+    const size_t unconfirmed = delivered - confirmed;
+    _stats.sent -= static_cast<uint32_t>(unconfirmed);
+    _stats.failed += static_cast<uint32_t>(unconfirmed);
+    return confirmed;
+#endif
+}
+
+void CloudUploader::disconnect() {
+    _mqtt.flush(UPLOAD_REQUEST_TIMEOUT);
+    _mqtt.disconnect();
+    _http.stop();
+}
+
+bool CloudUploader::sendReading(const SensorReading &reading) {
+    if (useThingSpeak()) {
+        // A GET is stamped on arrival; a replayed reading needs its own time
+        return reading.flags & READING_REPLAYED
+                   ? uploadThingSpeakBulk(&reading, 1)
+                   : uploadThingSpeak(reading.temperature, reading.humidity, reading.light);
+    }
+    return uploadMQTT(reading);
+}
+
+void CloudUploader::setTarget(UploadTarget target) {
+    _target = target;
+}
+
+void CloudUploader::setOverflowPolicy(UploadOverflowPolicy policy) {
+    _policy = policy;
+}
+
+void CloudUploader::setBatchSize(size_t readings) {
+    _batchSize = readings < 1 ? 1 : readings > THINGSPEAK_BATCH_SIZE ? THINGSPEAK_BATCH_SIZE
+                                                                     : readings;
+}
+
+void CloudUploader::setReportOnDelta(bool enabled) {
+    _reportOnDelta = enabled;
+    _reporter.reset();
+}
+
+void CloudUploader::setPayloadFormat(MqttPayloadFormat format) {
+    _payloadFormat = format;
+}
+
+void CloudUploader::setMqttQos(uint8_t qos) { _mqttQos = qos > 0 ? 1 : 0; }
+
+void CloudUploader::setMqttWindow(size_t messages) { _mqtt.setWindow(messages); }
+
+size_t CloudUploader::encodePayload(const SensorReading &reading, uint32_t sequence,
+                                    MqttPayloadFormat format, uint8_t *out,
+                                    size_t size) const {
+    // "ts" is millis() and only orders messages of one boot; a replayed
+    // reading also carries its calendar time once the clock is set
+    const uint32_t at = reading.flags & READING_REPLAYED ? wallClockAt(reading.timestamp) : 0;
+    if (format == MQTT_PAYLOAD_CBOR) {
+        CborWriter cbor(out, size);
+        cbor.beginMap(at != 0 ? 6 : 5);
+        cbor.text("seq");
+        cbor.uint(sequence);
+        cbor.text("ts");
+        cbor.uint(reading.timestamp);
+        if (at != 0) {
+            cbor.text("at");
+            cbor.uint(at);
+        }
+        cbor.text("t");
+        cbor.float32(reading.temperature);
+        cbor.text("h");
+        cbor.float32(reading.humidity);
+        cbor.text("l");
+        cbor.integer(reading.light);
+        return cbor.overflowed() ? 0 : cbor.length();
     }
+    StaticJsonDocument<JSON_OBJECT_SIZE(6)> doc;
+    doc["seq"] = sequence;
+    doc["ts"] = reading.timestamp;
+    if (at != 0) {
+        doc["at"] = at;
+    }
+    doc["t"] = round2(reading.temperature);
+    doc["h"] = round2(reading.humidity);
+    doc["l"] = reading.light;
+    const size_t length = serializeJson(doc, reinterpret_cast<char *>(out), size);
+    return length + 1 < size ? length : 0;
+}
+
+size_t CloudUploader::encodeChannels(const ChannelView &channels, uint32_t timestamp,
+                                     uint32_t sequence, MqttPayloadFormat format, uint8_t *out,
+                                     size_t size, ChannelMask mask) const {
+    if (format == MQTT_PAYLOAD_CBOR) {
+        size_t entries = 0;
+        for (size_t c = 0; c < channels.count; ++c) {
+            entries += channelSelected(mask, c) ? 1 : 0;
+        }
+        CborWriter cbor(out, size);
+        cbor.beginMap(2 + entries);
+        cbor.text("seq");
+        cbor.uint(sequence);
+        cbor.text("ts");
+        cbor.uint(timestamp);
+        for (size_t c = 0; c < channels.count; ++c) {
+            if (!channelSelected(mask, c)) {
+                continue;
+            }
+            const float v = channels.values[c];
+            cbor.text(channels.specs[c]->key);
+            if (channels.specs[c]->decimals == 0 && !isnan(v)) {
+                cbor.integer(lroundf(v));
+            } else {
+                cbor.float32(v);
+            }
+        }
+        return cbor.overflowed() ? 0 : cbor.length();
+    }
+    // Written directly rather than through a JsonDocument, whose capacity
+    // would have to cover the largest registry
+    char *text = reinterpret_cast<char *>(out);
+    int n = snprintf(text, size, "{\"seq\":%lu,\"ts\":%lu", static_cast<unsigned long>(sequence),
+                     static_cast<unsigned long>(timestamp));
+    size_t length = n > 0 ? static_cast<size_t>(n) : size;
+    for (size_t c = 0; c < channels.count && length < size; ++c) {
+        if (!channelSelected(mask, c)) {
+            continue;
+        }
+        const float v = channels.values[c];
+        char value[24];
+        if (isnan(v)) {
+            snprintf(value, sizeof(value), "null");
+        } else if (channels.specs[c]->decimals == 0) {
+            snprintf(value, sizeof(value), "%ld", lroundf(v));
+        } else {
+            formatFixed2(value, sizeof(value), v);
+        }
+        n = snprintf(text + length, size - length, ",\"%s\":%s", channels.specs[c]->key, value);
+        length += n > 0 ? static_cast<size_t>(n) : size;
+    }
+    if (length + 1 < size) {
+        text[length++] = '}';
+        text[length] = '\0';
+    }
+    return length < size ? length : 0;
+}
+
+BulkEntry CloudUploader::bulkEntry(const SensorReading &reading) {
+    BulkEntry entry;
+    entry.timestamp = reading.timestamp;
+    entry.flags = reading.flags;
+    entry.count = 3;
+    entry.mask = CHANNEL_MASK_ALL;
+    entry.fields[0] = reading.temperature;
+    entry.fields[1] = reading.humidity;
+    entry.fields[2] = static_cast<float>(reading.light);
+    return entry;
+}
+
+size_t CloudUploader::serializeBulkUpdate(const SensorReading *readings, size_t count,
+                                          char *out, size_t size) const {
+    BulkEntry entries[THINGSPEAK_BATCH_SIZE];
+    count = count < THINGSPEAK_BATCH_SIZE ? count : THINGSPEAK_BATCH_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        entries[i] = bulkEntry(readings[i]);
+    }
+    return serializeBulkUpdate(entries, count, out, size);
+}
+
+size_t CloudUploader::serializeBulkUpdate(const BulkEntry *entries, size_t count, char *out,
+                                          size_t size) const {
+    static const char *const kFieldKeys[kThingSpeakFields] = {
+        "field1", "field2", "field3", "field4", "field5", "field6", "field7", "field8"};
+    if (count > THINGSPEAK_BATCH_SIZE) {
+        count = THINGSPEAK_BATCH_SIZE;
+    }
+    StaticJsonDocument<JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(THINGSPEAK_BATCH_SIZE) +
+                       THINGSPEAK_BATCH_SIZE * JSON_OBJECT_SIZE(1 + kThingSpeakFields)> doc;
+    // String literals and const char * are stored by pointer, nothing is copied
+    doc["write_api_key"] = THINGSPEAK_API_KEY;
+    JsonArray updates = doc.createNestedArray("updates");
+    const bool clockSet = wallClock() != 0;
+    char createdAt[THINGSPEAK_BATCH_SIZE][24];
+    uint32_t previous = count > 0 ? entries[0].timestamp : 0;
+    for (size_t i = 0; i < count; ++i) {
+        JsonObject entry = updates.createNestedObject();
+        if (clockSet) {
+            formatIsoTime(createdAt[i], sizeof(createdAt[i]), wallClockAt(entries[i].timestamp));
+            entry["created_at"] = static_cast<const char *>(createdAt[i]);
+        } else {
+            entry["delta_t"] = (entries[i].timestamp - previous) / 1000;
+        }
+        // Fields left out keep no value for this entry
+        for (size_t f = 0; f < entries[i].count && f < kThingSpeakFields; ++f) {
+            if (channelSelected(entries[i].mask, f) && !isnan(entries[i].fields[f])) {
+                entry[kFieldKeys[f]] = round2(entries[i].fields[f]);
+            }
+        }
+        previous = entries[i].timestamp;
+    }
+    if (doc.overflowed()) {
+        return 0;
+    }
+    const size_t length = serializeJson(doc, out, size);
+    return length + 1 < size ? length : 0;
+}
+
+bool CloudUploader::uploadThingSpeak(float temperature, float humidity, int light) {
+    if (WiFi.status() != WL_CONNECTED) {
+        return false; // Cannot upload without WiFi
+    }
+    // Build the request URI with query parameters for fields 1-3
+    char temperatureText[24];
+    char humidityText[24];
+    formatFixed2(temperatureText, sizeof(temperatureText), temperature);
+    formatFixed2(humidityText, sizeof(humidityText), humidity);
+    char uri[128];
+    const int length = snprintf(uri, sizeof(uri),
+                                "/update?api_key=%s&field1=%s&field2=%s&field3=%d",
+                                THINGSPEAK_API_KEY, temperatureText, humidityText, light);
+    if (length < 0 || static_cast<size_t>(length) >= sizeof(uri)) {
+        return false;
+    }
+    const int httpCode = _http.request("GET", uri, nullptr, nullptr, 0);
+    LOG_DEBUG("ThingSpeak HTTP response code: %d", httpCode);
+    return httpCode >= 200 && httpCode < 300;
 }
 
-void CloudUploader::uploadThingSpeak(float temperature, float humidity, int light) {
+bool CloudUploader::uploadThingSpeakChannels(const ChannelView &channels, ChannelMask mask) {
     if (WiFi.status() != WL_CONNECTED) {
-        return; // Cannot upload without WiFi
-    }
-    // Build the URL with query parameters for fields 1‑3
-    String url = String("http://") + THINGSPEAK_SERVER + "/update?api_key=" + THINGSPEAK_API_KEY;
-    url += "&field1=" + String(temperature, 2);
-    url += "&field2=" + String(humidity, 2);
-    url += "&field3=" + String(light);
-    _httpClient.begin(_wifiClient, url);
-    int httpCode = _httpClient.GET();
-    // Optionally print the server response for debugging
-    DEBUG_PRINTF("ThingSpeak HTTP response code: %d\n", httpCode);
-    _httpClient.end();
-}
-
-void CloudUploader::uploadMQTT(float temperature, float humidity, int light) {
-    // Ensure the MQTT client is connected
-    if (!_mqttClient.connected()) {
-        // Create a unique client ID for this session
-        String clientId = String(MQTT_CLIENT_ID) + String("-") + String(millis(), HEX);
-        _mqttClient.connect(clientId.c_str());
-    }
-    if (!_mqttClient.connected()) {
+        return false;
+    }
+    char uri[96 + kThingSpeakFields * 24];
+    int n = snprintf(uri, sizeof(uri), "/update?api_key=%s", THINGSPEAK_API_KEY);
+    size_t length = n > 0 ? static_cast<size_t>(n) : sizeof(uri);
+    for (size_t c = 0; c < channels.count && c < kThingSpeakFields && length < sizeof(uri); ++c) {
+        // Fields left out keep no value for this entry
+        if (!channelSelected(mask, c) || isnan(channels.values[c])) {
+            continue;
+        }
+        char value[24];
+        formatFixed2(value, sizeof(value), channels.values[c]);
+        n = snprintf(uri + length, sizeof(uri) - length, "&field%u=%s",
+                     static_cast<unsigned>(c + 1), value);
+        length += n > 0 ? static_cast<size_t>(n) : sizeof(uri);
+    }
+    if (length >= sizeof(uri)) {
+        return false;
+    }
+    const int httpCode = _http.request("GET", uri, nullptr, nullptr, 0);
+    LOG_DEBUG("ThingSpeak HTTP response code: %d", httpCode);
+    return httpCode >= 200 && httpCode < 300;
+}
+
+bool CloudUploader::sendChannels(const ChannelView &channels, uint32_t timestamp,
+                                 ChannelMask mask) {
+    if (useThingSpeak()) {
+        return uploadThingSpeakChannels(channels, mask);
+    }
+    if (!connectMQTT()) {
+        return false;
+    }
+    uint8_t payload[MQTT_CHANNEL_PAYLOAD_MAX];
+    const size_t length = encodeChannels(channels, timestamp, _mqttSequence, _payloadFormat,
+                                         payload, sizeof(payload), mask);
+    if (length == 0) {
+        return false;
+    }
+    ++_mqttSequence;
+    return publishData(payload, length);
+}
+
+bool CloudUploader::uploadThingSpeakBulk(const SensorReading *readings, size_t count) {
+    BulkEntry entries[THINGSPEAK_BATCH_SIZE];
+    count = count < THINGSPEAK_BATCH_SIZE ? count : THINGSPEAK_BATCH_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        entries[i] = bulkEntry(readings[i]);
+    }
+    return uploadThingSpeakBulk(entries, count);
+}
+
+bool CloudUploader::uploadThingSpeakBulk(const BulkEntry *entries, size_t count) {
+    if (WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+    const size_t length = serializeBulkUpdate(entries, count, _bulkBody, sizeof(_bulkBody));
+    if (length == 0) {
+        return false;
+    }
+    const int httpCode = _http.request("POST", kBulkUpdateUri, "application/json",
+                                       reinterpret_cast<const uint8_t *>(_bulkBody), length);
+    LOG_DEBUG("ThingSpeak bulk update (%u entries) response code: %d",
+              static_cast<unsigned>(count), httpCode);
+    return httpCode >= 200 && httpCode < 300;
+}
+
+bool CloudUploader::connectMQTT() {
+    // Normally still open from the last upload; reconnects back off
+    if (!_mqtt.connect()) {
         // Failed to connect; skip publishing
-        DEBUG_PRINTLN("MQTT connection failed");
-        return;
+        LOG_WARN("MQTT connection failed");
+        return false;
     }
-    // Publish values to their respective topics
-    char payload[16];
-    dtostrf(temperature, 6, 2, payload);
-    _mqttClient.publish(MQTT_TOPIC_TEMP, payload);
-    dtostrf(humidity, 6, 2, payload);
-    _mqttClient.publish(MQTT_TOPIC_HUMID, payload);
-    itoa(light, payload, 10);
-    _mqttClient.publish(MQTT_TOPIC_LIGHT, payload);
-    // Also publish a status message containing timestamp
-    String status = String("OK ") + millis();
-    _mqttClient.publish(MQTT_TOPIC_STATUS, status.c_str());
-    // Allow the MQTT client to process outgoing data
-    _mqttClient.loop();
-}
\ No newline at end of file
+    return true;
+}
+
+bool CloudUploader::publishData(const uint8_t *payload, size_t length) {
+    // At QoS 1 this returns once the message is in the window; its PUBACK
+    // is handled by later loop() calls
+    return _mqtt.publish(MQTT_TOPIC_DATA, payload, length, _mqttQos);
+}
+
+bool CloudUploader::uploadMQTT(const SensorReading &reading) {
+    if (!connectMQTT()) {
+        return false;
+    }
+    // All channels travel in one message on one topic
+    uint8_t payload[MQTT_PAYLOAD_MAX];
+    const size_t length = encodePayload(reading, _mqttSequence, _payloadFormat, payload,
+                                        sizeof(payload));
+    if (length == 0) {
+        return false;
+    }
+    ++_mqttSequence;
+    return publishData(payload, length);
+}
@@ -0,0 +1,64 @@
+/**
+ * @file DeltaReporter.cpp
+ * @brief Implementation of the DeltaReporter class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "connectivity/DeltaReporter.h"
+
+#include <math.h>
+
+static_assert(SENSOR_MAX_CHANNELS <= 32, "Channels must fit a ChannelMask");
+
+DeltaReporter::DeltaReporter() {
+    for (size_t c = 0; c < SENSOR_MAX_CHANNELS; ++c) {
+        _deadband[c] = 0.0f;
+    }
+    for (const DeltaRule &rule : kDeltaRules) {
+        _deadband[rule.channel] = rule.deadband;
+    }
+    reset();
+}
+
+void DeltaReporter::reset() {
+    for (size_t c = 0; c < SENSOR_MAX_CHANNELS; ++c) {
+        _last[c] = NAN;
+    }
+    _known = 0;
+    _lastReportMs = 0;
+    _started = false;
+}
+
+bool DeltaReporter::heartbeatDue(uint32_t nowMs) const {
+    return _started && nowMs - _lastReportMs >= REPORT_HEARTBEAT_INTERVAL;
+}
+
+ChannelMask DeltaReporter::changed(const float *values, size_t count, uint32_t nowMs) const {
+    if (heartbeatDue(nowMs)) {
+        return CHANNEL_MASK_ALL;
+    }
+    ChannelMask mask = 0;
+    for (size_t c = 0; c < count && c < SENSOR_MAX_CHANNELS; ++c) {
+        const float v = values[c];
+        const float last = _last[c];
+        const bool known = (_known >> c) & 1u;
+        // A value appearing or disappearing (NAN) is a change too
+        if (!known || isnan(v) != isnan(last) || fabsf(v - last) > _deadband[c]) {
+            mask |= ChannelMask(1) << c;
+        }
+    }
+    return mask;
+}
+
+void DeltaReporter::reported(const float *values, size_t count, ChannelMask mask,
+                             uint32_t nowMs) {
+    for (size_t c = 0; c < count && c < SENSOR_MAX_CHANNELS; ++c) {
+        if ((mask >> c) & 1u) {
+            _last[c] = values[c];
+            _known |= ChannelMask(1) << c;
+        }
+    }
+    _lastReportMs = nowMs;
+    _started = true;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file HttpConnection.cpp
+ * @brief Implementation of the HttpConnection class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "connectivity/HttpConnection.h"
+
+#include <strings.h>
+
+HttpConnection::HttpConnection(const char *host, uint16_t port)
+    : _host(host), _port(port), _connectTimeout(UPLOAD_CONNECT_TIMEOUT),
+      _responseTimeout(UPLOAD_REQUEST_TIMEOUT) {}
+
+void HttpConnection::setTimeouts(uint32_t connectMs, uint32_t responseMs) {
+    _connectTimeout = connectMs;
+    _responseTimeout = responseMs;
+}
+
+void HttpConnection::stop() {
+    _client.stop();
+}
+
+bool HttpConnection::readLine(unsigned long start, size_t &length) {
+    length = 0;
+    for (;;) {
+        if (!_client.available()) {
+            if (millis() - start >= _responseTimeout || !_client.connected()) {
+                return false;
+            }
+            delay(1);
+            continue;
+        }
+        const int c = _client.read();
+        if (c == '\n') {
+            if (length > 0 && _buffer[length - 1] == '\r') {
+                --length;
+            }
+            _buffer[length] = '\0';
+            return true;
+        }
+        // Overlong lines are truncated; only their start is ever inspected
+        if (c >= 0 && length < sizeof(_buffer) - 1) {
+            _buffer[length++] = static_cast<char>(c);
+        }
+    }
+}
+
+int HttpConnection::request(const char *method, const char *uri, const char *contentType,
+                            const uint8_t *body, size_t length) {
+    if (!_client.connected()) {
+        _client.stop();
+        if (!_client.connect(_host, _port, static_cast<int32_t>(_connectTimeout))) {
+            return HTTP_ERROR_CONNECT;
+        }
+        _client.setTimeout((_responseTimeout + 999) / 1000);
+    }
+
+    int head = snprintf(_buffer, sizeof(_buffer),
+                        "%s %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n", method, uri,
+                        _host);
+    if (contentType && head > 0 && static_cast<size_t>(head) < sizeof(_buffer)) {
+        head += snprintf(_buffer + head, sizeof(_buffer) - head,
+                         "Content-Type: %s\r\nContent-Length: %u\r\n", contentType,
+                         static_cast<unsigned>(length));
+    }
+    if (head > 0 && static_cast<size_t>(head) < sizeof(_buffer)) {
+        head += snprintf(_buffer + head, sizeof(_buffer) - head, "\r\n");
+    }
+    if (head <= 0 || static_cast<size_t>(head) >= sizeof(_buffer)) {
+        return HTTP_ERROR_OVERFLOW;
+    }
+    // The response deadline covers sending the request too
+    const unsigned long start = millis();
+    if (_client.write(reinterpret_cast<const uint8_t *>(_buffer), head) !=
+            static_cast<size_t>(head) ||
+        (length > 0 && _client.write(body, length) != length)) {
+        _client.stop();
+        return HTTP_ERROR_SEND;
+    }
+
+    // Status line, e.g. "HTTP/1.1 200 OK"
+    size_t lineLength;
+    if (!readLine(start, lineLength)) {
+        _client.stop();
+        return HTTP_ERROR_TIMEOUT;
+    }
+    if (lineLength < 12 || strncmp(_buffer, "HTTP/1.", 7) != 0) {
+        _client.stop();
+        return HTTP_ERROR_PROTOCOL;
+    }
+    const int status = atoi(_buffer + 9);
+
+    // Headers: only Content-Length matters for keeping the connection
+    long contentLength = -1;
+    while (readLine(start, lineLength) && lineLength > 0) {
+        if (strncasecmp(_buffer, "Content-Length:", 15) == 0) {
+            contentLength = atol(_buffer + 15);
+        }
+    }
+    if (contentLength < 0) {
+        // Chunked or close-delimited body: drop the connection instead
+        _client.stop();
+        return status;
+    }
+    while (contentLength > 0 && millis() - start < _responseTimeout) {
+        if (_client.available()) {
+            _client.read();
+            --contentLength;
+        } else if (_client.connected()) {
+            delay(1);
+        } else {
+            break;
+        }
+    }
+    if (contentLength > 0) {
+        _client.stop();
+    }
+    return status;
+}
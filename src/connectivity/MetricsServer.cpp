@@ -0,0 +1,662 @@
+/**
+ * @file MetricsServer.cpp
+ * @brief Implementation of the MetricsServer class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "connectivity/MetricsServer.h"
+#include "storage/HistoryCodec.h"
+#include "utils/BinaryLog.h"
+#include "utils/HeapStats.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const char kMetricsType[] = "text/plain; version=0.0.4";
+const char kHistoryType[] = "text/csv";
+
+/**
+ * Buffers response bytes and writes them to the client METRICS_CHUNK_BYTES
+ * at a time. Numbers are formatted here rather than with printf, whose
+ * float conversion may allocate on newlib.
+ */
+class ResponseWriter {
+public:
+    explicit ResponseWriter(WiFiClient &client)
+        : _client(client), _length(0), _sent(0), _ok(true) {}
+
+    void put(char c) {
+        if (_length == sizeof(_buffer)) {
+            flush();
+        }
+        _buffer[_length++] = c;
+    }
+
+    void put(const char *text) {
+        while (*text) {
+            put(*text++);
+        }
+    }
+
+    void number(uint64_t value) {
+        char digits[20];
+        size_t n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        while (n > 0) {
+            put(digits[--n]);
+        }
+    }
+
+    /** Finite @p value with up to @p decimals, trailing zeros dropped. */
+    void fixed(float value, unsigned decimals) {
+        double v = value;
+        if (v < 0.0) {
+            put('-');
+            v = -v;
+        }
+        uint64_t scale = 1;
+        for (unsigned i = 0; i < decimals; ++i) {
+            scale *= 10;
+        }
+        // Beyond this the scaled value no longer fits; sensor values never are
+        const double limit = 1e15;
+        const uint64_t scaled = static_cast<uint64_t>((v < limit ? v : limit) * scale + 0.5);
+        number(scaled / scale);
+        uint64_t fraction = scaled % scale;
+        if (fraction == 0) {
+            return;
+        }
+        while (fraction % 10 == 0) {
+            fraction /= 10;
+            scale /= 10;
+        }
+        put('.');
+        for (uint64_t digit = scale / 10; digit > 0; digit /= 10) {
+            put(static_cast<char>('0' + fraction / digit % 10));
+        }
+    }
+
+    /** Sample value in the Prometheus text format. */
+    void metricValue(float value) {
+        if (isnan(value)) {
+            put("NaN");
+        } else if (isinf(value)) {
+            put(value > 0 ? "+Inf" : "-Inf");
+        } else {
+            fixed(value, 3);
+        }
+    }
+
+    /** Label value with backslash, quote and line feed escaped. */
+    void label(const char *value) {
+        for (; *value; ++value) {
+            if (*value == '\\' || *value == '"') {
+                put('\\');
+                put(*value);
+            } else if (*value == '\n') {
+                put("\\n");
+            } else {
+                put(*value);
+            }
+        }
+    }
+
+    void status(int code, const char *reason, const char *contentType) {
+        put("HTTP/1.1 ");
+        number(static_cast<uint64_t>(code));
+        put(' ');
+        put(reason);
+        put("\r\nContent-Type: ");
+        put(contentType);
+        put("\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n");
+    }
+
+    /** Hand the buffered bytes to the client; later data is dropped once it fails. */
+    void flush() {
+        if (_ok && _length > 0) {
+            const size_t written = _client.write(reinterpret_cast<const uint8_t *>(_buffer),
+                                                 _length);
+            _sent += written;
+            _ok = written == _length;
+        }
+        _length = 0;
+    }
+
+    /** @return false once the client stopped taking data. */
+    bool ok() const { return _ok; }
+
+    uint64_t sent() const { return _sent; }
+
+private:
+    WiFiClient &_client;
+    char _buffer[METRICS_CHUNK_BYTES];
+    size_t _length;
+    uint64_t _sent;
+    bool _ok;
+};
+
+/** Prometheus HELP and TYPE lines of one metric family. */
+void family(ResponseWriter &out, const char *name, const char *type, const char *help) {
+    out.put("# HELP ");
+    out.put(name);
+    out.put(' ');
+    out.put(help);
+    out.put("\n# TYPE ");
+    out.put(name);
+    out.put(' ');
+    out.put(type);
+    out.put('\n');
+}
+
+/** Metric family with a single unlabelled sample. */
+void single(ResponseWriter &out, const char *name, const char *type, const char *help,
+            uint64_t value) {
+    family(out, name, type, help);
+    out.put(name);
+    out.put(' ');
+    out.number(value);
+    out.put('\n');
+}
+
+/** Sample of a family labelled {<key>="<value>"}. */
+void labelled(ResponseWriter &out, const char *name, const char *key, const char *value,
+              uint64_t sample) {
+    out.put(name);
+    out.put('{');
+    out.put(key);
+    out.put("=\"");
+    out.label(value);
+    out.put("\"} ");
+    out.number(sample);
+    out.put('\n');
+}
+
+/**
+ * Find @p name in a query string ("a=1&b=2").
+ *
+ * @return Start of the value (up to the next '&' or the end), or nullptr
+ */
+const char *param(const char *query, const char *name) {
+    const size_t length = strlen(name);
+    while (query && *query) {
+        if (strncmp(query, name, length) == 0 && query[length] == '=') {
+            return query + length + 1;
+        }
+        query = strchr(query, '&');
+        if (query) {
+            ++query;
+        }
+    }
+    return nullptr;
+}
+
+/** @return false if @p name is present but not a number. */
+bool numberParam(const char *query, const char *name, uint32_t &value, bool &present) {
+    const char *text = param(query, name);
+    present = text != nullptr;
+    if (!present) {
+        return true;
+    }
+    char *end;
+    const unsigned long parsed = strtoul(text, &end, 10);
+    value = static_cast<uint32_t>(parsed);
+    return end != text && (*end == '\0' || *end == '&');
+}
+
+/** Text of a query value equals @p expected. */
+bool paramIs(const char *value, const char *expected) {
+    const size_t length = strlen(expected);
+    return strncmp(value, expected, length) == 0 &&
+           (value[length] == '\0' || value[length] == '&');
+}
+
+enum Aggregate { AGG_AVG, AGG_MIN, AGG_MAX };
+
+/** Parsed /history query. */
+struct HistoryQuery {
+    uint32_t from;
+    uint32_t to;
+    uint32_t step;      ///< 0: every row
+    bool hasFrom;
+    bool hasTo;
+    Aggregate aggregate;
+
+    bool contains(uint32_t timestamp) const {
+        // Differences, so the range works across the millis() roll-over
+        return (!hasFrom || static_cast<int32_t>(timestamp - from) >= 0) &&
+               (!hasTo || static_cast<int32_t>(to - timestamp) >= 0);
+    }
+};
+
+bool parseHistoryQuery(const char *query, HistoryQuery &q) {
+    uint32_t last = 0;
+    bool hasLast = false;
+    bool hasStep = false;
+    q.step = 0;
+    q.aggregate = AGG_AVG;
+    if (!numberParam(query, "from", q.from, q.hasFrom) ||
+        !numberParam(query, "to", q.to, q.hasTo) ||
+        !numberParam(query, "last", last, hasLast) ||
+        !numberParam(query, "step", q.step, hasStep)) {
+        return false;
+    }
+    if (hasLast) {
+        q.to = millis();
+        q.from = q.to - last;
+        q.hasFrom = q.hasTo = true;
+    }
+    const char *agg = param(query, "agg");
+    if (agg) {
+        if (paramIs(agg, "avg")) {
+            q.aggregate = AGG_AVG;
+        } else if (paramIs(agg, "min")) {
+            q.aggregate = AGG_MIN;
+        } else if (paramIs(agg, "max")) {
+            q.aggregate = AGG_MAX;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Decimals of history values: enough for the DMA light average. */
+const unsigned kHistoryDecimals = 2;
+
+/**
+ * Rows of one step reduced per channel. NAN values are skipped; a channel
+ * without valid values in the step stays empty.
+ */
+struct Bucket {
+    uint32_t start;
+    bool open;
+    uint16_t count[SENSOR_MAX_CHANNELS];
+    float value[SENSOR_MAX_CHANNELS];     ///< Sum, minimum or maximum
+
+    void reset(uint32_t at, size_t channels) {
+        start = at;
+        open = true;
+        for (size_t c = 0; c < channels; ++c) {
+            count[c] = 0;
+            value[c] = 0.0f;
+        }
+    }
+
+    void add(const float *values, size_t channels, Aggregate aggregate) {
+        for (size_t c = 0; c < channels; ++c) {
+            const float v = values[c];
+            if (isnan(v)) {
+                continue;
+            }
+            if (count[c] == 0) {
+                value[c] = v;
+            } else if (aggregate == AGG_AVG) {
+                value[c] += v;
+            } else if (aggregate == AGG_MIN ? v < value[c] : v > value[c]) {
+                value[c] = v;
+            }
+            ++count[c];
+        }
+    }
+
+    float result(size_t channel, Aggregate aggregate) const {
+        if (count[channel] == 0) {
+            return NAN;
+        }
+        return aggregate == AGG_AVG ? value[channel] / count[channel] : value[channel];
+    }
+};
+
+void csvRow(ResponseWriter &out, uint32_t timestamp, const float *values, size_t channels) {
+    out.number(timestamp);
+    for (size_t c = 0; c < channels; ++c) {
+        out.put(',');
+        if (!isnan(values[c]) && !isinf(values[c])) {
+            out.fixed(values[c], kHistoryDecimals);
+        }
+    }
+    out.put('\n');
+}
+
+/** Key of history channel @p channel, from the registry where it has one. */
+void channelKey(ResponseWriter &out, const SensorRegistry<> &registry, size_t channel) {
+    if (channel < registry.channelCount()) {
+        out.put(registry.spec(channel).key);
+    } else {
+        out.put('c');
+        out.number(channel);
+    }
+}
+
+void writeMetrics(ResponseWriter &out, const SensorRegistry<> &registry,
+                  const AlertManager &alerts, const CloudUploader &uploader,
+                  const History *history, const MetricsServerStats &server) {
+    const size_t channels = registry.channelCount();
+
+    family(out, "envnode_value", "gauge", "Filtered channel value (moving average).");
+    for (size_t c = 0; c < channels; ++c) {
+        const ChannelSpec &spec = registry.spec(c);
+        out.put("envnode_value{channel=\"");
+        out.label(spec.key);
+        out.put("\",label=\"");
+        out.label(spec.label);
+        out.put("\",unit=\"");
+        out.label(spec.unit);
+        out.put("\"} ");
+        out.metricValue(registry.average(c));
+        out.put('\n');
+    }
+    family(out, "envnode_sample", "gauge", "Last raw sample, NaN if the read failed.");
+    for (size_t c = 0; c < channels; ++c) {
+        out.put("envnode_sample{channel=\"");
+        out.label(registry.spec(c).key);
+        out.put("\"} ");
+        out.metricValue(registry.latest(c));
+        out.put('\n');
+    }
+    family(out, "envnode_valid_samples", "gauge", "Valid samples in the filter window.");
+    for (size_t c = 0; c < channels; ++c) {
+        labelled(out, "envnode_valid_samples", "channel", registry.spec(c).key,
+                 registry.validCount(c));
+    }
+
+    const AlertManager::Engine &engine = alerts.engine();
+    family(out, "envnode_alert_active", "gauge", "1 while the alert rule is active.");
+    for (size_t i = 0; i < AlertManager::Engine::ruleCount(); ++i) {
+        const AlertRule &rule = engine.rule(i);
+        out.put("envnode_alert_active{rule=\"");
+        out.number(i);
+        out.put("\",code=\"");
+        out.number(rule.code);
+        out.put("\",channel=\"");
+        if (rule.channel < channels) {
+            out.label(registry.spec(rule.channel).key);
+        }
+        out.put("\"} ");
+        out.number(engine.active(i) ? 1 : 0);
+        out.put('\n');
+    }
+    single(out, "envnode_alert_state", "gauge", "Code of the most severe active alert, 0 if none.",
+           alerts.getState());
+
+    const UploadStats uploads = uploader.getStats();
+    family(out, "envnode_uploads_total", "counter", "Readings by upload outcome.");
+    labelled(out, "envnode_uploads_total", "result", "enqueued", uploads.enqueued);
+    labelled(out, "envnode_uploads_total", "result", "sent", uploads.sent);
+    labelled(out, "envnode_uploads_total", "result", "failed", uploads.failed);
+    labelled(out, "envnode_uploads_total", "result", "dropped", uploads.dropped);
+    labelled(out, "envnode_uploads_total", "result", "coalesced", uploads.coalesced);
+    labelled(out, "envnode_uploads_total", "result", "expired", uploads.expired);
+    labelled(out, "envnode_uploads_total", "result", "suppressed", uploads.suppressed);
+    labelled(out, "envnode_uploads_total", "result", "heartbeat", uploads.heartbeats);
+    single(out, "envnode_upload_queue_depth", "gauge", "Uploads waiting in the queue.",
+           uploads.queueDepth);
+    single(out, "envnode_upload_latency_max_ms", "gauge", "Longest upload request.",
+           uploads.maxLatencyMs);
+    const MqttSessionStats mqtt = uploader.mqttStats();
+    single(out, "envnode_mqtt_connects_total", "counter", "MQTT sessions opened.", mqtt.connects);
+    single(out, "envnode_mqtt_disconnects_total", "counter", "Open MQTT sessions lost.",
+           mqtt.disconnects);
+    single(out, "envnode_mqtt_retransmits_total", "counter", "QoS 1 messages sent again.",
+           mqtt.retransmitted);
+    single(out, "envnode_mqtt_inflight", "gauge", "QoS 1 messages awaiting a PUBACK.",
+           mqtt.inFlight);
+
+    if (history) {
+        const HistoryStats &stats = history->getStats();
+        single(out, "envnode_history_rows", "gauge", "Sample rows held in RAM.", history->rows());
+        single(out, "envnode_history_bytes", "gauge", "Compressed bytes held in RAM.",
+               history->encodedBytes());
+        single(out, "envnode_history_rows_total", "counter", "Sample rows recorded.", stats.rows);
+        single(out, "envnode_history_blocks_sealed_total", "counter", "History blocks filled.",
+               stats.sealed);
+        single(out, "envnode_history_rows_overwritten_total", "counter",
+               "Rows dropped with the oldest block.", stats.droppedRows);
+    }
+
+    const HeapStats heap = readHeapStats();
+    single(out, "envnode_heap_free_bytes", "gauge", "Free heap.", heap.freeBytes);
+    single(out, "envnode_heap_min_free_bytes", "gauge", "Lowest free heap since boot.",
+           heap.minFreeBytes);
+    single(out, "envnode_heap_largest_block_bytes", "gauge", "Largest allocatable block.",
+           heap.largestFreeBlock);
+    single(out, "envnode_wifi_connected", "gauge", "1 while associated.",
+           WiFi.status() == WL_CONNECTED ? 1 : 0);
+    family(out, "envnode_uptime_seconds", "counter", "Time since boot.");
+    const uint32_t uptime = millis();
+    out.put("envnode_uptime_seconds ");
+    out.number(uptime / 1000);
+    out.put('.');
+    out.put(static_cast<char>('0' + uptime / 100 % 10));
+    out.put(static_cast<char>('0' + uptime / 10 % 10));
+    out.put(static_cast<char>('0' + uptime % 10));
+    out.put('\n');
+
+    family(out, "envnode_http_requests_total", "counter", "Requests served by this endpoint.");
+    labelled(out, "envnode_http_requests_total", "result", "ok",
+             server.requests - server.notFound - server.badRequests);
+    labelled(out, "envnode_http_requests_total", "result", "not_found", server.notFound);
+    labelled(out, "envnode_http_requests_total", "result", "bad_request", server.badRequests);
+    single(out, "envnode_http_rejected_total", "counter", "Connections refused while busy.",
+           server.rejected);
+}
+
+void writeHistory(ResponseWriter &out, const History &history, const SensorRegistry<> &registry,
+                  const HistoryQuery &q) {
+    const size_t channels = history.channels();
+    out.put("timestamp_ms");
+    for (size_t c = 0; c < channels; ++c) {
+        out.put(',');
+        channelKey(out, registry, c);
+    }
+    out.put('\n');
+
+    Bucket bucket = {};
+    float values[SENSOR_MAX_CHANNELS];
+    float reduced[SENSOR_MAX_CHANNELS];
+    for (size_t b = 0; b < history.blockCount() && out.ok(); ++b) {
+        size_t length;
+        const uint8_t *block = history.block(b, length);
+        HistoryDecoder decoder(block, length);
+        uint32_t timestamp;
+        while (decoder.next(timestamp, values) && out.ok()) {
+            if (!q.contains(timestamp)) {
+                continue;
+            }
+            if (q.step == 0) {
+                csvRow(out, timestamp, values, channels);
+                continue;
+            }
+            const uint32_t start = timestamp - timestamp % q.step;
+            if (bucket.open && start != bucket.start) {
+                for (size_t c = 0; c < channels; ++c) {
+                    reduced[c] = bucket.result(c, q.aggregate);
+                }
+                csvRow(out, bucket.start, reduced, channels);
+                bucket.open = false;
+            }
+            if (!bucket.open) {
+                bucket.reset(start, channels);
+            }
+            bucket.add(values, channels, q.aggregate);
+        }
+    }
+    if (bucket.open) {
+        for (size_t c = 0; c < channels; ++c) {
+            reduced[c] = bucket.result(c, q.aggregate);
+        }
+        csvRow(out, bucket.start, reduced, channels);
+    }
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(const SensorRegistry<> &registry, const AlertManager &alerts,
+                             const CloudUploader &uploader, const History *history,
+                             uint16_t port)
+    : _registry(registry), _alerts(alerts), _uploader(uploader), _history(history),
+      _server(port, METRICS_MAX_CLIENTS), _listening(false), _connections(), _stats() {}
+
+void MetricsServer::begin() {
+    _server.begin();
+    _server.setNoDelay(true);
+    _listening = true;
+    LOG_INFO("Metrics server started");
+}
+
+void MetricsServer::end() {
+    for (Connection &c : _connections) {
+        if (c.active) {
+            close(c);
+        }
+    }
+    _server.end();
+    _listening = false;
+}
+
+size_t MetricsServer::openConnections() const {
+    size_t open = 0;
+    for (const Connection &c : _connections) {
+        open += c.active ? 1 : 0;
+    }
+    return open;
+}
+
+void MetricsServer::loop() {
+    if (!_listening) {
+        return;
+    }
+    accept();
+    for (Connection &c : _connections) {
+        if (!c.active) {
+            continue;
+        }
+        if (receive(c)) {
+            respond(c);
+            close(c);
+        } else if (!c.client.connected()) {
+            close(c);
+        } else if (millis() - c.openedAt > METRICS_REQUEST_TIMEOUT) {
+            ++_stats.timeouts;
+            close(c);
+        }
+    }
+}
+
+void MetricsServer::accept() {
+    while (_server.hasClient()) {
+        WiFiClient client = _server.accept();
+        if (!client) {
+            return;
+        }
+        Connection *slot = nullptr;
+        for (Connection &c : _connections) {
+            if (!c.active) {
+                slot = &c;
+                break;
+            }
+        }
+        if (!slot) {
+            // Answered before the request is read: a busy node sheds load early
+            static const char kBusy[] =
+                "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n";
+            client.write(reinterpret_cast<const uint8_t *>(kBusy), sizeof(kBusy) - 1);
+            client.stop();
+            ++_stats.rejected;
+            continue;
+        }
+        slot->client = client;
+        slot->openedAt = millis();
+        slot->length = 0;
+        slot->newlines = 0;
+        slot->lineDone = false;
+        slot->overlong = false;
+        slot->active = true;
+    }
+}
+
+bool MetricsServer::receive(Connection &c) {
+    uint8_t buffer[64];
+    while (c.client.available() > 0) {
+        const int n = c.client.read(buffer, sizeof(buffer));
+        if (n <= 0) {
+            return false;
+        }
+        for (int i = 0; i < n; ++i) {
+            const char ch = static_cast<char>(buffer[i]);
+            if (ch == '\n') {
+                c.lineDone = true;
+                // Headers are skipped; a blank line ends the head
+                if (++c.newlines == 2) {
+                    return true;
+                }
+            } else if (ch != '\r') {
+                c.newlines = 0;
+                if (c.lineDone) {
+                    continue;
+                }
+                if (c.length < sizeof(c.line) - 1) {
+                    c.line[c.length++] = ch;
+                } else {
+                    c.overlong = true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void MetricsServer::respond(Connection &c) {
+    ResponseWriter out(c.client);
+    ++_stats.requests;
+    c.line[c.length] = '\0';
+
+    // "GET /path?query HTTP/1.1"
+    char *target = strchr(c.line, ' ');
+    char *version = target ? strchr(target + 1, ' ') : nullptr;
+    if (c.overlong || !version) {
+        ++_stats.badRequests;
+        out.status(c.overlong ? 414 : 400, c.overlong ? "URI Too Long" : "Bad Request",
+                   "text/plain");
+    } else if (strncmp(c.line, "GET ", 4) != 0) {
+        ++_stats.badRequests;
+        out.status(405, "Method Not Allowed", "text/plain");
+    } else {
+        *version = '\0';
+        ++target;
+        char *query = strchr(target, '?');
+        if (query) {
+            *query++ = '\0';
+        }
+        if (strcmp(target, "/metrics") == 0) {
+            out.status(200, "OK", kMetricsType);
+            writeMetrics(out, _registry, _alerts, _uploader, _history, _stats);
+        } else if (strcmp(target, "/history") == 0 && _history) {
+            HistoryQuery q;
+            if (parseHistoryQuery(query, q)) {
+                out.status(200, "OK", kHistoryType);
+                writeHistory(out, *_history, _registry, q);
+            } else {
+                ++_stats.badRequests;
+                out.status(400, "Bad Request", "text/plain");
+            }
+        } else {
+            ++_stats.notFound;
+            out.status(404, "Not Found", "text/plain");
+        }
+    }
+    out.flush();
+    _stats.bytesSent += out.sent();
+}
+
+void MetricsServer::close(Connection &c) {
+    c.client.stop();
+    c.active = false;
+}
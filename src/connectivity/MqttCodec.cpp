@@ -0,0 +1,208 @@
+/**
+ * @file MqttCodec.cpp
+ * @brief Implementation of the MQTT 3.1.1 packet codec.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "connectivity/MqttCodec.h"
+
+#include <string.h>
+
+namespace {
+
+/** Appends to a caller buffer; remembers running past its end. */
+struct Out {
+    uint8_t *data;
+    size_t size;
+    size_t length;
+
+    void byte(uint8_t value) {
+        if (length < size) {
+            data[length] = value;
+        }
+        ++length;
+    }
+    void u16(uint16_t value) {
+        byte(static_cast<uint8_t>(value >> 8));
+        byte(static_cast<uint8_t>(value));
+    }
+    void bytes(const uint8_t *value, size_t count) {
+        if (length + count <= size) {
+            memcpy(data + length, value, count);
+        }
+        length += count;
+    }
+    /** Length-prefixed UTF-8 string. */
+    void string(const char *value) {
+        const size_t count = strlen(value);
+        u16(static_cast<uint16_t>(count));
+        bytes(reinterpret_cast<const uint8_t *>(value), count);
+    }
+    /** Fixed header: type and flags, then the variable-length remaining length. */
+    void header(uint8_t type, uint8_t flags, size_t remaining) {
+        byte(static_cast<uint8_t>(type << 4 | flags));
+        do {
+            uint8_t digit = remaining % 128;
+            remaining /= 128;
+            byte(remaining > 0 ? digit | 0x80 : digit);
+        } while (remaining > 0);
+    }
+    size_t result() const { return length <= size ? length : 0; }
+};
+
+size_t stringSize(const char *value) { return 2 + strlen(value); }
+
+uint16_t readU16(const uint8_t *p) { return static_cast<uint16_t>(p[0] << 8 | p[1]); }
+
+} // namespace
+
+size_t MqttCodec::connect(uint8_t *out, size_t size, const char *clientId, uint16_t keepAliveS,
+                          bool cleanSession, const char *user, const char *password) {
+    uint8_t flags = cleanSession ? 0x02 : 0x00;
+    size_t remaining = 10 + stringSize(clientId);
+    if (user) {
+        flags |= 0x80;
+        remaining += stringSize(user);
+        if (password) {
+            flags |= 0x40;
+            remaining += stringSize(password);
+        }
+    }
+    Out o = {out, size, 0};
+    o.header(MQTT_CONNECT, 0, remaining);
+    o.string("MQTT");
+    o.byte(4);   // protocol level 3.1.1
+    o.byte(flags);
+    o.u16(keepAliveS);
+    o.string(clientId);
+    if (user) {
+        o.string(user);
+        if (password) {
+            o.string(password);
+        }
+    }
+    return o.result();
+}
+
+size_t MqttCodec::publishHeader(uint8_t *out, size_t size, const char *topic, size_t length,
+                                uint8_t qos, uint16_t packetId, bool dup, bool retain) {
+    const size_t remaining = stringSize(topic) + (qos > 0 ? 2 : 0) + length;
+    if (remaining > kMaxRemaining || qos > 1 || (qos > 0 && packetId == 0)) {
+        return 0;
+    }
+    Out o = {out, size, 0};
+    o.header(MQTT_PUBLISH,
+             static_cast<uint8_t>((dup && qos > 0 ? 0x08 : 0) | qos << 1 | (retain ? 1 : 0)),
+             remaining);
+    o.string(topic);
+    if (qos > 0) {
+        o.u16(packetId);
+    }
+    return o.result();
+}
+
+size_t MqttCodec::publish(uint8_t *out, size_t size, const char *topic, const uint8_t *payload,
+                          size_t length, uint8_t qos, uint16_t packetId, bool dup,
+                          bool retain) {
+    const size_t head = publishHeader(out, size, topic, length, qos, packetId, dup, retain);
+    if (head == 0 || head + length > size) {
+        return 0;
+    }
+    memcpy(out + head, payload, length);
+    return head + length;
+}
+
+size_t MqttCodec::puback(uint8_t *out, size_t size, uint16_t packetId) {
+    Out o = {out, size, 0};
+    o.header(MQTT_PUBACK, 0, 2);
+    o.u16(packetId);
+    return o.result();
+}
+
+size_t MqttCodec::subscribe(uint8_t *out, size_t size, uint16_t packetId, const char *topic,
+                            uint8_t qos) {
+    Out o = {out, size, 0};
+    o.header(MQTT_SUBSCRIBE, 0x02, 2 + stringSize(topic) + 1);
+    o.u16(packetId);
+    o.string(topic);
+    o.byte(qos);
+    return o.result();
+}
+
+size_t MqttCodec::pingreq(uint8_t *out, size_t size) {
+    Out o = {out, size, 0};
+    o.header(MQTT_PINGREQ, 0, 0);
+    return o.result();
+}
+
+size_t MqttCodec::disconnect(uint8_t *out, size_t size) {
+    Out o = {out, size, 0};
+    o.header(MQTT_DISCONNECT, 0, 0);
+    return o.result();
+}
+
+MqttParseResult MqttCodec::parse(const uint8_t *data, size_t available, MqttPacket &packet) {
+    size_t remaining = 0;
+    size_t multiplier = 1;
+    for (size_t i = 1; i <= 4; ++i) {
+        if (i >= available) {
+            return MQTT_PARSE_INCOMPLETE;
+        }
+        remaining += (data[i] & 0x7F) * multiplier;
+        if (!(data[i] & 0x80)) {
+            const size_t header = i + 1;
+            if (available - header < remaining) {
+                return MQTT_PARSE_INCOMPLETE;
+            }
+            packet.type = data[0] >> 4;
+            packet.flags = data[0] & 0x0F;
+            packet.body = data + header;
+            packet.length = remaining;
+            packet.size = header + remaining;
+            return packet.type == 0 || packet.type == 15 ? MQTT_PARSE_MALFORMED : MQTT_PARSE_OK;
+        }
+        multiplier *= 128;
+    }
+    // A fifth length byte is never valid
+    return MQTT_PARSE_MALFORMED;
+}
+
+bool MqttCodec::parsePublish(const MqttPacket &packet, MqttPublish &publish) {
+    if (packet.type != MQTT_PUBLISH || packet.length < 2) {
+        return false;
+    }
+    publish.qos = (packet.flags >> 1) & 0x03;
+    publish.dup = packet.flags & 0x08;
+    publish.retain = packet.flags & 0x01;
+    publish.topicLength = readU16(packet.body);
+    size_t offset = 2 + publish.topicLength;
+    const size_t idBytes = publish.qos > 0 ? 2 : 0;
+    if (publish.qos > 2 || offset + idBytes > packet.length) {
+        return false;
+    }
+    publish.topic = reinterpret_cast<const char *>(packet.body + 2);
+    publish.packetId = idBytes ? readU16(packet.body + offset) : 0;
+    offset += idBytes;
+    publish.payload = packet.body + offset;
+    publish.payloadLength = packet.length - offset;
+    return true;
+}
+
+bool MqttCodec::parseConnack(const MqttPacket &packet, bool &sessionPresent,
+                             uint8_t &returnCode) {
+    if (packet.type != MQTT_CONNACK || packet.length != 2) {
+        return false;
+    }
+    sessionPresent = packet.body[0] & 0x01;
+    returnCode = packet.body[1];
+    return true;
+}
+
+bool MqttCodec::parseAck(const MqttPacket &packet, uint16_t &packetId) {
+    if ((packet.type != MQTT_PUBACK && packet.type != MQTT_SUBACK) || packet.length < 2) {
+        return false;
+    }
+    packetId = readU16(packet.body);
+    return true;
+}
@@ -0,0 +1,347 @@
+/**
+ * @file MqttSession.cpp
+ * @brief Implementation of the MqttSession class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "connectivity/MqttSession.h"
+
+#include <string.h>
+#include "connectivity/MqttCodec.h"
+
+MqttSession::MqttSession(const char *host, uint16_t port)
+    : _host(host), _port(port), _clientId(), _connectTimeout(UPLOAD_CONNECT_TIMEOUT),
+      _responseTimeout(UPLOAD_REQUEST_TIMEOUT), _window(MQTT_INFLIGHT_MAX), _open(false),
+      _wanted(false), _failedAt(0), _backoff(0), _lastSend(0), _pingSent(0),
+      _pingPending(false), _packetId(0), _in(), _inLength(0), _stats(), _slots(), _head(0),
+      _count(0), _inFlight(0) {
+    setClientId(MQTT_CLIENT_ID);
+}
+
+void MqttSession::setClientId(const char *clientId) {
+    strncpy(_clientId, clientId, sizeof(_clientId) - 1);
+    _clientId[sizeof(_clientId) - 1] = '\0';
+}
+
+void MqttSession::setTimeouts(uint32_t connectMs, uint32_t responseMs) {
+    _connectTimeout = connectMs;
+    _responseTimeout = responseMs;
+}
+
+void MqttSession::setWindow(size_t messages) {
+    _window = messages < 1 ? 1 : messages > MQTT_INFLIGHT_MAX ? MQTT_INFLIGHT_MAX : messages;
+}
+
+bool MqttSession::connect() {
+    _wanted = true;
+    if (connected()) {
+        return true;
+    }
+    if (_open) {
+        close(true);
+    }
+    // No WiFi is not the broker's fault: no failure, no backoff
+    if (WiFi.status() != WL_CONNECTED ||
+        (_backoff > 0 && millis() - _failedAt < _backoff)) {
+        return false;
+    }
+    if (open()) {
+        _backoff = 0;
+        return true;
+    }
+    ++_stats.connectFailures;
+    _failedAt = millis();
+    _backoff = _backoff == 0 ? MQTT_RECONNECT_MIN
+               : _backoff * 2 > MQTT_RECONNECT_MAX ? MQTT_RECONNECT_MAX
+                                                   : _backoff * 2;
+    return false;
+}
+
+bool MqttSession::open() {
+    _client.stop();
+    if (!_client.connect(_host, _port, static_cast<int32_t>(_connectTimeout))) {
+        return false;
+    }
+    // Small packets must not wait for Nagle's timer
+    _client.setNoDelay(true);
+    _inLength = 0;
+    _pingPending = false;
+
+    // Clean session off: the broker keeps the session across connections
+    uint8_t packet[16 + sizeof(_clientId)];
+    const size_t length =
+        MqttCodec::connect(packet, sizeof(packet), _clientId, MQTT_KEEPALIVE, false);
+    const uint32_t start = millis();
+    if (!write(packet, length)) {
+        return false;
+    }
+    for (;;) {
+        while (_inLength < 4 && _client.available() > 0) {
+            const int c = _client.read();
+            if (c < 0) {
+                break;
+            }
+            _in[_inLength++] = static_cast<uint8_t>(c);
+        }
+        MqttPacket reply;
+        if (MqttCodec::parse(_in, _inLength, reply) == MQTT_PARSE_OK) {
+            bool sessionPresent;
+            uint8_t returnCode;
+            const bool accepted = MqttCodec::parseConnack(reply, sessionPresent, returnCode) &&
+                                  returnCode == 0;
+            _inLength = 0;
+            if (!accepted) {
+                _client.stop();
+                return false;
+            }
+            break;
+        }
+        if (millis() - start >= _responseTimeout || !_client.connected() || _inLength == 4) {
+            _client.stop();
+            return false;
+        }
+        delay(1);
+    }
+    _open = true;
+    ++_stats.connects;
+
+    // What the last connection left unacknowledged goes first, in order
+    for (size_t i = 0; i < _count; ++i) {
+        if (slot(i).packetId != 0 && !transmit(slot(i))) {
+            break;
+        }
+    }
+    return _open;
+}
+
+void MqttSession::close(bool lost) {
+    if (_open && lost) {
+        ++_stats.disconnects;
+    }
+    _open = false;
+    _pingPending = false;
+    _inLength = 0;
+    _client.stop();
+}
+
+bool MqttSession::write(const uint8_t *data, size_t length) {
+    if (length == 0 || _client.write(data, length) != length) {
+        close(true);
+        return false;
+    }
+    _lastSend = millis();
+    return true;
+}
+
+bool MqttSession::transmit(Slot &slot) {
+    const bool dup = slot.written;
+    if (dup) {
+        slot.packet[0] |= 0x08;
+    }
+    if (!write(slot.packet, slot.length)) {
+        return false;
+    }
+    slot.lastSent = millis();
+    if (dup) {
+        ++_stats.retransmitted;
+    } else {
+        slot.written = true;
+        slot.firstSent = slot.lastSent;
+        ++_stats.published;
+    }
+    return true;
+}
+
+bool MqttSession::receive() {
+    // Only acknowledgements are expected; they are a few bytes each
+    while (_client.available() > 0) {
+        const int c = _client.read();
+        if (c < 0) {
+            break;
+        }
+        _in[_inLength++] = static_cast<uint8_t>(c);
+        MqttPacket packet;
+        const MqttParseResult result = MqttCodec::parse(_in, _inLength, packet);
+        if (result == MQTT_PARSE_INCOMPLETE) {
+            if (_inLength == sizeof(_in)) {
+                return false;
+            }
+            continue;
+        }
+        if (result == MQTT_PARSE_MALFORMED) {
+            return false;
+        }
+        uint16_t packetId;
+        if (packet.type == MQTT_PUBACK && MqttCodec::parseAck(packet, packetId)) {
+            acknowledge(packetId);
+        } else if (packet.type == MQTT_PINGRESP) {
+            _pingPending = false;
+        }
+        _inLength = 0;
+    }
+    return true;
+}
+
+void MqttSession::acknowledge(uint16_t packetId) {
+    for (size_t i = 0; i < _count; ++i) {
+        Slot &s = slot(i);
+        if (s.packetId == packetId) {
+            const uint32_t ackMs = millis() - s.firstSent;
+            if (ackMs > _stats.maxAckMs) {
+                _stats.maxAckMs = ackMs;
+            }
+            ++_stats.acknowledged;
+            release(i);
+            return;
+        }
+    }
+    // A PUBACK for a duplicate that was already acknowledged matches nothing
+}
+
+void MqttSession::release(size_t index) {
+    slot(index).packetId = 0;
+    --_inFlight;
+    while (_count > 0 && slot(0).packetId == 0) {
+        _head = (_head + 1) % MQTT_INFLIGHT_MAX;
+        --_count;
+    }
+}
+
+bool MqttSession::pending(uint16_t packetId) const {
+    // 0 marks acknowledged slots; it is never a packet identifier
+    for (size_t i = 0; i < _count && packetId != 0; ++i) {
+        if (slot(i).packetId == packetId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MqttSession::abandon(uint16_t packetId) {
+    for (size_t i = 0; i < _count && packetId != 0; ++i) {
+        if (slot(i).packetId == packetId) {
+            release(i);
+            return;
+        }
+    }
+}
+
+uint16_t MqttSession::nextPacketId() {
+    for (;;) {
+        _packetId = static_cast<uint16_t>(_packetId == 0xFFFF ? 1 : _packetId + 1);
+        bool used = false;
+        for (size_t i = 0; i < _count && !used; ++i) {
+            used = slot(i).packetId == _packetId;
+        }
+        if (!used) {
+            return _packetId;
+        }
+    }
+}
+
+void MqttSession::loop() {
+    if (!connected()) {
+        if (_open) {
+            close(true);
+        }
+        if (_wanted) {
+            connect();
+        }
+        return;
+    }
+    if (!receive()) {
+        close(true);
+        return;
+    }
+    const uint32_t now = millis();
+    if (_pingPending) {
+        // Connections can die without a reset; silence is the only sign
+        if (now - _pingSent >= _responseTimeout) {
+            close(true);
+            return;
+        }
+    } else if (now - _lastSend >= MQTT_KEEPALIVE * 1000UL) {
+        uint8_t packet[2];
+        if (!write(packet, MqttCodec::pingreq(packet, sizeof(packet)))) {
+            return;
+        }
+        _pingPending = true;
+        _pingSent = now;
+    }
+    for (size_t i = 0; i < _count; ++i) {
+        Slot &s = slot(i);
+        if (s.packetId != 0 && (!s.written || now - s.lastSent >= MQTT_RETRY_INTERVAL) &&
+            !transmit(s)) {
+            return;
+        }
+    }
+}
+
+bool MqttSession::publish(const char *topic, const uint8_t *payload, size_t length,
+                          uint8_t qos) {
+    if (!connected()) {
+        return false;
+    }
+    if (qos == 0) {
+        // The payload is written from the caller's buffer, not copied
+        uint8_t head[16 + 64];
+        const size_t headLength =
+            MqttCodec::publishHeader(head, sizeof(head), topic, length, 0, 0);
+        if (headLength == 0 || !write(head, headLength) || !write(payload, length)) {
+            return false;
+        }
+        ++_stats.published;
+        return true;
+    }
+    const uint32_t start = millis();
+    while (_count >= _window) {
+        if (millis() - start >= _responseTimeout) {
+            ++_stats.windowFull;
+            return false;
+        }
+        delay(1);
+        loop();
+    }
+    Slot &s = slot(_count);
+    const uint16_t packetId = nextPacketId();
+    s.length = MqttCodec::publish(s.packet, sizeof(s.packet), topic, payload, length, 1, packetId);
+    if (s.length == 0) {
+        return false;
+    }
+    s.packetId = packetId;
+    s.written = false;
+    ++_count;
+    ++_inFlight;
+    // Taken either way: a failed write is repeated on the next connection
+    if (connected()) {
+        transmit(s);
+    }
+    return true;
+}
+
+bool MqttSession::flush(uint32_t timeoutMs) {
+    const uint32_t start = millis();
+    while (_inFlight > 0 && millis() - start < timeoutMs) {
+        loop();
+        if (_inFlight > 0) {
+            delay(1);
+        }
+    }
+    return _inFlight == 0;
+}
+
+void MqttSession::disconnect() {
+    _wanted = false;
+    if (connected()) {
+        uint8_t packet[2];
+        write(packet, MqttCodec::disconnect(packet, sizeof(packet)));
+    }
+    close(false);
+}
+
+MqttSessionStats MqttSession::getStats() const {
+    MqttSessionStats stats = _stats;
+    stats.inFlight = static_cast<uint32_t>(_inFlight);
+    return stats;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file StoreAndForward.cpp
+ * @brief Implementation of the StoreAndForward class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "connectivity/StoreAndForward.h"
+#include "utils/BinaryLog.h"
+
+StoreAndForward::StoreAndForward(FlashLog &log, CloudUploader &uploader)
+    : _log(log), _uploader(uploader), _lastReplay(0),
+      _interval(REPLAY_INTERVAL), _ready(false), _inFlight(0),
+      _replayedBase(0), _failedBase(0), _overwrittenBase(0) {}
+
+bool StoreAndForward::begin() {
+    _ready = _log.begin();
+    if (!_ready) {
+        LOG_ERROR("Flash log unavailable, offline readings will be lost");
+    }
+    return _ready;
+}
+
+void StoreAndForward::submit(const SensorReading &reading, bool connected) {
+    if (connected) {
+        _uploader.upload(reading.temperature, reading.humidity, reading.light);
+    } else if (_ready) {
+        _log.append(reading);
+    }
+}
+
+void StoreAndForward::submit(const ChannelView &channels, uint32_t timestamp, bool connected) {
+    if (connected) {
+        _uploader.uploadChannels(channels);
+        return;
+    }
+    if (!_ready || channels.count < 3 || isnan(channels.values[0]) ||
+        isnan(channels.values[1]) || isnan(channels.values[2])) {
+        return;
+    }
+    SensorReading reading;
+    reading.timestamp   = timestamp;
+    reading.temperature = channels.values[0];
+    reading.humidity    = channels.values[1];
+    reading.light       = static_cast<int>(lroundf(channels.values[2]));
+    reading.flags       = 0;
+    _log.append(reading);
+}
+
+size_t StoreAndForward::loop(bool connected) {
+    if (!_ready) {
+        return 0;
+    }
+    const size_t committed = settle();
+    if (_inFlight > 0 || !connected || _log.pending() == 0) {
+        return committed;
+    }
+    const unsigned long now = millis();
+    if (now - _lastReplay < _interval) {
+        return committed;
+    }
+    // Leave at least half of the queue to live readings
+    if (_uploader.queueDepth() > UPLOAD_QUEUE_DEPTH / 2) {
+        return committed;
+    }
+    _lastReplay = now;
+
+    SensorReading batch[REPLAY_BATCH_SIZE];
+    const size_t count = _log.peek(batch, REPLAY_BATCH_SIZE);
+    const UploadStats before = _uploader.getStats();
+    size_t accepted = 0;
+    while (accepted < count && _uploader.enqueueReplay(batch[accepted])) {
+        ++accepted;
+        // Without UPLOAD_ASYNC it was sent already; stop at the first failure
+        if (_uploader.getStats().replayFailed != before.replayFailed) {
+            break;
+        }
+    }
+    if (accepted == 0) {
+        return committed;
+    }
+    // Committed by settle() once the uploader has an outcome for each
+    _inFlight = accepted;
+    _replayedBase = before.replayed;
+    _failedBase = before.replayFailed;
+    _overwrittenBase = _log.getStats().overwritten;
+    return committed + settle();
+}
+
+size_t StoreAndForward::settle() {
+    if (_inFlight == 0) {
+        return 0;
+    }
+    const UploadStats stats = _uploader.getStats();
+    const uint32_t delivered = stats.replayed - _replayedBase;
+    const uint32_t failed = stats.replayFailed - _failedBase;
+    if (delivered + failed < _inFlight) {
+        return 0;   // Still queued, batched or awaiting its PUBACK
+    }
+    const size_t count = _inFlight;
+    _inFlight = 0;
+    if (failed > 0 || _log.getStats().overwritten != _overwrittenBase) {
+        // Left in flash; a later replay step sends the batch again
+        _lastReplay = millis();
+        _interval = failed > 0 ? REPLAY_RETRY_INTERVAL : REPLAY_INTERVAL;
+        return 0;
+    }
+    _interval = REPLAY_INTERVAL;
+    // Appends since the handover are behind these records: the same
+    // oldest ones come back
+    SensorReading batch[REPLAY_BATCH_SIZE];
+    if (_log.peek(batch, count) != count || !_log.commit()) {
+        return 0;
+    }
+    return count;
+}
@@ -7,39 +7,331 @@
 #include "secret.h"
 #include "connectivity/WiFiManager.h"
 
-WiFiManager::WiFiManager() : _lastAttempt(0) {}
+#include <esp_attr.h>
+#include "utils/BinaryLog.h"
+#include "utils/WallClock.h"
+#if WIFI_CACHE_NVS
+#include <Preferences.h>
+#endif
 
-bool WiFiManager::connect() {
-    if (WiFi.status() == WL_CONNECTED) {
+namespace {
+
+const uint32_t kLinkMagic = 0x574C4331;  // "WLC1"
+const char *const kNvsNamespace = "wifi";
+const char *const kNvsKey = "link";
+
+/** Lets the disconnect event of an abandoned fast attempt drain first. */
+const unsigned long kFallbackDelay = 50;
+
+/**
+ * Access point and lease of the last connection that reached GOT_IP.
+ * Plain data, as constructors of RTC_DATA_ATTR objects would run again on
+ * every wake-up.
+ */
+struct LinkCache {
+    uint32_t magic;
+    uint32_t ssidHash;  ///< Changed credentials invalidate the cache
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+RTC_DATA_ATTR LinkCache s_link;
+
+uint32_t ssidHash() {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char *c = WIFI_SSID; *c; ++c) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    return hash;
+}
+
+bool linkValid(const LinkCache &link) {
+    return link.magic == kLinkMagic && link.ssidHash == ssidHash() && link.channel > 0;
+}
+
+/** Make s_link valid if RTC memory or NVS holds a cached link. */
+bool loadLink() {
+    if (linkValid(s_link)) {
         return true;
     }
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    DEBUG_PRINTLN("Connecting to WiFi...");
-    unsigned long start = millis();
-    while (WiFi.status() != WL_CONNECTED && (millis() - start) < WIFI_TIMEOUT) {
-        delay(500);
-        DEBUG_PRINT(".");
-    }
-    if (WiFi.status() == WL_CONNECTED) {
-        DEBUG_PRINTLN("");
-        DEBUG_PRINT("Connected. IP address: ");
-        DEBUG_PRINTLN(WiFi.localIP());
+#if WIFI_CACHE_NVS
+    // Cold boot: RTC memory is gone, NVS is not
+    Preferences nvs;
+    if (nvs.begin(kNvsNamespace, true)) {
+        LinkCache stored;
+        if (nvs.getBytes(kNvsKey, &stored, sizeof(stored)) == sizeof(stored) &&
+            linkValid(stored)) {
+            s_link = stored;
+        }
+        nvs.end();
+    }
+#endif
+    return linkValid(s_link);
+}
+
+/** Cache the current connection; NVS is written only when it changed. */
+void storeLink() {
+    const uint8_t *bssid = WiFi.BSSID();
+    if (bssid == nullptr) {
+        return;
+    }
+    LinkCache link;
+    memset(&link, 0, sizeof(link));
+    link.magic = kLinkMagic;
+    link.ssidHash = ssidHash();
+    memcpy(link.bssid, bssid, sizeof(link.bssid));
+    link.channel = static_cast<uint8_t>(WiFi.channel());
+    link.ip = static_cast<uint32_t>(WiFi.localIP());
+    link.gateway = static_cast<uint32_t>(WiFi.gatewayIP());
+    link.subnet = static_cast<uint32_t>(WiFi.subnetMask());
+    link.dns = static_cast<uint32_t>(WiFi.dnsIP());
+    if (linkValid(s_link) && memcmp(&link, &s_link, sizeof(link)) == 0) {
+        return;
+    }
+    s_link = link;
+#if WIFI_CACHE_NVS
+    Preferences nvs;
+    if (nvs.begin(kNvsNamespace, false)) {
+        LinkCache stored;
+        if (nvs.getBytes(kNvsKey, &stored, sizeof(stored)) != sizeof(stored) ||
+            memcmp(&stored, &link, sizeof(link)) != 0) {
+            nvs.putBytes(kNvsKey, &link, sizeof(link));
+        }
+        nvs.end();
+    }
+#endif
+}
+
+void dropLink() {
+    s_link.magic = 0;
+#if WIFI_CACHE_NVS
+    Preferences nvs;
+    if (nvs.begin(kNvsNamespace, false)) {
+        nvs.remove(kNvsKey);
+        nvs.end();
+    }
+#endif
+}
+
+} // namespace
+
+WiFiManager::WiFiManager()
+    : _events(0), _state(WIFI_STATE_IDLE), _handlerRegistered(false), _handlerId(0),
+      _lastAttempt(0), _retryDelay(WIFI_BACKOFF_INITIAL), _failures(0), _attemptStart(0),
+      _fastPath(false), _fallingBack(false), _stats(), _listenerCount(0) {}
+
+WiFiManager::~WiFiManager() {
+    if (_handlerRegistered) {
+        WiFi.removeEvent(_handlerId);
+    }
+}
+
+bool WiFiManager::connect() {
+    if (!_handlerRegistered) {
+        // Runs in the WiFi event task: only record what happened
+        _handlerId = WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) {
+            (void)info;
+            onWiFiEvent(event);
+        });
+        _handlerRegistered = true;
+    }
+    if (_state == WIFI_STATE_CONNECTED) {
         return true;
     }
-    DEBUG_PRINTLN("");
-    DEBUG_PRINTLN("WiFi connection failed");
+    if (_state == WIFI_STATE_IDLE) {
+        // Events from before disconnect() would fail the new attempt
+        _events.store(0);
+    }
+    if (_state != WIFI_STATE_CONNECTING) {
+        startAttempt(millis());
+    }
     return false;
 }
 
+void WiFiManager::disconnect() {
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    _events.store(0);
+    setState(WIFI_STATE_IDLE);
+}
+
 bool WiFiManager::isConnected() const {
-    return WiFi.status() == WL_CONNECTED;
+    return _state == WIFI_STATE_CONNECTED;
+}
+
+WiFiState WiFiManager::getState() const {
+    return _state;
+}
+
+uint32_t WiFiManager::getFailures() const {
+    return _failures;
+}
+
+const WiFiConnectStats &WiFiManager::getStats() const {
+    return _stats;
+}
+
+void WiFiManager::forgetRetainedLink() {
+    s_link.magic = 0;
+}
+
+bool WiFiManager::onStateChange(WiFiStateCallback callback, void *context) {
+    if (_listenerCount >= WIFI_MAX_LISTENERS) {
+        return false;
+    }
+    _listeners[_listenerCount].callback = callback;
+    _listeners[_listenerCount].context = context;
+    ++_listenerCount;
+    return true;
+}
+
+void WiFiManager::onWiFiEvent(WiFiEvent_t event) {
+    switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        _events.fetch_or(EVENT_GOT_IP);
+        break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+        _events.fetch_or(EVENT_DISCONNECTED);
+        break;
+    default:
+        break;
+    }
 }
 
 void WiFiManager::loop() {
-    // Attempt reconnection only after the configured retry interval
-    if (!isConnected() && (millis() - _lastAttempt) > WIFI_RETRY_INTERVAL) {
-        _lastAttempt = millis();
-        connect();
+    const unsigned long now = millis();
+    const uint32_t events = _events.exchange(0);
+    if (events) {
+        // Both flags may be pending; the driver status tells which came last
+        if (WiFi.status() == WL_CONNECTED) {
+            if (_state != WIFI_STATE_CONNECTED) {
+                _stats.lastConnectMs = now - _attemptStart;
+                _stats.lastFast = _fastPath;
+                const IPAddress ip = WiFi.localIP();
+                LOG_INFO("WiFi connected in %lu ms (%s), IP address %u.%u.%u.%u",
+                         _stats.lastConnectMs, _fastPath ? "cached link" : "full scan",
+                         ip[0], ip[1], ip[2], ip[3]);
+#if WIFI_FAST_CONNECT
+                if (!_fastPath) {
+                    storeLink();
+                }
+#endif
+                if (wallClock() == 0) {
+                    // UTC; SNTP keeps the clock in step from here on
+                    configTime(0, 0, NTP_SERVER);
+                }
+                _failures = 0;
+                _retryDelay = WIFI_BACKOFF_INITIAL;
+                setState(WIFI_STATE_CONNECTED);
+            }
+        } else if (_state == WIFI_STATE_CONNECTED) {
+            LOG_WARN("WiFi connection lost");
+            scheduleRetry(now);
+        } else if (_state == WIFI_STATE_CONNECTING && _fastPath) {
+            fallBack(now);
+        } else if (_state == WIFI_STATE_CONNECTING) {
+            LOG_WARN("WiFi connection failed");
+            ++_failures;
+            scheduleRetry(now);
+        }
+    }
+
+    switch (_state) {
+    case WIFI_STATE_CONNECTING:
+        if (_fastPath && now - _lastAttempt >= WIFI_FAST_TIMEOUT) {
+            WiFi.disconnect();
+            fallBack(now);
+        } else if (now - _lastAttempt >= WIFI_TIMEOUT) {
+            LOG_WARN("WiFi connection timed out");
+            WiFi.disconnect();
+            ++_failures;
+            scheduleRetry(now);
+        }
+        break;
+    case WIFI_STATE_BACKOFF:
+        if (now - _lastAttempt >= _retryDelay) {
+            startAttempt(now);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void WiFiManager::startAttempt(unsigned long now) {
+    // The state machine owns retries; the driver must not race it
+    WiFi.setAutoReconnect(false);
+    WiFi.mode(WIFI_STA);
+    if (!_fallingBack) {
+        _attemptStart = now;
     }
-}
\ No newline at end of file
+    _fallingBack = false;
+#if WIFI_FAST_CONNECT
+    _fastPath = loadLink();
+#endif
+    if (_fastPath) {
+#if WIFI_CACHE_STATIC_IP
+        WiFi.config(IPAddress(s_link.ip), IPAddress(s_link.gateway), IPAddress(s_link.subnet),
+                    IPAddress(s_link.dns));
+#endif
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, s_link.channel, s_link.bssid);
+        ++_stats.fastAttempts;
+        LOG_INFO("Connecting to WiFi (cached channel %u)...", s_link.channel);
+    } else {
+#if WIFI_CACHE_STATIC_IP
+        // Back to DHCP: the cached lease may be what failed
+        WiFi.config(IPAddress(), IPAddress(), IPAddress());
+#endif
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+        ++_stats.scanAttempts;
+        LOG_INFO("Connecting to WiFi...");
+    }
+    _lastAttempt = now;
+    setState(WIFI_STATE_CONNECTING);
+}
+
+void WiFiManager::fallBack(unsigned long now) {
+    // The access point moved or the lease is stale: scan without counting
+    // a failure or backing off
+    LOG_INFO("Cached WiFi link failed, scanning");
+    dropLink();
+    ++_stats.fastFallbacks;
+    _fastPath = false;
+    _fallingBack = true;
+    _retryDelay = kFallbackDelay;
+    _lastAttempt = now;
+    setState(WIFI_STATE_BACKOFF);
+}
+
+void WiFiManager::scheduleRetry(unsigned long now) {
+    // Exponential backoff capped at WIFI_RETRY_INTERVAL, with "equal jitter"
+    // (half fixed, half random) so a fleet does not reconnect in lockstep
+    unsigned long ceiling = WIFI_BACKOFF_INITIAL;
+    for (uint32_t i = 1; i < _failures && ceiling < WIFI_RETRY_INTERVAL; ++i) {
+        ceiling *= 2;
+    }
+    if (ceiling > WIFI_RETRY_INTERVAL) {
+        ceiling = WIFI_RETRY_INTERVAL;
+    }
+    _retryDelay = ceiling / 2 + static_cast<unsigned long>(random(ceiling / 2 + 1));
+    _lastAttempt = now;
+    LOG_INFO("WiFi retry in %lu ms", _retryDelay);
+    setState(WIFI_STATE_BACKOFF);
+}
+
+void WiFiManager::setState(WiFiState state) {
+    if (state == _state) {
+        return;
+    }
+    _state = state;
+    for (size_t i = 0; i < _listenerCount; ++i) {
+        _listeners[i].callback(state, _listeners[i].context);
+    }
+}
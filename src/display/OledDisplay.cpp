@@ -7,7 +7,24 @@
 #include "secret.h"
 #include "display/OledDisplay.h"
 
-OledDisplay::OledDisplay() : _display(OLED_WIDTH, OLED_HEIGHT, &Wire, -1) {}
+namespace {
+
+const uint8_t kControlCommand = 0x00;
+const uint8_t kControlData = 0x40;
+
+/** Append @p value with one decimal, as Print::print(value, 1) would. */
+int formatTenths(char *out, size_t size, float value) {
+    const long tenths = lroundf(value * 10.0f);
+    const unsigned long magnitude = static_cast<unsigned long>(tenths < 0 ? -tenths : tenths);
+    return snprintf(out, size, "%s%lu.%lu", tenths < 0 ? "-" : "", magnitude / 10,
+                    magnitude % 10);
+}
+
+} // namespace
+
+OledDisplay::OledDisplay()
+    : _display(OLED_WIDTH, OLED_HEIGHT, &Wire, -1, OLED_I2C_CLOCK, OLED_I2C_CLOCK), _shadow(),
+      _lines(), _lineCount(0), _linesValid(false), _stats() {}
 
 bool OledDisplay::begin() {
     // Initialize I2C pins (Wire will use default SDA/SCL defined by pins).
@@ -16,43 +33,189 @@ bool OledDisplay::begin() {
         // Failed to initialize display
         return false;
     }
+    Wire.setClock(OLED_I2C_CLOCK);
     _display.clearDisplay();
     _display.setTextSize(1);
     _display.setTextColor(SSD1306_WHITE);
-    _display.display();
+    // Panel RAM is undefined after power-up: send one full frame
+    flush(true);
+    _stats = DisplayStats();
     return true;
 }
 
+void OledDisplay::setClock(uint32_t hz) {
+    Wire.setClock(hz);
+}
+
 void OledDisplay::clear() {
     _display.clearDisplay();
-    _display.display();
+    flush(false);
+    _linesValid = false;
 }
 
 void OledDisplay::showReadings(float temperature, float humidity, int light) {
-    _display.clearDisplay();
-    _display.setCursor(0, 0);
-    _display.print(F("Temp: "));
+    const uint32_t start = micros();
+    char lines[kMaxLines][kLineMax];
+    char value[24];
     if (isnan(temperature)) {
-        _display.println(F("--"));
+        snprintf(lines[0], kLineMax, "Temp: --");
     } else {
-        _display.print(temperature, 1);
-        _display.println(F(" C"));
+        formatTenths(value, sizeof(value), temperature);
+        snprintf(lines[0], kLineMax, "Temp: %.12s C", value);
     }
-    _display.print(F("Hum: "));
     if (isnan(humidity)) {
-        _display.println(F("--"));
+        snprintf(lines[1], kLineMax, "Hum: --");
     } else {
-        _display.print(humidity, 1);
-        _display.println(F(" %"));
+        formatTenths(value, sizeof(value), humidity);
+        snprintf(lines[1], kLineMax, "Hum: %.12s %%", value);
+    }
+    snprintf(lines[2], kLineMax, "Light: %d mV", light);
+    showLines(lines, 3, start);
+}
+
+size_t OledDisplay::channelPages(size_t channels) {
+    if (channels <= kMaxLines) {
+        return 1;
+    }
+    // Last line holds the page indicator
+    return (channels + kMaxLines - 2) / (kMaxLines - 1);
+}
+
+void OledDisplay::showChannels(const ChannelView &channels, size_t page) {
+    const uint32_t start = micros();
+    const size_t pages = channelPages(channels.count);
+    const size_t perPage = pages == 1 ? kMaxLines : kMaxLines - 1;
+    page %= pages;
+    const size_t first = page * perPage;
+    const size_t last = first + perPage < channels.count ? first + perPage : channels.count;
+
+    char lines[kMaxLines][kLineMax];
+    char value[24];
+    size_t count = 0;
+    for (size_t c = first; c < last; ++c) {
+        const ChannelSpec &spec = *channels.specs[c];
+        const float v = channels.values[c];
+        if (isnan(v)) {
+            snprintf(value, sizeof(value), "--");
+        } else if (spec.decimals > 0) {
+            formatTenths(value, sizeof(value), v);
+        } else {
+            snprintf(value, sizeof(value), "%ld", lroundf(v));
+        }
+        snprintf(lines[count++], kLineMax, spec.unit[0] && !isnan(v) ? "%s: %.12s %s" : "%s: %.12s",
+                 spec.label, value, spec.unit);
+    }
+    if (pages > 1) {
+        snprintf(lines[count++], kLineMax, "Page %u/%u", static_cast<unsigned>(page + 1),
+                 static_cast<unsigned>(pages));
+    }
+    showLines(lines, count, start);
+}
+
+void OledDisplay::showLines(char (*lines)[kLineMax], size_t count, uint32_t startUs) {
+    // The displayed text only changes at 0.1 resolution; most frames repeat
+    bool same = _linesValid && count == _lineCount;
+    for (size_t i = 0; same && i < count; ++i) {
+        same = strcmp(lines[i], _lines[i]) == 0;
     }
-    _display.print(F("Light: "));
-    _display.println(light);
-    _display.display();
+    if (same) {
+        ++_stats.skipped;
+        recordFrame(startUs);
+        return;
+    }
+    const char *text[kMaxLines] = {};
+    for (size_t i = 0; i < count; ++i) {
+        text[i] = lines[i];
+    }
+    render(text, count);
+    for (size_t i = 0; i < count; ++i) {
+        memcpy(_lines[i], lines[i], strlen(lines[i]) + 1);
+    }
+    _lineCount = count;
+    _linesValid = true;
+    recordFrame(startUs);
 }
 
 void OledDisplay::showStatus(const String &status) {
+    const uint32_t start = micros();
+    const char *const text[1] = {status.c_str()};
+    render(text, 1);
+    _linesValid = false;
+    recordFrame(start);
+}
+
+void OledDisplay::render(const char *const *lines, size_t count) {
     _display.clearDisplay();
     _display.setCursor(0, 0);
-    _display.println(status);
-    _display.display();
-}
\ No newline at end of file
+    for (size_t i = 0; i < count; ++i) {
+        _display.println(lines[i]);
+    }
+    flush(false);
+}
+
+void OledDisplay::flush(bool full) {
+    const uint8_t *buffer = _display.getBuffer();
+    if (!buffer) {
+        return;
+    }
+    bool sent = false;
+    for (size_t page = 0; page < kPages; ++page) {
+        const uint8_t *row = buffer + page * OLED_WIDTH;
+        uint8_t *shadow = _shadow + page * OLED_WIDTH;
+        size_t first = 0;
+        size_t last = OLED_WIDTH - 1;
+        if (!full) {
+            while (first < OLED_WIDTH && row[first] == shadow[first]) {
+                ++first;
+            }
+            if (first == OLED_WIDTH) {
+                continue;  // Page unchanged
+            }
+            while (row[last] == shadow[last]) {
+                --last;
+            }
+        }
+        // Horizontal addressing mode: restrict the window to the changed span
+        const uint8_t window[] = {SSD1306_COLUMNADDR, static_cast<uint8_t>(first),
+                                  static_cast<uint8_t>(last), SSD1306_PAGEADDR,
+                                  static_cast<uint8_t>(page), static_cast<uint8_t>(page)};
+        sendCommands(window, sizeof(window));
+        sendData(row + first, last - first + 1);
+        memcpy(shadow + first, row + first, last - first + 1);
+        sent = true;
+    }
+    if (sent) {
+        ++_stats.flushes;
+    }
+}
+
+void OledDisplay::sendCommands(const uint8_t *commands, size_t count) {
+    Wire.beginTransmission(OLED_ADDRESS);
+    Wire.write(kControlCommand);
+    Wire.write(commands, count);
+    Wire.endTransmission();
+    _stats.i2cBytes += count + 2;
+}
+
+void OledDisplay::sendData(const uint8_t *data, size_t count) {
+    while (count > 0) {
+        const size_t chunk = count < OLED_I2C_CHUNK - 1 ? count : OLED_I2C_CHUNK - 1;
+        Wire.beginTransmission(OLED_ADDRESS);
+        Wire.write(kControlData);
+        Wire.write(data, chunk);
+        Wire.endTransmission();
+        _stats.i2cBytes += chunk + 2;
+        data += chunk;
+        count -= chunk;
+    }
+}
+
+void OledDisplay::recordFrame(uint32_t startUs) {
+    const uint32_t elapsed = micros() - startUs;
+    ++_stats.frames;
+    _stats.lastFrameUs = elapsed;
+    _stats.totalFrameUs += elapsed;
+    if (elapsed > _stats.maxFrameUs) {
+        _stats.maxFrameUs = elapsed;
+    }
+}
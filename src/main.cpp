@@ -5,6 +5,20 @@
  * The firmware reads temperature, humidity and light levels, filters the
  * readings, displays them on an OLED screen, indicates alerts via an LED
  * and periodically uploads the data to a cloud service.
+ *
+ * The sensors are sampled through a SensorRegistry, and filtering, alerts,
+ * display and uploads iterate over its channels. With USE_TASK_PIPELINE the
+ * work is split into FreeRTOS tasks (see TaskPipeline); otherwise
+ * everything is polled from loop(); with ADAPTIVE_SAMPLING an
+ * AdaptiveSampler reads each sensor as often as its signal needs rather
+ * than every SENSOR_READ_INTERVAL; with HISTORY_ENABLED the raw samples are
+ * also kept in a compressed History, and with METRICS_SERVER a
+ * MetricsServer answers /metrics and /history locally. With LOOP_PROFILER
+ * each stage of the loop is timed in cycles and the histograms are reported
+ * every PROFILER_REPORT_INTERVAL. With LOW_POWER_MODE each loop() is one
+ * PowerManager duty cycle over the three fixed channels, followed by light
+ * or deep sleep. Modules log through the LOG_* macros of BinaryLog, which a
+ * low-priority task drains to Serial.
  */
 
 #include <Arduino.h>
@@ -12,11 +26,51 @@
 
 #include "sensors/DHTSensor.h"
 #include "sensors/LightSensor.h"
+#include "sensors/SensorRegistry.h"
+#include "sensors/AdaptiveSampler.h"
+#if ADAPTIVE_SAMPLING && (USE_TASK_PIPELINE || LOW_POWER_MODE != LOW_POWER_OFF)
+#error "ADAPTIVE_SAMPLING requires the polled loop (USE_TASK_PIPELINE=0, LOW_POWER_MODE off)"
+#endif
 #include "display/OledDisplay.h"
 #include "connectivity/WiFiManager.h"
 #include "connectivity/CloudUploader.h"
 #include "utils/DataFilter.h"
 #include "utils/AlertManager.h"
+#include "utils/BinaryLog.h"
+#include "utils/LoopProfiler.h"
+#if LOOP_PROFILER && (USE_TASK_PIPELINE || LOW_POWER_MODE != LOW_POWER_OFF)
+#error "LOOP_PROFILER requires the polled loop (USE_TASK_PIPELINE=0, LOW_POWER_MODE off)"
+#endif
+#if HISTORY_ENABLED
+#include "storage/History.h"
+#if USE_TASK_PIPELINE || LOW_POWER_MODE != LOW_POWER_OFF
+#error "HISTORY_ENABLED requires the polled loop (USE_TASK_PIPELINE=0, LOW_POWER_MODE off)"
+#endif
+#endif
+#if METRICS_SERVER
+#include "connectivity/MetricsServer.h"
+#if USE_TASK_PIPELINE || LOW_POWER_MODE != LOW_POWER_OFF
+#error "METRICS_SERVER requires the polled loop (USE_TASK_PIPELINE=0, LOW_POWER_MODE off)"
+#endif
+#endif
+#if STORE_AND_FORWARD
+#include "connectivity/StoreAndForward.h"
+#include "storage/FlashLog.h"
+#include "storage/PartitionFlash.h"
+#endif
+#if USE_TASK_PIPELINE
+#include "pipeline/TaskPipeline.h"
+#endif
+#if LOW_POWER_MODE != LOW_POWER_OFF
+#include "power/PowerManager.h"
+#if USE_TASK_PIPELINE
+#error "LOW_POWER_MODE requires USE_TASK_PIPELINE=0"
+#endif
+#if UPLOAD_ASYNC
+// The worker would drive the MQTT session alongside sendBatch()
+#error "LOW_POWER_MODE requires UPLOAD_ASYNC=0"
+#endif
+#endif
 
 // Instantiate global objects
 DHTSensor dhtSensor;
@@ -24,21 +78,70 @@ LightSensor lightSensor;
 OledDisplay oledDisplay;
 WiFiManager wifiManager;
 CloudUploader cloudUploader;
-DataFilter tempFilter;
-DataFilter humidFilter;
-DataFilter lightFilter;
 AlertManager alertManager;
 
+#if STORE_AND_FORWARD
+PartitionFlash flashPartition;
+FlashLog flashLog(flashPartition);
+StoreAndForward storeAndForward(flashLog, cloudUploader);
+#define STORE_AND_FORWARD_PTR (&storeAndForward)
+#else
+#define STORE_AND_FORWARD_PTR nullptr
+#endif
+
+#if LOW_POWER_MODE != LOW_POWER_OFF
+// Low-power mode keeps the three fixed channels: their filters and any
+// pending uploads must fit in RTC memory across deep sleep
+DataFilter<FILTER_WINDOW_SIZE> tempFilter;
+DataFilter<FILTER_WINDOW_SIZE> humidFilter;
+DataFilter<FILTER_WINDOW_SIZE> lightFilter;
+PowerManager powerManager(dhtSensor, lightSensor, tempFilter, humidFilter, lightFilter,
+                          oledDisplay, alertManager, wifiManager, cloudUploader);
+#else
+// Every channel of every registered sensor, filtered per channel. Extra
+// sensors are added in setup(); the first three channels are temperature,
+// humidity and light, which store-and-forward keeps in flash.
+SensorRegistry<> sensorRegistry;
+#if USE_TASK_PIPELINE
+TaskPipeline pipeline(sensorRegistry, oledDisplay, alertManager, wifiManager, cloudUploader,
+                      STORE_AND_FORWARD_PTR);
+#else
+static size_t displayPage = 0;
+#if ADAPTIVE_SAMPLING
+// Per-channel read intervals from the variance of the filter windows
+AdaptiveSampler<> sampler(sensorRegistry);
+#endif
+#if HISTORY_ENABLED
+// Full-resolution raw samples of every channel, compressed in RAM
+History history;
+#define HISTORY_PTR (&history)
+#else
+#define HISTORY_PTR nullptr
+#endif
+#if METRICS_SERVER
+// Prometheus scrape target and history queries on the local network
+MetricsServer metricsServer(sensorRegistry, alertManager, cloudUploader, HISTORY_PTR);
+#endif
+#if LOOP_PROFILER
+// Cycle histograms of the loop stages (PROFILE_* compile out without it)
+LoopProfiler loopProfiler;
+#endif
+
 // Timing variables
+#if !ADAPTIVE_SAMPLING
 static unsigned long lastSensorTime = 0;
+#endif
 static unsigned long lastDisplayTime = 0;
 static unsigned long lastUploadTime = 0;
+#endif // USE_TASK_PIPELINE
+#endif // LOW_POWER_MODE
 
 void setup() {
     // Initialize serial for debugging
     Serial.begin(SERIAL_BAUD_RATE);
-    DEBUG_PRINTLN();
-    DEBUG_PRINTLN(F("Starting " DEVICE_NAME " (FW " FIRMWARE_VERSION ")"));
+    // Log records go out through a low-priority task from here on
+    binaryLog.begin(Serial);
+    LOG_INFO("Starting " DEVICE_NAME " (FW " FIRMWARE_VERSION ")");
 
     // Initialise sensors
     dhtSensor.begin();
@@ -46,68 +149,168 @@ void setup() {
 
     // Initialise display
     if (!oledDisplay.begin()) {
-        DEBUG_PRINTLN(F("OLED init failed"));
+        LOG_ERROR("OLED init failed");
     }
 
     // Setup alert LED
     alertManager.begin();
 
+#if LOW_POWER_MODE != LOW_POWER_OFF
+    // Filters, alerts and pending uploads come back from RTC memory after
+    // a deep sleep wake-up; the radio stays off until an upload is due
+    if (powerManager.begin()) {
+        oledDisplay.showStatus("Booting...");
+    }
+    cloudUploader.begin();
+#else
+    // Clear initial display
+    oledDisplay.showStatus("Booting...");
+
+#if STORE_AND_FORWARD
+    // Recover readings stored before a reset or power loss
+    if (flashPartition.begin()) {
+        storeAndForward.begin();
+    }
+#endif
+
+    sensorRegistry.add(dhtSensor);
+    sensorRegistry.add(lightSensor);
+
+#if USE_TASK_PIPELINE
+    // WiFi and the uploader are brought up by the uplink task
+    pipeline.begin();
+#else
+#if ADAPTIVE_SAMPLING
+    sampler.begin(millis());
+#endif
+#if HISTORY_ENABLED
+    history.begin(sensorRegistry.channelCount());
+#endif
+
     // Establish WiFi connection
     wifiManager.connect();
 
     // Initialise cloud uploader
     cloudUploader.begin();
 
-    // Clear initial display
-    oledDisplay.showStatus("Booting...");
+#if METRICS_SERVER
+    // Listens on every interface; requests are served once WiFi is up
+    metricsServer.begin();
+#endif
+#endif
+#endif // LOW_POWER_MODE
 }
 
 void loop() {
+#if LOW_POWER_MODE != LOW_POWER_OFF
+    // Deep sleep does not return: the next cycle starts in setup()
+    powerManager.sleep(powerManager.runCycle());
+#elif USE_TASK_PIPELINE
+    // All work happens in the pipeline tasks; free the Arduino loop task
+    vTaskDelete(nullptr);
+#else
     unsigned long now = millis();
+    PROFILE_LOOP_BEGIN(loopProfiler);
 
     // Maintain WiFi connection
     wifiManager.loop();
+#if !UPLOAD_ASYNC
+    // Keep the MQTT session alive between uploads; the worker does with UPLOAD_ASYNC
+    cloudUploader.loop();
+#endif
+    PROFILE_LAP(loopProfiler, PROFILE_WIFI);
 
+#if METRICS_SERVER
+    // Answer local requests from the current state
+    metricsServer.loop();
+    PROFILE_LAP(loopProfiler, PROFILE_METRICS);
+#endif
+
+#if ADAPTIVE_SAMPLING
+    // Read the sensors whose channels are due; quiet ones wait longer
+    const SensorMask dueSensors = sampler.due(now);
+    if (dueSensors != 0) {
+        PROFILE_MARK(loopProfiler);
+        // Out-of-range values are discarded
+        const float *row = sensorRegistry.readSensors(dueSensors);
+        PROFILE_LAP(loopProfiler, PROFILE_SENSORS);
+        sensorRegistry.addSamples(row, dueSensors);
+        sampler.update(dueSensors, now);
+        const ChannelMask sampled = sensorRegistry.channelMask(dueSensors);
+        PROFILE_LAP(loopProfiler, PROFILE_FILTER);
+#else
     // Read sensors at configured interval
     if (now - lastSensorTime >= SENSOR_READ_INTERVAL) {
         lastSensorTime = now;
-        float t = dhtSensor.readTemperature();
-        float h = dhtSensor.readHumidity();
-        int   l = lightSensor.readRaw();
-        // Add valid readings to filters
-        if (DHTSensor::isValid(t, TEMP_MIN_VALID, TEMP_MAX_VALID)) {
-            tempFilter.addValue(t);
-        }
-        if (DHTSensor::isValid(h, HUMID_MIN_VALID, HUMID_MAX_VALID)) {
-            humidFilter.addValue(h);
-        }
-        if (l >= LIGHT_MIN_VALID && l <= LIGHT_MAX_VALID) {
-            lightFilter.addValue(static_cast<float>(l));
+        PROFILE_MARK(loopProfiler);
+        // Samples every channel; out-of-range values are discarded
+        const float *row = sensorRegistry.readSensors();
+        PROFILE_LAP(loopProfiler, PROFILE_SENSORS);
+        sensorRegistry.addSamples(row);
+        const ChannelMask sampled = CHANNEL_MASK_ALL;
+        PROFILE_LAP(loopProfiler, PROFILE_FILTER);
+#endif
+        // Evaluate alert rules and update the LED on every sample; only
+        // the rules of the channels just read advance
+        alertManager.update(sensorRegistry.view(), now, sampled);
+        PROFILE_LAP(loopProfiler, PROFILE_ALERTS);
+#if HISTORY_ENABLED
+        // A full block goes out as is; offline, it stays in RAM only.
+        // Channels not read this time repeat their last sample.
+        if (history.append(now, sensorRegistry.latestRow()) && wifiManager.isConnected()) {
+            size_t length;
+            const uint8_t *block = history.lastSealed(length);
+            cloudUploader.uploadHistory(block, length);
         }
+        PROFILE_LAP(loopProfiler, PROFILE_HISTORY);
+#endif
     }
+    const ChannelView channels = sensorRegistry.view();
 
     // Update display at configured interval
     if (now - lastDisplayTime >= DISPLAY_UPDATE_INTERVAL) {
         lastDisplayTime = now;
-        float avgTemp  = tempFilter.getAverage();
-        float avgHumid = humidFilter.getAverage();
-        int   avgLight = static_cast<int>(lightFilter.getAverage());
-        oledDisplay.showReadings(avgTemp, avgHumid, avgLight);
-        // Update alerts and LED
-        alertManager.update(avgTemp, avgHumid, avgLight);
+        PROFILE_MARK(loopProfiler);
+        // More channels than lines: show the next page each update
+        oledDisplay.showChannels(channels, displayPage);
+        displayPage = (displayPage + 1) % OledDisplay::channelPages(channels.count);
+        PROFILE_LAP(loopProfiler, PROFILE_DISPLAY);
     }
 
     // Upload data at configured interval
     if (now - lastUploadTime >= CLOUD_UPLOAD_INTERVAL) {
         lastUploadTime = now;
+        PROFILE_MARK(loopProfiler);
+#if STORE_AND_FORWARD
+        // Offline only temperature, humidity and light go to flash
+        storeAndForward.submit(channels, now, wifiManager.isConnected());
+#else
         if (wifiManager.isConnected()) {
-            float avgTemp  = tempFilter.getAverage();
-            float avgHumid = humidFilter.getAverage();
-            int   avgLight = static_cast<int>(lightFilter.getAverage());
-            cloudUploader.upload(avgTemp, avgHumid, avgLight);
+            cloudUploader.uploadChannels(channels);
+        }
+#endif
+        PROFILE_LAP(loopProfiler, PROFILE_UPLOAD);
+    }
+
+#if STORE_AND_FORWARD
+    // Drain readings stored while offline, paced behind live uploads
+    PROFILE_MARK(loopProfiler);
+    storeAndForward.loop(wifiManager.isConnected());
+    PROFILE_LAP(loopProfiler, PROFILE_REPLAY);
+#endif
+    PROFILE_LOOP_END(loopProfiler);
+
+#if LOOP_PROFILER
+    // Print and publish the stage histograms, then start a new period
+    if (loopProfiler.due(now)) {
+        const size_t length = loopProfiler.closePeriod(now);
+        if (length > 0 && wifiManager.isConnected()) {
+            cloudUploader.uploadProfile(loopProfiler.payload(), length);
         }
     }
+#endif
 
     // Small delay to prevent watchdog resets on some boards
     delay(10);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+/**
+ * @file TaskPipeline.cpp
+ * @brief Implementation of the FreeRTOS task pipeline.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "pipeline/TaskPipeline.h"
+#include "utils/BinaryLog.h"
+
+TaskPipeline::TaskPipeline(SensorRegistry<> &registry, OledDisplay &display,
+                           AlertManager &alertManager, WiFiManager &wifiManager,
+                           CloudUploader &cloudUploader,
+                           StoreAndForward *storeAndForward)
+    : _registry(registry), _display(display),
+      _alertManager(alertManager), _wifiManager(wifiManager), _cloudUploader(cloudUploader),
+      _storeAndForward(storeAndForward),
+      _displayDrops(0), _uplinkDrops(0),
+      _senseTiming("sense", SENSOR_READ_INTERVAL),
+      _displayTiming("display", DISPLAY_UPDATE_INTERVAL),
+      _uplinkTiming("uplink", UPLINK_TASK_PERIOD) {}
+
+bool TaskPipeline::begin() {
+    bool ok = true;
+    ok &= xTaskCreatePinnedToCore(senseTask, "sense", SENSE_TASK_STACK, this,
+                                  SENSE_TASK_PRIORITY, nullptr, SENSE_TASK_CORE) == pdPASS;
+    ok &= xTaskCreatePinnedToCore(displayTask, "display", DISPLAY_TASK_STACK, this,
+                                  DISPLAY_TASK_PRIORITY, nullptr, DISPLAY_TASK_CORE) == pdPASS;
+    ok &= xTaskCreatePinnedToCore(uplinkTask, "uplink", UPLINK_TASK_STACK, this,
+                                  UPLINK_TASK_PRIORITY, nullptr, UPLINK_TASK_CORE) == pdPASS;
+    if (!ok) {
+        LOG_ERROR("Failed to create pipeline tasks");
+    }
+    return ok;
+}
+
+void TaskPipeline::senseTask(void *arg) {
+    static_cast<TaskPipeline *>(arg)->runSense();
+}
+
+void TaskPipeline::displayTask(void *arg) {
+    static_cast<TaskPipeline *>(arg)->runDisplay();
+}
+
+void TaskPipeline::uplinkTask(void *arg) {
+    static_cast<TaskPipeline *>(arg)->runUplink();
+}
+
+ChannelFrame TaskPipeline::sample() {
+    // Samples every channel; out-of-range values are discarded
+    _registry.addSamples(_registry.readSensors());
+    const ChannelView channels = _registry.view();
+    ChannelFrame frame;
+    frame.timestamp = millis();
+    frame.count = channels.count < SENSOR_MAX_CHANNELS ? channels.count : SENSOR_MAX_CHANNELS;
+    frame.specs = channels.specs;
+    frame.mask = CHANNEL_MASK_ALL;
+    memcpy(frame.values, channels.values, frame.count * sizeof(float));
+    return frame;
+}
+
+void TaskPipeline::runSense() {
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        _senseTiming.onWake(micros());
+        const ChannelFrame frame = sample();
+        // Rules run on every sample, not at the display rate
+        _alertManager.update(_registry.view(), frame.timestamp);
+        if (!_displayQueue.push(frame)) {
+            ++_displayDrops;
+        }
+        if (!_uplinkQueue.push(frame)) {
+            ++_uplinkDrops;
+        }
+        _senseTiming.onDone(micros());
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_READ_INTERVAL));
+    }
+}
+
+void TaskPipeline::runDisplay() {
+    TickType_t lastWake = xTaskGetTickCount();
+    ChannelFrame latest;
+    bool haveReading = false;
+    size_t page = 0;
+    unsigned long lastReport = millis();
+    for (;;) {
+        _displayTiming.onWake(micros());
+        // Only the most recent reading matters for the screen
+        while (_displayQueue.pop(latest)) {
+            haveReading = true;
+        }
+        if (haveReading) {
+            // More channels than lines: show the next page each update
+            _display.showChannels(ChannelView{latest.count, latest.specs, latest.values}, page);
+            page = (page + 1) % OledDisplay::channelPages(latest.count);
+        }
+        _displayTiming.onDone(micros());
+#if PIPELINE_JITTER_REPORT
+        if (millis() - lastReport >= PIPELINE_JITTER_REPORT_INTERVAL) {
+            lastReport = millis();
+            reportJitter();
+        }
+#else
+        (void)lastReport;
+#endif
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(DISPLAY_UPDATE_INTERVAL));
+    }
+}
+
+void TaskPipeline::runUplink() {
+    // Connecting here rather than in setup() lets sensing start immediately
+    _wifiManager.connect();
+    _cloudUploader.begin();
+
+    TickType_t lastWake = xTaskGetTickCount();
+    ChannelFrame latest;
+    bool haveReading = false;
+    unsigned long lastUpload = millis();
+    for (;;) {
+        _uplinkTiming.onWake(micros());
+        _wifiManager.loop();
+        while (_uplinkQueue.pop(latest)) {
+            haveReading = true;
+        }
+        if (haveReading && millis() - lastUpload >= CLOUD_UPLOAD_INTERVAL) {
+            lastUpload = millis();
+            const ChannelView channels = {latest.count, latest.specs, latest.values};
+            if (_storeAndForward) {
+                // Offline only temperature, humidity and light go to flash
+                _storeAndForward->submit(channels, latest.timestamp, _wifiManager.isConnected());
+            } else if (_wifiManager.isConnected()) {
+                _cloudUploader.uploadChannels(channels);
+            }
+        }
+        if (_storeAndForward) {
+            _storeAndForward->loop(_wifiManager.isConnected());
+        }
+        _uplinkTiming.onDone(micros());
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(UPLINK_TASK_PERIOD));
+    }
+}
+
+void TaskPipeline::reportJitter() const {
+    _senseTiming.report();
+    _displayTiming.report();
+    _uplinkTiming.report();
+    LOG_INFO("[jitter] queue drops: display=%lu uplink=%lu",
+             static_cast<unsigned long>(_displayDrops), static_cast<unsigned long>(_uplinkDrops));
+}
@@ -0,0 +1,268 @@
+/**
+ * @file PowerManager.cpp
+ * @brief Implementation of the PowerManager class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "power/PowerManager.h"
+#include "utils/BinaryLog.h"
+
+#include <esp_attr.h>
+#include <esp_sleep.h>
+#include <type_traits>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <driver/gpio.h>
+#endif
+
+namespace {
+
+const uint32_t kRetainedMagic = 0x504D5232;  // "PMR2"
+
+/**
+ * Everything that must survive deep sleep. Plain data only: constructors
+ * of RTC_DATA_ATTR objects would run again on every wake-up.
+ */
+struct RetainedState {
+    uint32_t magic;
+    uint32_t cycle;
+    uint32_t clockMs;        ///< Node time at millis() == 0 of the current boot
+    uint32_t lastUploadMs;   ///< Node time of the last upload cycle
+    uint8_t backoff;         ///< Upload cycles to skip after the next failure
+    uint8_t skipUploads;     ///< Upload cycles left to skip (radio stays off)
+    uint8_t filters[3][sizeof(PowerManager::Filter)];
+    uint8_t alerts[sizeof(AlertManager::Engine)];
+    uint8_t pendingCount;
+    SensorReading pending[LOW_POWER_PENDING_MAX];
+    CycleReport last;
+    uint64_t totalEnergyUj;
+    uint64_t totalTimeMs;
+};
+
+static_assert(std::is_trivially_copyable<PowerManager::Filter>::value,
+              "Filters are retained by copying their bytes");
+static_assert(std::is_trivially_copyable<AlertManager::Engine>::value,
+              "Alert state is retained by copying its bytes");
+static_assert(sizeof(RetainedState) <= 2048, "Retained state must fit RTC slow memory");
+
+RTC_DATA_ATTR RetainedState s_retained;
+
+uint32_t energyUj(float currentMa, uint32_t ms) {
+    // mA * ms * V = uJ
+    return static_cast<uint32_t>(currentMa * ms * (POWER_SUPPLY_MV / 1000.0f));
+}
+
+} // namespace
+
+PowerManager::PowerManager(DHTSensor &dht, LightSensor &light, Filter &tempFilter,
+                           Filter &humidFilter, Filter &lightFilter, OledDisplay &display,
+                           AlertManager &alerts, WiFiManager &wifi, CloudUploader &uploader,
+                           PowerMode mode)
+    : _dht(dht), _light(light), _tempFilter(tempFilter), _humidFilter(humidFilter),
+      _lightFilter(lightFilter), _display(display), _alerts(alerts), _wifi(wifi),
+      _uploader(uploader), _mode(mode), _wakeAt(0), _radioMs(0), _connectMs(0), _firstUploadMs(0),
+      _uploaded(0) {}
+
+bool PowerManager::begin() {
+#ifdef ARDUINO_ARCH_ESP32
+    // The LED level was latched through deep sleep
+    gpio_hold_dis(static_cast<gpio_num_t>(LED_ALERT_PIN));
+#endif
+    if (_mode == POWER_DEEP_SLEEP && s_retained.magic == kRetainedMagic) {
+        restore();
+        return false;
+    }
+    memset(&s_retained, 0, sizeof(s_retained));
+    s_retained.magic = kRetainedMagic;
+    return true;
+}
+
+void PowerManager::forgetRetainedState() {
+    s_retained.magic = 0;
+}
+
+uint32_t PowerManager::nodeMillis() const {
+    return s_retained.clockMs + millis();
+}
+
+const CycleReport &PowerManager::lastReport() const {
+    return s_retained.last;
+}
+
+uint64_t PowerManager::totalEnergyUj() const {
+    return s_retained.totalEnergyUj;
+}
+
+uint64_t PowerManager::totalTimeMs() const {
+    return s_retained.totalTimeMs;
+}
+
+uint32_t PowerManager::runCycle() {
+    // After a deep sleep reset the cycle began at millis() == 0, boot included
+    _wakeAt = _mode == POWER_DEEP_SLEEP ? 0 : millis();
+    _radioMs = 0;
+    _connectMs = 0;
+    _firstUploadMs = 0;
+    _uploaded = 0;
+    ++s_retained.cycle;
+
+    const uint32_t now = nodeMillis();
+    sample();
+    const float temperature = _tempFilter.getAverage();
+    const float humidity = _humidFilter.getAverage();
+    const int light = static_cast<int>(_lightFilter.getAverage());
+    _display.showReadings(temperature, humidity, light);
+    _alerts.update(temperature, humidity, light, now);
+
+    if (now - s_retained.lastUploadMs >= CLOUD_UPLOAD_INTERVAL) {
+        s_retained.lastUploadMs = now;
+        if (s_retained.pendingCount == LOW_POWER_PENDING_MAX) {
+            // Offline for too long: keep the newest readings
+            memmove(s_retained.pending, s_retained.pending + 1,
+                    (LOW_POWER_PENDING_MAX - 1) * sizeof(SensorReading));
+            --s_retained.pendingCount;
+        }
+        SensorReading &reading = s_retained.pending[s_retained.pendingCount++];
+        reading.timestamp = now;
+        reading.temperature = temperature;
+        reading.humidity = humidity;
+        reading.light = light;
+        reading.flags = 0;
+        if (s_retained.skipUploads > 0) {
+            --s_retained.skipUploads;
+        } else {
+            _uploaded = upload();
+        }
+    }
+
+    const uint32_t awake = millis() - _wakeAt;
+    return awake < SENSOR_READ_INTERVAL ? SENSOR_READ_INTERVAL - awake : 0;
+}
+
+void PowerManager::sample() {
+    const DHTReading dht = _dht.read();
+    const float t = dht.temperature;
+    const float h = dht.humidity;
+    const int l = _light.readMillivolts();
+    if (DHTSensor::isValid(t, TEMP_MIN_VALID, TEMP_MAX_VALID)) {
+        _tempFilter.addValue(t);
+    }
+    if (DHTSensor::isValid(h, HUMID_MIN_VALID, HUMID_MAX_VALID)) {
+        _humidFilter.addValue(h);
+    }
+    if (l >= LIGHT_MIN_VALID && l <= LIGHT_MAX_VALID) {
+        _lightFilter.addValue(static_cast<float>(l));
+    }
+}
+
+uint8_t PowerManager::upload() {
+    // The radio is powered only for the duration of this call
+    const uint32_t radioStart = millis();
+    _wifi.connect();
+    while (!_wifi.isConnected() && millis() - radioStart < LOW_POWER_WIFI_TIMEOUT) {
+        delay(LOW_POWER_WIFI_POLL);
+        _wifi.loop();
+    }
+    size_t sent = 0;
+    if (_wifi.isConnected()) {
+        _connectMs = millis() - radioStart;
+        sent = _uploader.sendBatch(s_retained.pending, s_retained.pendingCount);
+        if (sent > 0) {
+            // Dominated by the WiFi connection; see WIFI_FAST_CONNECT
+            _firstUploadMs = millis() - _wakeAt;
+            LOG_INFO("Time to first upload %lu ms (WiFi %lu ms, %s)",
+                     static_cast<unsigned long>(_firstUploadMs),
+                     static_cast<unsigned long>(_connectMs),
+                     _wifi.getStats().lastFast ? "cached link" : "full scan");
+        }
+        _uploader.disconnect();
+        s_retained.backoff = 0;
+    } else {
+        // Do not burn a radio-on timeout every cycle while the network is down
+        s_retained.backoff = s_retained.backoff == 0 ? 1
+                             : s_retained.backoff * 2 > LOW_POWER_MAX_BACKOFF
+                                 ? LOW_POWER_MAX_BACKOFF
+                                 : s_retained.backoff * 2;
+        s_retained.skipUploads = s_retained.backoff;
+        LOG_WARN("No WiFi, %u readings kept, next attempt in %u upload cycles",
+                 s_retained.pendingCount, s_retained.backoff + 1);
+    }
+    _wifi.disconnect();
+    _radioMs = millis() - radioStart;
+
+    s_retained.pendingCount -= static_cast<uint8_t>(sent);
+    memmove(s_retained.pending, s_retained.pending + sent,
+            s_retained.pendingCount * sizeof(SensorReading));
+    return static_cast<uint8_t>(sent);
+}
+
+void PowerManager::sleep(uint32_t ms) {
+    const uint32_t awake = millis() - _wakeAt;
+    const float sleepMa = _mode == POWER_DEEP_SLEEP    ? POWER_DEEP_SLEEP_MA
+                          : _mode == POWER_LIGHT_SLEEP ? POWER_LIGHT_SLEEP_MA
+                                                       : POWER_ACTIVE_MA;
+    CycleReport &report = s_retained.last;
+    report.cycle = s_retained.cycle;
+    report.awakeMs = awake;
+    report.radioMs = _radioMs;
+    report.connectMs = _connectMs;
+    report.firstUploadMs = _firstUploadMs;
+    report.sleepMs = ms;
+    report.energyUj = energyUj(POWER_ACTIVE_MA, awake - _radioMs) +
+                      energyUj(POWER_RADIO_MA, _radioMs) + energyUj(sleepMa, ms);
+    report.alwaysOnUj = energyUj(POWER_ALWAYS_ON_MA, awake + ms);
+    report.uploaded = _uploaded;
+    report.pending = s_retained.pendingCount;
+    s_retained.totalEnergyUj += report.energyUj;
+    s_retained.totalTimeMs += awake + ms;
+    LOG_INFO("Cycle %lu: awake %lu ms (radio %lu ms), sleep %lu ms, %lu uJ "
+             "(always-on %lu uJ), %u sent, %u pending",
+             static_cast<unsigned long>(report.cycle), static_cast<unsigned long>(awake),
+             static_cast<unsigned long>(_radioMs), static_cast<unsigned long>(ms),
+             static_cast<unsigned long>(report.energyUj),
+             static_cast<unsigned long>(report.alwaysOnUj), report.uploaded, report.pending);
+
+    switch (_mode) {
+    case POWER_DEEP_SLEEP:
+        // millis() restarts from 0 after the wake-up reset
+        s_retained.clockMs += awake + ms;
+        save();
+        binaryLog.flush();
+        Serial.flush();
+#ifdef ARDUINO_ARCH_ESP32
+        gpio_hold_en(static_cast<gpio_num_t>(LED_ALERT_PIN));
+        gpio_deep_sleep_hold_en();
+#endif
+        esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(ms) * 1000ULL);
+        esp_deep_sleep_start();
+        break;
+    case POWER_LIGHT_SLEEP:
+        if (ms > 0) {
+            binaryLog.flush();
+            Serial.flush();
+            esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(ms) * 1000ULL);
+            esp_light_sleep_start();
+        }
+        break;
+    default:
+        delay(ms);
+        break;
+    }
+}
+
+void PowerManager::save() {
+    memcpy(s_retained.filters[0], &_tempFilter, sizeof(Filter));
+    memcpy(s_retained.filters[1], &_humidFilter, sizeof(Filter));
+    memcpy(s_retained.filters[2], &_lightFilter, sizeof(Filter));
+    memcpy(s_retained.alerts, &_alerts.engine(), sizeof(AlertManager::Engine));
+}
+
+void PowerManager::restore() {
+    memcpy(&_tempFilter, s_retained.filters[0], sizeof(Filter));
+    memcpy(&_humidFilter, s_retained.filters[1], sizeof(Filter));
+    memcpy(&_lightFilter, s_retained.filters[2], sizeof(Filter));
+    AlertManager::Engine engine = _alerts.engine();
+    memcpy(&engine, s_retained.alerts, sizeof(AlertManager::Engine));
+    _alerts.restore(engine);
+}
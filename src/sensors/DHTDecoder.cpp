@@ -0,0 +1,110 @@
+/**
+ * @file DHTDecoder.cpp
+ * @brief Implementation of the DHT frame decoder.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "sensors/DHTDecoder.h"
+
+namespace {
+
+// Accepted pulse lengths (us), datasheet values with margin for jitter
+// and for the RMT glitch filter
+const uint16_t kResponseMin = 40;
+const uint16_t kResponseMax = 120;
+const uint16_t kBitLowMin = 30;
+const uint16_t kBitLowMax = 90;
+const uint16_t kBitHighMin = 10;
+const uint16_t kBitHighMax = 95;
+const uint16_t kOneThreshold = 48;
+
+bool inRange(uint16_t value, uint16_t min, uint16_t max) { return value >= min && value <= max; }
+
+void fail(DHTReading &reading, DHTStatus status) {
+    reading.temperature = NAN;
+    reading.humidity = NAN;
+    reading.status = status;
+}
+
+} // namespace
+
+bool decodeDhtPulses(const uint16_t *durations, size_t count, uint8_t type, DHTReading &reading) {
+    if (count < DHT_FRAME_PULSES) {
+        fail(reading, DHT_ERROR_PULSES);
+        return false;
+    }
+    const uint16_t *frame = durations + (count - DHT_FRAME_PULSES);
+    if (!inRange(frame[0], kResponseMin, kResponseMax) ||
+        !inRange(frame[1], kResponseMin, kResponseMax)) {
+        fail(reading, DHT_ERROR_PULSES);
+        return false;
+    }
+    uint8_t data[5] = {0, 0, 0, 0, 0};
+    const uint16_t *bits = frame + 2;
+    for (unsigned i = 0; i < 40; ++i) {
+        const uint16_t low = bits[2 * i];
+        const uint16_t high = bits[2 * i + 1];
+        if (!inRange(low, kBitLowMin, kBitLowMax) || !inRange(high, kBitHighMin, kBitHighMax)) {
+            fail(reading, DHT_ERROR_PULSES);
+            return false;
+        }
+        data[i / 8] = static_cast<uint8_t>((data[i / 8] << 1) | (high > kOneThreshold ? 1 : 0));
+    }
+    return decodeDhtBytes(data, type, reading);
+}
+
+bool decodeDhtBytes(const uint8_t data[5], uint8_t type, DHTReading &reading) {
+    if (static_cast<uint8_t>(data[0] + data[1] + data[2] + data[3]) != data[4]) {
+        fail(reading, DHT_ERROR_CHECKSUM);
+        return false;
+    }
+    float t;
+    float h;
+    switch (type) {
+    case DHT11:
+        // Same encoding as the Adafruit driver: a negative value is
+        // -1 - integer part, plus the (positive) tenths
+        h = data[0] + data[1] * 0.1f;
+        t = data[2];
+        if (data[3] & 0x80) {
+            t = -1.0f - t;
+        }
+        t += (data[3] & 0x0F) * 0.1f;
+        break;
+    case DHT12:
+        h = data[0] + data[1] * 0.1f;
+        t = (data[2] & 0x7F) + (data[3] & 0x0F) * 0.1f;
+        if (data[2] & 0x80) {
+            t = -t;
+        }
+        break;
+    default:  // DHT21 / DHT22: 16-bit tenths, sign-magnitude temperature
+        h = ((data[0] << 8) | data[1]) * 0.1f;
+        t = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+        if (data[2] & 0x80) {
+            t = -t;
+        }
+        break;
+    }
+    reading.temperature = t;
+    reading.humidity = h;
+    reading.status = DHT_OK;
+    return true;
+}
+
+const char *dhtStatusName(DHTStatus status) {
+    switch (status) {
+    case DHT_OK:
+        return "ok";
+    case DHT_PENDING:
+        return "pending";
+    case DHT_ERROR_TIMEOUT:
+        return "timeout";
+    case DHT_ERROR_PULSES:
+        return "bad pulses";
+    case DHT_ERROR_CHECKSUM:
+        return "checksum";
+    }
+    return "?";
+}
@@ -6,26 +6,208 @@
 #include "config.h"
 #include "secret.h"
 #include "sensors/DHTSensor.h"
+#include "utils/BinaryLog.h"
 
-DHTSensor::DHTSensor(uint8_t pin, uint8_t type) : dht(pin, type) {
-    // Constructor body is empty; member initialiser list sets up the DHT object
+namespace {
+
+const ChannelSpec kDefaultChannels[2] = {
+    {"Temp", "t", "C", 1, TEMP_MIN_VALID, TEMP_MAX_VALID},
+    {"Hum", "h", "%", 1, HUMID_MIN_VALID, HUMID_MAX_VALID},
+};
+
+#if DHT_USE_RMT
+
+const rmt_channel_t kChannel = static_cast<rmt_channel_t>(DHT_RMT_CHANNEL);
+const uint8_t kClockDivider = 80;      ///< 80 MHz APB clock -> 1 us ticks
+const uint16_t kIdleThreshold = 100;   ///< Longest level in a frame is 80 us
+const uint8_t kGlitchFilter = 100;     ///< APB ticks (1.25 us)
+const size_t kRingSize = 512;
+const size_t kMaxPulses = 100;         ///< Frame is 83 plus the initial high
+#endif
+
+} // namespace
+
+DHTSensor::DHTSensor(uint8_t pin, uint8_t type, const ChannelSpec *channels)
+    :
+#if DHT_USE_RMT
+      _ring(nullptr), _phase(IDLE), _phaseStart(0),
+#else
+      dht(pin, type),
+#endif
+      _pin(pin), _type(type), _channels(channels ? channels : kDefaultChannels),
+      _hasRead(false), _lastReadMs(0),
+      _last{NAN, NAN, DHT_ERROR_TIMEOUT} {
 }
 
 void DHTSensor::begin() {
+#if DHT_USE_RMT
+    // Open drain with the pull-up: the line idles high and the RMT input
+    // sees the sensor's answer once the start pulse is released
+    const gpio_num_t gpio = static_cast<gpio_num_t>(_pin);
+    gpio_set_direction(gpio, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(gpio, GPIO_PULLUP_ONLY);
+    gpio_set_level(gpio, 1);
+
+    rmt_config_t config = {};
+    config.rmt_mode = RMT_MODE_RX;
+    config.channel = kChannel;
+    config.gpio_num = gpio;
+    config.clk_div = kClockDivider;
+    config.mem_block_num = 1;
+    config.rx_config.idle_threshold = kIdleThreshold;
+    config.rx_config.filter_ticks_thresh = kGlitchFilter;
+    config.rx_config.filter_en = true;
+    // Already installed after a deep sleep wake is not an error
+    esp_err_t err = rmt_config(&config);
+    if (err == ESP_OK) {
+        err = rmt_driver_install(kChannel, kRingSize, 0);
+    }
+    if ((err != ESP_OK && err != ESP_ERR_INVALID_STATE) ||
+        rmt_get_ringbuf_handle(kChannel, &_ring) != ESP_OK) {
+        LOG_ERROR("DHT RMT init failed");
+        _ring = nullptr;
+    }
+#else
     dht.begin();
+#endif
 }
 
-float DHTSensor::readTemperature() {
-    float t = dht.readTemperature();
-    // Adafruit DHT returns NAN on error
-    return t;
+DHTReading DHTSensor::read() {
+    if (!startRead()) {
+        return _last;
+    }
+#if DHT_USE_RMT
+    if (_phase == START_PULSE) {
+        // Rounded up to whole ticks: a longer start pulse is harmless and
+        // delay() yields where delayMicroseconds() would spin
+        delay((startPulseMicros() + 999) / 1000);
+        release();
+        receive(pdMS_TO_TICKS(DHT_RESPONSE_TIMEOUT));
+    }
+#endif
+    return _last;
 }
 
-float DHTSensor::readHumidity() {
-    float h = dht.readHumidity();
-    return h;
+bool DHTSensor::startRead() {
+    if (_hasRead && millis() - _lastReadMs < samplingPeriod()) {
+        return false;
+    }
+#if DHT_USE_RMT
+    if (_phase != IDLE) {
+        return false;
+    }
+    if (!_ring) {
+        finish(DHTReading{NAN, NAN, DHT_ERROR_TIMEOUT});
+        return true;
+    }
+    gpio_set_level(static_cast<gpio_num_t>(_pin), 0);
+    _phase = START_PULSE;
+    _phaseStart = micros();
+#else
+    const bool ok = dht.read();
+    // Both values come from the transfer dht.read() just made
+    finish(ok ? DHTReading{dht.readTemperature(), dht.readHumidity(), DHT_OK}
+              : DHTReading{NAN, NAN, DHT_ERROR_TIMEOUT});
+#endif
+    return true;
+}
+
+DHTStatus DHTSensor::poll() {
+#if DHT_USE_RMT
+    switch (_phase) {
+    case START_PULSE:
+        if (micros() - _phaseStart < startPulseMicros()) {
+            return DHT_PENDING;
+        }
+        release();
+        return receive(0);
+    case RECEIVING:
+        return receive(0);
+    case IDLE:
+        break;
+    }
+#endif
+    return _last.status;
 }
 
 bool DHTSensor::isValid(float value, float minValid, float maxValid) {
     return (!isnan(value) && value >= minValid && value <= maxValid);
-}
\ No newline at end of file
+}
+
+const ChannelSpec &DHTSensor::channel(size_t index) const {
+    return _channels[index < 2 ? index : 1];
+}
+
+void DHTSensor::sample(float *values) {
+    const DHTReading reading = read();
+    values[0] = reading.temperature;
+    values[1] = reading.humidity;
+}
+
+unsigned long DHTSensor::samplingPeriod() const {
+    return (_type == DHT11 || _type == DHT12) ? 1000 : 2000;
+}
+
+void DHTSensor::finish(const DHTReading &reading) {
+    _last = reading;
+    _hasRead = true;
+    _lastReadMs = millis();
+    if (reading.status != DHT_OK) {
+        LOG_WARN("DHT read failed: %s", dhtStatusName(reading.status));
+    }
+}
+
+#if DHT_USE_RMT
+uint32_t DHTSensor::startPulseMicros() const {
+    // Datasheets: at least 18 ms for the DHT11 family, 1 ms otherwise
+    return (_type == DHT11 || _type == DHT12) ? 20000 : 1100;
+}
+
+void DHTSensor::release() {
+    gpio_set_level(static_cast<gpio_num_t>(_pin), 1);
+    rmt_rx_start(kChannel, true);
+    _phase = RECEIVING;
+    _phaseStart = micros();
+}
+
+DHTStatus DHTSensor::receive(TickType_t ticks) {
+    size_t size = 0;
+    rmt_item32_t *items =
+        static_cast<rmt_item32_t *>(xRingbufferReceive(_ring, &size, ticks));
+    if (!items) {
+        if (ticks == 0 && micros() - _phaseStart < DHT_RESPONSE_TIMEOUT * 1000UL) {
+            return DHT_PENDING;
+        }
+        rmt_rx_stop(kChannel);
+        _phase = IDLE;
+        finish(DHTReading{NAN, NAN, DHT_ERROR_TIMEOUT});
+        return _last.status;
+    }
+
+    // Flatten the items into low/high durations, dropping the pull-up
+    // high before the response; a zero duration ends the frame
+    uint16_t durations[kMaxPulses];
+    size_t count = 0;
+    const size_t halves = size / sizeof(rmt_item32_t) * 2;
+    for (size_t i = 0; i < halves && count < kMaxPulses; ++i) {
+        const rmt_item32_t &item = items[i / 2];
+        const uint32_t duration = i % 2 == 0 ? item.duration0 : item.duration1;
+        const uint32_t level = i % 2 == 0 ? item.level0 : item.level1;
+        if (duration == 0) {
+            break;
+        }
+        if (count == 0 && level == 1) {
+            continue;
+        }
+        durations[count++] = static_cast<uint16_t>(duration);
+    }
+    vRingbufferReturnItem(_ring, items);
+    rmt_rx_stop(kChannel);
+    _phase = IDLE;
+
+    DHTReading reading;
+    decodeDhtPulses(durations, count, _type, reading);
+    finish(reading);
+    return _last.status;
+}
+#endif
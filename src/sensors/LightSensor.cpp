@@ -6,17 +6,86 @@
 #include "config.h"
 #include "secret.h"
 #include "sensors/LightSensor.h"
+#include "utils/BinaryLog.h"
 
-LightSensor::LightSensor(uint8_t pin) : _pin(pin) {}
+#if LIGHT_ADC_CONTINUOUS
+#include <driver/adc.h>
+
+static_assert(LIGHT_ADC_DECIMATION % 4 == 0, "The decimation kernel sums 4 conversions per step");
+static_assert(LIGHT_ADC_WINDOW % LIGHT_ADC_DECIMATION == 0, "Window must be whole blocks");
+static_assert(LIGHT_ADC_SAMPLE_RATE >= SOC_ADC_SAMPLE_FREQ_THRES_LOW &&
+              LIGHT_ADC_SAMPLE_RATE <= SOC_ADC_SAMPLE_FREQ_THRES_HIGH,
+              "Sample rate outside the DMA ADC range");
+#endif
+
+namespace {
+
+const ChannelSpec kDefaultChannel = {"Light", "l", "mV", 0, LIGHT_MIN_VALID, LIGHT_MAX_VALID};
+
+} // namespace
+
+LightSensor::LightSensor(uint8_t pin, const ChannelSpec *spec)
+    : _pin(pin), _spec(spec ? spec : &kDefaultChannel), _window{0, 0.0f, 0, 0.0f, 0.0f}, _continuous(false),
+      _flickering(false), _calibration() {}
 
 void LightSensor::begin() {
     // Configure ADC resolution for the ESP32. 12‑bit yields values in 0..4095.
     analogReadResolution(LDR_RESOLUTION);
     pinMode(_pin, INPUT);
+    // analogRead() uses 11 dB attenuation; the DMA pattern below does too
+    const esp_adc_cal_value_t source = esp_adc_cal_characterize(
+        ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, LDR_DEFAULT_VREF, &_calibration);
+    LOG_INFO("LDR calibration: %s, Vref %lu mV",
+             source == ESP_ADC_CAL_VAL_EFUSE_TP     ? "eFuse two-point"
+             : source == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref"
+                                                    : "default Vref",
+             static_cast<unsigned long>(_calibration.vref));
+
+#if LIGHT_ADC_CONTINUOUS
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = sizeof(_frames);
+    init.conv_num_each_intr = 256;
+    init.adc1_chan_mask = 1u << LDR_ADC_CHANNEL;
+    init.adc2_chan_mask = 0;
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;
+    pattern.channel = LDR_ADC_CHANNEL;
+    pattern.unit = 0;  // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = true;
+    config.conv_limit_num = 250;
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = LIGHT_ADC_SAMPLE_RATE;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+    _continuous = adc_digi_initialize(&init) == ESP_OK &&
+                  adc_digi_controller_configure(&config) == ESP_OK;
+    if (!_continuous) {
+        LOG_WARN("Continuous ADC unavailable, using analogRead()");
+        adc_digi_deinitialize();
+    }
+#endif
 }
 
 int LightSensor::readRaw() {
-    int value = analogRead(_pin);
+#if LIGHT_ADC_CONTINUOUS
+    if (!_continuous || !readWindow()) {
+        readSingle();
+    }
+#else
+    readSingle();
+#endif
+    return static_cast<int>(_window.raw + 0.5f);
+}
+
+int LightSensor::readMillivolts() {
+    readRaw();
+    int value = static_cast<int>(_window.millivolts);
     // Constrain the reading to valid bounds
     if (value < LIGHT_MIN_VALID) value = LIGHT_MIN_VALID;
     if (value > LIGHT_MAX_VALID) value = LIGHT_MAX_VALID;
@@ -24,7 +93,80 @@ int LightSensor::readRaw() {
 }
 
 int LightSensor::readNormalized() {
-    // At present, normalisation simply returns the raw reading. In a future
-    // revision this function could map the reading to a percentage or lux.
-    return readRaw();
-}
\ No newline at end of file
+    const uint32_t percent = static_cast<uint32_t>(readMillivolts()) * 100UL / LDR_FULL_SCALE_MV;
+    return percent > 100 ? 100 : static_cast<int>(percent);
+}
+
+const LightWindow &LightSensor::getWindow() const {
+    return _window;
+}
+
+bool LightSensor::isContinuous() const {
+    return _continuous;
+}
+
+void LightSensor::readSingle() {
+    _window.conversions = 1;
+    _window.raw = static_cast<float>(analogRead(_pin));
+    _window.millivolts = toMillivolts(_window.raw);
+    _window.flickerPercent = 0.0f;
+    _window.flickerHz = 0.0f;
+}
+
+#if LIGHT_ADC_CONTINUOUS
+bool LightSensor::readWindow() {
+    const uint32_t windowMs = LIGHT_ADC_WINDOW * 1000UL / LIGHT_ADC_SAMPLE_RATE;
+    uint32_t received = 0;
+    // DMA samples while this task blocks; the CPU only runs the decimation
+    adc_digi_start();
+    const unsigned long start = millis();
+    while (received < sizeof(_frames) && millis() - start <= 2 * windowMs + 10) {
+        uint32_t length = 0;
+        adc_digi_read_bytes(reinterpret_cast<uint8_t *>(_frames) + received,
+                            sizeof(_frames) - received, &length, 2 * windowMs + 10);
+        received += length;
+    }
+    adc_digi_stop();
+
+    const size_t count = received / sizeof(_frames[0]);
+    const OversampledWindow w = oversampleWindow(_frames, count, LIGHT_ADC_DECIMATION, _blocks,
+                                                 LIGHT_ADC_SAMPLE_RATE,
+                                                 LIGHT_FLICKER_MIN_PERCENT);
+    if (w.conversions == 0) {
+        return false;
+    }
+    _window.conversions = w.conversions;
+    _window.raw = w.mean;
+    _window.millivolts = toMillivolts(w.mean);
+    _window.flickerPercent = w.flickerPercent;
+    _window.flickerHz = w.flickerHz;
+    // Report changes only: under a flickering lamp every window sees it
+    const bool flickering = _window.flickerHz > 0.0f;
+    if (flickering && !_flickering) {
+        LOG_INFO("Light flicker %.1f%% at %.0f Hz", _window.flickerPercent, _window.flickerHz);
+    } else if (!flickering && _flickering) {
+        LOG_INFO("Light flicker stopped");
+    }
+    _flickering = flickering;
+    return true;
+}
+#endif
+
+uint32_t LightSensor::toMillivolts(float raw) const {
+    // Interpolate between neighbouring codes to keep the oversampled
+    // resolution through the calibration curve
+    const uint32_t code = static_cast<uint32_t>(raw);
+    const float fraction = raw - static_cast<float>(code);
+    const uint32_t low = esp_adc_cal_raw_to_voltage(code, &_calibration);
+    const uint32_t high = esp_adc_cal_raw_to_voltage(code + 1, &_calibration);
+    return low + static_cast<uint32_t>(fraction * static_cast<float>(high - low) + 0.5f);
+}
+
+const ChannelSpec &LightSensor::channel(size_t index) const {
+    (void)index;
+    return *_spec;
+}
+
+void LightSensor::sample(float *values) {
+    values[0] = static_cast<float>(readMillivolts());
+}
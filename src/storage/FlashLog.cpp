@@ -0,0 +1,372 @@
+/**
+ * @file FlashLog.cpp
+ * @brief Implementation of the FlashLog class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "storage/FlashLog.h"
+#include "utils/BinaryLog.h"
+#include "utils/WallClock.h"
+
+namespace {
+
+const uint32_t kSectorMagic = 0x4C474F4C;  // "LOGL"
+const uint32_t kLogVersion = 2;  // 2: records carry boot and epoch
+const uint32_t kConsumed = 0;
+
+uint32_t crc32(const void *data, size_t length) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    uint32_t crc = 0xFFFFFFFFu;
+    while (length--) {
+        crc ^= *bytes++;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+bool isErased(const void *data, size_t length) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < length; ++i) {
+        if (bytes[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+/** First bytes of every sector in use. */
+struct FlashLog::SectorHeader {
+    uint32_t magic;
+    uint32_t sequence;   ///< Increments by one per sector opened
+    uint32_t version;
+    uint32_t crc;        ///< CRC32 of the fields above
+};
+
+/** One stored reading. The consumed word is outside the CRC so it can be
+ *  programmed later without erasing. */
+struct FlashLog::Record {
+    uint32_t sequence;
+    uint32_t boot;       ///< Boot the record was written in (see FlashLog::_boot)
+    uint32_t timestamp;  ///< millis() of that boot
+    uint32_t epoch;      ///< Seconds since the Unix epoch, 0 if the clock was not set
+    float temperature;
+    float humidity;
+    int32_t light;
+    uint32_t crc;        ///< CRC32 of the fields above
+    uint32_t consumed;   ///< 0xFFFFFFFF until the batch ending here is committed
+};
+
+FlashLog::FlashLog(FlashStorage &storage)
+    : _storage(storage), _sectors(0), _slotsPerSector(0), _write{0, 0}, _read{0, 0},
+      _batchEnd{0, 0}, _batchLast{0, 0}, _batchCount(0), _sectorSequence(0),
+      _recordSequence(0), _boot(0), _batchStale(0), _pending(0), _mounted(false), _stats() {
+    static_assert(sizeof(SectorHeader) == 16, "SectorHeader layout changed");
+    static_assert(sizeof(Record) == 36, "Record layout changed");
+}
+
+size_t FlashLog::capacity() const {
+    // The sector being recycled is lost as a whole, so one sector of
+    // records is not guaranteed
+    return _sectors > 1 ? (_sectors - 1) * _slotsPerSector : 0;
+}
+
+size_t FlashLog::slotOffset(const Position &pos) const {
+    return pos.sector * _storage.sectorSize() + sizeof(SectorHeader) + pos.slot * sizeof(Record);
+}
+
+void FlashLog::advance(Position &pos) const {
+    // Never step past the write position; beyond it lie erased or stale slots
+    if (pos.sector == _write.sector && pos.slot + 1 >= _write.slot) {
+        pos = _write;
+        return;
+    }
+    if (++pos.slot >= _slotsPerSector) {
+        pos.sector = (pos.sector + 1) % _sectors;
+        pos.slot = 0;
+    }
+}
+
+FlashLog::SlotState FlashLog::readSlot(const Position &pos, Record &record) {
+    if (!_storage.read(slotOffset(pos), &record, sizeof(record))) {
+        return SLOT_CORRUPT;
+    }
+    if (isErased(&record, sizeof(record))) {
+        return SLOT_ERASED;
+    }
+    if (crc32(&record, offsetof(Record, crc)) != record.crc) {
+        return SLOT_CORRUPT;
+    }
+    return SLOT_VALID;
+}
+
+bool FlashLog::readHeader(uint32_t sector, uint32_t &sequence) {
+    SectorHeader header;
+    if (!_storage.read(sector * _storage.sectorSize(), &header, sizeof(header))) {
+        return false;
+    }
+    if (header.magic != kSectorMagic || header.version != kLogVersion ||
+        crc32(&header, offsetof(SectorHeader, crc)) != header.crc) {
+        return false;
+    }
+    sequence = header.sequence;
+    return true;
+}
+
+bool FlashLog::startSector(uint32_t sector, uint32_t sequence) {
+    if (!_storage.eraseSector(sector)) {
+        return false;
+    }
+    ++_stats.erases;
+    SectorHeader header;
+    header.magic = kSectorMagic;
+    header.sequence = sequence;
+    header.version = kLogVersion;
+    header.crc = crc32(&header, offsetof(SectorHeader, crc));
+    if (!_storage.write(sector * _storage.sectorSize(), &header, sizeof(header))) {
+        return false;
+    }
+    _sectorSequence = sequence;
+    return true;
+}
+
+bool FlashLog::format() {
+    _sectors = static_cast<uint32_t>(_storage.sectorCount());
+    if (_sectors < 2 || _storage.sectorSize() < sizeof(SectorHeader) + sizeof(Record)) {
+        return false;
+    }
+    _slotsPerSector =
+        static_cast<uint32_t>((_storage.sectorSize() - sizeof(SectorHeader)) / sizeof(Record));
+    // Stale headers from an older log would confuse the next mount
+    for (uint32_t s = 1; s < _sectors; ++s) {
+        if (!_storage.eraseSector(s)) {
+            return false;
+        }
+        ++_stats.erases;
+    }
+    if (!startSector(0, 1)) {
+        return false;
+    }
+    _write = Position{0, 0};
+    _read = _batchEnd = _batchLast = _write;
+    _batchCount = _batchStale = 0;
+    _recordSequence = 0;
+    _boot = 0;
+    _pending = 0;
+    _mounted = true;
+    return true;
+}
+
+bool FlashLog::begin() {
+    _mounted = false;
+    _sectors = static_cast<uint32_t>(_storage.sectorCount());
+    if (_sectors < 2 || _storage.sectorSize() < sizeof(SectorHeader) + sizeof(Record)) {
+        return false;
+    }
+    _slotsPerSector =
+        static_cast<uint32_t>((_storage.sectorSize() - sizeof(SectorHeader)) / sizeof(Record));
+
+    // The head is the sector with the newest header
+    bool found = false;
+    uint32_t head = 0;
+    uint32_t headSequence = 0;
+    for (uint32_t s = 0; s < _sectors; ++s) {
+        uint32_t sequence;
+        if (readHeader(s, sequence) &&
+            (!found || static_cast<int32_t>(sequence - headSequence) > 0)) {
+            found = true;
+            head = s;
+            headSequence = sequence;
+        }
+    }
+    if (!found) {
+        LOG_WARN("Flash log not found, formatting");
+        return format();
+    }
+
+    // Walk backwards while sequence numbers stay contiguous to find the tail
+    uint32_t tail = head;
+    uint32_t expected = headSequence;
+    for (uint32_t i = 1; i < _sectors; ++i) {
+        const uint32_t previous = (tail + _sectors - 1) % _sectors;
+        uint32_t sequence;
+        if (!readHeader(previous, sequence) || sequence != expected - 1) {
+            break;
+        }
+        tail = previous;
+        expected = sequence;
+    }
+    _sectorSequence = headSequence;
+
+    // Scan the chain once: find the write position, the last committed
+    // record and how many valid records precede it
+    _write = Position{head, _slotsPerSector};
+    Position lastMarked = {tail, 0};
+    bool haveMarked = false;
+    size_t total = 0;
+    size_t consumed = 0;
+    _boot = 0;
+    Record record;
+    for (uint32_t s = tail;; s = (s + 1) % _sectors) {
+        for (uint32_t slot = 0; slot < _slotsPerSector; ++slot) {
+            const Position pos = {s, slot};
+            const SlotState state = readSlot(pos, record);
+            if (state == SLOT_ERASED) {
+                if (s == head) {
+                    _write = pos;
+                }
+                break;
+            }
+            if (state == SLOT_CORRUPT) {
+                // Typically the record being written when power failed
+                ++_stats.corrupt;
+                continue;
+            }
+            ++total;
+            _recordSequence = record.sequence + 1;
+            // New records get a boot number no stored record has
+            _boot = record.boot + 1;
+            if (record.consumed == kConsumed) {
+                lastMarked = pos;
+                haveMarked = true;
+                consumed = total;
+            }
+        }
+        if (s == head) {
+            break;
+        }
+    }
+
+    _read = Position{tail, 0};
+    if (haveMarked) {
+        _read = lastMarked;
+        advance(_read);
+    }
+    _batchEnd = _batchLast = _read;
+    _batchCount = _batchStale = 0;
+    _pending = total - consumed;
+    _mounted = true;
+    LOG_INFO("Flash log mounted: %u pending, %u corrupt", static_cast<unsigned>(_pending),
+             static_cast<unsigned>(_stats.corrupt));
+    return true;
+}
+
+bool FlashLog::openNextSector() {
+    const uint32_t next = (_write.sector + 1) % _sectors;
+    Record record;
+    if (_pending > 0 && _read.sector == next) {
+        // The oldest unsent records are about to be erased
+        size_t lost = 0;
+        for (uint32_t slot = _read.slot; slot < _slotsPerSector; ++slot) {
+            if (readSlot(Position{next, slot}, record) == SLOT_VALID) {
+                ++lost;
+            }
+        }
+        _pending -= lost < _pending ? lost : _pending;
+        _stats.overwritten += lost;
+        _read = Position{(next + 1) % _sectors, 0};
+        _batchEnd = _read;
+        _batchCount = _batchStale = 0;
+    }
+    if (!startSector(next, _sectorSequence + 1)) {
+        return false;
+    }
+    _write = Position{next, 0};
+    if (_pending == 0) {
+        _read = _batchEnd = _write;
+        _batchCount = _batchStale = 0;
+    }
+    return true;
+}
+
+bool FlashLog::append(const SensorReading &reading) {
+    if (!_mounted) {
+        return false;
+    }
+    if (_write.slot >= _slotsPerSector && !openNextSector()) {
+        return false;
+    }
+    Record record;
+    record.sequence = _recordSequence;
+    record.boot = _boot;
+    record.timestamp = reading.timestamp;
+    record.epoch = wallClockAt(reading.timestamp);
+    record.temperature = reading.temperature;
+    record.humidity = reading.humidity;
+    record.light = reading.light;
+    record.crc = crc32(&record, offsetof(Record, crc));
+    record.consumed = 0xFFFFFFFFu;
+    if (!_storage.write(slotOffset(_write), &record, sizeof(record))) {
+        return false;
+    }
+    ++_recordSequence;
+    ++_write.slot;
+    ++_pending;
+    ++_stats.appended;
+    return true;
+}
+
+size_t FlashLog::peek(SensorReading *out, size_t max) {
+    size_t count = 0;
+    size_t stale = 0;
+    Position pos = _read;
+    Record record;
+    while (count < max && _mounted && pos != _write) {
+        const SlotState state = readSlot(pos, record);
+        uint32_t timestamp = record.timestamp;
+        if (state == SLOT_VALID && record.boot != _boot) {
+            // millis() of an earlier boot: place the reading by calendar time
+            const uint32_t now = wallClock();
+            if (record.epoch != 0 && now == 0) {
+                break;   // Until SNTP has set the clock
+            }
+            if (record.epoch == 0) {
+                // Taken before the clock was ever set; there is no telling when
+                ++stale;
+                _batchLast = pos;
+                advance(pos);
+                continue;
+            }
+            timestamp = millis() - (now - record.epoch) * 1000;
+        }
+        if (state == SLOT_VALID) {
+            out[count].timestamp = timestamp;
+            out[count].temperature = record.temperature;
+            out[count].humidity = record.humidity;
+            out[count].light = record.light;
+            out[count].flags = READING_REPLAYED;
+            ++count;
+            _batchLast = pos;
+        }
+        if (state == SLOT_ERASED && pos.sector != _write.sector) {
+            // Sector closed early; continue with the next one
+            pos.slot = _slotsPerSector - 1;
+        }
+        advance(pos);
+    }
+    _batchEnd = pos;
+    _batchCount = count;
+    _batchStale = stale;
+    return count;
+}
+
+bool FlashLog::commit() {
+    const size_t batch = _batchCount + _batchStale;
+    if (batch > 0) {
+        const uint32_t consumed = kConsumed;
+        if (!_storage.write(slotOffset(_batchLast) + offsetof(Record, consumed), &consumed,
+                            sizeof(consumed))) {
+            return false;
+        }
+        _pending -= batch < _pending ? batch : _pending;
+        _stats.replayed += _batchCount;
+        _stats.stale += _batchStale;
+    }
+    _read = _batchEnd;
+    _batchCount = _batchStale = 0;
+    return true;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file History.cpp
+ * @brief Implementation of the History class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "storage/History.h"
+
+History::History()
+    : _open(0), _sealedCount(0), _hasSealed(false), _channels(0), _stats() {}
+
+bool History::begin(size_t channels) {
+    _open = 0;
+    _sealedCount = 0;
+    _hasSealed = false;
+    _stats = HistoryStats();
+    _channels = 0;
+    if (!_encoder.begin(_blocks[_open], HISTORY_BLOCK_BYTES, channels, HISTORY_TIME_UNIT)) {
+        return false;
+    }
+    _channels = channels;
+    return true;
+}
+
+bool History::append(uint32_t timestamp, const float *values) {
+    if (_channels == 0) {
+        return false;
+    }
+    bool sealed = false;
+    if (!_encoder.append(timestamp, values)) {
+        seal();
+        sealed = true;
+        _encoder.append(timestamp, values);
+    }
+    ++_stats.rows;
+    return sealed;
+}
+
+void History::seal() {
+    _lengths[_open] = static_cast<uint16_t>(_encoder.length());
+    _rows[_open] = static_cast<uint16_t>(_encoder.rows());
+    _hasSealed = true;
+    ++_stats.sealed;
+    _open = (_open + 1) % HISTORY_BLOCKS;
+    if (_sealedCount == HISTORY_BLOCKS - 1) {
+        // The slot after the open block holds the oldest sealed block
+        ++_stats.overwritten;
+        _stats.droppedRows += _rows[_open];
+    } else {
+        ++_sealedCount;
+    }
+    _encoder.begin(_blocks[_open], HISTORY_BLOCK_BYTES, _channels, HISTORY_TIME_UNIT);
+}
+
+size_t History::blockCount() const {
+    return _sealedCount + (_encoder.rows() > 0 ? 1 : 0);
+}
+
+const uint8_t *History::block(size_t index, size_t &length) const {
+    if (index >= blockCount()) {
+        length = 0;
+        return nullptr;
+    }
+    if (index == _sealedCount) {
+        length = _encoder.length();
+        return _blocks[_open];
+    }
+    const size_t slot = (_open + HISTORY_BLOCKS - _sealedCount + index) % HISTORY_BLOCKS;
+    length = _lengths[slot];
+    return _blocks[slot];
+}
+
+const uint8_t *History::lastSealed(size_t &length) const {
+    if (!_hasSealed) {
+        length = 0;
+        return nullptr;
+    }
+    const size_t slot = (_open + HISTORY_BLOCKS - 1) % HISTORY_BLOCKS;
+    length = _lengths[slot];
+    return _blocks[slot];
+}
+
+size_t History::rows() const {
+    size_t total = _encoder.rows();
+    for (size_t i = 0; i < _sealedCount; ++i) {
+        total += _rows[(_open + HISTORY_BLOCKS - 1 - i) % HISTORY_BLOCKS];
+    }
+    return total;
+}
+
+size_t History::encodedBytes() const {
+    size_t total = _encoder.rows() > 0 ? _encoder.length() : 0;
+    for (size_t i = 0; i < _sealedCount; ++i) {
+        total += _lengths[(_open + HISTORY_BLOCKS - 1 - i) % HISTORY_BLOCKS];
+    }
+    return total;
+}
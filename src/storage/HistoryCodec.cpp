@@ -0,0 +1,327 @@
+/**
+ * @file HistoryCodec.cpp
+ * @brief Implementation of the HistoryEncoder and HistoryDecoder classes.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "storage/HistoryCodec.h"
+
+namespace {
+
+const uint8_t kNoWindow = 0xFF;   ///< No previous XOR window in this block
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void put16(uint8_t *p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void put32(uint8_t *p, uint32_t v) {
+    put16(p, static_cast<uint16_t>(v));
+    put16(p + 2, static_cast<uint16_t>(v >> 16));
+}
+
+uint16_t get16(const uint8_t *p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t get32(const uint8_t *p) {
+    return get16(p) | (static_cast<uint32_t>(get16(p + 2)) << 16);
+}
+
+} // namespace
+
+HistoryEncoder::HistoryEncoder()
+    : _buffer(nullptr), _capacityBits(0), _bits(0), _channels(0), _timeUnit(1), _rows(0),
+      _firstTimestamp(0), _lastTime(0), _lastDelta(0) {}
+
+bool HistoryEncoder::begin(uint8_t *buffer, size_t capacity, size_t channels,
+                           uint8_t timeUnit) {
+    if (!buffer || capacity <= HISTORY_HEADER_BYTES || capacity > 0xFFFF || channels == 0 ||
+        channels > SENSOR_MAX_CHANNELS || timeUnit == 0) {
+        _buffer = nullptr;
+        return false;
+    }
+    _buffer = buffer;
+    _capacityBits = capacity * 8;
+    _bits = HISTORY_HEADER_BYTES * 8;
+    _channels = channels;
+    _timeUnit = timeUnit;
+    _rows = 0;
+    _firstTimestamp = 0;
+    _lastTime = 0;
+    _lastDelta = 0;
+    for (size_t c = 0; c < _channels; ++c) {
+        _last[c] = 0;
+        _leading[c] = kNoWindow;
+        _trailing[c] = 0;
+    }
+    writeHeader();
+    return true;
+}
+
+bool HistoryEncoder::append(uint32_t timestamp, const float *values) {
+    if (!_buffer || _rows == 0xFFFF || _bits + maxRowBits(_channels) > _capacityBits) {
+        return false;
+    }
+    if (_rows == 0) {
+        _firstTimestamp = timestamp;
+        for (size_t c = 0; c < _channels; ++c) {
+            _last[c] = floatBits(values[c]);
+            write(_last[c], 32);
+        }
+    } else {
+        // Relative to the first row, so millis() roll-over stays exact
+        writeTime((timestamp - _firstTimestamp) / _timeUnit);
+        for (size_t c = 0; c < _channels; ++c) {
+            writeValue(c, floatBits(values[c]));
+        }
+    }
+    ++_rows;
+    writeHeader();
+    return true;
+}
+
+void HistoryEncoder::write(uint32_t value, unsigned bits) {
+    // Whole chunks up to the next byte boundary, most significant first
+    while (bits > 0) {
+        const unsigned used = _bits & 7;
+        const unsigned room = 8 - used;
+        const unsigned take = bits < room ? bits : room;
+        const uint8_t chunk = static_cast<uint8_t>((value >> (bits - take)) & ((1u << take) - 1));
+        uint8_t &byte = _buffer[_bits >> 3];
+        if (used == 0) {
+            byte = 0;
+        }
+        byte |= static_cast<uint8_t>(chunk << (room - take));
+        _bits += take;
+        bits -= take;
+    }
+}
+
+void HistoryEncoder::writeTime(uint32_t time) {
+    const uint32_t delta = time - _lastTime;
+    const int32_t dod = static_cast<int32_t>(delta - _lastDelta);
+    _lastTime = time;
+    _lastDelta = delta;
+    if (dod == 0) {
+        write(0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        write(0x2, 2);
+        write(static_cast<uint32_t>(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        write(0x6, 3);
+        write(static_cast<uint32_t>(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        write(0xE, 4);
+        write(static_cast<uint32_t>(dod + 2047), 12);
+    } else {
+        write(0xF, 4);
+        write(static_cast<uint32_t>(dod), 32);
+    }
+}
+
+void HistoryEncoder::writeValue(size_t channel, uint32_t bits) {
+    const uint32_t x = bits ^ _last[channel];
+    _last[channel] = bits;
+    if (x == 0) {
+        write(0, 1);
+        return;
+    }
+    unsigned leading = static_cast<unsigned>(__builtin_clz(x));
+    const unsigned trailing = static_cast<unsigned>(__builtin_ctz(x));
+    if (leading > 31) {
+        leading = 31;
+    }
+    if (_leading[channel] != kNoWindow && leading >= _leading[channel] &&
+        trailing >= _trailing[channel]) {
+        write(0x2, 2);
+        write(x >> _trailing[channel], 32 - _leading[channel] - _trailing[channel]);
+        return;
+    }
+    const unsigned meaningful = 32 - leading - trailing;
+    write(0x3, 2);
+    write(leading, 5);
+    write(meaningful - 1, 5);
+    write(x >> trailing, meaningful);
+    _leading[channel] = static_cast<uint8_t>(leading);
+    _trailing[channel] = static_cast<uint8_t>(trailing);
+}
+
+void HistoryEncoder::writeHeader() {
+    _buffer[0] = HISTORY_BLOCK_MAGIC;
+    _buffer[1] = HISTORY_BLOCK_VERSION;
+    _buffer[2] = static_cast<uint8_t>(_channels);
+    _buffer[3] = _timeUnit;
+    put16(_buffer + 4, _rows);
+    put16(_buffer + 6, static_cast<uint16_t>(length()));
+    put32(_buffer + 8, _firstTimestamp);
+}
+
+HistoryDecoder::HistoryDecoder(const uint8_t *block, size_t length)
+    : _block(block), _valid(false), _length(0), _channels(0), _timeUnit(1), _rows(0), _row(0),
+      _bits(HISTORY_HEADER_BYTES * 8), _firstTimestamp(0), _lastTime(0), _lastDelta(0) {
+    if (!block || length < HISTORY_HEADER_BYTES || block[0] != HISTORY_BLOCK_MAGIC ||
+        block[1] != HISTORY_BLOCK_VERSION) {
+        return;
+    }
+    _channels = block[2];
+    _timeUnit = block[3];
+    _rows = get16(block + 4);
+    _length = get16(block + 6);
+    _firstTimestamp = get32(block + 8);
+    _valid = _timeUnit > 0 && _channels > 0 && _channels <= SENSOR_MAX_CHANNELS &&
+             _length >= HISTORY_HEADER_BYTES && _length <= length;
+    for (size_t c = 0; c < SENSOR_MAX_CHANNELS; ++c) {
+        _last[c] = 0;
+        _leading[c] = kNoWindow;
+        _trailing[c] = 0;
+    }
+}
+
+bool HistoryDecoder::next(uint32_t &timestamp, float *values) {
+    if (!_valid || _row == _rows) {
+        return false;
+    }
+    if (_row == 0) {
+        for (size_t c = 0; c < _channels; ++c) {
+            if (!read(32, _last[c])) {
+                return false;
+            }
+        }
+    } else {
+        if (!readTime(_lastTime)) {
+            return false;
+        }
+        for (size_t c = 0; c < _channels; ++c) {
+            if (!readValue(c, _last[c])) {
+                return false;
+            }
+        }
+    }
+    timestamp = _firstTimestamp + _lastTime * _timeUnit;
+    for (size_t c = 0; c < _channels; ++c) {
+        values[c] = bitsFloat(_last[c]);
+    }
+    ++_row;
+    return true;
+}
+
+bool HistoryDecoder::read(unsigned bits, uint32_t &value) {
+    if (_bits + bits > _length * 8) {
+        _valid = false;
+        return false;
+    }
+    value = 0;
+    while (bits > 0) {
+        const unsigned used = _bits & 7;
+        const unsigned room = 8 - used;
+        const unsigned take = bits < room ? bits : room;
+        const uint8_t byte = _block[_bits >> 3];
+        value = (value << take) | ((byte >> (room - take)) & ((1u << take) - 1));
+        _bits += take;
+        bits -= take;
+    }
+    return true;
+}
+
+bool HistoryDecoder::readTime(uint32_t &time) {
+    uint32_t prefix = 0;
+    unsigned ones = 0;
+    // Up to four prefix bits: the number of leading ones selects the bucket
+    while (ones < 4) {
+        if (!read(1, prefix)) {
+            return false;
+        }
+        if (prefix == 0) {
+            break;
+        }
+        ++ones;
+    }
+    uint32_t raw = 0;
+    int32_t dod = 0;
+    switch (ones) {
+    case 0:
+        break;
+    case 1:
+        if (!read(7, raw)) {
+            return false;
+        }
+        dod = static_cast<int32_t>(raw) - 63;
+        break;
+    case 2:
+        if (!read(9, raw)) {
+            return false;
+        }
+        dod = static_cast<int32_t>(raw) - 255;
+        break;
+    case 3:
+        if (!read(12, raw)) {
+            return false;
+        }
+        dod = static_cast<int32_t>(raw) - 2047;
+        break;
+    default:
+        if (!read(32, raw)) {
+            return false;
+        }
+        dod = static_cast<int32_t>(raw);
+        break;
+    }
+    _lastDelta += static_cast<uint32_t>(dod);
+    time += _lastDelta;
+    return true;
+}
+
+bool HistoryDecoder::readValue(size_t channel, uint32_t &bits) {
+    uint32_t control = 0;
+    if (!read(1, control)) {
+        return false;
+    }
+    if (control == 0) {
+        return true;
+    }
+    if (!read(1, control)) {
+        return false;
+    }
+    uint32_t x = 0;
+    if (control == 0) {
+        if (_leading[channel] == kNoWindow) {
+            _valid = false;
+            return false;
+        }
+        const unsigned meaningful = 32 - _leading[channel] - _trailing[channel];
+        if (!read(meaningful, x)) {
+            return false;
+        }
+        bits ^= x << _trailing[channel];
+        return true;
+    }
+    uint32_t leading = 0;
+    uint32_t meaningful = 0;
+    if (!read(5, leading) || !read(5, meaningful)) {
+        return false;
+    }
+    ++meaningful;
+    if (leading + meaningful > 32 || !read(meaningful, x)) {
+        _valid = false;
+        return false;
+    }
+    const unsigned trailing = 32 - leading - meaningful;
+    _leading[channel] = static_cast<uint8_t>(leading);
+    _trailing[channel] = static_cast<uint8_t>(trailing);
+    bits ^= x << trailing;
+    return true;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file PartitionFlash.cpp
+ * @brief Implementation of the PartitionFlash class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "storage/PartitionFlash.h"
+#include "utils/BinaryLog.h"
+
+#include <esp_partition.h>
+
+PartitionFlash::PartitionFlash(const char *label) : _label(label), _partition(nullptr) {}
+
+bool PartitionFlash::begin() {
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                          ESP_PARTITION_SUBTYPE_ANY, _label);
+    if (!_partition) {
+        LOG_ERROR("Flash partition '%s' not found", _label);
+        return false;
+    }
+    return true;
+}
+
+size_t PartitionFlash::sectorSize() const {
+    return SPI_FLASH_SEC_SIZE;
+}
+
+size_t PartitionFlash::sectorCount() const {
+    return _partition ? _partition->size / SPI_FLASH_SEC_SIZE : 0;
+}
+
+bool PartitionFlash::read(size_t offset, void *buffer, size_t length) {
+    return _partition && esp_partition_read(_partition, offset, buffer, length) == ESP_OK;
+}
+
+bool PartitionFlash::write(size_t offset, const void *buffer, size_t length) {
+    return _partition && esp_partition_write(_partition, offset, buffer, length) == ESP_OK;
+}
+
+bool PartitionFlash::eraseSector(size_t sector) {
+    return _partition &&
+           esp_partition_erase_range(_partition, sector * SPI_FLASH_SEC_SIZE,
+                                     SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
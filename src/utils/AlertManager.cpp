@@ -8,38 +8,46 @@
 #include "utils/AlertManager.h"
 
 AlertManager::AlertManager(uint8_t ledPin)
-    : _ledPin(ledPin), _state(ALERT_OK) {}
+    : _ledPin(ledPin), _engine(kAlertRules) {}
 
 void AlertManager::begin() {
     pinMode(_ledPin, OUTPUT);
     digitalWrite(_ledPin, LOW);
 }
 
-AlertState AlertManager::update(float temperature, float humidity, int light) {
-    // Determine the state based on threshold comparisons. Order of
-    // evaluation matters; more severe conditions take precedence.
-    if (!isnan(temperature) && temperature >= TEMP_HIGH_THRESHOLD) {
-        _state = ALERT_TEMP_HIGH;
-    } else if (!isnan(temperature) && temperature <= TEMP_LOW_THRESHOLD) {
-        _state = ALERT_TEMP_LOW;
-    } else if (!isnan(humidity) && humidity >= HUMID_HIGH_THRESHOLD) {
-        _state = ALERT_HUMID_HIGH;
-    } else if (!isnan(humidity) && humidity <= HUMID_LOW_THRESHOLD) {
-        _state = ALERT_HUMID_LOW;
-    } else if (light <= LIGHT_LOW_THRESHOLD) {
-        _state = ALERT_LIGHT_LOW;
-    } else {
-        _state = ALERT_OK;
+AlertState AlertManager::update(float temperature, float humidity, int light, uint32_t nowMs) {
+    const float values[3] = {temperature, humidity, static_cast<float>(light)};
+    return evaluate(values, 3, nowMs, CHANNEL_MASK_ALL);
+}
+
+AlertState AlertManager::update(const ChannelView &channels, uint32_t nowMs, ChannelMask sampled) {
+    return evaluate(channels.values, channels.count, nowMs, sampled);
+}
+
+AlertState AlertManager::evaluate(const float *values, size_t count, uint32_t nowMs,
+                                  ChannelMask sampled) {
+    // Drive LED only on a change: on while any alert is present
+    if (_engine.update(values, count, nowMs, sampled)) {
+        setLED(_engine.any());
     }
-    // Drive LED: on when an alert is present, off otherwise
-    setLED(_state != ALERT_OK);
-    return _state;
+    return getState();
 }
 
 AlertState AlertManager::getState() const {
-    return _state;
+    const int rule = _engine.first();
+    return rule < 0 ? ALERT_OK : static_cast<AlertState>(_engine.rule(rule).code);
+}
+
+int AlertManager::alertChannel() const {
+    const int rule = _engine.first();
+    return rule < 0 ? -1 : _engine.rule(rule).channel;
+}
+
+void AlertManager::restore(const Engine &saved) {
+    _engine = saved;
+    setLED(_engine.any());
 }
 
 void AlertManager::setLED(bool on) {
     digitalWrite(_ledPin, on ? HIGH : LOW);
-}
\ No newline at end of file
+}
@@ -0,0 +1,180 @@
+/**
+ * @file BinaryLog.cpp
+ * @brief Implementation of the BinaryLog class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "utils/BinaryLog.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+BinaryLog binaryLog;
+
+#if LOG_BINARY
+namespace {
+
+/** CRC-8 (polynomial 0x07) of every byte value. */
+struct Crc8Table {
+    uint8_t entries[256];
+    constexpr Crc8Table() : entries() {
+        for (int i = 0; i < 256; ++i) {
+            uint8_t crc = static_cast<uint8_t>(i);
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07)
+                                   : static_cast<uint8_t>(crc << 1);
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+constexpr Crc8Table kCrc8;
+
+/** CRC-8 over the unencoded frame. */
+uint8_t crc8(const uint8_t *data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = kCrc8.entries[crc ^ data[i]];
+    }
+    return crc;
+}
+
+} // namespace
+
+BinaryLog::BinaryLog()
+    : _levels(static_cast<uint8_t>((2u << LOG_DEFAULT_LEVEL) - 1)), _dropped(0),
+      _reportedDrops(0), _out(nullptr), _stats() {}
+
+void BinaryLog::begin(Print &out) {
+    _out = &out;
+    const uint8_t delimiter = 0;
+    _out->write(&delimiter, 1);
+#ifdef ARDUINO_ARCH_ESP32
+    xTaskCreatePinnedToCore(drainTask, "log", LOG_TASK_STACK, this, LOG_TASK_PRIORITY, nullptr,
+                            LOG_TASK_CORE);
+#endif
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+void BinaryLog::drainTask(void *arg) {
+    BinaryLog *self = static_cast<BinaryLog *>(arg);
+    for (;;) {
+        if (self->drain() == 0) {
+            vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_IDLE_MS));
+        }
+    }
+}
+#endif
+
+size_t BinaryLog::drain(size_t maxRecords) {
+    if (_out == nullptr) {
+        return 0;
+    }
+    const uint32_t depth = static_cast<uint32_t>(_ring.size());
+    if (depth > _stats.maxDepth) {
+        _stats.maxDepth = depth;
+    }
+    // Announce drops first, in order with the records that follow them
+    const uint32_t dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != _reportedDrops) {
+        LogRecord notice = {};
+        const uint32_t count = dropped - _reportedDrops;
+        notice.micros = micros();
+        notice.level = LOG_LEVEL_WARN;
+        notice.length = sizeof(count);
+        memcpy(notice.args, &count, sizeof(count));
+        if (!writeFrame(notice)) {
+            return 0;
+        }
+        _reportedDrops = dropped;
+    }
+    size_t written = 0;
+    LogRecord record;
+    while (written < maxRecords && _out->availableForWrite() >= static_cast<int>(kFrameMax) &&
+           _ring.pop(record)) {
+        writeFrame(record);
+        ++written;
+    }
+    return written;
+}
+
+void BinaryLog::flush() {
+    if (_out == nullptr) {
+        return;
+    }
+    const uint32_t start = millis();
+    while (_ring.size() > 0 && millis() - start < LOG_FLUSH_TIMEOUT) {
+#ifndef ARDUINO_ARCH_ESP32
+        // No drain task on the host: the caller is the consumer
+        drain();
+#endif
+        if (_ring.size() > 0) {
+            delay(1);
+        }
+    }
+}
+
+bool BinaryLog::writeFrame(const LogRecord &record) {
+    if (_out->availableForWrite() < static_cast<int>(kFrameMax)) {
+        return false;
+    }
+    uint8_t frame[kFrameMax];
+    const size_t length = encodeFrame(record, frame);
+    _out->write(frame, length);
+    ++_stats.records;
+    _stats.bytes += length;
+    return true;
+}
+
+size_t BinaryLog::encodeFrame(const LogRecord &record, uint8_t *out) {
+    // id, micros and level little-endian, then the arguments and a CRC
+    uint8_t raw[9 + LOG_RECORD_ARGS + 1];
+    size_t size = 0;
+    for (int i = 0; i < 4; ++i) {
+        raw[size++] = static_cast<uint8_t>(record.id >> (8 * i));
+    }
+    for (int i = 0; i < 4; ++i) {
+        raw[size++] = static_cast<uint8_t>(record.micros >> (8 * i));
+    }
+    raw[size++] = record.level;
+    const size_t argBytes = record.length <= LOG_RECORD_ARGS ? record.length : LOG_RECORD_ARGS;
+    memcpy(raw + size, record.args, argBytes);
+    size += argBytes;
+    raw[size] = crc8(raw, size);
+    ++size;
+
+    // COBS: every 0 becomes the distance to the next one, so the only 0 on
+    // the wire is the frame delimiter. Frames are shorter than 254 bytes,
+    // so no block needs splitting.
+    size_t code = 0;
+    size_t length = 1;
+    uint8_t run = 1;
+    for (size_t i = 0; i < size; ++i) {
+        if (raw[i] == 0) {
+            out[code] = run;
+            code = length++;
+            run = 1;
+        } else {
+            out[length++] = raw[i];
+            ++run;
+        }
+    }
+    out[code] = run;
+    out[length++] = 0;
+    return length;
+}
+
+LogStats BinaryLog::getStats() const {
+    LogStats stats = _stats;
+    stats.dropped = _dropped.load(std::memory_order_relaxed);
+    return stats;
+}
+#else
+BinaryLog::BinaryLog() : _levels(static_cast<uint8_t>((2u << LOG_DEFAULT_LEVEL) - 1)) {}
+
+void BinaryLog::begin(Print &out) { (void)out; }
+#endif
@@ -0,0 +1,25 @@
+/**
+ * @file HeapStats.cpp
+ * @brief Implementation of the heap telemetry helpers.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "utils/HeapStats.h"
+
+HeapStats readHeapStats() {
+    HeapStats stats;
+    stats.freeBytes = ESP.getFreeHeap();
+    stats.largestFreeBlock = ESP.getMaxAllocHeap();
+    stats.minFreeBytes = ESP.getMinFreeHeap();
+    return stats;
+}
+
+size_t formatHeapStats(const HeapStats &stats, char *out, size_t size) {
+    const int length = snprintf(out, size, "{\"heap\":%lu,\"maxblk\":%lu,\"minheap\":%lu,\"up\":%lu}",
+                                static_cast<unsigned long>(stats.freeBytes),
+                                static_cast<unsigned long>(stats.largestFreeBlock),
+                                static_cast<unsigned long>(stats.minFreeBytes),
+                                static_cast<unsigned long>(millis() / 1000));
+    return length > 0 && static_cast<size_t>(length) < size ? static_cast<size_t>(length) : 0;
+}
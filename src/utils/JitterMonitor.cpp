@@ -0,0 +1,49 @@
+/**
+ * @file JitterMonitor.cpp
+ * @brief Implementation of the JitterMonitor class.
+ */
+
+#include "utils/JitterMonitor.h"
+#include "utils/BinaryLog.h"
+
+JitterMonitor::JitterMonitor(const char *name, uint32_t periodMs)
+    : _name(name), _periodUs(periodMs * 1000UL) {
+    reset();
+}
+
+void JitterMonitor::onWake(uint32_t nowUs) {
+    _wakeUs = nowUs;
+    if (_cycles++ == 0) {
+        _expectedUs = nowUs + _periodUs;
+        return;
+    }
+    const int32_t deviation = static_cast<int32_t>(nowUs - _expectedUs);
+    const uint32_t jitter = static_cast<uint32_t>(deviation < 0 ? -deviation : deviation);
+    if (jitter > _maxJitterUs) {
+        _maxJitterUs = jitter;
+    }
+    // A missed period re-anchors the schedule instead of reporting the same
+    // lateness on every later cycle
+    _expectedUs = (jitter >= _periodUs) ? nowUs + _periodUs : _expectedUs + _periodUs;
+}
+
+void JitterMonitor::onDone(uint32_t nowUs) {
+    const uint32_t run = nowUs - _wakeUs;
+    if (run > _maxRunUs) {
+        _maxRunUs = run;
+    }
+}
+
+void JitterMonitor::report() const {
+    LOG_INFO("[jitter] %-8s cycles=%lu max_jitter=%lu us max_run=%lu us", _name,
+             static_cast<unsigned long>(_cycles), static_cast<unsigned long>(_maxJitterUs),
+             static_cast<unsigned long>(_maxRunUs));
+}
+
+void JitterMonitor::reset() {
+    _expectedUs = 0;
+    _wakeUs = 0;
+    _cycles = 0;
+    _maxJitterUs = 0;
+    _maxRunUs = 0;
+}
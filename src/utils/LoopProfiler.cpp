@@ -0,0 +1,80 @@
+/**
+ * @file LoopProfiler.cpp
+ * @brief Implementation of the LoopProfiler class.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "utils/LoopProfiler.h"
+#include "utils/BinaryLog.h"
+
+#include <stdio.h>
+
+namespace {
+
+const char *const kStageNames[PROFILE_STAGES] = {
+    "loop", "wifi", "metrics", "sensors", "filter",
+    "alerts", "history", "display", "upload", "replay",
+};
+
+} // namespace
+
+LoopProfiler::LoopProfiler() : _loopStart(0), _mark(0), _periodStart(0) { _payload[0] = '\0'; }
+
+const char *LoopProfiler::stageName(ProfileStage stage) {
+    return stage < PROFILE_STAGES ? kStageNames[stage] : "?";
+}
+
+size_t LoopProfiler::closePeriod(uint32_t nowMs) {
+#if DEBUG_ENABLED
+    const float mhz = static_cast<float>(ESP.getCpuFreqMHz());
+    LOG_INFO("Loop profile, last %lu s (us): count min p50 p99 max",
+             static_cast<unsigned long>((nowMs - _periodStart) / 1000));
+    for (size_t s = 0; s < PROFILE_STAGES; ++s) {
+        const CycleHistogram &h = _histograms[s];
+        if (h.count() == 0) {
+            continue;
+        }
+        LOG_INFO("  %-8s %6lu %9.1f %9.1f %9.1f %9.1f", kStageNames[s],
+                 static_cast<unsigned long>(h.count()), h.min() / mhz, h.percentile(500) / mhz,
+                 h.percentile(990) / mhz, h.max() / mhz);
+    }
+#endif
+
+    const size_t length = format(nowMs, _payload, sizeof(_payload));
+    if (length == 0) {
+        _payload[0] = '\0';
+    }
+    for (CycleHistogram &h : _histograms) {
+        h.reset();
+    }
+    _periodStart = nowMs;
+    return length;
+}
+
+size_t LoopProfiler::format(uint32_t nowMs, char *out, size_t size) const {
+    int n = snprintf(out, size, "{\"period_ms\":%lu,\"cpu_mhz\":%lu,\"stages\":{",
+                     static_cast<unsigned long>(nowMs - _periodStart),
+                     static_cast<unsigned long>(ESP.getCpuFreqMHz()));
+    size_t length = n > 0 ? static_cast<size_t>(n) : size;
+    bool first = true;
+    for (size_t s = 0; s < PROFILE_STAGES && length < size; ++s) {
+        const CycleHistogram &h = _histograms[s];
+        if (h.count() == 0) {
+            continue;
+        }
+        n = snprintf(out + length, size - length, "%s\"%s\":[%lu,%lu,%lu,%lu,%lu]",
+                     first ? "" : ",", kStageNames[s], static_cast<unsigned long>(h.count()),
+                     static_cast<unsigned long>(h.min()),
+                     static_cast<unsigned long>(h.percentile(500)),
+                     static_cast<unsigned long>(h.percentile(990)),
+                     static_cast<unsigned long>(h.max()));
+        length += n > 0 ? static_cast<size_t>(n) : size;
+        first = false;
+    }
+    if (length < size) {
+        n = snprintf(out + length, size - length, "}}");
+        length += n > 0 ? static_cast<size_t>(n) : size;
+    }
+    return length < size ? length : 0;
+}
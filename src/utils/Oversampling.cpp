@@ -0,0 +1,97 @@
+/**
+ * @file Oversampling.cpp
+ * @brief Implementation of the ADC decimation kernel.
+ */
+
+#include "config.h"
+#include "secret.h"
+#include "utils/Oversampling.h"
+
+namespace {
+
+const uint16_t kSampleMask = 0x0FFF;
+
+} // namespace
+
+OversampledWindow oversampleWindow(const uint16_t *samples, size_t count, unsigned decimation,
+                                   uint32_t *blocks, uint32_t sampleRateHz,
+                                   float minFlickerPercent) {
+    OversampledWindow window = {0, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    const size_t blockCount = decimation >= 4 ? count / decimation : 0;
+    if (blockCount == 0) {
+        return window;
+    }
+
+    // Pass 1: decimate. Four accumulators break the add dependency chain.
+    uint64_t total = 0;
+    uint32_t lo = UINT32_MAX;
+    uint32_t hi = 0;
+    const uint16_t *p = samples;
+    for (size_t b = 0; b < blockCount; ++b, p += decimation) {
+        uint32_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+        for (unsigned i = 0; i < decimation; i += 4) {
+            a0 += p[i] & kSampleMask;
+            a1 += p[i + 1] & kSampleMask;
+            a2 += p[i + 2] & kSampleMask;
+            a3 += p[i + 3] & kSampleMask;
+        }
+        const uint32_t sum = a0 + a1 + a2 + a3;
+        blocks[b] = sum;
+        total += sum;
+        lo = sum < lo ? sum : lo;
+        hi = sum > hi ? sum : hi;
+    }
+
+    const float scale = 1.0f / static_cast<float>(decimation);
+    window.conversions = static_cast<uint32_t>(blockCount * decimation);
+    window.mean = static_cast<float>(total) / static_cast<float>(window.conversions);
+    window.min = lo * scale;
+    window.max = hi * scale;
+    if (hi + lo > 0) {
+        window.flickerPercent = 100.0f * static_cast<float>(hi - lo) / static_cast<float>(hi + lo);
+    }
+    if (window.flickerPercent < minFlickerPercent) {
+        // Steady light: the swing is noise and crossings would be meaningless
+        return window;
+    }
+
+    // Pass 2: find crossings of the mean with a quarter of the swing as
+    // hysteresis, so residual noise does not add crossings
+    const float meanSum = window.mean * decimation;
+    const float hysteresis = (hi - lo) / 4.0f;
+    const float upper = meanSum + hysteresis;
+    const float lower = meanSum - hysteresis;
+    int state = 0;  // -1 below, +1 above, 0 not yet known
+    uint32_t crossings = 0;
+    uint32_t wholeCrossings = 0;
+    size_t first = 0;
+    size_t lastWhole = 0;  // A crossing a whole number of periods after the first
+    for (size_t b = 0; b < blockCount; ++b) {
+        const float v = static_cast<float>(blocks[b]);
+        const int next = v > upper ? 1 : v < lower ? -1 : state;
+        if (state != 0 && next != state) {
+            if (crossings == 0) {
+                first = b;
+            }
+            if (crossings % 2 == 0) {
+                lastWhole = b;
+                wholeCrossings = crossings;
+            }
+            ++crossings;
+        }
+        state = next;
+    }
+    if (wholeCrossings >= 2) {
+        // Two crossings per period. The mean over whole periods only is
+        // free of the bias a partial period adds.
+        const size_t span = lastWhole - first;
+        window.flickerHz = wholeCrossings / 2.0f /
+                           (static_cast<float>(span * decimation) / sampleRateHz);
+        uint64_t periodTotal = 0;
+        for (size_t b = first; b < lastWhole; ++b) {
+            periodTotal += blocks[b];
+        }
+        window.mean = static_cast<float>(periodTotal) / static_cast<float>(span * decimation);
+    }
+    return window;
+}
@@ -0,0 +1,295 @@
+#!/usr/bin/env python3
+"""Decode the binary log stream written by BinaryLog (include/utils/BinaryLog.h).
+
+The firmware sends each LOG_* call as a COBS frame ending in a 0 byte:
+
+    id (u32 LE) | micros (u32 LE) | level (u8) | arguments | CRC-8
+
+id is the 32-bit FNV-1a hash of the format string. This tool finds the
+format strings of all LOG_* calls in the sources, hashes them the same
+way and prints the records as text. Arguments are read back by the
+conversions in the format: integers are 4 bytes (8 with ll), floating
+point values a float, strings a length byte followed by the characters.
+
+Usage:
+    tools/logdecode.py capture.bin
+    tools/logdecode.py /dev/ttyUSB0 --baud 115200   (needs pyserial)
+    pio device monitor --raw | tools/logdecode.py -
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+LEVELS = ["ERROR", "WARN", "INFO", "DEBUG"]
+TRUNCATED = 0x80
+DROP_NOTICE_ID = 0
+
+LOG_CALL = re.compile(r"\bLOG_(?:ERROR|WARN|INFO|DEBUG)\s*\(")
+STRING_DEFINE = re.compile(r'^\s*#\s*define\s+(\w+)\s+("(?:[^"\\]|\\.)*")', re.M)
+CONVERSION = re.compile(
+    r"%(?P<flags>[-+ #0]*)(?P<width>\d+|\*)?(?:\.(?P<precision>\d+|\*))?"
+    r"(?P<length>hh|h|ll|l|z|j|t|L)?(?P<conv>[diouxXcsfFeEgGp%])"
+)
+SIMPLE_ESCAPES = {"n": "\n", "t": "\t", "r": "\r", "\\": "\\", '"': '"', "'": "'",
+                  "a": "\a", "b": "\b", "f": "\f", "v": "\v", "?": "?"}
+
+
+def fnv1a(data):
+    h = 2166136261
+    for byte in data:
+        h = ((h ^ byte) * 16777619) & 0xFFFFFFFF
+    return h or 1
+
+
+def unescape(body):
+    out = []
+    i = 0
+    while i < len(body):
+        c = body[i]
+        if c != "\\":
+            out.append(c)
+            i += 1
+            continue
+        nxt = body[i + 1]
+        if nxt in SIMPLE_ESCAPES:
+            out.append(SIMPLE_ESCAPES[nxt])
+            i += 2
+        elif nxt == "x":
+            m = re.match(r"[0-9a-fA-F]+", body[i + 2:])
+            out.append(chr(int(m.group(0), 16)))
+            i += 2 + len(m.group(0))
+        else:
+            m = re.match(r"[0-7]{1,3}", body[i + 1:])
+            out.append(chr(int(m.group(0), 8)))
+            i += 1 + len(m.group(0))
+    return "".join(out)
+
+
+def read_literals(text, pos, macros):
+    """Concatenate the string literals (and string macros) starting at pos."""
+    parts = []
+    token = re.compile(r'\s*(?:"((?:[^"\\]|\\.)*)"|(\w+))')
+    while True:
+        m = token.match(text, pos)
+        if not m:
+            break
+        if m.group(1) is not None:
+            parts.append(unescape(m.group(1)))
+        elif m.group(2) in macros:
+            parts.append(macros[m.group(2)])
+        else:
+            break
+        pos = m.end()
+    return "".join(parts) if parts else None
+
+
+def scan_sources(roots):
+    """Map format ids to format strings for every LOG_* call under roots."""
+    files = []
+    for root in roots:
+        for dirpath, _, names in os.walk(root):
+            files += [os.path.join(dirpath, n) for n in names
+                      if n.endswith((".h", ".hpp", ".c", ".cpp", ".ino"))]
+    texts = {}
+    macros = {}
+    for path in files:
+        with open(path, encoding="utf-8", errors="replace") as f:
+            texts[path] = f.read()
+        for name, literal in STRING_DEFINE.findall(texts[path]):
+            macros.setdefault(name, unescape(literal[1:-1]))
+    formats = {}
+    for path, text in texts.items():
+        for m in LOG_CALL.finditer(text):
+            line_start = text.rfind("\n", 0, m.start()) + 1
+            if text[line_start:m.start()].lstrip().startswith(("*", "//")):
+                continue  # mentioned in a comment
+            fmt = read_literals(text, m.end(), macros)
+            if fmt is None:
+                continue
+            fid = fnv1a(fmt.encode("utf-8"))
+            if fid in formats and formats[fid][0] != fmt:
+                print("warning: format id 0x%08x collides: %r and %r"
+                      % (fid, formats[fid][0], fmt), file=sys.stderr)
+            line = text.count("\n", 0, m.start()) + 1
+            formats.setdefault(fid, (fmt, "%s:%d" % (os.path.relpath(path), line)))
+    return formats
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def render(fmt, args, truncated):
+    """printf fmt with arguments decoded from args."""
+    out = []
+    pos = 0
+    offset = 0
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        conv = m.group("conv")
+        if conv == "%":
+            out.append("%")
+            continue
+        spec = "%" + m.group("flags") + (m.group("width") or "")
+        if m.group("precision") is not None:
+            spec += "." + m.group("precision")
+        try:
+            if conv == "s":
+                size = args[offset]
+                if offset + 1 + size > len(args):
+                    raise IndexError
+                value = args[offset + 1:offset + 1 + size].decode("utf-8", "replace")
+                offset += 1 + size
+                out.append((spec + "s") % value)
+            elif conv in "fFeEgG":
+                (value,) = struct.unpack_from("<f", args, offset)
+                offset += 4
+                out.append((spec + conv) % value)
+            else:
+                size = 8 if m.group("length") == "ll" else 4
+                signed = conv in "di"
+                if offset + size > len(args):
+                    raise IndexError
+                value = int.from_bytes(args[offset:offset + size], "little", signed=signed)
+                offset += size
+                if conv == "c":
+                    out.append((spec + "c") % chr(value & 0xFF))
+                elif conv == "p":
+                    out.append("0x%08x" % (value & 0xFFFFFFFF))
+                else:
+                    out.append((spec + ("d" if conv in "diu" else conv)) % value)
+        except (IndexError, struct.error):
+            out.append("?" if truncated else "<missing>")
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+class Decoder:
+    def __init__(self, formats, out):
+        self.formats = formats
+        self.out = out
+        self.buffer = bytearray()
+        self.last_micros = None
+        self.epoch = 0
+        self.records = 0
+        self.bad = 0
+
+    def feed(self, data):
+        self.buffer += data
+        while True:
+            end = self.buffer.find(b"\x00")
+            if end < 0:
+                return
+            chunk = bytes(self.buffer[:end])
+            del self.buffer[:end + 1]
+            if chunk:
+                self.frame(chunk)
+
+    def frame(self, chunk):
+        raw = cobs_decode(chunk)
+        if raw is None or len(raw) < 10 or crc8(raw[:-1]) != raw[-1]:
+            text = chunk.decode("ascii", "replace")
+            if all(c.isprintable() or c in "\r\n\t" for c in text):
+                # Plain text on the same port, e.g. the ROM boot messages
+                self.out.write(text)
+            else:
+                self.bad += 1
+            return
+        fid, micros, level = struct.unpack_from("<IIB", raw)
+        args = raw[9:-1]
+        # Records from different tasks may be a little out of order; only a
+        # large step back is the 71-minute wrap of micros()
+        if self.last_micros is not None and self.last_micros - micros > 1 << 31:
+            self.epoch += 1 << 32
+        self.last_micros = micros
+        seconds = (self.epoch + micros) / 1e6
+        truncated = bool(level & TRUNCATED)
+        name = LEVELS[level & 0x7F] if (level & 0x7F) < len(LEVELS) else "L%d" % level
+        if fid == DROP_NOTICE_ID:
+            (count,) = struct.unpack_from("<I", args)
+            message = "*** %d log records dropped (ring full)" % count
+        elif fid in self.formats:
+            message = render(self.formats[fid][0], args, truncated)
+            if truncated:
+                message += " [truncated]"
+        else:
+            message = "<unknown format 0x%08x: %s>" % (fid, args.hex())
+        self.records += 1
+        self.out.write("%12.6f %-5s %s\n" % (seconds, name, message.rstrip("\n")))
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith(("/dev/", "COM")):
+        import serial  # pyserial
+
+        return serial.Serial(path, baud, timeout=0.2)
+    return open(path, "rb")
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    repo = os.path.dirname(here)
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", nargs="?", help="capture file, serial port, or - for stdin")
+    parser.add_argument("--src", action="append",
+                        help="source directory to scan for LOG_* calls (repeatable)")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--list", action="store_true", help="print the format table and exit")
+    options = parser.parse_args()
+
+    roots = options.src or [os.path.join(repo, "src"), os.path.join(repo, "include")]
+    formats = scan_sources(roots)
+    if options.list:
+        for fid, (fmt, where) in sorted(formats.items(), key=lambda item: item[1][1]):
+            print("0x%08x  %-32s %r" % (fid, where, fmt))
+        return 0
+    if options.input is None:
+        parser.error("input is required")
+
+    decoder = Decoder(formats, sys.stdout)
+    stream = open_input(options.input, options.baud)
+    is_port = hasattr(stream, "in_waiting")
+    read = stream.read1 if hasattr(stream, "read1") else stream.read
+    try:
+        while True:
+            data = read(4096)
+            if not data:
+                if is_port:
+                    continue  # read timeout, keep listening
+                break
+            decoder.feed(data)
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    if decoder.bad:
+        print("%d corrupt frames skipped" % decoder.bad, file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())